@@ -0,0 +1,205 @@
+#pragma once
+
+#include "VkDescriptorBuffer.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/vec4.hpp>
+
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+using BindlessIndex = uint32_t;
+
+const BindlessIndex BINDLESS_NONE = UINT32_MAX;
+
+enum BindlessBackend
+{
+  BINDLESS_BACKEND_DESCRIPTOR_SET,   // an update-after-bind descriptor set
+  BINDLESS_BACKEND_DESCRIPTOR_BUFFER // descriptors written into a buffer (VK_EXT_descriptor_buffer)
+};
+
+/**
+ * Bindings of the heap set, see Bindless.glsl
+ */
+enum BindlessBinding : uint32_t
+{
+  BINDLESS_BINDING_TEXTURES = 0, // texture2D[]
+  BINDLESS_BINDING_SAMPLERS = 1, // sampler[]
+  BINDLESS_BINDING_BUFFERS = 2   // storage buffers
+};
+
+/**
+ * Push constants of the heap's pipeline layout. A draw selects everything it
+ * reads through these indices; buffers are heap buffer indices.
+ */
+struct BindlessDrawConstants
+{
+  BindlessIndex materials = BINDLESS_NONE; // buffer of BindlessMaterial
+  uint32_t material = 0;
+  BindlessIndex objects = BINDLESS_NONE;   // buffer of per-object data, the shader's own layout
+  uint32_t object = 0;
+};
+
+/**
+ * One material as read by Bindless.glsl (std430)
+ */
+struct BindlessMaterial
+{
+  BindlessIndex albedo = BINDLESS_NONE;
+  BindlessIndex sampler = 0;
+  uint32_t padding[2] = {};
+  glm::vec4 base_color = glm::vec4(1.0f);
+};
+
+static_assert(sizeof(BindlessMaterial) == 32, "BindlessMaterial must match the std430 layout of Bindless.glsl");
+
+struct BindlessLimits
+{
+  uint32_t max_textures = 16384; // clamped to the device's update-after-bind limits
+  uint32_t max_samplers = 64;
+  uint32_t max_buffers = 4096;
+};
+
+struct BindlessStats
+{
+  uint32_t textures = 0;
+  uint32_t samplers = 0;
+  uint32_t buffers = 0;
+  uint32_t writes = 0; // descriptors written by the last flush
+};
+
+/**
+ * True if the device has VK_EXT_descriptor_indexing with the features of
+ * bindlessFeatures(). Enable both at device creation.
+ */
+bool isBindlessSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+/**
+ * The descriptor indexing features the heap needs, to chain into VkDeviceCreateInfo
+ */
+VkPhysicalDeviceDescriptorIndexingFeatures bindlessFeatures();
+
+/**
+ * True if the device is Vulkan 1.2 with bufferDeviceAddress and has
+ * VK_EXT_descriptor_buffer with descriptorBuffer, for
+ * BINDLESS_BACKEND_DESCRIPTOR_BUFFER. Enable them along with bindlessFeatures().
+ */
+bool isDescriptorBufferSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+/**
+ * One global, partially bound, update-after-bind descriptor set holding every
+ * sampled image, sampler and storage buffer the renderer uses.
+ *
+ * Resources get stable indices when added; shaders index the heap's arrays
+ * with them (non-uniformly where they vary within a draw) and draws pass their
+ * material and object indices as push constants. Every pipeline built on
+ * pipelineLayout() is layout compatible, so the set is bound once per command
+ * buffer and stays bound across pipeline changes.
+ *
+ * Descriptors are written in batches by flush() and may be written after the
+ * set is bound, before the commands using them are submitted. A removed index
+ * keeps its descriptor until frames_in_flight beginFrame() calls later, since
+ * frames still in flight may read it, and is reused after that.
+ *
+ * The backend is chosen at init. BINDLESS_BACKEND_DESCRIPTOR_BUFFER keeps the
+ * set in a host visible buffer instead of a pool: flush() writes descriptors
+ * into it with vkGetDescriptorEXT and bind() binds its address, with no set
+ * object in between. Its pipelines need pipelineCreateFlags(), and the
+ * buffers it is given need SHADER_DEVICE_ADDRESS usage and an explicit range.
+ */
+class BindlessHeap
+{
+public:
+  void init(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, uint32_t frames_in_flight, BindlessBackend backend = BINDLESS_BACKEND_DESCRIPTOR_SET,
+    const BindlessLimits &limits = {}, uint32_t push_constant_size = sizeof(BindlessDrawConstants));
+  void cleanup();
+
+  /**
+   * Call once per frame after waiting on its fence: recycles indices removed
+   * frames_in_flight frames ago and flushes pending writes
+   */
+  void beginFrame();
+
+  BindlessIndex addTexture(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  BindlessIndex addSampler(VkSampler sampler);
+  BindlessIndex addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+  void removeTexture(BindlessIndex index) { release(BINDLESS_BINDING_TEXTURES, index); }
+  void removeSampler(BindlessIndex index) { release(BINDLESS_BINDING_SAMPLERS, index); }
+  void removeBuffer(BindlessIndex index) { release(BINDLESS_BINDING_BUFFERS, index); }
+
+  /**
+   * Writes the descriptors added since the last flush. Call before submitting
+   * commands that use them.
+   */
+  void flush();
+
+  /**
+   * Binds the heap at set 0. Once per command buffer and bind point.
+   */
+  void bind(VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point) const;
+
+  void pushConstants(VkCommandBuffer command_buffer, const BindlessDrawConstants &constants) const;
+
+  VkDescriptorSetLayout setLayout() const { return set_layout; }
+  VkPipelineLayout pipelineLayout() const { return pipeline_layout; } // the heap at set 0, push constants for every stage
+  VkDescriptorSet set() const { return descriptor_set; } // null on the descriptor buffer backend
+  BindlessBackend backend() const { return heap_backend; }
+  VkPipelineCreateFlags pipelineCreateFlags() const; // for every pipeline on pipelineLayout()
+  BindlessStats stats() const;
+
+private:
+  struct IndexAllocator
+  {
+    uint32_t capacity = 0;
+    uint32_t next = 0;
+    std::vector<BindlessIndex> free;
+    std::vector<std::pair<BindlessIndex, uint64_t>> retired; // index, frame it was removed in
+    uint32_t live = 0;
+  };
+
+  struct PendingWrite
+  {
+    BindlessBinding binding;
+    BindlessIndex index;
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+  };
+
+  void createDescriptorSet(const VkDescriptorSetLayoutBinding *bindings);
+  void createDescriptorBuffer(VkInstance instance, VkPhysicalDevice physical_device, const VkDescriptorSetLayoutBinding *bindings);
+  void writeDescriptor(const PendingWrite &pending);
+
+  IndexAllocator &indexAllocator(BindlessBinding binding);
+  BindlessIndex acquire(BindlessBinding binding);
+  void release(BindlessBinding binding, BindlessIndex index);
+  void recycle(IndexAllocator &indices);
+
+  VkDevice device = VK_NULL_HANDLE;
+  BindlessBackend heap_backend = BINDLESS_BACKEND_DESCRIPTOR_SET;
+  uint32_t frames_in_flight = 1;
+  uint64_t frame = 0;
+  uint32_t push_constant_size = 0;
+
+  IndexAllocator textures;
+  IndexAllocator samplers;
+  IndexAllocator buffers;
+  std::vector<PendingWrite> pending_writes;
+  uint32_t last_writes = 0;
+
+  VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+
+  // Descriptor buffer backend
+  Buffer descriptor_buffer;
+  VkDeviceAddress descriptor_buffer_address = 0;
+  VkDeviceSize binding_offsets[3] = {};
+  size_t descriptor_sizes[3] = {};
+  PFN_vkGetDescriptorEXT get_descriptor = nullptr;
+  PFN_vkCmdBindDescriptorBuffersEXT bind_descriptor_buffers = nullptr;
+  PFN_vkCmdSetDescriptorBufferOffsetsEXT set_descriptor_buffer_offsets = nullptr;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ImageFile.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Texel encodings a texture file can hold. BCn and ASTC use 4x4 blocks.
+ */
+enum TextureFormat : uint32_t
+{
+  TEXTURE_FORMAT_RGBA8 = 0,
+  TEXTURE_FORMAT_BC1 = 1,     // RGB, 8 bytes per block
+  TEXTURE_FORMAT_BC3 = 2,     // RGBA (BC4 alpha + BC1 color), 16 bytes
+  TEXTURE_FORMAT_BC4 = 3,     // R, 8 bytes
+  TEXTURE_FORMAT_BC5 = 4,     // RG (two BC4 blocks), 16 bytes, for normal maps
+  TEXTURE_FORMAT_BC7 = 5,     // RGBA, 16 bytes
+  TEXTURE_FORMAT_ASTC_4x4 = 6 // RGBA LDR, 16 bytes; stored only, no CPU codec
+};
+
+struct TextureFormatInfo
+{
+  uint32_t block_extent; // texels per block side, 1 for uncompressed
+  uint32_t block_size;   // bytes per block
+};
+
+TextureFormatInfo textureFormatInfo(TextureFormat format);
+
+const char *textureFormatName(TextureFormat format);
+
+/**
+ * Bytes of one level of width x height texels
+ */
+size_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+
+/**
+ * Whether compressImage/decompressImage handle the format
+ */
+bool hasBlockCodec(TextureFormat format);
+
+/**
+ * False for BC4 and BC5: their channels are data, there is no sRGB variant
+ */
+bool hasSrgbVariant(TextureFormat format);
+
+/**
+ * Whether decompressImage decodes every block of `size` bytes of level data.
+ * Always true for formats with a codec, except BC7 with blocks in modes other than 6.
+ */
+bool canDecompress(const uint8_t *data, size_t size, TextureFormat format);
+
+/**
+ * Encodes an RGBA8 image, blocks row by row; partial edge blocks repeat the
+ * last row and column. The BC7 encoder only emits mode 6 (one subset, RGBA
+ * endpoints with 4-bit indices), which is quick and good on smooth content.
+ */
+std::vector<uint8_t> compressImage(const ImageData &image, TextureFormat format);
+
+/**
+ * Decodes blocks to RGBA8, for devices that cannot sample the format.
+ * BC4 and BC5 come out the way they sample: missing channels 0, alpha 255.
+ * The BC7 decoder covers mode 6 only, which is what compressImage writes.
+ */
+ImageData decompressImage(const uint8_t *data, uint32_t width, uint32_t height, TextureFormat format);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "VertexQuantization.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Streaming cluster pages (.vpages)
+  - A fixed header, the cell table, the cell level table and the page table,
+    followed by the pages themselves.
+  - The mesh is split into spatial cells. Every level of detail of a cell is
+    stored in one or more pages, so a cell is refined by streaming in the pages
+    of a finer level while the coarser level keeps being drawn.
+  - Every page is CLUSTER_PAGE_SIZE bytes on a CLUSTER_PAGE_SIZE boundary so it
+    is read with one aligned request and uploaded with one copy. A page holds
+    its own vertices first, then 16-bit page-local indices.
+*/
+const uint32_t CLUSTER_PAGES_MAGIC = 0x53475056; // "VPGS"
+const uint32_t CLUSTER_PAGES_VERSION = 1;
+const uint32_t CLUSTER_PAGE_SIZE = 64 * 1024;
+
+struct ClusterPagesHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertex_encoding; // VertexEncoding
+  uint32_t lod_count;
+  uint32_t cell_count;
+  uint32_t page_count;
+  uint64_t page_data_offset; // first page, from the start of the file
+  QuantizationParams quantization;
+};
+
+/**
+ * Bounding sphere of a cell over all of its levels
+ */
+struct ClusterCell
+{
+  float center[3];
+  float radius;
+};
+
+/**
+ * One level of a cell, lod_count per cell, cell-major, level 0 first.
+ * `error` is the simplification error in mesh units, as in MeshLod.
+ */
+struct ClusterCellLod
+{
+  uint32_t first_page;
+  uint32_t page_count;
+  uint32_t triangle_count;
+  float error;
+};
+
+/**
+ * Vertices start at byte 0 of the page, indices at index_offset.
+ * `size` is the number of bytes in use, the rest of the page is padding.
+ */
+struct ClusterPageInfo
+{
+  uint32_t cell;
+  uint32_t lod;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t index_offset;
+  uint32_t size;
+};
+
+static_assert(sizeof(ClusterPagesHeader) == 64, "ClusterPagesHeader layout changed");
+static_assert(sizeof(ClusterCell) == 16, "ClusterCell layout changed");
+static_assert(sizeof(ClusterCellLod) == 16, "ClusterCellLod layout changed");
+static_assert(sizeof(ClusterPageInfo) == 24, "ClusterPageInfo layout changed");
+
+struct ClusterPagesReport
+{
+  uint32_t cell_count = 0;
+  uint32_t page_count = 0;
+  float page_fill = 0.0f;          // average fraction of a page in use
+  float vertex_duplication = 0.0f; // page vertices per source vertex of level 0
+};
+
+/**
+ * Writes every level of the mesh (see generateLods) as cluster pages.
+ * Cells are a uniform grid over the mesh bounds sized for about
+ * cell_triangles level 0 triangles each; triangles keep their index order.
+ * If `quantized` is given its vertices are stored instead of mesh.vertices.
+ */
+ClusterPagesReport writeClusterPages(const std::string &file_name, const MeshData &mesh, const QuantizedMesh *quantized = nullptr, uint32_t cell_triangles = 16384);
+
+/**
+ * A mapped .vpages file. Tables and pages point into the mapping, so reading
+ * a page on a worker thread is what pulls it in from disk.
+ */
+class ClusterPageFile
+{
+public:
+  explicit ClusterPageFile(const std::string &file_name);
+
+  const ClusterPagesHeader &header() const;
+  VertexEncoding vertexEncoding() const { return static_cast<VertexEncoding>(header().vertex_encoding); }
+  uint32_t vertexStride() const;
+
+  uint32_t cellCount() const { return header().cell_count; }
+  uint32_t lodCount() const { return header().lod_count; }
+  uint32_t pageCount() const { return header().page_count; }
+
+  const ClusterCell *cells() const { return cell_table; }
+  const ClusterCellLod &cellLod(uint32_t cell, uint32_t lod) const { return cell_lods[cell * lodCount() + lod]; }
+  const ClusterPageInfo *pages() const { return page_table; }
+  const uint8_t *pageData(uint32_t page) const;
+
+private:
+  MappedFile file;
+  const ClusterCell *cell_table = nullptr;
+  const ClusterCellLod *cell_lods = nullptr;
+  const ClusterPageInfo *page_table = nullptr;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ClusterPages.hpp"
+#include "FrustumCulling.hpp"
+#include "JobSystem.hpp"
+#include "LodSelector.hpp"
+#include "StagingUploader.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ClusterStreamingStats
+{
+  uint32_t resident_pages = 0;
+  uint32_t pinned_pages = 0;
+  uint32_t pending_reads = 0;
+  uint32_t loaded = 0;  // uploaded this update
+  uint32_t evicted = 0; // this update
+  uint32_t dropped = 0; // reads finished with no slot left to evict, this update
+  uint32_t cells_drawn = 0;
+  uint32_t cells_refining = 0; // drawn coarser than selected
+  uint64_t triangles_drawn = 0;
+  VkDeviceSize resident_bytes = 0;
+  VkDeviceSize budget_bytes = 0;
+};
+
+/**
+ * Keeps the cluster pages the camera needs resident in a fixed pool of GPU
+ * page slots, for meshes far larger than device memory.
+ *
+ * Every update picks a level per visible cell by screen-space error (see
+ * LodSelector) and draws the finest resident level at or above it; the
+ * coarsest level is pinned at init so every cell can always be drawn.
+ * Missing pages are read from the mapped file on the job system, most
+ * refinement-starved and nearest first, and uploaded through the staging
+ * uploader on the next update. When the budget is used up the least recently
+ * drawn page is evicted, but only once it has not been drawn for
+ * frames_in_flight updates, so in-flight frames never see it overwritten.
+ *
+ * The pool is one buffer bound as both vertex and 16-bit index buffer.
+ * Build the pipeline with vertexInputLayout(encoding()) and, for quantized
+ * pages, pass quantization() to Quantized.vert.
+ */
+class ClusterStreamer
+{
+public:
+  float max_pixel_error = 1.0f;
+  uint32_t max_pending_reads = 16;
+
+  /**
+   * memory_budget: bytes of device memory for page slots, at least enough for the coarsest level
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, const std::string &file_name, VkDeviceSize memory_budget, uint32_t frames_in_flight);
+  void cleanup();
+
+  /**
+   * Call once per frame after waiting on the frame's fence, before recording draw().
+   * Uploads the reads that finished since the last update and flushes the uploader.
+   */
+  void update(const glm::mat4 &view, const glm::mat4 &proj, float viewport_height);
+
+  void draw(VkCommandBuffer command_buffer) const;
+
+  VertexEncoding encoding() const { return pages->vertexEncoding(); }
+  QuantizationParams quantization() const { return pages->header().quantization; }
+  const ClusterStreamingStats &stats() const { return frame_stats; }
+
+private:
+  static const int32_t NO_SLOT = -1;
+
+  struct PageState
+  {
+    int32_t slot = NO_SLOT;
+    bool pinned = false;
+    bool requested = false;
+    uint64_t last_used = 0;
+    std::list<uint32_t>::iterator lru; // valid while resident and not pinned
+  };
+
+  struct PageRead
+  {
+    uint32_t page;
+    std::vector<uint8_t> data;
+  };
+
+  struct LevelRequest
+  {
+    uint32_t cell;
+    uint32_t lod;
+    uint32_t deficit; // levels between the drawn and the selected one
+    float distance;
+  };
+
+  bool isLevelResident(uint32_t cell, uint32_t lod) const;
+  void touchLevel(uint32_t cell, uint32_t lod);
+  bool isEvictable(uint32_t page) const;
+  uint32_t availableSlots() const;
+  int32_t allocateSlot();
+  void uploadPage(uint32_t page, int32_t slot, const uint8_t *data);
+  void receiveReads();
+  void requestPages();
+
+  VkDevice device = VK_NULL_HANDLE;
+  StagingUploader *uploader = nullptr;
+  JobSystem *jobs = nullptr;
+  std::unique_ptr<ClusterPageFile> pages;
+
+  Buffer pool;
+  VkDeviceSize slot_size = 0;
+  uint32_t vertex_stride = 0;
+  std::vector<int32_t> free_slots;
+  uint32_t frames_in_flight = 1;
+  uint64_t frame = 0;
+
+  std::vector<PageState> page_states;
+  std::list<uint32_t> lru_pages; // front = most recently used
+  std::vector<LevelRequest> requests;
+  uint32_t pending_reads = 0; // submitted, not yet received
+
+  // Filled by the read jobs
+  std::mutex read_mutex;
+  std::vector<PageRead> finished_reads;
+
+  CullingBounds cell_bounds;
+  std::vector<uint32_t> visible_cells;
+  std::vector<LodChain> cell_chains;
+  LodSelector selector;
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  ClusterStreamingStats frame_stats;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+/**
+ * One descriptor of a set: a buffer range, or an image view and/or sampler.
+ * Fields the type does not use stay null, so equal descriptors compare equal.
+ */
+struct DescriptorWrite
+{
+  uint32_t binding = 0;
+  uint32_t array_element = 0;
+  VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize range = 0;
+  VkSampler sampler = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  bool operator==(const DescriptorWrite &other) const;
+};
+
+DescriptorWrite bufferDescriptor(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+DescriptorWrite imageDescriptor(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler = VK_NULL_HANDLE,
+  VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+/**
+ * `write` as a VkWriteDescriptorSet of one descriptor, pointing into buffer_info or image_info
+ */
+VkWriteDescriptorSet descriptorSetWrite(VkDescriptorSet set, const DescriptorWrite &write, VkDescriptorBufferInfo &buffer_info, VkDescriptorImageInfo &image_info);
+
+struct DescriptorStats
+{
+  uint32_t allocated = 0; // sets allocated and written
+  uint32_t reused = 0;    // requests answered from the cache
+  uint32_t pools = 0;     // pools the frame has grown to
+};
+
+/**
+ * Transient descriptor sets, valid for one frame in flight.
+ *
+ * Every frame in flight owns a list of pools. Sets are allocated from its
+ * current pool and a new, twice as large pool is added when it runs out;
+ * beginFrame() resets them all with vkResetDescriptorPool once the frame's
+ * fence has signalled, so sets are never freed one by one and the pools are
+ * kept for the next use of the frame. Requests are keyed by a hash of the
+ * layout and the descriptors: an identical request later in the same frame
+ * gets the set already written, so a draw that binds what an earlier draw
+ * bound costs a hash and a lookup.
+ */
+class DescriptorAllocator
+{
+public:
+  /**
+   * sets_per_pool sizes the first pool of each frame, with pool_ratios
+   * descriptors of each type per set (a default mix when empty)
+   */
+  void init(VkDevice device, uint32_t frames_in_flight, uint32_t sets_per_pool = 64, const std::vector<VkDescriptorPoolSize> &pool_ratios = {});
+  void cleanup();
+
+  /**
+   * Call once per frame after waiting on the fence of frame_index, before
+   * recording it. Sets handed out the last time the frame was used become invalid.
+   */
+  void beginFrame(uint32_t frame_index);
+
+  /**
+   * A set of `layout` holding `writes`, one descriptor each. Valid until
+   * the frame's next beginFrame(); bind it only in this frame's commands.
+   */
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout, const DescriptorWrite *writes, uint32_t write_count);
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout, std::initializer_list<DescriptorWrite> writes)
+  {
+    return allocate(layout, writes.begin(), static_cast<uint32_t>(writes.size()));
+  }
+
+  const DescriptorStats &stats() const { return frames[current_frame].stats; }
+
+private:
+  static const uint32_t NO_ENTRY = UINT32_MAX;
+
+  struct CachedSet
+  {
+    VkDescriptorSetLayout layout;
+    uint32_t first_write; // in FramePools::writes
+    uint32_t write_count;
+    uint32_t next;        // entry with the same hash
+    VkDescriptorSet set;
+  };
+
+  struct FramePools
+  {
+    std::vector<VkDescriptorPool> pools;
+    size_t current_pool = 0;
+    std::unordered_map<uint64_t, uint32_t> cache; // hash to first entry
+    std::vector<CachedSet> entries;
+    std::vector<DescriptorWrite> writes;
+    DescriptorStats stats;
+  };
+
+  VkDescriptorPool createPool(uint32_t max_sets) const;
+  VkDescriptorSet allocateSet(FramePools &frame, VkDescriptorSetLayout layout);
+  void writeSet(VkDescriptorSet set, const DescriptorWrite *writes, uint32_t write_count);
+  const CachedSet *findSet(const FramePools &frame, uint64_t hash, VkDescriptorSetLayout layout, const DescriptorWrite *writes, uint32_t write_count) const;
+
+  VkDevice device = VK_NULL_HANDLE;
+  uint32_t sets_per_pool = 0;
+  std::vector<VkDescriptorPoolSize> pool_ratios;
+  std::vector<FramePools> frames;
+  uint32_t current_frame = 0;
+
+  // Scratch of writeSet, kept to avoid allocating per set
+  std::vector<VkWriteDescriptorSet> set_writes;
+  std::vector<VkDescriptorBufferInfo> buffer_infos;
+  std::vector<VkDescriptorImageInfo> image_infos;
+};
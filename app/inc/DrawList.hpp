@@ -0,0 +1,166 @@
+#pragma once
+
+#include "JobSystem.hpp"
+#include "PipelineLayoutBuilder.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * 64-bit draw sort key, most significant first:
+ * pass (4) | pipeline (12) | material (16) | depth (32)
+ * Sorting by it groups draws by pass, then by state, then front to back.
+ */
+const uint32_t SORT_KEY_PASS_BITS = 4;
+const uint32_t SORT_KEY_PIPELINE_BITS = 12;
+const uint32_t SORT_KEY_MATERIAL_BITS = 16;
+const uint32_t SORT_KEY_DEPTH_BITS = 32;
+
+uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth);
+
+/**
+ * Order preserving bits of a view depth. back_to_front flips the order for blended passes.
+ */
+uint32_t sortKeyDepth(float view_depth, bool back_to_front = false);
+
+/**
+ * Everything the recorder needs for one draw.
+ * Without an index buffer element_count/first_element are vertices, otherwise indices.
+ * With an indirect buffer the packet is draw_count tightly packed
+ * VkDraw(Indexed)IndirectCommands at indirect_offset, issued in one call,
+ * and the element and instance fields are unused.
+ */
+struct DrawPacket
+{
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE; // set 0, nothing bound if null
+  VkBuffer vertex_buffer = VK_NULL_HANDLE;
+  VkDeviceSize vertex_buffer_offset = 0;
+  VkBuffer index_buffer = VK_NULL_HANDLE;
+  VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+  uint32_t element_count = 0;
+  uint32_t first_element = 0;
+  int32_t base_vertex = 0;
+  uint32_t instance_count = 1;
+  uint32_t first_instance = 0;
+  VkBuffer indirect_buffer = VK_NULL_HANDLE;
+  VkDeviceSize indirect_offset = 0;
+  uint32_t draw_count = 0;
+};
+
+/**
+ * Per-draw data of a packet, copied into the list by DrawList::add:
+ * push constants at offset 0 and descriptors pushed to set `push_set` of the
+ * packet's layout (a PipelineLayout with push descriptors). None of it needs
+ * a descriptor set or a buffer write.
+ */
+struct DrawData
+{
+  const void *constants = nullptr;
+  uint32_t constant_size = 0;
+  VkShaderStageFlags constant_stages = 0;
+  const DescriptorWrite *writes = nullptr;
+  uint32_t write_count = 0;
+  uint32_t push_set = 0;
+};
+
+struct DrawSortItem
+{
+  uint64_t key;
+  uint32_t packet;
+};
+
+/**
+ * Stable LSD radix sort, 8 bits per pass. Passes where every key has the
+ * same digit are skipped. Chunks are histogrammed and scattered on the job system.
+ */
+void radixSortDraws(std::vector<DrawSortItem> &items, std::vector<DrawSortItem> &scratch, JobSystem *jobs = nullptr);
+
+/**
+ * Per frame list of draw packets, recorded in sort key order
+ */
+class DrawList
+{
+public:
+  void clear();
+  void add(uint64_t key, const DrawPacket &packet);
+  void add(uint64_t key, const DrawPacket &packet, const DrawData &data);
+  void sort(JobSystem *jobs = nullptr);
+
+  size_t size() const { return items.size(); }
+
+  /**
+   * i-th packet in sorted order (submission order before sort())
+   */
+  const DrawPacket &packet(size_t i) const { return packets[items[i].packet]; }
+  uint64_t key(size_t i) const { return items[i].key; }
+
+  /**
+   * Per-draw data of the i-th packet, pointing into the list
+   */
+  DrawData data(size_t i) const;
+
+private:
+  struct DrawPayload
+  {
+    uint32_t first_constant = 0; // in constants
+    uint32_t constant_size = 0;
+    VkShaderStageFlags constant_stages = 0;
+    uint32_t first_write = 0;    // in writes
+    uint32_t write_count = 0;
+    uint32_t push_set = 0;
+  };
+
+  std::vector<DrawPacket> packets;
+  std::vector<DrawPayload> payloads; // one per packet
+  std::vector<uint8_t> constants;
+  std::vector<DescriptorWrite> writes;
+  std::vector<DrawSortItem> items;
+  std::vector<DrawSortItem> scratch;
+};
+
+/**
+ * Commands issued by recordDrawList; everything but draws counts as a state change.
+ * An indirect packet is one draw however many commands it reads.
+ */
+struct DrawStats
+{
+  uint32_t draws = 0;
+  uint32_t pipeline_binds = 0;
+  uint32_t descriptor_binds = 0;
+  uint32_t vertex_buffer_binds = 0;
+  uint32_t index_buffer_binds = 0;
+  uint32_t constant_pushes = 0;
+  uint32_t descriptor_pushes = 0;
+
+  uint32_t stateChanges() const
+  {
+    return pipeline_binds + descriptor_binds + vertex_buffer_binds + index_buffer_binds + constant_pushes + descriptor_pushes;
+  }
+
+  /**
+   * Sums the lists of several render passes
+   */
+  DrawStats &operator+=(const DrawStats &other)
+  {
+    draws += other.draws;
+    pipeline_binds += other.pipeline_binds;
+    descriptor_binds += other.descriptor_binds;
+    vertex_buffer_binds += other.vertex_buffer_binds;
+    index_buffer_binds += other.index_buffer_binds;
+    constant_pushes += other.constant_pushes;
+    descriptor_pushes += other.descriptor_pushes;
+    return *this;
+  }
+};
+
+/**
+ * Records the draws of a sorted list, skipping binds of state that is already bound
+ * and pushes of per-draw data equal to the previous draw's.
+ * Must be called inside a render pass; viewport and scissor are left to the caller.
+ * push_descriptor_set is needed once a packet has push descriptors.
+ */
+DrawStats recordDrawList(VkCommandBuffer command_buffer, const DrawList &list, PFN_vkCmdPushDescriptorSetKHR push_descriptor_set = nullptr);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Six normalized planes (xyz = normal, w = distance), pointing inwards.
+ * Order: left, right, bottom, top, near, far.
+ */
+struct Frustum
+{
+  glm::vec4 planes[6];
+};
+
+/**
+ * Extracts the frustum planes of a view-projection matrix using
+ * the Vulkan clip volume (-w <= x, y <= w, 0 <= z <= w).
+ */
+Frustum extractFrustum(const glm::mat4 &view_proj);
+
+/**
+ * Bounding spheres stored as structure-of-arrays.
+ * The arrays are padded to a multiple of CULL_BATCH_SIZE with spheres that
+ * always fail the test, so the SIMD paths never need a scalar tail.
+ */
+class CullingBounds
+{
+public:
+  static constexpr size_t CULL_BATCH_SIZE = 8;
+
+  uint32_t add(const glm::vec3 &center, float radius);
+  void set(uint32_t index, const glm::vec3 &center, float radius);
+  void clear();
+
+  size_t size() const { return count; }
+  size_t paddedSize() const { return center_x.size(); }
+
+  std::vector<float> center_x;
+  std::vector<float> center_y;
+  std::vector<float> center_z;
+  std::vector<float> radius;
+
+private:
+  size_t count = 0;
+};
+
+/**
+ * Each cull function overwrites `visible` with the indices of the spheres
+ * that intersect the frustum, in ascending order.
+ */
+void cullSpheresScalar(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible);
+void cullSpheresSSE(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible);
+void cullSpheresAVX(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible);
+
+/**
+ * Dispatches to the widest path compiled in (see GLM_ARCH).
+ */
+void cullSpheres(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible);
+
+/**
+ * Name of the path used by cullSpheres, for logging.
+ */
+const char *cullSpheresPath();
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "VertexFormat.hpp"
+#include "VertexQuantization.hpp"
+#include "VkHelpers.hpp"
+#include "StagingUploader.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+/**
+ * Locations 0 = position, 1 = normal, 2 = tangent, 3 = uv
+ */
+template <>
+struct VertexFormat<Vertex>
+{
+  static constexpr VertexAttribute attributes[] =
+  {
+    VERTEX_ATTRIBUTE(Vertex, position),
+    VERTEX_ATTRIBUTE(Vertex, normal),
+    VERTEX_ATTRIBUTE(Vertex, tangent),
+    VERTEX_ATTRIBUTE(Vertex, uv)
+  };
+};
+
+template <>
+struct VertexFormat<QuantizedVertex>
+{
+  static constexpr VertexAttribute attributes[] =
+  {
+    VERTEX_ATTRIBUTE_AS(QuantizedVertex, position, VK_FORMAT_R16G16B16A16_UNORM),
+    VERTEX_ATTRIBUTE_AS(QuantizedVertex, normal, VK_FORMAT_R16G16_SNORM),
+    VERTEX_ATTRIBUTE_AS(QuantizedVertex, tangent, VK_FORMAT_R16G16_SNORM),
+    VERTEX_ATTRIBUTE_AS(QuantizedVertex, uv, VK_FORMAT_R16G16_SFLOAT)
+  };
+};
+
+/**
+ * Binding 0 vertex input for an encoding, pointing at the constexpr
+ * descriptions of VertexInput<Vertex> or VertexInput<QuantizedVertex>
+ */
+struct VertexInputLayout
+{
+  VkVertexInputBindingDescription binding;
+  const VkVertexInputAttributeDescription *attributes;
+  uint32_t attribute_count;
+};
+
+VertexInputLayout vertexInputLayout(VertexEncoding encoding);
+
+/**
+ * True if every attribute format of the encoding can be fetched from a vertex buffer.
+ */
+bool isVertexEncodingSupported(VkPhysicalDevice physical_device, VertexEncoding encoding);
+
+/**
+ * Device local vertex/index buffers of one mesh.
+ * The vertex buffer is also a storage buffer so shaders can fetch from it directly.
+ * Build the pipeline with vertexInputLayout(encoding); quantized meshes also
+ * need `quantization` passed to Quantized.vert.
+ */
+struct GpuMesh
+{
+  Buffer vertex_buffer;
+  Buffer index_buffer;
+  VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+  VertexEncoding encoding = VERTEX_ENCODING_FLOAT;
+  QuantizationParams quantization;
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+  std::vector<Submesh> submeshes;
+  std::vector<MeshLod> lods; // lod_count per submesh, see MeshData
+  uint32_t lod_count = 1;
+  glm::vec3 bounds_min = glm::vec3(0.0f);
+  glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+/**
+ * Stages the vertex and index blobs straight from the mapped cache.
+ * Quantized vertices are expanded to floats only if the device cannot fetch them.
+ * The copies are queued on the uploader; call flush() before drawing.
+ */
+GpuMesh uploadMesh(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const MeshCache &cache);
+void destroyGpuMesh(VkDevice device, GpuMesh &mesh);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "MipGenerator.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+/**
+ * Depth pyramid where every texel holds the farthest depth of the area it
+ * covers (depth 0 = near). Level 0 is the depth buffer rounded down to a power
+ * of two, so each level halves the previous one exactly.
+ *
+ * Only level 0 is reduced here; the mip generator builds the rest in a single
+ * max dispatch when it has a compute path for R32_SFLOAT, otherwise every
+ * level gets its own dispatch.
+ */
+class HiZPyramid
+{
+public:
+  /**
+   * depth_view is sampled in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+   * Re-create the pyramid when the depth buffer is re-created.
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, VkImageView depth_view, VkExtent2D depth_extent, MipGenerator &mips);
+  void cleanup();
+
+  /**
+   * Records the reduction, outside a render pass. The depth writes must be
+   * visible to compute shaders (the render pass' outgoing dependency).
+   * The pyramid stays in VK_IMAGE_LAYOUT_GENERAL and is ready for compute reads.
+   */
+  void build(VkCommandBuffer command_buffer);
+
+  VkImageView view() const { return pyramid.view; }
+  VkSampler sampler() const { return nearest_sampler; }
+  uint32_t width() const { return pyramid.width; }
+  uint32_t height() const { return pyramid.height; }
+  uint32_t mipCount() const { return pyramid.mip_levels; }
+
+private:
+  void createPipeline();
+  void createDescriptors(VkImageView depth_view);
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkExtent2D depth_extent{};
+  MipGenerator *mips = nullptr; // set when it builds levels 1 and up
+  MipChainHandle mip_chain = 0;
+  Image pyramid;
+  std::vector<VkImageView> mip_views;
+  VkSampler nearest_sampler = VK_NULL_HANDLE;
+
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> descriptor_sets; // one per level reduced here, reading the level above
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline pipeline = VK_NULL_HANDLE;
+};
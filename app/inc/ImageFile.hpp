@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * CPU-side image as produced by the decoders: RGBA8, top row first.
+ */
+struct ImageData
+{
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+/**
+ * Decodes a TGA (uncompressed or RLE; 8, 24 or 32 bit) or binary PNM (P5, P6)
+ * image held in memory. Gray and RGB sources get an opaque alpha channel.
+ */
+ImageData decodeImage(const uint8_t *data, size_t size);
+
+/**
+ * Maps the file and decodes it with decodeImage
+ */
+ImageData loadImage(const std::string &file_name);
+
+/**
+ * Next mip level: 2x2 box filter, odd sizes round down (never below 1).
+ * Filters the stored values, so sRGB data is averaged in gamma space.
+ */
+ImageData downsampleImage(const ImageData &image);
+
+/**
+ * Number of levels in a full mip chain down to 1x1
+ */
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Fixed pool of worker threads fed from one FIFO queue.
+ * parallelFor() splits a range into batches that the workers and the calling
+ * thread claim from a shared counter, so it never waits on an idle caller.
+ */
+class JobSystem
+{
+public:
+  /**
+   * worker_count = 0 starts one worker per hardware thread, minus the caller.
+   */
+  explicit JobSystem(uint32_t worker_count = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem &operator=(const JobSystem&) = delete;
+
+  uint32_t workerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+  /**
+   * Queues a job to run on a worker thread
+   */
+  void submit(std::function<void()> job);
+
+  /**
+   * Calls fn(begin, end) over [0, count) in batches of batch_size and
+   * returns once every batch has run. fn must be safe to call concurrently.
+   */
+  void parallelFor(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t, uint32_t)> &fn);
+
+  /**
+   * Blocks until the queue is empty and no job is running
+   */
+  void waitIdle();
+
+private:
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable job_available;
+  std::condition_variable idle;
+  uint32_t running = 0;
+  bool stopping = false;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Per-level error and triangle count of a whole mesh (all submeshes)
+ */
+struct LodChain
+{
+  std::vector<float> errors;
+  std::vector<uint32_t> triangle_counts;
+};
+
+LodChain buildLodChain(const std::vector<MeshLod> &lods, uint32_t lod_count);
+
+struct LodStats
+{
+  std::vector<uint32_t> objects;
+  std::vector<uint64_t> triangles;
+  uint64_t total_triangles = 0;
+};
+
+void printLodStats(const LodStats &stats);
+
+/**
+ * Picks a level per object so its simplification error stays below
+ * max_pixel_error on screen. An object only changes level once the error
+ * crosses the threshold by `hysteresis`, which stops popping back and forth.
+ */
+class LodSelector
+{
+public:
+  float max_pixel_error = 1.0f;
+  float hysteresis = 0.25f;
+
+  /**
+   * Resets the per-frame statistics and caches the camera terms
+   */
+  void beginFrame(const glm::mat4 &view, const glm::mat4 &proj, float viewport_height);
+
+  /**
+   * object: stable id used to remember the previous choice
+   * center, radius: world space bounding sphere
+   * scale: largest world scale of the object, converts mesh errors to world units
+   */
+  uint32_t select(uint32_t object, const glm::vec3 &center, float radius, float scale, const LodChain &chain);
+
+  const LodStats &stats() const { return frame_stats; }
+
+private:
+  std::vector<uint8_t> current_lods;
+  glm::vec3 camera_position = glm::vec3(0.0f);
+  float pixels_per_unit_at_one = 1.0f;
+  LodStats frame_stats;
+};
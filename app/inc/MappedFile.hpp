@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * The mapping lives as long as the object; data() stays valid until then.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &file_name);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile &operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  void open(const std::string &file_name);
+  void close();
+
+  bool isOpen() const { return mapping != nullptr; }
+  const uint8_t *data() const { return static_cast<const uint8_t*>(mapping); }
+  size_t size() const { return file_size; }
+
+private:
+  void *mapping = nullptr;
+  size_t file_size = 0;
+#ifdef _WIN32
+  void *file_handle = nullptr;
+  void *mapping_handle = nullptr;
+#endif
+};
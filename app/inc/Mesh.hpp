@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct Vertex
+{
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec4 tangent; // w = bitangent sign
+  glm::vec2 uv;
+};
+
+struct Submesh
+{
+  uint32_t index_offset;
+  uint32_t index_count;
+};
+
+/**
+ * One level of detail of a submesh. All levels share the vertex buffer.
+ * `error` is the simplification error in mesh units (0 for the source level).
+ */
+struct MeshLod
+{
+  uint32_t index_offset;
+  uint32_t index_count;
+  float error;
+};
+
+/**
+ * A cluster of level 0 triangles. vertex_offset indexes meshlet_vertices, which
+ * hold vertex buffer indices; triangle_offset indexes meshlet_triangles, which
+ * hold three 8-bit meshlet-local vertex indices per entry.
+ */
+struct Meshlet
+{
+  uint32_t vertex_offset;
+  uint32_t triangle_offset;
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+};
+
+/**
+ * Bounding sphere and backface cone of a meshlet, laid out as three vec4s for the GPU.
+ * The meshlet faces away from a camera at c if dot(normalize(cone_apex - c), cone_axis) >= cone_cutoff.
+ */
+struct MeshletBounds
+{
+  glm::vec3 center;
+  float radius;
+  glm::vec3 cone_apex;
+  float cone_cutoff;
+  glm::vec3 cone_axis;
+  float padding;
+};
+
+/**
+ * CPU-side mesh as produced by the importers.
+ * `lods` is empty or holds lod_count levels per submesh, submesh-major, level 0 first.
+ * `meshlets` is empty or covers level 0 of every submesh, in submesh order.
+ */
+struct MeshData
+{
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<Submesh> submeshes;
+  std::vector<MeshLod> lods;
+  uint32_t lod_count = 1;
+  std::vector<Meshlet> meshlets;
+  std::vector<MeshletBounds> meshlet_bounds;
+  std::vector<uint32_t> meshlet_vertices;
+  std::vector<uint32_t> meshlet_triangles;
+  glm::vec3 bounds_min = glm::vec3(0.0f);
+  glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+/**
+ * Loads a triangulated Wavefront OBJ. Every `o`/`g`/`usemtl` starts a new submesh.
+ */
+MeshData loadObj(const std::string &file_name);
+
+void computeBounds(MeshData &mesh);
+void computeTangents(MeshData &mesh);
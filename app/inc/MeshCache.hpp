@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "VertexQuantization.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Binary mesh cache (.vmesh)
+  - A fixed header, followed by a section table, followed by the section blobs.
+  - Every blob starts on a MESH_CACHE_ALIGNMENT boundary, so a mapped file can be
+    copied into staging memory (or read by the GPU) without any fix-ups.
+  - Everything is little endian and stored exactly as the GPU consumes it.
+*/
+const uint32_t MESH_CACHE_MAGIC = 0x48534D56; // "VMSH"
+const uint32_t MESH_CACHE_VERSION = 4;
+const uint64_t MESH_CACHE_ALIGNMENT = 256;
+
+enum MeshCacheSectionType : uint32_t
+{
+  MESH_SECTION_VERTICES = 1,           // Vertex[]
+  MESH_SECTION_INDICES = 2,            // uint16_t[] or uint32_t[], see element_size
+  MESH_SECTION_SUBMESHES = 3,          // Submesh[]
+  MESH_SECTION_QUANTIZED_VERTICES = 4, // QuantizedVertex[], replaces MESH_SECTION_VERTICES
+  MESH_SECTION_QUANTIZATION = 5,       // QuantizationParams
+  MESH_SECTION_LODS = 6,               // MeshLod[], lod_count per submesh
+  MESH_SECTION_MESHLETS = 7,           // Meshlet[]
+  MESH_SECTION_MESHLET_BOUNDS = 8,     // MeshletBounds[], one per meshlet
+  MESH_SECTION_MESHLET_VERTICES = 9,   // uint32_t[] vertex indices
+  MESH_SECTION_MESHLET_TRIANGLES = 10  // uint32_t[] packed 8:8:8 local indices
+};
+
+struct MeshCacheSection
+{
+  uint32_t type;
+  uint32_t element_size;
+  uint64_t offset; // from the start of the file
+  uint64_t size;   // in bytes
+};
+
+struct MeshCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t section_count;
+  uint32_t lod_count;
+  float bounds_min[4];
+  float bounds_max[4];
+};
+
+static_assert(sizeof(MeshCacheHeader) == 48, "MeshCacheHeader layout changed");
+static_assert(sizeof(MeshCacheSection) == 24, "MeshCacheSection layout changed");
+
+/**
+ * Writes the mesh to disk. Indices are narrowed to 16 bits when possible.
+ * If `quantized` is given its vertices are stored instead of mesh.vertices.
+ */
+void writeMeshCache(const std::string &file_name, const MeshData &mesh, const QuantizedMesh *quantized = nullptr);
+
+/**
+ * A mapped .vmesh file. Nothing is parsed or copied; accessors point into the mapping.
+ */
+class MeshCache
+{
+public:
+  explicit MeshCache(const std::string &file_name);
+
+  const MeshCacheHeader &header() const;
+  const MeshCacheSection *findSection(MeshCacheSectionType type) const;
+  const uint8_t *sectionData(const MeshCacheSection &section) const;
+
+  VertexEncoding vertexEncoding() const;
+  const MeshCacheSection &vertexSection() const;
+  QuantizationParams quantizationParams() const;
+
+  uint32_t vertexCount() const;
+  uint32_t indexCount() const;
+  uint32_t indexSize() const;
+  uint32_t submeshCount() const;
+  const Submesh *submeshes() const;
+  uint32_t lodCount() const;
+  const MeshLod *lods() const;
+  uint32_t meshletCount() const;
+  const Meshlet *meshlets() const;
+  const MeshletBounds *meshletBounds() const;
+
+private:
+  MappedFile file;
+  const MeshCacheSection *sections = nullptr;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+/**
+ * Post-transform cache statistics from a FIFO cache simulation
+ *  - acmr: vertex shader invocations per triangle (0.5 is ideal, 3 is worst)
+ *  - atvr: vertex shader invocations per referenced vertex (1 is ideal)
+ */
+struct VertexCacheStats
+{
+  uint32_t triangles = 0;
+  uint32_t vertices = 0;
+  uint32_t transformed = 0;
+  float acmr = 0.0f;
+  float atvr = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * Reorders triangles for the post-transform cache (Tipsify, Sander et al. 2007).
+ * Writes the triangle index at which each cluster of the new order starts.
+ */
+void optimizeVertexCache(uint32_t *indices, size_t index_count, size_t vertex_count, std::vector<uint32_t> *cluster_starts = nullptr, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * Reorders the clusters of a cache optimized index list so outward facing ones
+ * come first. `threshold` is how much ACMR may grow (1.05 = 5%) to get finer clusters.
+ */
+void optimizeOverdraw(uint32_t *indices, size_t index_count, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &cluster_starts, float threshold = 1.05f, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * Reorders vertices by first use and remaps the indices. Unreferenced vertices are dropped.
+ */
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+/**
+ * Runs cache, overdraw and fetch optimization on every submesh of the mesh.
+ * Generated levels of detail are cache optimized as well.
+ */
+void optimizeMesh(MeshData &mesh);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Quadric error metric simplification (Garland & Heckbert) by edge collapse.
+ * Vertices only ever collapse onto other existing vertices, so the result indexes
+ * the same vertex buffer. Border and attribute seam vertices are never moved.
+ *
+ * Stops at target_index_count or once the next collapse would exceed target_error
+ * (mesh units). `result_error` receives the largest error introduced.
+ */
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex> &vertices, const uint32_t *indices, size_t index_count, size_t target_index_count, float target_error, float *result_error = nullptr);
+
+/**
+ * Builds up to lod_count levels per submesh, each with about `ratio` of the
+ * previous level's triangles. Levels are appended to mesh.indices and listed in mesh.lods.
+ */
+void generateLods(MeshData &mesh, uint32_t lod_count = 4, float ratio = 0.5f);
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "GpuMesh.hpp"
+#include "MeshCache.hpp"
+#include "VkHelpers.hpp"
+#include "ShaderLayout.hpp"
+#include "StagingUploader.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+/*
+* VK_EXT_mesh_shader is newer than the bundled Vulkan headers (1.2.216).
+  These are the few definitions the renderer needs, taken from the registry.
+*/
+#ifndef VK_EXT_mesh_shader
+#define VK_EXT_mesh_shader 1
+#define VK_EXT_MESH_SHADER_EXTENSION_NAME "VK_EXT_mesh_shader"
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT = static_cast<VkStructureType>(1000328000);
+const VkShaderStageFlagBits VK_SHADER_STAGE_TASK_BIT_EXT = static_cast<VkShaderStageFlagBits>(0x00000040);
+const VkShaderStageFlagBits VK_SHADER_STAGE_MESH_BIT_EXT = static_cast<VkShaderStageFlagBits>(0x00000080);
+const VkPipelineStageFlagBits VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT = static_cast<VkPipelineStageFlagBits>(0x00080000);
+const VkPipelineStageFlagBits VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT = static_cast<VkPipelineStageFlagBits>(0x00100000);
+
+typedef struct VkPhysicalDeviceMeshShaderFeaturesEXT
+{
+  VkStructureType sType;
+  void *pNext;
+  VkBool32 taskShader;
+  VkBool32 meshShader;
+  VkBool32 multiviewMeshShader;
+  VkBool32 primitiveFragmentShadingRateMeshShader;
+  VkBool32 meshShaderQueries;
+} VkPhysicalDeviceMeshShaderFeaturesEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdDrawMeshTasksEXT)(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+#endif
+
+enum MeshletPath
+{
+  MESHLET_PATH_MESH_SHADER, // task shader culls, mesh shader emits the triangles
+  MESHLET_PATH_COMPUTE      // compute shader culls into indexed indirect draws
+};
+
+/**
+ * True if the device has task and mesh shaders through VK_EXT_mesh_shader.
+ * To use them the device must be created with VK_EXT_mesh_shader and
+ * VK_KHR_spirv_1_4 enabled, and VkPhysicalDeviceMeshShaderFeaturesEXT
+ * (taskShader, meshShader) chained into VkDeviceCreateInfo.
+ * Needs a Vulkan 1.1 instance, returns false otherwise.
+ */
+bool isMeshShaderSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+/**
+ * Uniform block shared by every meshlet shader (std140, see MeshletCommon.glsl)
+ */
+struct MeshletFrameData
+{
+  glm::mat4 model;
+  glm::mat4 view_proj;
+  glm::vec4 planes[6];
+  glm::vec4 camera_position;
+  glm::vec4 position_offset;
+  glm::vec4 position_scale;
+  uint32_t meshlet_count;
+  float model_scale;
+  uint32_t padding[2];
+};
+
+template <>
+struct ShaderBlock<MeshletFrameData>
+{
+  static constexpr BlockLayout layout = BLOCK_LAYOUT_STD140;
+  static constexpr BlockMember members[] =
+  {
+    BLOCK_MEMBER(MeshletFrameData, model),
+    BLOCK_MEMBER(MeshletFrameData, view_proj),
+    BLOCK_MEMBER(MeshletFrameData, planes),
+    BLOCK_MEMBER(MeshletFrameData, camera_position),
+    BLOCK_MEMBER(MeshletFrameData, position_offset),
+    BLOCK_MEMBER(MeshletFrameData, position_scale),
+    BLOCK_MEMBER(MeshletFrameData, meshlet_count),
+    BLOCK_MEMBER(MeshletFrameData, model_scale)
+  };
+};
+
+/**
+ * Draws one mesh meshlet by meshlet, culling clusters against the frustum and
+ * their backface cones on the GPU. The compute path runs anywhere with storage
+ * buffers (lavapipe included); it uses multiDrawIndirect when the device
+ * supports it, so enable that feature at device creation.
+ */
+class MeshletRenderer
+{
+public:
+  /**
+   * The cache must have meshlets (MeshConverter builds them). Buffers are
+   * staged on the uploader; flush it before the first frame.
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const MeshCache &cache, const GpuMesh &mesh, VkRenderPass render_pass, MeshletPath path);
+  void cleanup();
+
+  /**
+   * Records the per-frame data update and, on the compute path, the cull dispatch.
+   * Must be recorded outside a render pass.
+   */
+  void cull(VkCommandBuffer command_buffer, const glm::mat4 &model, const glm::mat4 &view_proj, const glm::vec3 &camera_position);
+
+  /**
+   * Records the draw inside the render pass. Viewport and scissor are dynamic.
+   */
+  void draw(VkCommandBuffer command_buffer);
+
+  MeshletPath path() const { return meshlet_path; }
+  uint32_t meshletCount() const { return meshlet_count; }
+
+private:
+  void createDescriptors(VkShaderStageFlags stages);
+  void createGraphicsPipeline(VkRenderPass render_pass, VertexEncoding encoding);
+  void createCullPipeline(VertexEncoding encoding);
+
+  VkDevice device = VK_NULL_HANDLE;
+  MeshletPath meshlet_path = MESHLET_PATH_COMPUTE;
+  uint32_t meshlet_count = 0;
+  uint32_t max_draws_per_call = 1; // compute path, maxDrawIndirectCount with multiDrawIndirect
+  MeshletFrameData frame_data{};
+
+  Buffer frame_buffer;
+  Buffer meshlet_buffer;
+  Buffer bounds_buffer;
+  Buffer meshlet_vertex_buffer;
+  Buffer meshlet_triangle_buffer;
+  Buffer index_buffer;    // compute path: expanded meshlet triangles
+  Buffer indirect_buffer; // compute path: one VkDrawIndexedIndirectCommand per meshlet
+  VkBuffer vertex_buffer = VK_NULL_HANDLE;
+
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline graphics_pipeline = VK_NULL_HANDLE;
+  VkPipeline cull_pipeline = VK_NULL_HANDLE;
+
+  PFN_vkCmdDrawMeshTasksEXT cmd_draw_mesh_tasks = nullptr;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/**
+ * Splits level 0 of every submesh into meshlets and computes their bounds.
+ * Triangles are taken in index order, so run this after optimizeMesh() to get
+ * compact clusters out of the cache-optimized order.
+ */
+void buildMeshlets(MeshData &mesh, uint32_t max_vertices = MESHLET_MAX_VERTICES, uint32_t max_triangles = MESHLET_MAX_TRIANGLES);
+
+MeshletBounds computeMeshletBounds(const MeshData &mesh, const Meshlet &meshlet);
+
+/**
+ * CPU version of the cone test in the culling shaders
+ */
+bool isMeshletBackfacing(const MeshletBounds &bounds, const glm::vec3 &camera_position);
+
+inline uint32_t packMeshletTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+  return a | (b << 8) | (c << 16);
+}
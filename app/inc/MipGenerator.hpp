@@ -0,0 +1,117 @@
+#pragma once
+
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+enum MipReduction : uint32_t
+{
+  MIP_REDUCTION_AVERAGE = 0, // color mips, bloom chains
+  MIP_REDUCTION_MIN = 1,     // reversed-Z Hi-Z
+  MIP_REDUCTION_MAX = 2      // Hi-Z (farthest depth)
+};
+
+enum MipPath
+{
+  MIP_PATH_BLIT,   // vkCmdBlitImage level by level, linear filter
+  MIP_PATH_COMPUTE // single dispatch downsampler, any reduction
+};
+
+using MipChainHandle = uint32_t;
+
+/**
+ * Whether the downsampler can use subgroup quad operations in compute shaders.
+ * Needs Vulkan 1.1; otherwise it exchanges texels through shared memory.
+ */
+bool isSubgroupQuadSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+/**
+ * Fills the mip chain of an image from its base level on the GPU.
+ *
+ * Averaged chains of formats that support linear blits use a blit per level.
+ * Everything else (min/max reductions, formats without blits) uses the compute
+ * downsampler: each group reduces a 64x64 tile to six levels and the last group
+ * to finish reduces the remaining 64x64 texels to up to six more, so a chain of
+ * up to 4096 texels takes one dispatch. Each level halves the previous one,
+ * rounding down, so odd sizes drop their last row or column.
+ *
+ * The compute path writes storage images without a format qualifier; enable
+ * shaderStorageImageWriteWithoutFormat on the device when it is supported,
+ * otherwise only the blit path is available.
+ */
+class MipGenerator
+{
+public:
+  void init(VkDevice device, VkPhysicalDevice physical_device, bool subgroup_quads, uint32_t max_chains = 64);
+  void cleanup();
+
+  bool supportsBlit(VkFormat format) const;
+  bool supportsCompute(VkFormat format) const;
+
+  /**
+   * Usage flags an image needs besides its own for addChain to accept it,
+   * 0 when the format has no path for the reduction
+   */
+  VkImageUsageFlags requiredUsage(VkFormat format, MipReduction reduction = MIP_REDUCTION_AVERAGE) const;
+
+  /**
+   * Prepares the views and descriptors of an image whose levels 1..mip_levels-1
+   * will be generated. Keep the chain for images that are regenerated often
+   * (render targets, pyramids); remove it once the GPU is done with it.
+   */
+  MipChainHandle addChain(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mip_levels, MipReduction reduction = MIP_REDUCTION_AVERAGE);
+  void removeChain(MipChainHandle chain);
+  MipPath path(MipChainHandle chain) const { return chains[chain].path; }
+
+  /**
+   * Records the generation. The base level is in base_layout and was last
+   * written by base_stages/base_access; the other levels' contents are
+   * discarded. Every level ends up in final_layout, ready for fragment and
+   * compute shader reads. Outside a render pass, on a graphics queue.
+   */
+  void generate(VkCommandBuffer command_buffer, MipChainHandle chain, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout);
+
+private:
+  struct MipDispatch
+  {
+    uint32_t base_level;
+    uint32_t level_count; // levels written below base_level
+    VkDescriptorSet descriptor_set;
+  };
+
+  struct MipChain
+  {
+    VkImage image = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    uint32_t mip_levels = 0;
+    MipReduction reduction = MIP_REDUCTION_AVERAGE;
+    MipPath path = MIP_PATH_BLIT;
+    std::vector<VkImageView> mip_views;
+    std::vector<MipDispatch> dispatches;
+  };
+
+  void createDescriptors(uint32_t max_chains);
+  void createPipelines(bool subgroup_quads);
+  void planDispatches(MipChain &chain, VkFormat format);
+  void generateBlit(VkCommandBuffer command_buffer, const MipChain &chain, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout);
+  void generateCompute(VkCommandBuffer command_buffer, const MipChain &chain, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout);
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+  bool storage_write_without_format = false;
+
+  VkSampler nearest_sampler = VK_NULL_HANDLE;
+  Buffer scratch; // group counter and the sixth level of every tile
+  bool scratch_cleared = false;
+
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline pipelines[3] = {}; // by MipReduction
+
+  std::vector<MipChain> chains;
+  std::vector<MipChainHandle> free_chains;
+};
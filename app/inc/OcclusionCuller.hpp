@@ -0,0 +1,149 @@
+#pragma once
+
+#include "DrawList.hpp"
+#include "HiZPyramid.hpp"
+#include "VkHelpers.hpp"
+#include "ShaderLayout.hpp"
+#include "StagingUploader.hpp"
+#include "UniformRing.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+
+/**
+ * One culled object: a bounding sphere (xyz = center, w = radius) and its
+ * indexed draw. Matches CullObject in the shaders (std430).
+ */
+struct CullObject
+{
+  glm::vec4 sphere;
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t padding;
+};
+
+static_assert(sizeof(CullObject) == 32, "CullObject must match the std430 layout");
+
+/**
+ * Object counts of one frame, written by the culling shader
+ */
+struct OcclusionStats
+{
+  uint32_t frustum_culled = 0;
+  uint32_t occluded = 0;
+  uint32_t drawn_first_phase = 0;
+  uint32_t drawn_second_phase = 0;
+};
+
+/**
+ * The CullFrame uniform block of OcclusionCull.comp
+ */
+struct CullFrameData
+{
+  glm::mat4 view_proj;
+  glm::vec4 planes[6];
+  uint32_t object_count;
+  uint32_t hiz_mip_count;
+  glm::vec2 hiz_size;
+};
+
+template <>
+struct ShaderBlock<CullFrameData>
+{
+  static constexpr BlockLayout layout = BLOCK_LAYOUT_STD140;
+  static constexpr BlockMember members[] =
+  {
+    BLOCK_MEMBER(CullFrameData, view_proj),
+    BLOCK_MEMBER(CullFrameData, planes),
+    BLOCK_MEMBER(CullFrameData, object_count),
+    BLOCK_MEMBER(CullFrameData, hiz_mip_count),
+    BLOCK_MEMBER(CullFrameData, hiz_size)
+  };
+};
+
+enum CullPhase : uint32_t
+{
+  CULL_PHASE_FIRST,  // objects visible last frame, tested against the frustum only
+  CULL_PHASE_SECOND  // every object against the frustum and this frame's Hi-Z
+};
+
+/**
+ * Two-phase GPU occlusion culling. A frame is recorded as:
+ *   cullFirstPhase, render pass (clear) + draw(FIRST), HiZPyramid::build,
+ *   cullSecondPhase, render pass (load) + draw(SECOND).
+ * The first phase redraws last frame's visible set, which usually fills in
+ * most of the depth buffer; the second phase tests everything against the
+ * pyramid built from it, draws what became visible and stores the visibility
+ * for the next frame.
+ *
+ * Every object keeps one VkDrawIndexedIndirectCommand per phase with zero or
+ * one instance. firstInstance is the object index, so the device must have
+ * drawIndirectFirstInstance enabled.
+ */
+class OcclusionCuller
+{
+public:
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const std::vector<CullObject> &objects, uint32_t frames_in_flight);
+  void cleanup();
+
+  /**
+   * Points the second phase at the pyramid; again after every resize.
+   */
+  void setHiZ(const HiZPyramid &hiz);
+
+  /**
+   * Both are recorded outside a render pass, the first one after the fence
+   * of the frame's last use signaled. The second phase copies the counts to
+   * the `frame` slot, read them with stats() once its fence signaled.
+   */
+  void cullFirstPhase(VkCommandBuffer command_buffer, const glm::mat4 &view_proj, uint32_t frame);
+  void cullSecondPhase(VkCommandBuffer command_buffer, uint32_t frame);
+
+  /**
+   * Records the phase's draws. The caller binds the pipeline and the index buffer.
+   */
+  void draw(VkCommandBuffer command_buffer, CullPhase phase);
+
+  /**
+   * The same draws for a DrawList: `call` < drawPacketCount() picks one
+   * multi-draw call of the phase, `state` gives the pipeline, layout,
+   * descriptor set and index buffer it is drawn with
+   */
+  uint32_t drawPacketCount() const { return (object_count + max_draws_per_call - 1) / max_draws_per_call; }
+  DrawPacket drawPacket(const DrawPacket &state, CullPhase phase, uint32_t call) const;
+
+  OcclusionStats stats(uint32_t frame) const;
+
+  uint32_t objectCount() const { return object_count; }
+  VkBuffer objectBuffer() const { return object_buffer.buffer; }
+
+private:
+  void createDescriptors();
+  void createPipeline();
+  void dispatch(VkCommandBuffer command_buffer, CullPhase phase);
+
+  VkDevice device = VK_NULL_HANDLE;
+  uint32_t object_count = 0;
+  uint32_t max_draws_per_call = 1;
+  CullFrameData frame_data{};
+  uint32_t frame_offset = 0; // of this frame's CullFrameData in the ring
+
+  UniformRing uniforms;
+  Buffer object_buffer;
+  Buffer visibility_buffer;
+  Buffer draw_buffer;     // object_count commands per phase
+  Buffer stats_buffer;
+  Buffer readback_buffer; // one OcclusionStats per frame in flight
+
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline pipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "StagingUploader.hpp"
+#include "TextureAtlas.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Packs textures at load time with packTextures and uploads the result as RGBA8:
+ * one image per bind group, atlas pages with their bleed-free mips, arrays
+ * and standalone textures with full chains (box filtered on the CPU).
+ *
+ * Bind a group once for every texture in it: array groups need a
+ * sampler2DArray and the placement's layer, atlas entries their UV rect
+ * (remapUvs, or sampleAtlas in TextureAtlas.glsl for repeating ones).
+ */
+class PackedTextureSet
+{
+public:
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const std::vector<TexturePackInput> &textures, const TexturePackSettings &settings = {});
+  void cleanup();
+
+  uint32_t bindGroupCount() const { return static_cast<uint32_t>(images.size()); }
+  uint32_t bindGroup(uint32_t texture) const { return packed.bindGroup(texture); }
+  const TexturePlacement &placement(uint32_t texture) const { return packed.placements[texture]; }
+  const std::vector<TexturePlacement> &placements() const { return packed.placements; }
+
+  VkImageView view(uint32_t bind_group) const { return images[bind_group].view; }
+  bool isArray(uint32_t bind_group) const { return bind_group >= packed.pages.size() && bind_group < packed.pages.size() + packed.arrays.size(); }
+
+private:
+  void uploadChain(const Image &image, const ImageData &base, uint32_t layer);
+
+  VkDevice device = VK_NULL_HANDLE;
+  PackedTextures packed; // page pixels are released once uploaded
+  std::vector<Image> images; // by bind group
+  StagingUploader *uploader = nullptr;
+};
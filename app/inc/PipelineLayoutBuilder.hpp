@@ -0,0 +1,123 @@
+#pragma once
+
+#include "DescriptorAllocator.hpp"
+#include "ShaderLayout.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * What every device guarantees: maxPushConstantsSize and, with
+ * VK_KHR_push_descriptor, maxPushDescriptors. Layouts built here stay within
+ * them so they work everywhere.
+ */
+const uint32_t PUSH_CONSTANT_GUARANTEED_SIZE = 128;
+const uint32_t PUSH_DESCRIPTOR_GUARANTEED_COUNT = 32;
+
+/**
+ * Per-draw data small enough to travel in the command buffer, see DrawConstants.glsl
+ */
+struct DrawConstants
+{
+  glm::mat4 transform = glm::mat4(1.0f);
+  uint32_t object = 0;
+  uint32_t material = 0;
+  uint32_t padding[2] = {};
+};
+
+template <>
+struct ShaderBlock<DrawConstants>
+{
+  static constexpr BlockLayout layout = BLOCK_LAYOUT_STD430;
+  static constexpr BlockMember members[] =
+  {
+    BLOCK_MEMBER(DrawConstants, transform),
+    BLOCK_MEMBER(DrawConstants, object),
+    BLOCK_MEMBER(DrawConstants, material)
+  };
+};
+
+static_assert(ShaderBlockLayout<DrawConstants>::size <= PUSH_CONSTANT_GUARANTEED_SIZE, "DrawConstants must fit the guaranteed push constant size");
+
+/**
+ * True if the device has VK_KHR_push_descriptor. Enable it at device creation.
+ */
+bool isPushDescriptorSupported(VkPhysicalDevice physical_device);
+
+/**
+ * A pipeline layout with an optional per-draw set at its last set index.
+ *
+ * With push descriptors the per-draw set is recorded straight into the
+ * command buffer by pushDescriptors(), nothing is allocated. Without them
+ * push_set_layout is a regular layout and its sets come from a DescriptorAllocator.
+ */
+struct PipelineLayout
+{
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkDescriptorSetLayout push_set_layout = VK_NULL_HANDLE; // null without per-draw bindings
+  uint32_t push_set = 0;
+  bool push_descriptors = false;
+  PFN_vkCmdPushDescriptorSetKHR push_descriptor_set = nullptr;
+};
+
+void destroyPipelineLayout(VkDevice device, PipelineLayout &layout);
+
+/**
+ * Records `writes` as the per-draw set of `layout`. Needs layout.push_descriptors.
+ */
+void pushDescriptors(VkCommandBuffer command_buffer, const PipelineLayout &layout, VkPipelineBindPoint bind_point, const DescriptorWrite *writes, uint32_t write_count);
+void pushDescriptors(VkCommandBuffer command_buffer, PFN_vkCmdPushDescriptorSetKHR push_descriptor_set, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set,
+  const DescriptorWrite *writes, uint32_t write_count);
+
+/**
+ * Collects the sets, push constant ranges and per-draw bindings of a pipeline
+ * layout and checks them as they are added, throwing on anything the spec
+ * rejects or the guaranteed limits do not cover: ranges past
+ * PUSH_CONSTANT_GUARANTEED_SIZE, misaligned ranges, a stage in two ranges,
+ * more than PUSH_DESCRIPTOR_GUARANTEED_COUNT per-draw descriptors or dynamic
+ * buffers among them.
+ *
+ *   PipelineLayout layout = PipelineLayoutBuilder()
+ *     .setLayout(frame_set_layout)
+ *     .pushConstants<DrawConstants>(VK_SHADER_STAGE_VERTEX_BIT)
+ *     .pushDescriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+ *     .build(device, push_descriptors_enabled);
+ */
+class PipelineLayoutBuilder
+{
+public:
+  /**
+   * Appends a set; sets are numbered in the order they are added
+   */
+  PipelineLayoutBuilder &setLayout(VkDescriptorSetLayout layout);
+
+  PipelineLayoutBuilder &pushConstants(VkShaderStageFlags stages, uint32_t offset, uint32_t size);
+
+  template <typename T>
+  PipelineLayoutBuilder &pushConstants(VkShaderStageFlags stages, uint32_t offset = 0)
+  {
+    static_assert(sizeof(T) % 4 == 0, "Push constant blocks are made of 4 byte words");
+    static_assert(sizeof(T) <= PUSH_CONSTANT_GUARANTEED_SIZE, "Push constant block exceeds the guaranteed 128 bytes");
+    return pushConstants(stages, offset, sizeof(T));
+  }
+
+  /**
+   * Adds a binding to the per-draw set, which comes after every setLayout()
+   */
+  PipelineLayoutBuilder &pushDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count = 1);
+
+  /**
+   * push_descriptors: VK_KHR_push_descriptor is enabled on the device. If not,
+   * the per-draw set gets a regular layout.
+   */
+  PipelineLayout build(VkDevice device, bool push_descriptors) const;
+
+private:
+  std::vector<VkDescriptorSetLayout> set_layouts;
+  std::vector<VkPushConstantRange> ranges;
+  std::vector<VkDescriptorSetLayoutBinding> push_bindings;
+  uint32_t push_descriptor_count = 0;
+};
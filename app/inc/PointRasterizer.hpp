@@ -0,0 +1,93 @@
+#pragma once
+
+#include "VertexFormat.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+
+/**
+ * One point as read by PointRaster.comp (std430: vec3 + uint)
+ */
+struct PointVertex
+{
+  glm::vec3 position;
+  uint32_t color; // RGBA8, red in the low byte
+};
+
+static_assert(sizeof(PointVertex) == 16, "PointVertex must match the std430 layout of PointRaster.comp");
+
+/**
+ * The same buffer drawn as a point list, see PointList.vert
+ */
+template <>
+struct VertexFormat<PointVertex>
+{
+  static constexpr VertexAttribute attributes[] =
+  {
+    VERTEX_ATTRIBUTE(PointVertex, position),
+    VERTEX_ATTRIBUTE_AS(PointVertex, color, VK_FORMAT_R8G8B8A8_UNORM)
+  };
+};
+
+/**
+ * True if the device is Vulkan 1.2 with shaderInt64 and shaderBufferInt64Atomics.
+ * Both features must be enabled at device creation.
+ */
+bool isPointRasterizerSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+/**
+ * Draws point clouds with a compute shader instead of the point topology.
+ *
+ * Every point is projected by one invocation and written to a per-pixel
+ * 64-bit value with atomicMin: depth bits in the high half, color in the low
+ * half, so the nearest point wins without any ordering between invocations.
+ * A full screen pass then resolves the values into the current render pass,
+ * writing gl_FragDepth so the points depth test against the rest of the scene.
+ *
+ * The values live in a storage buffer rather than a 64-bit storage image,
+ * which would need VK_EXT_shader_image_atomic_int64.
+ */
+class PointRasterizer
+{
+public:
+  /**
+   * points: storage buffer of PointVertex, used by every rasterize()
+   * Re-create with the swapchain (the value buffer has one entry per pixel).
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, VkRenderPass render_pass, VkExtent2D extent, VkBuffer points, uint32_t point_count);
+  void cleanup();
+
+  /**
+   * Records the clear and the point pass, outside a render pass, followed by
+   * the barrier that makes the result visible to resolve()
+   */
+  void rasterize(VkCommandBuffer command_buffer, const glm::mat4 &view_proj);
+
+  /**
+   * Records the full screen resolve, inside `render_pass` given at init
+   */
+  void resolve(VkCommandBuffer command_buffer);
+
+  uint32_t pointCount() const { return point_count; }
+
+private:
+  void createDescriptors(VkBuffer points);
+  void createPipelines(VkRenderPass render_pass);
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  uint32_t point_count = 0;
+  uint32_t max_group_count = 1;
+  Buffer pixel_buffer;
+
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline raster_pipeline = VK_NULL_HANDLE;
+  VkPipeline resolve_pipeline = VK_NULL_HANDLE;
+};
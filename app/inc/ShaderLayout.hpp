@@ -0,0 +1,268 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <type_traits>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compile-time std140/std430 layout of structs shared with shaders.
+ *
+ * A struct that is copied byte for byte into a uniform, storage or push
+ * constant block lists its members once, in block order, by specializing
+ * ShaderBlock:
+ *
+ *   template <>
+ *   struct ShaderBlock<CullFrameData>
+ *   {
+ *     static constexpr BlockLayout layout = BLOCK_LAYOUT_STD140;
+ *     static constexpr BlockMember members[] =
+ *     {
+ *       BLOCK_MEMBER(CullFrameData, view_proj),
+ *       BLOCK_MEMBER(CullFrameData, planes),
+ *       ...
+ *     };
+ *   };
+ *
+ * ShaderBlockLayout<T> then static_asserts that every member sits at the
+ * offset GLSL gives it and has the size GLSL gives it. Padding never goes
+ * in the list, only the members the shader declares.
+ *
+ * glm types mostly match GLSL, the exceptions are what the checks catch:
+ * - a vec3 is aligned to 16 bytes; declare it `alignas(16) glm::vec3`. A
+ *   scalar may follow it in the same 16 bytes, as in GLSL.
+ * - std140 array elements are 16 bytes apart, so float, vec2 and vec3 arrays
+ *   need BlockElement<T> elements (std430 only pads vec3 arrays).
+ * - glm::mat3 and bool have no GLSL layout equivalent and are rejected.
+ *
+ * Nested structs work once they have a ShaderBlock of their own; they take
+ * the layout of the block they are in.
+ */
+enum BlockLayout : uint32_t
+{
+  BLOCK_LAYOUT_STD140 = 0, // uniform blocks
+  BLOCK_LAYOUT_STD430 = 1  // storage and push constant blocks
+};
+
+/**
+ * Base alignment and size of a member type under one layout. array_stride is
+ * 0 for anything but arrays.
+ */
+struct BlockRules
+{
+  uint32_t alignment;
+  uint32_t size;
+  uint32_t array_stride;
+};
+
+struct BlockMember
+{
+  const char *name;
+  uint32_t offset;      // offsetof the host member
+  uint32_t host_size;   // sizeof the host member
+  uint32_t host_stride; // sizeof a host array element, 0 for anything but arrays
+  BlockRules rules[2];  // indexed by BlockLayout
+};
+
+/**
+ * Specialized for every shared struct, see above
+ */
+template <typename T>
+struct ShaderBlock;
+
+constexpr uint32_t blockRoundUp(uint32_t value, uint32_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Rules of a non-array member type under std430; std140 only differs for
+ * arrays and structs. Specialized below for the glm types that have a GLSL equivalent.
+ */
+template <typename T, typename = void>
+struct BlockType
+{
+  static_assert(sizeof(T) == 0, "No GLSL layout for this member type (glm::mat3 and bool do not match theirs, use glm::mat4 and uint32_t)");
+};
+
+template <uint32_t alignment_, uint32_t size_>
+struct BlockScalarType
+{
+  static constexpr BlockRules rules(BlockLayout)
+  {
+    return {alignment_, size_, 0};
+  }
+};
+
+template <> struct BlockType<float> : BlockScalarType<4, 4> {};
+template <> struct BlockType<int32_t> : BlockScalarType<4, 4> {};
+template <> struct BlockType<uint32_t> : BlockScalarType<4, 4> {};
+template <> struct BlockType<uint64_t> : BlockScalarType<8, 8> {}; // buffer references and VkDeviceAddress
+template <> struct BlockType<glm::vec2> : BlockScalarType<8, 8> {};
+template <> struct BlockType<glm::ivec2> : BlockScalarType<8, 8> {};
+template <> struct BlockType<glm::uvec2> : BlockScalarType<8, 8> {};
+template <> struct BlockType<glm::vec3> : BlockScalarType<16, 12> {};
+template <> struct BlockType<glm::ivec3> : BlockScalarType<16, 12> {};
+template <> struct BlockType<glm::uvec3> : BlockScalarType<16, 12> {};
+template <> struct BlockType<glm::vec4> : BlockScalarType<16, 16> {};
+template <> struct BlockType<glm::ivec4> : BlockScalarType<16, 16> {};
+template <> struct BlockType<glm::uvec4> : BlockScalarType<16, 16> {};
+template <> struct BlockType<glm::mat4> : BlockScalarType<16, 64> {}; // column-major, columns 16 bytes apart in both layouts
+
+// Enums travel as their underlying integer
+template <typename T>
+struct BlockType<T, std::enable_if_t<std::is_enum<T>::value>> : BlockType<std::underlying_type_t<T>> {};
+
+template <typename T>
+constexpr BlockRules blockStructRules(BlockLayout layout)
+{
+  uint32_t alignment = 0;
+  uint32_t end = 0;
+  for (const BlockMember &member : ShaderBlock<T>::members)
+  {
+    const BlockRules &rules = member.rules[layout];
+    alignment = rules.alignment > alignment ? rules.alignment : alignment;
+    end = blockRoundUp(end, rules.alignment) + rules.size;
+  }
+
+  if (layout == BLOCK_LAYOUT_STD140)
+  {
+    alignment = blockRoundUp(alignment, 16);
+  }
+  return {alignment, blockRoundUp(end, alignment), 0};
+}
+
+template <typename T>
+struct BlockType<T, std::void_t<decltype(ShaderBlock<T>::members)>>
+{
+  static constexpr BlockRules rules(BlockLayout layout)
+  {
+    return blockStructRules<T>(layout);
+  }
+};
+
+/**
+ * Array element padded to the layout's array stride, for element types
+ * whose size is not already a multiple of it (float, vec2, vec3 in std140;
+ * vec3 in std430). Converts to and from T.
+ */
+template <typename T, BlockLayout layout = BLOCK_LAYOUT_STD140>
+struct alignas(layout == BLOCK_LAYOUT_STD140 ? 16 : BlockType<T>::rules(layout).alignment) BlockElement
+{
+  T value;
+
+  BlockElement() = default;
+  BlockElement(const T &value) : value(value) {}
+
+  operator const T &() const { return value; }
+  BlockElement &operator=(const T &other) { value = other; return *this; }
+};
+
+template <typename T, BlockLayout layout>
+struct BlockType<BlockElement<T, layout>> : BlockType<T> {};
+
+template <typename T>
+constexpr BlockRules blockRules(BlockLayout layout)
+{
+  if constexpr (std::is_array<T>::value)
+  {
+    BlockRules element = blockRules<std::remove_extent_t<T>>(layout);
+    if (layout == BLOCK_LAYOUT_STD140)
+    {
+      element.alignment = blockRoundUp(element.alignment, 16);
+    }
+    uint32_t stride = blockRoundUp(element.size, element.alignment);
+    return {element.alignment, stride * static_cast<uint32_t>(std::extent<T>::value), stride};
+  }
+  else
+  {
+    return BlockType<std::remove_cv_t<T>>::rules(layout);
+  }
+}
+
+template <typename T>
+constexpr BlockMember blockMember(const char *name, size_t offset)
+{
+  uint32_t host_stride = std::is_array<T>::value ? static_cast<uint32_t>(sizeof(std::remove_extent_t<T>)) : 0;
+  return {name, static_cast<uint32_t>(offset), static_cast<uint32_t>(sizeof(T)), host_stride,
+    {blockRules<T>(BLOCK_LAYOUT_STD140), blockRules<T>(BLOCK_LAYOUT_STD430)}};
+}
+
+#define BLOCK_MEMBER(block, member) \
+  blockMember<decltype(block::member)>(#member, offsetof(block, member))
+
+/**
+ * Offset GLSL gives member `index` of T under T's layout
+ */
+template <typename T>
+constexpr uint32_t blockMemberOffset(size_t index)
+{
+  uint32_t end = 0;
+  for (size_t i = 0; i < index; i++)
+  {
+    const BlockRules &rules = ShaderBlock<T>::members[i].rules[ShaderBlock<T>::layout];
+    end = blockRoundUp(end, rules.alignment) + rules.size;
+  }
+  return blockRoundUp(end, ShaderBlock<T>::members[index].rules[ShaderBlock<T>::layout].alignment);
+}
+
+/**
+ * Bytes the shader's block covers: up to the end of its last member
+ */
+template <typename T>
+constexpr uint32_t blockSize()
+{
+  constexpr size_t last = std::size(ShaderBlock<T>::members) - 1;
+  return blockMemberOffset<T>(last) + ShaderBlock<T>::members[last].rules[ShaderBlock<T>::layout].size;
+}
+
+template <typename T>
+constexpr bool blockOffsetsMatchLayout()
+{
+  for (size_t i = 0; i < std::size(ShaderBlock<T>::members); i++)
+  {
+    if (ShaderBlock<T>::members[i].offset != blockMemberOffset<T>(i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+constexpr bool blockSizesMatchLayout()
+{
+  for (const BlockMember &member : ShaderBlock<T>::members)
+  {
+    const BlockRules &rules = member.rules[ShaderBlock<T>::layout];
+    if (member.host_size != rules.size || member.host_stride != rules.array_stride)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Compile-time checks of T against its ShaderBlock; instantiated by whatever
+ * uploads or verifies T. Only padding up to the next 16 bytes may follow the
+ * last member, the shader's view of the block ends there.
+ */
+template <typename T>
+struct ShaderBlockLayout
+{
+  static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value, "Shader blocks are copied as raw bytes and need offsetof");
+  static_assert(blockOffsetsMatchLayout<T>(), "Block member is not at the offset its layout gives it, check vec3 alignment and padding members");
+  static_assert(blockSizesMatchLayout<T>(), "Block member does not have the size its layout gives it, check array element padding");
+  static_assert(sizeof(T) >= blockSize<T>() && sizeof(T) <= blockRoundUp(blockSize<T>(), 16), "Block struct has members missing from its ShaderBlock");
+
+  static constexpr BlockLayout layout = ShaderBlock<T>::layout;
+  static constexpr uint32_t size = blockSize<T>();
+  static constexpr const BlockMember *members = ShaderBlock<T>::members;
+  static constexpr uint32_t member_count = static_cast<uint32_t>(std::size(ShaderBlock<T>::members));
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "FrustumCulling.hpp"
+#include "JobSystem.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Object space triangles of an occluder, usually a few boxes or a heavily
+ * simplified LOD rather than the render mesh.
+ */
+struct OccluderMesh
+{
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+};
+
+struct Occluder
+{
+  const OccluderMesh *mesh;
+  glm::mat4 model;
+};
+
+enum OcclusionRasterPath
+{
+  OCCLUSION_PATH_SCALAR,
+  OCCLUSION_PATH_AVX2
+};
+
+/**
+ * Low resolution CPU depth buffer for culling objects hidden behind large
+ * occluders before their draws are recorded.
+ *
+ * The buffer is stored in 8x4 pixel tiles so one AVX2 register holds a tile
+ * row: rasterization evaluates the edge functions of 8 pixels at once and
+ * writes depth through the resulting coverage mask. Each tile also keeps its
+ * farthest depth, which skips triangles behind a tile and answers most
+ * occludee tests without touching pixels.
+ *
+ * Depth is 0 at the near plane (Vulkan clip space). Occluder depth is
+ * rounded away from the camera within each pixel, so a pixel never claims to
+ * hide more than its occluder does at its center.
+ */
+class SoftwareOcclusion
+{
+public:
+  static constexpr uint32_t TILE_WIDTH = 8;
+  static constexpr uint32_t TILE_HEIGHT = 4;
+
+  /**
+   * The resolution is rounded up to whole tiles
+   */
+  SoftwareOcclusion(uint32_t width, uint32_t height);
+
+  /**
+   * Clears the buffer and rasterizes the occluders. Occluders are transformed
+   * in parallel, then each job rasterizes its own band of tile rows.
+   */
+  void render(const std::vector<Occluder> &occluders, const glm::mat4 &view_proj, JobSystem *jobs = nullptr);
+
+  /**
+   * Tests the bounding box of a sphere against the last render()
+   */
+  bool isSphereVisible(const glm::vec3 &center, float radius) const;
+
+  /**
+   * Overwrites `visible` with the candidates (indices into bounds, typically
+   * the output of cullSpheres) that are not hidden, keeping their order.
+   */
+  void cullSpheres(const CullingBounds &bounds, const std::vector<uint32_t> &candidates, std::vector<uint32_t> &visible, JobSystem *jobs = nullptr) const;
+
+  /**
+   * Defaults to the widest path compiled in (see GLM_ARCH).
+   * Both paths produce bit identical buffers.
+   */
+  void setPath(OcclusionRasterPath path);
+  OcclusionRasterPath path() const { return raster_path; }
+
+  uint32_t width() const { return buffer_width; }
+  uint32_t height() const { return buffer_height; }
+  size_t triangleCount() const;
+  float depth(uint32_t x, uint32_t y) const;
+
+private:
+  /**
+   * Edge functions and depth plane in pixel coordinates: a pixel center is
+   * inside if every edge is >= 0, depth = min(z_a * x + z_b * y + z_c, z_max)
+   */
+  struct RasterTriangle
+  {
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float z_a;
+    float z_b;
+    float z_c;
+    float z_min;
+    float z_max;
+    int32_t min_x;
+    int32_t max_x;
+    int32_t min_y;
+    int32_t max_y;
+  };
+
+  void transformOccluder(const Occluder &occluder, std::vector<RasterTriangle> &triangles) const;
+  void setupTriangle(const glm::vec4 clip[3], std::vector<RasterTriangle> &triangles) const;
+  void rasterizeTileRows(uint32_t first_row, uint32_t end_row);
+  void rasterizeTileScalar(const RasterTriangle &triangle, uint32_t tile_x, uint32_t tile_y);
+  void rasterizeTileAVX2(const RasterTriangle &triangle, uint32_t tile_x, uint32_t tile_y);
+  bool isRectVisibleScalar(int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y, float nearest) const;
+  bool isRectVisibleAVX2(int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y, float nearest) const;
+
+  uint32_t buffer_width;
+  uint32_t buffer_height;
+  uint32_t tiles_x;
+  uint32_t tiles_y;
+  OcclusionRasterPath raster_path;
+
+  glm::mat4 view_proj = glm::mat4(1.0f);
+  std::vector<float> tile_depth; // TILE_WIDTH * TILE_HEIGHT floats per tile, row major inside
+  std::vector<float> tile_max;
+  std::vector<std::vector<RasterTriangle>> occluder_triangles;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ShaderLayout.hpp"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+
+enum SpirvBlockKind : uint32_t
+{
+  SPIRV_BLOCK_UNIFORM,
+  SPIRV_BLOCK_STORAGE,
+  SPIRV_BLOCK_PUSH_CONSTANT
+};
+
+struct SpirvBlockMember
+{
+  std::string name;          // empty when the module was stripped of names
+  uint32_t offset = 0;
+  uint32_t size = 0;         // 0 for runtime arrays
+  uint32_t array_stride = 0; // 0 for anything but arrays
+};
+
+/**
+ * A uniform, storage or push constant block as the compiler laid it out
+ */
+struct SpirvBlock
+{
+  std::string name;
+  SpirvBlockKind kind = SPIRV_BLOCK_UNIFORM;
+  uint32_t set = 0;     // not for push constants
+  uint32_t binding = 0;
+  uint32_t size = 0;    // up to the end of the last member
+  std::vector<SpirvBlockMember> members;
+};
+
+/**
+ * The blocks a SPIR-V module declares, read from its decorations. Only what
+ * checking host structs needs is parsed: names, offsets, strides and the
+ * scalar, vector, matrix, array and struct types they refer to.
+ */
+struct SpirvReflection
+{
+  std::vector<SpirvBlock> blocks;
+
+  /**
+   * nullptr if the module has no such block; set and binding are ignored for push constants
+   */
+  const SpirvBlock *findBlock(SpirvBlockKind kind, uint32_t set = 0, uint32_t binding = 0) const;
+};
+
+SpirvReflection reflectSpirv(const std::vector<uint32_t> &code);
+
+/**
+ * Throws unless every member of `block` is at the offset, and has the size
+ * and array stride, the host struct's members have under `layout`
+ */
+void verifyBlockLayout(const SpirvBlock &block, BlockLayout layout, const BlockMember *members, uint32_t member_count);
+
+/**
+ * Checks T against the block the shader declares, at pipeline creation.
+ * The compile-time checks guarantee T follows GLSL's rules; this guarantees
+ * the shader's block is the one T was written for.
+ */
+template <typename T>
+void verifyShaderBlock(const SpirvReflection &reflection, SpirvBlockKind kind, uint32_t set = 0, uint32_t binding = 0)
+{
+  const SpirvBlock *block = reflection.findBlock(kind, set, binding);
+  if (block == nullptr)
+  {
+    throw std::runtime_error("Shader has no block at the verified binding!");
+  }
+
+  verifyBlockLayout(*block, ShaderBlockLayout<T>::layout, ShaderBlockLayout<T>::members, ShaderBlockLayout<T>::member_count);
+}
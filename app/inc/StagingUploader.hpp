@@ -0,0 +1,73 @@
+#pragma once
+
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+/**
+ * Batches host-to-device copies through one persistently mapped staging buffer.
+ * Copies are recorded as they are queued and submitted together by flush().
+ * When the staging buffer fills up it is flushed automatically.
+ */
+class StagingUploader
+{
+public:
+  void init(VkDevice device, VkPhysicalDevice physical_device, VkQueue queue, uint32_t queue_family, VkDeviceSize staging_size);
+  void cleanup();
+
+  /**
+   * Reserves `size` bytes of staging memory that will be copied to dst at dst_offset.
+   * The caller writes the data into the returned pointer before the next flush().
+   */
+  void *stageBuffer(VkBuffer dst, VkDeviceSize dst_offset, VkDeviceSize size);
+
+  /**
+   * Copies `size` bytes from data, splitting uploads bigger than the staging buffer.
+   */
+  void uploadBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+
+  /**
+   * Reserves `size` bytes of staging memory for a width x height texel region
+   * of mip_level in array_layer at (x, y), both multiples of the block size.
+   * dst must already be in TRANSFER_DST_OPTIMAL; the caller writes the tightly
+   * packed texels or blocks before the next flush().
+   */
+  void *stageImage(VkImage dst, uint32_t mip_level, uint32_t array_layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, VkDeviceSize size);
+
+  /**
+   * Copies a whole mip level of `block_size` byte blocks covering
+   * block_extent x block_extent texels (1 for uncompressed formats), in bands
+   * of block rows when it is bigger than the staging buffer. The level (of one
+   * array layer) is moved from any layout (its contents are discarded) to
+   * SHADER_READ_ONLY_OPTIMAL.
+   */
+  void uploadImage(VkImage dst, uint32_t mip_level, uint32_t width, uint32_t height, uint32_t block_size, const void *data, uint32_t block_extent = 1, uint32_t array_layer = 0);
+
+  /**
+   * The current batch's command buffer, for transfer commands (image copies,
+   * layout transitions) that must run in order with the queued copies
+   */
+  VkCommandBuffer batchCommandBuffer();
+
+  /**
+   * Submits every queued copy and waits for it to complete.
+   */
+  void flush();
+
+  VkDeviceSize capacity() const { return staging.size; }
+  VkDeviceSize pendingBytes() const { return staging_offset; }
+
+private:
+  void beginBatch();
+  void *reserve(VkDeviceSize size, VkDeviceSize alignment);
+  void transitionImage(VkImage image, uint32_t mip_level, uint32_t array_layer, VkImageLayout old_layout, VkImageLayout new_layout);
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkQueue queue = VK_NULL_HANDLE;
+  VkCommandPool command_pool = VK_NULL_HANDLE;
+  VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  Buffer staging;
+  VkDeviceSize staging_offset = 0;
+  bool recording = false;
+};
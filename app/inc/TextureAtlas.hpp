@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ImageFile.hpp"
+#include "Mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Bottom-left skyline packer over a fixed width page. Rectangles are placed
+ * where they end lowest, ties going to the narrowest gap.
+ */
+class SkylinePacker
+{
+public:
+  SkylinePacker(uint32_t width, uint32_t height);
+
+  bool insert(uint32_t width, uint32_t height, uint32_t &x, uint32_t &y);
+
+  uint32_t usedHeight() const;
+  float occupancy() const; // placed area over width * usedHeight()
+
+private:
+  struct SkylineNode
+  {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+  };
+
+  bool fits(size_t node, uint32_t width, uint32_t height, uint32_t &y) const;
+
+  uint32_t width;
+  uint32_t height;
+  uint64_t used_area = 0;
+  std::vector<SkylineNode> skyline;
+};
+
+struct TexturePackSettings
+{
+  uint32_t page_size = 2048;     // atlas page width, and height before trimming
+  uint32_t padding = 4;          // power of two, texels around every atlas entry
+  uint32_t max_atlas_size = 512; // larger textures stay standalone or go to arrays
+  uint32_t min_array_layers = 2; // textures of one size and color space per array
+  uint32_t max_array_layers = 256;
+};
+
+struct TexturePackInput
+{
+  const ImageData *image;
+  bool srgb;
+  bool repeat; // sampled with wrapping UVs
+};
+
+enum TexturePlacementKind : uint32_t
+{
+  TEXTURE_PLACEMENT_STANDALONE = 0,
+  TEXTURE_PLACEMENT_ATLAS = 1,
+  TEXTURE_PLACEMENT_ARRAY = 2
+};
+
+/**
+ * Where a texture ended up. `group` indexes the pages, arrays or standalone
+ * textures of PackedTextures by kind. UVs of an atlas entry map to
+ * uv_offset + uv * uv_scale; other kinds keep their UVs.
+ */
+struct TexturePlacement
+{
+  TexturePlacementKind kind = TEXTURE_PLACEMENT_STANDALONE;
+  uint32_t group = 0;
+  uint32_t layer = 0;
+  bool repeat = false;
+  glm::vec2 uv_offset = glm::vec2(0.0f);
+  glm::vec2 uv_scale = glm::vec2(1.0f);
+};
+
+/**
+ * Level 0 of an atlas page with its padding filled in. Only mip_count levels
+ * keep every entry inside its padding: past that, neighbours would bleed in.
+ */
+struct AtlasPage
+{
+  bool srgb = false;
+  uint32_t mip_count = 1;
+  float occupancy = 0.0f; // texture texels over page texels, padding excluded
+  ImageData image;
+  std::vector<uint32_t> textures;
+};
+
+struct TextureArrayGroup
+{
+  bool srgb = false;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint32_t> textures; // by layer
+};
+
+/**
+ * The result of packing: one placement per input texture, and the images to
+ * bind. Bind groups are numbered pages first, then arrays, then standalone
+ * textures, so textures sharing a bind group can share a material sort key.
+ */
+struct PackedTextures
+{
+  std::vector<AtlasPage> pages;
+  std::vector<TextureArrayGroup> arrays;
+  std::vector<uint32_t> standalone;
+  std::vector<TexturePlacement> placements;
+
+  uint32_t bindGroupCount() const { return static_cast<uint32_t>(pages.size() + arrays.size() + standalone.size()); }
+  uint32_t bindGroup(uint32_t texture) const;
+};
+
+/**
+ * Textures sharing a size and color space with at least min_array_layers - 1
+ * others become layers of a 2D array. The rest, up to max_atlas_size, are
+ * skyline packed into atlas pages per color space, tallest first. Entries are
+ * aligned to the padding and padded by it, replicating their edges (wrapping,
+ * for repeating textures), so the first log2(padding) + 1 mips of a page
+ * filter only their own texels; the default 4 also keeps BC blocks apart.
+ */
+PackedTextures packTextures(const std::vector<TexturePackInput> &textures, const TexturePackSettings &settings = {});
+
+glm::vec2 atlasUv(const TexturePlacement &placement, glm::vec2 uv);
+
+/**
+ * Rewrites the UVs of every submesh's vertices into its texture's atlas rect
+ * (one placement per submesh). Repeating entries keep their UVs, the shader
+ * wraps them (TextureAtlas.glsl). Throws if a remapped vertex is shared with
+ * a submesh of another placement or has UVs outside [0, 1].
+ */
+void remapUvs(MeshData &mesh, const std::vector<TexturePlacement> &submesh_placements);
+
+/*
+* Atlas manifest, a text file with one line per texture:
+  <name> <standalone|atlas|array> <file> <layer> <repeat> <u offset> <v offset> <u scale> <v scale>
+  Names and file names cannot contain whitespace.
+*/
+struct AtlasManifestEntry
+{
+  std::string name;
+  std::string file_name; // the .vtex holding the texture
+  TexturePlacement placement;
+};
+
+void writeAtlasManifest(const std::string &file_name, const std::vector<AtlasManifestEntry> &entries);
+std::vector<AtlasManifestEntry> loadAtlasManifest(const std::string &file_name);
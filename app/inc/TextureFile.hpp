@@ -0,0 +1,104 @@
+#pragma once
+
+#include "BlockCompression.hpp"
+#include "ImageFile.hpp"
+#include "MappedFile.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Texture file (.vtex), a KTX2-like container of one GPU-ready mip chain
+  - A fixed header, the level table, then the level blobs.
+  - The table holds every layer of level 0, then every layer of level 1, and so on;
+    a plain 2D texture has one layer, a texture array several of the same size.
+  - Every blob starts on a TEXTURE_FILE_ALIGNMENT boundary and holds the level
+    exactly as vkCmdCopyBufferToImage reads it: blocks row by row, tightly packed.
+  - One texel format per file, chosen when converting; the loader expands it
+    on the CPU when the device cannot sample it.
+*/
+const uint32_t TEXTURE_FILE_MAGIC = 0x58455456; // "VTEX"
+const uint32_t TEXTURE_FILE_VERSION = 2;
+const uint64_t TEXTURE_FILE_ALIGNMENT = 16;
+
+const uint32_t TEXTURE_FILE_SRGB = 1; // header flag: color data, sample through an sRGB format
+
+struct TextureFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format; // TextureFormat
+  uint32_t flags;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mip_count;
+  uint32_t layer_count;
+};
+
+struct TextureFileLevel
+{
+  uint64_t offset; // from the start of the file
+  uint64_t size;   // in bytes
+  uint32_t width;
+  uint32_t height;
+};
+
+static_assert(sizeof(TextureFileHeader) == 32, "TextureFileHeader layout changed");
+static_assert(sizeof(TextureFileLevel) == 24, "TextureFileLevel layout changed");
+
+struct TextureFileReport
+{
+  uint32_t mip_count = 0;
+  uint32_t layer_count = 0;
+  size_t data_bytes = 0;    // every level as stored
+  size_t rgba8_bytes = 0;   // the same chain as RGBA8
+  float level0_psnr = 0.0f; // dB over the stored channels, 0 when exact
+};
+
+/**
+ * Builds the mip chain of `image` (box filtered), encodes every level and
+ * writes the file. mip_count 0 keeps the full chain. ASTC has no encoder here;
+ * write those levels with writeTextureLevels from an external encoder's output.
+ */
+TextureFileReport writeTextureFile(const std::string &file_name, const ImageData &image, TextureFormat format, bool srgb, uint32_t mip_count = 0);
+
+/**
+ * The same for a texture array; every layer must have the same size
+ */
+TextureFileReport writeTextureFile(const std::string &file_name, const std::vector<ImageData> &layers, TextureFormat format, bool srgb, uint32_t mip_count = 0);
+
+/**
+ * Writes already encoded levels in table order (every layer of a level, then
+ * the next level), each textureLevelSize bytes. srgb is dropped for BC4 and
+ * BC5. BC7 levels are rejected unless the CPU fallback can decode them (mode 6
+ * blocks only), so a file never loads on one device and fails on another.
+ */
+void writeTextureLevels(const std::string &file_name, TextureFormat format, bool srgb, uint32_t width, uint32_t height, uint32_t layer_count, const std::vector<std::vector<uint8_t>> &levels);
+
+/**
+ * A mapped .vtex file. The tables are validated on open; level data points into the mapping.
+ */
+class TextureFile
+{
+public:
+  explicit TextureFile(const std::string &file_name);
+
+  const TextureFileHeader &header() const;
+  TextureFormat format() const { return static_cast<TextureFormat>(header().format); }
+  bool isSrgb() const { return (header().flags & TEXTURE_FILE_SRGB) != 0; }
+  uint32_t mipCount() const { return header().mip_count; }
+  uint32_t layerCount() const { return header().layer_count; }
+  const TextureFileLevel &level(uint32_t mip, uint32_t layer = 0) const { return levels[mip * layerCount() + layer]; }
+  const uint8_t *levelData(uint32_t mip, uint32_t layer = 0) const { return file.data() + level(mip, layer).offset; }
+
+  /**
+   * Every level decoded to RGBA8 in table order, for devices without the format
+   */
+  std::vector<ImageData> decompress() const;
+
+private:
+  MappedFile file;
+  const TextureFileLevel *levels = nullptr;
+};
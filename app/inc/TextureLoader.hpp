@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ImageFile.hpp"
+#include "JobSystem.hpp"
+#include "MipGenerator.hpp"
+#include "StagingUploader.hpp"
+#include "TextureFile.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+using TextureHandle = uint32_t;
+
+struct TextureLoadStats
+{
+  uint32_t pending = 0;  // queued or decoding
+  uint32_t decoded = 0;  // waiting for upload budget
+  uint32_t resident = 0;
+  uint32_t failed = 0;
+  uint32_t transcoded = 0; // block compressed files expanded to RGBA8 on the CPU
+  uint32_t uploaded = 0; // this update
+  VkDeviceSize uploaded_bytes = 0; // this update
+  float average_latency_ms = 0.0f; // load() to resident, over every resident texture
+  float max_latency_ms = 0.0f;
+};
+
+/**
+ * Time spent on one texture; total_ms stays 0 until it is resident
+ */
+struct TextureLoadTiming
+{
+  float decode_ms = 0.0f; // file read and decode on the worker
+  float total_ms = 0.0f;  // load() to resident, including queueing and upload
+};
+
+/**
+ * Loads textures without stalling the render thread.
+ *
+ * load() returns a handle at once and queues the file read and decode on the
+ * job system. update() uploads the images decoded since the last call through
+ * the staging uploader, up to upload_budget bytes, in one flush. Until then
+ * view() returns a 1x1 grey placeholder, so a handle can be bound right away;
+ * rewrite the descriptors of the handles in becameResident() after each update.
+ * A texture that fails to load keeps the placeholder.
+ *
+ * .vtex files are uploaded as stored, every mip straight from the mapping, when
+ * the device samples their format; otherwise they are decoded to RGBA8 on the
+ * worker. Files with several layers (texture arrays) get a 2D_ARRAY view.
+ * TGA and PNM images are uploaded as one RGBA8 level; with a mip generator
+ * the rest of their chain is built on the GPU in the same batch, so the
+ * uploader's queue must support graphics and compute.
+ */
+class TextureLoader
+{
+public:
+  VkDeviceSize upload_budget = 32 * 1024 * 1024; // per update, at least one texture
+
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, MipGenerator *mips = nullptr);
+  void cleanup();
+
+  /**
+   * Loading the same file again returns the first handle (and its color space).
+   * A .vtex file's own color space flag overrides srgb.
+   */
+  TextureHandle load(const std::string &file_name, bool srgb = true);
+
+  /**
+   * Call once per frame on the render thread, outside any frame's recording
+   */
+  void update();
+
+  VkImageView view(TextureHandle texture) const;
+  VkSampler sampler() const { return default_sampler; }
+  bool isResident(TextureHandle texture) const { return textures[texture].state == TextureState::Resident; }
+  bool isFailed(TextureHandle texture) const { return textures[texture].state == TextureState::Failed; }
+  const std::string &error(TextureHandle texture) const { return textures[texture].error; }
+  const TextureLoadTiming &timing(TextureHandle texture) const { return textures[texture].timing; }
+  const std::vector<TextureHandle> &becameResident() const { return resident_this_update; }
+  const TextureLoadStats &stats() const { return load_stats; }
+
+  /**
+   * The format a texture file's levels are uploaded in as stored
+   */
+  static VkFormat vulkanFormat(TextureFormat format, bool srgb);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class TextureState
+  {
+    Loading,
+    Resident,
+    Failed
+  };
+
+  struct Texture
+  {
+    Image image;
+    bool srgb = true;
+    TextureState state = TextureState::Loading;
+    Clock::time_point requested;
+    TextureLoadTiming timing;
+    std::string error;
+  };
+
+  struct DecodedTexture
+  {
+    TextureHandle texture;
+    std::vector<ImageData> levels;    // RGBA8 mips in texture file table order
+    std::unique_ptr<TextureFile> file; // or the mapped file, in a format the device samples
+    uint32_t layer_count;
+    bool srgb;
+    bool transcoded;
+    float decode_ms;
+    std::string error; // empty on success
+  };
+
+  void createPlaceholder(VkPhysicalDevice physical_device);
+  void queryFormats();
+  Image createTextureImage(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t layer_count, VkFormat format, VkImageUsageFlags extra_usage) const;
+  DecodedTexture decodeTexture(TextureHandle texture, const std::string &file_name, bool srgb) const;
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+  StagingUploader *uploader = nullptr;
+  JobSystem *jobs = nullptr;
+  MipGenerator *mips = nullptr;
+
+  Image placeholder;
+  VkSampler default_sampler = VK_NULL_HANDLE;
+  bool sampled_formats[TEXTURE_FORMAT_ASTC_4x4 + 1][2] = {}; // [format][srgb], read by the decode jobs
+
+  std::vector<Texture> textures;
+  std::unordered_map<std::string, TextureHandle> handles;
+  std::deque<DecodedTexture> ready; // decoded, over the upload budget so far
+  std::vector<TextureHandle> resident_this_update;
+  std::vector<MipChainHandle> mip_chains; // generated this update, removed after the flush
+  uint32_t loading = 0; // load() calls not yet resident or failed
+  double total_latency_ms = 0.0;
+
+  // Filled by the decode jobs
+  std::mutex decoded_mutex;
+  std::vector<DecodedTexture> decoded;
+
+  TextureLoadStats load_stats;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "ImageFile.hpp"
+#include "JobSystem.hpp"
+#include "StagingUploader.hpp"
+#include "TextureLoader.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct TextureStreamingStats
+{
+  uint32_t textures = 0;
+  uint32_t pending_reads = 0;
+  uint32_t streamed_in = 0; // textures refined this update
+  uint32_t evicted = 0;     // textures shrunk this update
+  uint32_t dropped = 0;     // reads finished with no room left, this update
+  uint32_t starved = 0;     // sampled textures coarser than desired
+  VkDeviceSize resident_bytes = 0;
+  VkDeviceSize budget_bytes = 0;
+};
+
+/**
+ * Keeps each texture's mip chain resident only down to the level the camera
+ * samples, under a fixed memory budget.
+ *
+ * Textures start with their mip tail (levels no larger than min_resident_size),
+ * which is never evicted. Fragment shaders report per material how finely they
+ * sample through MipFeedback.glsl into a host visible buffer per frame in
+ * flight; update() reads the buffer of the frame that just completed, so the
+ * feedback is frames_in_flight frames old and never waits on the GPU.
+ * The material's rate becomes a desired mip per texture of that material.
+ *
+ * A texture is refined by decoding its file on the job system and re-creating
+ * the image with the finer levels; it is shrunk by copying the coarser levels
+ * into a smaller image on the GPU. Shrinking picks textures resident finer than
+ * they are sampled first, then the least recently sampled ones, and never a
+ * texture sampled in the last frame unless it is over-resident. Old images are
+ * destroyed frames_in_flight updates later.
+ *
+ * The uploader must submit to the queue that renders, so its layout
+ * transitions are ordered after the frames still sampling a texture.
+ * Fragment shaders writing feedback need the fragmentStoresAndAtomics feature.
+ */
+class TextureStreamer
+{
+public:
+  uint32_t min_resident_size = 64; // pinned mip tail, in texels of the larger side
+  uint32_t max_pending_reads = 4;
+  uint32_t keep_frames = 120;      // unsampled this long, a texture falls back to its tail
+  float mip_bias = 0.0f;           // added to every desired mip
+
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, uint32_t material_count, VkDeviceSize memory_budget, uint32_t frames_in_flight);
+  void cleanup();
+
+  /**
+   * The texture shows a grey placeholder until its tail is resident
+   */
+  TextureHandle load(const std::string &file_name, bool srgb = true);
+
+  /**
+   * The texture is sampled by `material` with the uv the material's shader reports
+   */
+  void addMaterialTexture(uint32_t material, TextureHandle texture);
+
+  /**
+   * Call once per frame after waiting on the fence of frame_index, before
+   * recording it. Reads and clears feedbackBuffer(frame_index).
+   */
+  void update(uint32_t frame_index);
+
+  /**
+   * Records the barrier that makes the frame's feedback writes visible to
+   * update(). Call at the end of the frame, outside the render pass.
+   */
+  void recordFeedbackBarrier(VkCommandBuffer command_buffer) const;
+
+  /**
+   * Bind as the storage buffer of MipFeedback.glsl for frame_index
+   */
+  VkBuffer feedbackBuffer(uint32_t frame_index) const { return feedback[frame_index].buffer; }
+  VkDeviceSize feedbackSize() const { return feedback.empty() ? 0 : feedback[0].size; }
+
+  /**
+   * Host view of feedbackBuffer(frame_index), one rate per material as
+   * MipFeedback.glsl writes it, for tools that report rates without rendering
+   */
+  uint32_t *feedbackRates(uint32_t frame_index) const { return static_cast<uint32_t*>(feedback[frame_index].mapped); }
+
+  VkImageView view(TextureHandle texture) const;
+  VkSampler sampler() const { return default_sampler; }
+  uint32_t residentMip(TextureHandle texture) const { return textures[texture].resident_base; }
+  uint32_t desiredMip(TextureHandle texture) const { return textures[texture].desired; }
+  uint32_t mipCount(TextureHandle texture) const { return textures[texture].mip_count; }
+  uint32_t tailMip(TextureHandle texture) const { return textures[texture].tail_base; }
+
+  /**
+   * Textures whose view changed this update. The old view stays valid for
+   * frames_in_flight updates, so each frame's descriptor set can be rewritten
+   * the next time that frame is recorded.
+   */
+  const std::vector<TextureHandle> &changed() const { return changed_textures; }
+  const TextureStreamingStats &stats() const { return frame_stats; }
+
+private:
+  struct StreamedTexture
+  {
+    std::string file_name;
+    bool srgb = true;
+    Image image;                // levels resident_base .. mip_count - 1
+    uint32_t width = 0;         // of level 0, known once the tail is loaded
+    uint32_t height = 0;
+    uint32_t mip_count = 0;
+    uint32_t tail_base = 0;     // first pinned level
+    uint32_t resident_base = 0;
+    uint32_t desired = 0;
+    uint32_t sampled_rate = 0;  // this update's feedback, 0 = not sampled
+    uint64_t last_sampled = 0;
+    bool requested = false;
+    bool failed = false;
+  };
+
+  static const uint32_t TAIL = UINT32_MAX; // read base of a texture's first load
+
+  struct MipRead
+  {
+    TextureHandle texture;
+    uint32_t base;
+    uint32_t width; // of level 0
+    uint32_t height;
+    std::vector<ImageData> levels; // base .. 1x1
+    std::string error;
+  };
+
+  struct RetiredImage
+  {
+    Image image;
+    uint64_t frame;
+  };
+
+  static VkDeviceSize chainBytes(uint32_t width, uint32_t height, uint32_t base);
+
+  void submitRead(TextureHandle texture, uint32_t base);
+  void readFeedback(uint32_t frame_index);
+  void receiveReads();
+  void requestReads();
+  VkDeviceSize residentBytes(const StreamedTexture &texture) const;
+  bool makeRoom(VkDeviceSize bytes, TextureHandle keep);
+  void shrink(TextureHandle texture, uint32_t new_base);
+  void replaceImage(StreamedTexture &texture, const Image &image, uint32_t base);
+  uint32_t targetMip(const StreamedTexture &texture) const;
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+  StagingUploader *uploader = nullptr;
+  JobSystem *jobs = nullptr;
+  uint32_t frames_in_flight = 1;
+  uint64_t frame = 0;
+
+  Image placeholder;
+  VkSampler default_sampler = VK_NULL_HANDLE;
+  std::vector<Buffer> feedback;       // per frame in flight, one uint per material
+  std::vector<std::vector<TextureHandle>> material_textures;
+
+  std::vector<StreamedTexture> textures;
+  std::vector<RetiredImage> retired;
+  std::vector<TextureHandle> changed_textures;
+  uint32_t pending_reads = 0;
+  VkDeviceSize memory_budget = 0;
+  VkDeviceSize resident_bytes = 0;
+
+  // Filled by the read jobs
+  std::mutex read_mutex;
+  std::vector<MipRead> finished_reads;
+
+  TextureStreamingStats frame_stats;
+};
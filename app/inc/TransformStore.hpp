@@ -0,0 +1,79 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+typedef uint32_t TransformId;
+const TransformId INVALID_TRANSFORM = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Scene transform hierarchy stored as structure-of-arrays.
+ * Slots are sorted by depth so every level is one contiguous range that comes
+ * after its parents; update() walks the levels in order and splits each one
+ * across the job system. Only nodes whose local transform changed, or whose
+ * parent was recomputed, get a new world matrix.
+ *
+ * TransformIds stay valid for the life of the store, slots may move when a
+ * node is created under a parent of a shallower level than the last one.
+ */
+class TransformStore
+{
+public:
+  TransformId create(TransformId parent = INVALID_TRANSFORM, const glm::vec3 &position = glm::vec3(0.0f), const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3 &scale = glm::vec3(1.0f));
+  void clear();
+
+  void setPosition(TransformId id, const glm::vec3 &position);
+  void setRotation(TransformId id, const glm::quat &rotation);
+  void setScale(TransformId id, const glm::vec3 &scale);
+
+  const glm::vec3 &position(TransformId id) const { return positions[slots[id]]; }
+  const glm::quat &rotation(TransformId id) const { return rotations[slots[id]]; }
+  const glm::vec3 &scale(TransformId id) const { return scales[slots[id]]; }
+  TransformId parent(TransformId id) const;
+
+  /**
+   * World matrix as of the last update()
+   */
+  const glm::mat4 &world(TransformId id) const { return worlds[slots[id]]; }
+
+  /**
+   * Recomputes the world matrices of every dirty subtree.
+   * Runs serially without a job system.
+   */
+  void update(JobSystem *jobs = nullptr);
+
+  size_t size() const { return ids.size(); }
+  uint32_t levelCount() const { return static_cast<uint32_t>(level_starts.size()); }
+  uint32_t lastUpdateCount() const { return last_update_count; }
+
+private:
+  uint32_t markDirty(TransformId id);
+  void sortByDepth();
+
+  // TransformId -> slot and slot -> TransformId
+  std::vector<uint32_t> slots;
+  std::vector<TransformId> ids;
+
+  // Per slot
+  std::vector<uint32_t> parents;
+  std::vector<uint16_t> depths;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<glm::vec3> scales;
+  std::vector<glm::mat4> worlds;
+  std::vector<uint8_t> dirty;
+
+  // Per depth
+  std::vector<uint32_t> level_starts;
+  std::vector<uint8_t> level_dirty;
+
+  bool unsorted = false;
+  uint32_t last_update_count = 0;
+};
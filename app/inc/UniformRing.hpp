@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ShaderLayout.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <cstdint>
+
+/**
+ * What every device guarantees for maxUniformBufferRange
+ */
+const uint32_t UNIFORM_RANGE_GUARANTEED_SIZE = 16384;
+
+/**
+ * Where a write landed: bind `buffer` as a dynamic uniform buffer with range
+ * `size` and pass `offset` as its dynamic offset, or write it as a plain one
+ */
+struct UniformAllocation
+{
+  VkBuffer buffer = VK_NULL_HANDLE;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+};
+
+/**
+ * Per-frame uniform data in one persistently mapped, host coherent buffer:
+ * a slice per frame in flight, filled front to back. Writing a block is a
+ * single memcpy of its host struct, which the ShaderBlock checks guarantee
+ * already has the shader's layout; nothing is repacked and nothing is
+ * recorded into the command buffer.
+ *
+ * A frame's slice is reused frames_in_flight frames later, so beginFrame()
+ * must come after that frame's fence signaled.
+ */
+class UniformRing
+{
+public:
+  /**
+   * frame_capacity: bytes one frame writes at most, before alignment
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize frame_capacity, uint32_t frames_in_flight);
+  void cleanup();
+
+  void beginFrame(uint32_t frame);
+
+  /**
+   * Reserves `size` bytes at the device's uniform offset alignment
+   */
+  UniformAllocation allocate(uint32_t size);
+
+  template <typename T>
+  UniformAllocation write(const T &data)
+  {
+    static_assert(ShaderBlockLayout<T>::layout == BLOCK_LAYOUT_STD140, "Uniform blocks are std140");
+    static_assert(sizeof(T) <= UNIFORM_RANGE_GUARANTEED_SIZE, "Uniform block exceeds the guaranteed 16384 byte range");
+
+    UniformAllocation allocation = allocate(sizeof(T));
+    std::memcpy(static_cast<uint8_t*>(buffer.mapped) + allocation.offset, &data, sizeof(T));
+    return allocation;
+  }
+
+  VkBuffer ringBuffer() const { return buffer.buffer; }
+
+  /**
+   * Bytes a frame reserves for `size` bytes of writes, padded to the alignment
+   */
+  VkDeviceSize alignedSize(VkDeviceSize size) const { return (size + alignment - 1) / alignment * alignment; }
+
+private:
+  VkDevice device = VK_NULL_HANDLE;
+  Buffer buffer;
+  VkDeviceSize alignment = 1;
+  VkDeviceSize frame_size = 0; // one slice, a multiple of alignment
+  VkDeviceSize frame_start = 0;
+  VkDeviceSize frame_used = 0;
+};
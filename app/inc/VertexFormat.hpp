@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compile-time vertex input descriptions.
+ *
+ * A vertex struct lists its attributes once, in shader location order, by
+ * specializing VertexFormat:
+ *
+ *   template <>
+ *   struct VertexFormat<Vertex>
+ *   {
+ *     static constexpr VertexAttribute attributes[] =
+ *     {
+ *       VERTEX_ATTRIBUTE(Vertex, position),                             // location 0, R32G32B32_SFLOAT
+ *       VERTEX_ATTRIBUTE_AS(Vertex, color, VK_FORMAT_R8G8B8A8_UNORM)    // location 1
+ *     };
+ *   };
+ *
+ * VertexInput<Vertex> then holds the binding and attribute descriptions as
+ * constexpr arrays and static_asserts that every format has the size of its
+ * member, that attributes neither overlap nor run past the stride, and that
+ * the format stays within the limits every device supports.
+ */
+struct VertexAttribute
+{
+  uint32_t offset;
+  uint32_t size;   // of the member
+  VkFormat format;
+};
+
+/**
+ * Format a member type gets without VERTEX_ATTRIBUTE_AS. Only types with one
+ * obvious format have one; packed and normalized members must name theirs.
+ */
+template <typename T>
+struct DefaultVertexFormat
+{
+  static_assert(sizeof(T) == 0, "No default vertex format for this member type, use VERTEX_ATTRIBUTE_AS");
+};
+
+template <> struct DefaultVertexFormat<float> { static constexpr VkFormat format = VK_FORMAT_R32_SFLOAT; };
+template <> struct DefaultVertexFormat<glm::vec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT; };
+template <> struct DefaultVertexFormat<glm::vec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT; };
+template <> struct DefaultVertexFormat<glm::vec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT; };
+template <> struct DefaultVertexFormat<int32_t> { static constexpr VkFormat format = VK_FORMAT_R32_SINT; };
+template <> struct DefaultVertexFormat<glm::ivec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_SINT; };
+template <> struct DefaultVertexFormat<glm::ivec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_SINT; };
+template <> struct DefaultVertexFormat<glm::ivec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SINT; };
+template <> struct DefaultVertexFormat<uint32_t> { static constexpr VkFormat format = VK_FORMAT_R32_UINT; };
+template <> struct DefaultVertexFormat<glm::uvec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_UINT; };
+template <> struct DefaultVertexFormat<glm::uvec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_UINT; };
+template <> struct DefaultVertexFormat<glm::uvec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_UINT; };
+
+#define VERTEX_ATTRIBUTE_AS(vertex, member, vk_format) \
+  VertexAttribute{static_cast<uint32_t>(offsetof(vertex, member)), static_cast<uint32_t>(sizeof(vertex::member)), vk_format}
+
+#define VERTEX_ATTRIBUTE(vertex, member) \
+  VERTEX_ATTRIBUTE_AS(vertex, member, DefaultVertexFormat<std::remove_cv_t<decltype(vertex::member)>>::format)
+
+/**
+ * Specialized for every vertex struct, see above
+ */
+template <typename V>
+struct VertexFormat;
+
+/**
+ * Bytes per element of the formats vertex structs use; 0 for any other format
+ */
+constexpr uint32_t vertexFormatSize(VkFormat format)
+{
+  switch (format)
+  {
+    case VK_FORMAT_R8G8_UNORM: case VK_FORMAT_R8G8_SNORM: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8_SINT:
+      return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SNORM: case VK_FORMAT_R8G8B8A8_UINT: case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32: case VK_FORMAT_A2B10G10R10_SNORM_PACK32:
+    case VK_FORMAT_R16G16_UNORM: case VK_FORMAT_R16G16_SNORM: case VK_FORMAT_R16G16_UINT: case VK_FORMAT_R16G16_SINT: case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT: case VK_FORMAT_R32_UINT: case VK_FORMAT_R32_SINT:
+      return 4;
+    case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SNORM: case VK_FORMAT_R16G16B16A16_UINT: case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32_SINT:
+      return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32_SINT:
+      return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R32G32B32A32_SINT:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Guaranteed minimums of maxVertexInputAttributes, maxVertexInputAttributeOffset
+ * and maxVertexInputBindingStride
+ */
+const uint32_t VERTEX_ATTRIBUTE_GUARANTEED_COUNT = 16;
+const uint32_t VERTEX_ATTRIBUTE_GUARANTEED_OFFSET = 2047;
+const uint32_t VERTEX_STRIDE_GUARANTEED_SIZE = 2048;
+
+template <typename V>
+constexpr bool vertexFormatsMatchMembers()
+{
+  for (const VertexAttribute &attribute : VertexFormat<V>::attributes)
+  {
+    if (vertexFormatSize(attribute.format) != attribute.size)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename V>
+constexpr bool vertexAttributesDisjoint()
+{
+  const auto &attributes = VertexFormat<V>::attributes;
+  for (size_t i = 0; i < std::size(attributes); i++)
+  {
+    for (size_t j = i + 1; j < std::size(attributes); j++)
+    {
+      if (attributes[i].offset < attributes[j].offset + attributes[j].size && attributes[j].offset < attributes[i].offset + attributes[i].size)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename V>
+constexpr bool vertexAttributesWithinStride()
+{
+  for (const VertexAttribute &attribute : VertexFormat<V>::attributes)
+  {
+    if (attribute.offset + attribute.size > sizeof(V) || attribute.offset > VERTEX_ATTRIBUTE_GUARANTEED_OFFSET)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Binding and attribute descriptions of V at `binding`, attribute i at location first_location + i
+ */
+template <typename V, uint32_t binding = 0, VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX, uint32_t first_location = 0>
+struct VertexInput
+{
+  static_assert(std::is_standard_layout<V>::value && std::is_trivially_copyable<V>::value, "Vertex structs are uploaded as raw bytes and need offsetof");
+  static_assert(sizeof(V) <= VERTEX_STRIDE_GUARANTEED_SIZE, "Vertex stride exceeds the guaranteed 2048 bytes");
+  static_assert(first_location + std::size(VertexFormat<V>::attributes) <= VERTEX_ATTRIBUTE_GUARANTEED_COUNT, "Vertex format exceeds the guaranteed 16 attributes");
+  static_assert(vertexFormatsMatchMembers<V>(), "Vertex attribute format does not match the size of its member");
+  static_assert(vertexAttributesDisjoint<V>(), "Vertex attributes overlap");
+  static_assert(vertexAttributesWithinStride<V>(), "Vertex attribute runs past the stride or the guaranteed offset");
+
+  static constexpr uint32_t attribute_count = static_cast<uint32_t>(std::size(VertexFormat<V>::attributes));
+
+  static constexpr VkVertexInputBindingDescription binding_description = {binding, static_cast<uint32_t>(sizeof(V)), input_rate};
+
+  static constexpr std::array<VkVertexInputAttributeDescription, attribute_count> attributeDescriptions()
+  {
+    std::array<VkVertexInputAttributeDescription, attribute_count> descriptions{};
+    for (uint32_t i = 0; i < attribute_count; i++)
+    {
+      const VertexAttribute &attribute = VertexFormat<V>::attributes[i];
+      descriptions[i] = {first_location + i, binding, attribute.format, attribute.offset};
+    }
+    return descriptions;
+  }
+
+  static constexpr std::array<VkVertexInputAttributeDescription, attribute_count> attribute_descriptions = attributeDescriptions();
+
+  /**
+   * Vertex input state of a pipeline fetching only V
+   */
+  static VkPipelineVertexInputStateCreateInfo createInfo()
+  {
+    VkPipelineVertexInputStateCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    info.vertexBindingDescriptionCount = 1;
+    info.pVertexBindingDescriptions = &binding_description;
+    info.vertexAttributeDescriptionCount = attribute_count;
+    info.pVertexAttributeDescriptions = attribute_descriptions.data();
+    return info;
+  }
+};
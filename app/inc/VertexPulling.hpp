@@ -0,0 +1,132 @@
+#pragma once
+
+#include "DrawList.hpp"
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "VertexQuantization.hpp"
+#include "VkHelpers.hpp"
+#include "ShaderLayout.hpp"
+#include "StagingUploader.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * True if the device is Vulkan 1.2 with bufferDeviceAddress. Chain
+ * vertexPullingFeatures() into VkDeviceCreateInfo to use a MeshPool.
+ */
+bool isVertexPullingSupported(VkInstance instance, VkPhysicalDevice physical_device);
+
+VkPhysicalDeviceBufferDeviceAddressFeatures vertexPullingFeatures();
+
+/**
+ * Push constants of Pulled.vert (see VertexPulling.glsl): where the draw's
+ * vertices start in the pool and how to decode them
+ */
+struct PulledDrawConstants
+{
+  glm::mat4 transform;
+  VkDeviceAddress vertices = 0;
+  VertexEncoding encoding = VERTEX_ENCODING_FLOAT;
+  uint32_t padding = 0;
+  glm::vec4 position_offset = glm::vec4(0.0f); // QuantizationParams, quantized meshes only
+  glm::vec4 position_scale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+};
+
+template <>
+struct ShaderBlock<PulledDrawConstants>
+{
+  static constexpr BlockLayout layout = BLOCK_LAYOUT_STD430;
+  static constexpr BlockMember members[] =
+  {
+    BLOCK_MEMBER(PulledDrawConstants, transform),
+    BLOCK_MEMBER(PulledDrawConstants, vertices),
+    BLOCK_MEMBER(PulledDrawConstants, encoding),
+    BLOCK_MEMBER(PulledDrawConstants, padding),
+    BLOCK_MEMBER(PulledDrawConstants, position_offset),
+    BLOCK_MEMBER(PulledDrawConstants, position_scale)
+  };
+};
+
+static_assert(ShaderBlockLayout<PulledDrawConstants>::size <= PUSH_CONSTANT_GUARANTEED_SIZE, "PulledDrawConstants must fit the guaranteed push constant size");
+
+/**
+ * A mesh inside a MeshPool. Index offsets of submeshes and lods are relative
+ * to first_index, which counts index_type indices from the start of the pool's
+ * index buffer.
+ */
+struct PooledMesh
+{
+  VkDeviceAddress vertices = 0;
+  VertexEncoding encoding = VERTEX_ENCODING_FLOAT;
+  QuantizationParams quantization;
+  VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+  uint32_t first_index = 0;
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+  std::vector<Submesh> submeshes;
+  std::vector<MeshLod> lods; // lod_count per submesh, see MeshData
+  uint32_t lod_count = 1;
+  glm::vec3 bounds_min = glm::vec3(0.0f);
+  glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+/**
+ * Programmable vertex pulling: the vertices of every mesh live in one storage
+ * buffer and the vertex shader fetches and decodes them through the address
+ * in its push constants, so the pool's one pipeline draws meshes of any
+ * encoding. Indices of every mesh share one index buffer and are still
+ * fetched by the hardware; 16-bit and 32-bit meshes only differ in the index
+ * type the draw binds.
+ *
+ * Quantized vertices are decoded in the shader, so unlike uploadMesh() they
+ * are never expanded for devices without 16-bit vertex formats.
+ *
+ * Meshes are appended and stay until the pool is destroyed.
+ */
+class MeshPool
+{
+public:
+  /**
+   * The device needs isVertexPullingSupported() with vertexPullingFeatures() enabled
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, VkRenderPass render_pass, VkDeviceSize vertex_capacity, VkDeviceSize index_capacity);
+  void cleanup();
+
+  /**
+   * Stages the vertex and index blobs straight from the mapped cache. The
+   * copies are queued on the uploader; call flush() before drawing.
+   */
+  PooledMesh add(StagingUploader &uploader, const MeshCache &cache);
+
+  /**
+   * Draw of one level of a submesh, to add to a DrawList with drawConstants() as its DrawData constants
+   */
+  DrawPacket drawPacket(const PooledMesh &mesh, uint32_t submesh, uint32_t lod = 0) const;
+
+  VkPipeline pipeline() const { return graphics_pipeline; }
+  VkPipelineLayout pipelineLayout() const { return pipeline_layout; }
+  VkBuffer indexBuffer() const { return index_buffer.buffer; }
+  VkDeviceSize vertexBytes() const { return vertex_offset; }
+  VkDeviceSize indexBytes() const { return index_offset; }
+
+private:
+  void createPipeline(VkRenderPass render_pass);
+
+  VkDevice device = VK_NULL_HANDLE;
+  Buffer vertex_buffer;
+  Buffer index_buffer;
+  VkDeviceAddress vertex_address = 0;
+  VkDeviceSize vertex_offset = 0;
+  VkDeviceSize index_offset = 0;
+
+  VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  VkPipeline graphics_pipeline = VK_NULL_HANDLE;
+};
+
+PulledDrawConstants drawConstants(const PooledMesh &mesh, const glm::mat4 &transform);
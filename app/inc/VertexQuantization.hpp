@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * 20 byte vertex (48 bytes as Vertex)
+ *  - position: unorm16 relative to the mesh bounds, w holds the tangent sign
+ *  - normal, tangent: octahedral snorm16
+ *  - uv: half floats
+ */
+struct QuantizedVertex
+{
+  glm::u16vec4 position;
+  glm::i16vec2 normal;
+  glm::i16vec2 tangent;
+  glm::u16vec2 uv;
+};
+
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must stay tightly packed");
+
+enum VertexEncoding : uint32_t
+{
+  VERTEX_ENCODING_FLOAT = 0,
+  VERTEX_ENCODING_QUANTIZED = 1
+};
+
+/**
+ * Maps the quantized positions back to mesh space: position = offset + q * scale.
+ * Fed to Quantized.vert; unused by the float encoding.
+ */
+struct QuantizationParams
+{
+  glm::vec4 position_offset = glm::vec4(0.0f);
+  glm::vec4 position_scale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+};
+
+/**
+ * Largest error introduced by quantization, measured against the source mesh
+ */
+struct QuantizationReport
+{
+  float max_position_error = 0.0f;  // mesh units
+  float max_normal_error = 0.0f;    // degrees
+  float max_tangent_error = 0.0f;   // degrees
+  float max_uv_error = 0.0f;
+  size_t source_bytes = 0;
+  size_t quantized_bytes = 0;
+};
+
+struct QuantizedMesh
+{
+  std::vector<QuantizedVertex> vertices;
+  QuantizationParams params;
+  QuantizationReport report;
+};
+
+QuantizedMesh quantizeMesh(const MeshData &mesh);
+Vertex dequantizeVertex(const QuantizedVertex &vertex, const QuantizationParams &params);
+
+glm::i16vec2 encodeOctahedral(const glm::vec3 &direction);
+glm::vec3 decodeOctahedral(const glm::i16vec2 &encoded);
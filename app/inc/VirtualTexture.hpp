@@ -0,0 +1,241 @@
+#pragma once
+
+#include "JobSystem.hpp"
+#include "StagingUploader.hpp"
+#include "TextureFile.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+const uint32_t VIRTUAL_TEXTURE_MAX_LEVELS = 16;
+
+/**
+ * Uniform block of VirtualTexture.glsl (std140), written once by init()
+ */
+struct VirtualTextureInfo
+{
+  uint32_t size[4];   // virtual width, height, tile width, tile height (content texels)
+  uint32_t config[4]; // page levels, 1 when sampling the sparse image, tile border, 0
+  uint32_t cache[4];  // cache width, height, slot width, height (software path)
+  uint32_t levels[VIRTUAL_TEXTURE_MAX_LEVELS][4]; // tiles x, tiles y, first feedback bit, 0
+};
+
+struct VirtualTextureStats
+{
+  uint32_t page_count = 0;     // tiles over every page level
+  uint32_t cache_slots = 0;
+  uint32_t resident_tiles = 0; // pinned included
+  uint32_t pending_reads = 0;
+  uint32_t requested = 0;      // reads started this update
+  uint32_t uploaded = 0;       // this update
+  uint32_t evicted = 0;        // this update
+  uint32_t dropped = 0;        // reads finished with no slot to spare, this update
+  bool sparse = false;
+};
+
+/**
+ * Whether images of `format` can be partially resident (sparseBinding and
+ * sparseResidencyImage2D, which the device must also enable)
+ */
+bool isSparseResidencySupported(VkPhysicalDevice physical_device, VkFormat format);
+
+/**
+ * Virtual texturing of one texture file (.vtex) far bigger than the memory it
+ * may use, typically a terrain or megatexture.
+ *
+ * The texture is split into fixed size tiles on every page level; the last
+ * page level is pinned, the others are made resident on demand. Fragment
+ * shaders sample through VirtualTexture.glsl, which reads a page table (one
+ * texel per tile and level, pointing at the finest resident tile covering it)
+ * and marks the tiles it wanted in a feedback bitmask per frame in flight.
+ * update() reads the bitmask of the frame that just completed, copies the
+ * requested tiles out of the mapped file on the job system, coarser levels
+ * first and only below a resident parent, and uploads them through the staging
+ * uploader together with the changed page table rows. When the cache is full
+ * the least recently requested tile without resident children is evicted;
+ * its slot is reused frames_in_flight updates later.
+ *
+ * With a sparse binding queue and device support, tiles are the sparse
+ * granularity and are bound into a partially resident image of the whole
+ * texture with vkQueueBindSparse; shaders sample that image directly, with the
+ * LOD clamped to the page table's resident level. Texels next to a missing
+ * tile filter against undefined data there (zeros with
+ * residencyNonResidentStrict). Otherwise tiles go to slots of a physical cache
+ * texture, with a border replicated from their neighbours for filtering, and
+ * the shader translates addresses itself; this path needs no optional features.
+ *
+ * Page levels stop at the first level that fits in one tile or has an odd
+ * size, so every tile's parent covers it exactly. The uploader must submit to
+ * the queue that renders.
+ */
+class VirtualTexture
+{
+public:
+  uint32_t max_uploads = 32; // tiles per update
+  uint32_t max_pending_reads = 64;
+
+  /**
+   * cache_slots tiles may be resident besides the pinned level. tile_size (a
+   * power of two) and border apply to the software path; the sparse path uses
+   * the format's sparse block size. sparse_queue is a queue of a family with
+   * VK_QUEUE_SPARSE_BINDING_BIT, or VK_NULL_HANDLE for the software path.
+   */
+  void init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, VkQueue sparse_queue, const std::string &file_name,
+    uint32_t cache_slots, uint32_t frames_in_flight, uint32_t tile_size = 128, uint32_t border = 4);
+  void cleanup();
+
+  /**
+   * Call once per frame after waiting on the fence of frame_index, before
+   * recording it. Reads and clears feedbackBuffer(frame_index).
+   */
+  void update(uint32_t frame_index);
+
+  /**
+   * Records the barrier that makes the frame's feedback writes visible to
+   * update(). Call at the end of the frame, outside the render pass.
+   */
+  void recordFeedbackBarrier(VkCommandBuffer command_buffer) const;
+
+  // Bindings of VirtualTexture.glsl, in order
+  VkBuffer infoBuffer() const { return info.buffer; }
+  VkImageView pageTableView() const { return page_table.view; }
+  VkImageView cacheView() const { return cache.view; } // the sparse image on the sparse path
+  VkBuffer feedbackBuffer(uint32_t frame_index) const { return feedback[frame_index].buffer; }
+  VkDeviceSize feedbackSize() const { return feedback.empty() ? 0 : feedback[0].size; }
+
+  VkSampler pageTableSampler() const { return nearest_sampler; }
+  VkSampler cacheSampler() const { return linear_sampler; }
+
+  /**
+   * Host view of feedbackBuffer(frame_index), for tools that request tiles
+   * without rendering. Tile bits follow the levels of layout().
+   */
+  uint32_t *feedbackBits(uint32_t frame_index) const { return static_cast<uint32_t*>(feedback[frame_index].mapped); }
+  const VirtualTextureInfo &layout() const { return *static_cast<const VirtualTextureInfo*>(info.mapped); }
+
+  // The page table in SHADER_READ_ONLY_OPTIMAL between updates, readable by transfers
+  VkImage pageTableImage() const { return page_table.image; }
+  VkExtent2D pageTableExtent() const { return {page_table.width, page_table.height}; }
+
+  bool isSparse() const { return sparse; }
+  const VirtualTextureStats &stats() const { return frame_stats; }
+
+private:
+  static const uint32_t NO_SLOT = UINT32_MAX;
+
+  struct PageLevel
+  {
+    uint32_t width;   // texels
+    uint32_t height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t first_tile;
+    uint32_t table_offset; // of the level's page table texels
+  };
+
+  struct Tile
+  {
+    uint32_t slot = NO_SLOT;       // while resident (software path)
+    uint32_t bound_slot = NO_SLOT; // memory bound to the tile (sparse path), kept after eviction
+    uint64_t last_requested = 0;
+    uint32_t resident_children = 0;
+    bool resident = false;
+    bool pending = false;
+  };
+
+  struct CacheSlot
+  {
+    uint32_t tile = NO_SLOT;     // last tile stored in (or bound to) the slot
+    uint64_t reusable_frame = 0; // after an eviction
+    bool pinned = false;
+  };
+
+  struct TileRead
+  {
+    uint32_t tile;
+    std::vector<uint8_t> data; // blocks row by row: the slot with its border, or the tile clipped to the level (sparse)
+  };
+
+  void choosePath(uint32_t tile_size, uint32_t border);
+  void createSparseImage();
+  void createPageLevels();
+  void createSparseMemory(uint32_t cache_slots);
+  void createCache(uint32_t cache_slots);
+  void createPageTable();
+  void createBuffers();
+  void createSamplers();
+  void loadPinnedLevels();
+
+  uint32_t tileLevel(uint32_t tile) const;
+  uint32_t parentTile(uint32_t tile) const;
+  VkExtent2D tileExtent(uint32_t tile) const; // content texels, clipped to the level
+  TileRead readTile(uint32_t tile) const;
+
+  void readFeedback(uint32_t frame_index);
+  void requestTile(uint32_t tile);
+  void submitReads();
+  void receiveReads(std::vector<TileRead> &reads, std::vector<uint32_t> &read_slots);
+  uint32_t allocateSlot(uint32_t slot_waits, bool &retry); // slot_waits: reads of this update already waiting for one
+  void bindSparseTiles(const std::vector<TileRead> &reads, const std::vector<uint32_t> &read_slots);
+  void submitBinds(const VkBindSparseInfo &bind_info);
+  void stageRegion(VkImage image, uint32_t level, uint32_t x, uint32_t y, uint32_t width, uint32_t height, TextureFormatInfo region_format, const uint8_t *data);
+  void stageTile(const TileRead &read, uint32_t slot);
+  void rebuildPageTable();
+  void stagePageTable(bool everything);
+  void recordTransferBarriers(VkCommandBuffer command_buffer, bool to_transfer, bool include_cache) const;
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+  StagingUploader *uploader = nullptr;
+  JobSystem *jobs = nullptr;
+  VkQueue sparse_queue = VK_NULL_HANDLE;
+  uint32_t frames_in_flight = 1;
+  uint64_t frame = 0;
+
+  std::unique_ptr<TextureFile> file;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  TextureFormatInfo format_info{};
+  bool sparse = false;
+  uint32_t tile_width = 0;
+  uint32_t tile_height = 0;
+  uint32_t border = 0;
+  uint32_t slots_x = 0;
+
+  std::vector<PageLevel> levels;
+  std::vector<Tile> tiles;
+  std::vector<CacheSlot> slots;
+  std::vector<uint32_t> free_slots;       // evicted slots become reusable at their reusable_frame
+  std::vector<uint32_t> page_entries;     // page table texels, every level
+  std::vector<uint32_t> uploaded_entries;
+  std::vector<uint32_t> requests;         // this update, coarsest level first
+  uint32_t page_table_width = 0;
+  uint32_t page_table_height = 0;
+  uint32_t pending_reads = 0;
+
+  Image cache;      // software cache, or the sparse image (no memory of its own)
+  Image page_table; // R8G8B8A8_UINT: slot x, slot y, resident level, 1
+  VkDeviceMemory tile_memory = VK_NULL_HANDLE;   // sparse: one block per slot
+  VkDeviceMemory pinned_memory = VK_NULL_HANDLE; // sparse: the pinned levels and the mip tail
+  VkDeviceSize sparse_block_size = 0;
+  uint32_t sparse_memory_types = 0;
+  VkSparseImageMemoryRequirements sparse_requirements{};
+  VkFence bind_fence = VK_NULL_HANDLE;
+  bool layouts_initialized = false;
+
+  Buffer info;
+  std::vector<Buffer> feedback; // per frame in flight, one bit per tile
+  VkSampler nearest_sampler = VK_NULL_HANDLE;
+  VkSampler linear_sampler = VK_NULL_HANDLE;
+
+  // Filled by the read jobs
+  std::mutex read_mutex;
+  std::vector<TileRead> finished_reads;
+
+  VirtualTextureStats frame_stats;
+};
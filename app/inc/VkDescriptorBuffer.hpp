@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+/*
+* VK_EXT_descriptor_buffer, for Vulkan headers older than 1.3.235 (the bundled
+  ones). Same names and values as the registry; the functions are loaded with
+  vkGetDeviceProcAddr, so only their pointer types are declared.
+*/
+#ifndef VK_EXT_descriptor_buffer
+#define VK_EXT_descriptor_buffer 1
+#define VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME "VK_EXT_descriptor_buffer"
+
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT = static_cast<VkStructureType>(1000316000);
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT = static_cast<VkStructureType>(1000316002);
+const VkStructureType VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT = static_cast<VkStructureType>(1000316003);
+const VkStructureType VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT = static_cast<VkStructureType>(1000316004);
+const VkStructureType VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT = static_cast<VkStructureType>(1000316011);
+
+const VkDescriptorSetLayoutCreateFlagBits VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT = static_cast<VkDescriptorSetLayoutCreateFlagBits>(0x00000010);
+const VkBufferUsageFlagBits VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT = static_cast<VkBufferUsageFlagBits>(0x00200000);
+const VkBufferUsageFlagBits VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT = static_cast<VkBufferUsageFlagBits>(0x00400000);
+const VkPipelineCreateFlagBits VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT = static_cast<VkPipelineCreateFlagBits>(0x20000000);
+
+typedef struct VkPhysicalDeviceDescriptorBufferPropertiesEXT
+{
+  VkStructureType sType;
+  void *pNext;
+  VkBool32 combinedImageSamplerDescriptorSingleArray;
+  VkBool32 bufferlessPushDescriptors;
+  VkBool32 allowSamplerImageViewPostSubmitCreation;
+  VkDeviceSize descriptorBufferOffsetAlignment;
+  uint32_t maxDescriptorBufferBindings;
+  uint32_t maxResourceDescriptorBufferBindings;
+  uint32_t maxSamplerDescriptorBufferBindings;
+  uint32_t maxEmbeddedImmutableSamplerBindings;
+  uint32_t maxEmbeddedImmutableSamplers;
+  size_t bufferCaptureReplayDescriptorDataSize;
+  size_t imageCaptureReplayDescriptorDataSize;
+  size_t imageViewCaptureReplayDescriptorDataSize;
+  size_t samplerCaptureReplayDescriptorDataSize;
+  size_t accelerationStructureCaptureReplayDescriptorDataSize;
+  size_t samplerDescriptorSize;
+  size_t combinedImageSamplerDescriptorSize;
+  size_t sampledImageDescriptorSize;
+  size_t storageImageDescriptorSize;
+  size_t uniformTexelBufferDescriptorSize;
+  size_t robustUniformTexelBufferDescriptorSize;
+  size_t storageTexelBufferDescriptorSize;
+  size_t robustStorageTexelBufferDescriptorSize;
+  size_t uniformBufferDescriptorSize;
+  size_t robustUniformBufferDescriptorSize;
+  size_t storageBufferDescriptorSize;
+  size_t robustStorageBufferDescriptorSize;
+  size_t inputAttachmentDescriptorSize;
+  size_t accelerationStructureDescriptorSize;
+  VkDeviceSize maxSamplerDescriptorBufferRange;
+  VkDeviceSize maxResourceDescriptorBufferRange;
+  VkDeviceSize samplerDescriptorBufferAddressSpaceSize;
+  VkDeviceSize resourceDescriptorBufferAddressSpaceSize;
+  VkDeviceSize descriptorBufferAddressSpaceSize;
+} VkPhysicalDeviceDescriptorBufferPropertiesEXT;
+
+typedef struct VkPhysicalDeviceDescriptorBufferFeaturesEXT
+{
+  VkStructureType sType;
+  void *pNext;
+  VkBool32 descriptorBuffer;
+  VkBool32 descriptorBufferCaptureReplay;
+  VkBool32 descriptorBufferImageLayoutIgnored;
+  VkBool32 descriptorBufferPushDescriptors;
+} VkPhysicalDeviceDescriptorBufferFeaturesEXT;
+
+typedef struct VkDescriptorAddressInfoEXT
+{
+  VkStructureType sType;
+  void *pNext;
+  VkDeviceAddress address;
+  VkDeviceSize range;
+  VkFormat format;
+} VkDescriptorAddressInfoEXT;
+
+typedef struct VkDescriptorBufferBindingInfoEXT
+{
+  VkStructureType sType;
+  void *pNext;
+  VkDeviceAddress address;
+  VkBufferUsageFlags usage;
+} VkDescriptorBufferBindingInfoEXT;
+
+typedef union VkDescriptorDataEXT
+{
+  const VkSampler *pSampler;
+  const VkDescriptorImageInfo *pCombinedImageSampler;
+  const VkDescriptorImageInfo *pInputAttachmentImage;
+  const VkDescriptorImageInfo *pSampledImage;
+  const VkDescriptorImageInfo *pStorageImage;
+  const VkDescriptorAddressInfoEXT *pUniformTexelBuffer;
+  const VkDescriptorAddressInfoEXT *pStorageTexelBuffer;
+  const VkDescriptorAddressInfoEXT *pUniformBuffer;
+  const VkDescriptorAddressInfoEXT *pStorageBuffer;
+  VkDeviceAddress accelerationStructure;
+} VkDescriptorDataEXT;
+
+typedef struct VkDescriptorGetInfoEXT
+{
+  VkStructureType sType;
+  const void *pNext;
+  VkDescriptorType type;
+  VkDescriptorDataEXT data;
+} VkDescriptorGetInfoEXT;
+
+typedef void (VKAPI_PTR *PFN_vkGetDescriptorSetLayoutSizeEXT)(VkDevice device, VkDescriptorSetLayout layout, VkDeviceSize *pLayoutSizeInBytes);
+typedef void (VKAPI_PTR *PFN_vkGetDescriptorSetLayoutBindingOffsetEXT)(VkDevice device, VkDescriptorSetLayout layout, uint32_t binding, VkDeviceSize *pOffset);
+typedef void (VKAPI_PTR *PFN_vkGetDescriptorEXT)(VkDevice device, const VkDescriptorGetInfoEXT *pDescriptorInfo, size_t dataSize, void *pDescriptor);
+typedef void (VKAPI_PTR *PFN_vkCmdBindDescriptorBuffersEXT)(VkCommandBuffer commandBuffer, uint32_t bufferCount, const VkDescriptorBufferBindingInfoEXT *pBindingInfos);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDescriptorBufferOffsetsEXT)(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout,
+  uint32_t firstSet, uint32_t setCount, const uint32_t *pBufferIndices, const VkDeviceSize *pOffsets);
+#endif
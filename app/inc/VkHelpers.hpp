@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * A buffer with its own dedicated allocation.
+ * `mapped` is set for host visible buffers and stays mapped until destroyBuffer.
+ */
+struct Buffer
+{
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+};
+
+uint32_t findMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+Buffer createBuffer(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+void destroyBuffer(VkDevice device, Buffer &buffer);
+
+/**
+ * GPU address of a buffer created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+ * (Vulkan 1.2 with the bufferDeviceAddress feature)
+ */
+VkDeviceAddress bufferAddress(VkDevice device, VkBuffer buffer);
+
+/**
+ * A 2D image (or 2D array) with its own dedicated allocation and a view of every mip level and layer.
+ */
+struct Image
+{
+  VkImage image = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mip_levels = 1;
+  uint32_t layers = 1;
+};
+
+Image createImage(VkDevice device, VkPhysicalDevice physical_device, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+
+/**
+ * Like createImage, with `layers` array layers behind a 2D_ARRAY view (even for one layer)
+ */
+Image createImageArray(VkDevice device, VkPhysicalDevice physical_device, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t layers, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+void destroyImage(VkDevice device, Image &image);
+
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t base_mip, uint32_t mip_count);
+
+/**
+ * First depth-only format the device can both render to and sample from.
+ */
+VkFormat findDepthFormat(VkPhysicalDevice physical_device);
+
+/**
+ * Reads a SPIR-V file (relative to the working directory, like the app's shaders)
+ */
+std::vector<uint32_t> readSpirv(const std::string &file_name);
+
+VkShaderModule loadShaderModule(VkDevice device, const std::vector<uint32_t> &code);
+
+/**
+ * Loads a SPIR-V file (relative to the working directory, like the app's shaders)
+ */
+VkShaderModule loadShaderModule(VkDevice device, const std::string &file_name);
@@ -0,0 +1,562 @@
+#include "BindlessHeap.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+bool isBindlessSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+  if (get_features2 == nullptr)
+  {
+    return false;
+  }
+
+  uint32_t extension_count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+
+  bool has_extension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties &extension)
+  {
+    return std::strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+  });
+
+  if (!has_extension)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures indexing_features{};
+  indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &indexing_features;
+  get_features2(physical_device, &features);
+
+  return indexing_features.runtimeDescriptorArray && indexing_features.descriptorBindingPartiallyBound &&
+    indexing_features.descriptorBindingUpdateUnusedWhilePending &&
+    indexing_features.descriptorBindingSampledImageUpdateAfterBind && indexing_features.descriptorBindingStorageBufferUpdateAfterBind &&
+    indexing_features.shaderSampledImageArrayNonUniformIndexing && indexing_features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeatures bindlessFeatures()
+{
+  VkPhysicalDeviceDescriptorIndexingFeatures features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  features.runtimeDescriptorArray = VK_TRUE;
+  features.descriptorBindingPartiallyBound = VK_TRUE;
+  features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  return features;
+}
+
+bool isDescriptorBufferSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+  if (properties.apiVersion < VK_API_VERSION_1_2 || get_features2 == nullptr || !isBindlessSupported(instance, physical_device))
+  {
+    return false;
+  }
+
+  uint32_t extension_count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+
+  bool has_extension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties &extension)
+  {
+    return std::strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME) == 0;
+  });
+
+  if (!has_extension)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_features{};
+  descriptor_buffer_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+
+  VkPhysicalDeviceBufferDeviceAddressFeatures address_features{};
+  address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+  address_features.pNext = &descriptor_buffer_features;
+
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &address_features;
+  get_features2(physical_device, &features);
+
+  return address_features.bufferDeviceAddress && descriptor_buffer_features.descriptorBuffer;
+}
+
+void BindlessHeap::init(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, uint32_t frames_in_flight, BindlessBackend backend,
+  const BindlessLimits &limits, uint32_t push_constant_size)
+{
+  this->device = device;
+  heap_backend = backend;
+  this->frames_in_flight = frames_in_flight;
+  this->push_constant_size = push_constant_size;
+  frame = 0;
+
+  auto get_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+
+  VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{};
+  indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+  VkPhysicalDeviceProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &indexing_properties;
+  get_properties2(physical_device, &properties);
+
+  if (push_constant_size > properties.properties.limits.maxPushConstantsSize)
+  {
+    throw std::runtime_error("Bindless push constants exceed the device limit!");
+  }
+
+  // Every binding is visible to every stage, so the per-stage limits apply to the whole set
+  samplers.capacity = std::min({limits.max_samplers, indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+    indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers});
+  buffers.capacity = std::min({limits.max_buffers, indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+    indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+  textures.capacity = std::min({limits.max_textures, indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+    indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages});
+
+  uint32_t max_resources = indexing_properties.maxPerStageUpdateAfterBindResources;
+  if (samplers.capacity + buffers.capacity + textures.capacity > max_resources)
+  {
+    textures.capacity = max_resources > samplers.capacity + buffers.capacity ? max_resources - samplers.capacity - buffers.capacity : 0;
+  }
+
+  if (samplers.capacity == 0 || buffers.capacity == 0 || textures.capacity == 0)
+  {
+    throw std::runtime_error("Bindless heap does not fit the device limits!");
+  }
+
+  VkDescriptorSetLayoutBinding bindings[3]{};
+  bindings[0].binding = BINDLESS_BINDING_TEXTURES;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  bindings[0].descriptorCount = textures.capacity;
+  bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+  bindings[1].binding = BINDLESS_BINDING_SAMPLERS;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  bindings[1].descriptorCount = samplers.capacity;
+  bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+  bindings[2].binding = BINDLESS_BINDING_BUFFERS;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[2].descriptorCount = buffers.capacity;
+  bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+
+  if (heap_backend == BINDLESS_BACKEND_DESCRIPTOR_BUFFER)
+  {
+    createDescriptorBuffer(instance, physical_device, bindings);
+  }
+  else
+  {
+    createDescriptorSet(bindings);
+  }
+
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+  push_constant_range.size = push_constant_size;
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &set_layout;
+  pipeline_layout_info.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create bindless pipeline layout!");
+  }
+}
+
+void BindlessHeap::createDescriptorSet(const VkDescriptorSetLayoutBinding *bindings)
+{
+  // Unused entries may hold anything, and entries the GPU is not reading can be written at any time
+  VkDescriptorBindingFlags binding_flags[3];
+  std::fill(std::begin(binding_flags), std::end(binding_flags), VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+  binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  binding_flags_info.bindingCount = 3;
+  binding_flags_info.pBindingFlags = binding_flags;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.pNext = &binding_flags_info;
+  layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layout_info.bindingCount = 3;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create bindless descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize pool_sizes[] =
+  {
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textures.capacity},
+    {VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity}
+  };
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 3;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create bindless descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &set_layout;
+
+  if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate bindless descriptor set!");
+  }
+}
+
+void BindlessHeap::createDescriptorBuffer(VkInstance instance, VkPhysicalDevice physical_device, const VkDescriptorSetLayoutBinding *bindings)
+{
+  auto get_layout_size = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(vkGetDeviceProcAddr(device, "vkGetDescriptorSetLayoutSizeEXT"));
+  auto get_binding_offset = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(vkGetDeviceProcAddr(device, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+  get_descriptor = reinterpret_cast<PFN_vkGetDescriptorEXT>(vkGetDeviceProcAddr(device, "vkGetDescriptorEXT"));
+  bind_descriptor_buffers = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(vkGetDeviceProcAddr(device, "vkCmdBindDescriptorBuffersEXT"));
+  set_descriptor_buffer_offsets = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(vkGetDeviceProcAddr(device, "vkCmdSetDescriptorBufferOffsetsEXT"));
+
+  if (get_layout_size == nullptr || get_binding_offset == nullptr || get_descriptor == nullptr || bind_descriptor_buffers == nullptr || set_descriptor_buffer_offsets == nullptr)
+  {
+    throw std::runtime_error("VK_EXT_descriptor_buffer is not enabled!");
+  }
+
+  auto get_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+
+  VkPhysicalDeviceDescriptorBufferPropertiesEXT buffer_properties{};
+  buffer_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+
+  VkPhysicalDeviceProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &buffer_properties;
+  get_properties2(physical_device, &properties);
+
+  descriptor_sizes[BINDLESS_BINDING_TEXTURES] = buffer_properties.sampledImageDescriptorSize;
+  descriptor_sizes[BINDLESS_BINDING_SAMPLERS] = buffer_properties.samplerDescriptorSize;
+  descriptor_sizes[BINDLESS_BINDING_BUFFERS] = buffer_properties.storageBufferDescriptorSize;
+
+  // Descriptors are plain memory here: nothing to update after bind, unwritten entries are never read
+  VkDescriptorBindingFlags binding_flags[3];
+  std::fill(std::begin(binding_flags), std::end(binding_flags), VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+  binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  binding_flags_info.bindingCount = 3;
+  binding_flags_info.pBindingFlags = binding_flags;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.pNext = &binding_flags_info;
+  layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+  layout_info.bindingCount = 3;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create bindless descriptor set layout!");
+  }
+
+  VkDeviceSize layout_size = 0;
+  get_layout_size(device, set_layout, &layout_size);
+
+  for (uint32_t binding = 0; binding < 3; binding++)
+  {
+    get_binding_offset(device, set_layout, binding, &binding_offsets[binding]);
+  }
+
+  // Holds samplers and resources alike, so it is bound with both usages
+  descriptor_buffer = createBuffer(device, physical_device, layout_size,
+    VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  descriptor_buffer_address = bufferAddress(device, descriptor_buffer.buffer);
+
+  if (descriptor_buffer_address % buffer_properties.descriptorBufferOffsetAlignment != 0)
+  {
+    throw std::runtime_error("Descriptor buffer is not aligned!");
+  }
+}
+
+void BindlessHeap::cleanup()
+{
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+
+  if (descriptor_buffer.buffer != VK_NULL_HANDLE)
+  {
+    destroyBuffer(device, descriptor_buffer);
+  }
+
+  *this = BindlessHeap{};
+}
+
+void BindlessHeap::beginFrame()
+{
+  frame++;
+
+  recycle(textures);
+  recycle(samplers);
+  recycle(buffers);
+
+  flush();
+}
+
+BindlessIndex BindlessHeap::addTexture(VkImageView view, VkImageLayout layout)
+{
+  PendingWrite write{};
+  write.binding = BINDLESS_BINDING_TEXTURES;
+  write.index = acquire(BINDLESS_BINDING_TEXTURES);
+  write.image = {VK_NULL_HANDLE, view, layout};
+  pending_writes.push_back(write);
+  return write.index;
+}
+
+BindlessIndex BindlessHeap::addSampler(VkSampler sampler)
+{
+  PendingWrite write{};
+  write.binding = BINDLESS_BINDING_SAMPLERS;
+  write.index = acquire(BINDLESS_BINDING_SAMPLERS);
+  write.image = {sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED};
+  pending_writes.push_back(write);
+  return write.index;
+}
+
+BindlessIndex BindlessHeap::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+  if (heap_backend == BINDLESS_BACKEND_DESCRIPTOR_BUFFER && range == VK_WHOLE_SIZE)
+  {
+    throw std::runtime_error("Descriptor buffer bindless buffers need an explicit range!");
+  }
+
+  PendingWrite write{};
+  write.binding = BINDLESS_BINDING_BUFFERS;
+  write.index = acquire(BINDLESS_BINDING_BUFFERS);
+  write.buffer = {buffer, offset, range};
+  pending_writes.push_back(write);
+  return write.index;
+}
+
+void BindlessHeap::flush()
+{
+  last_writes = static_cast<uint32_t>(pending_writes.size());
+
+  if (pending_writes.empty())
+  {
+    return;
+  }
+
+  if (heap_backend == BINDLESS_BACKEND_DESCRIPTOR_BUFFER)
+  {
+    for (const PendingWrite &pending : pending_writes)
+    {
+      writeDescriptor(pending);
+    }
+
+    pending_writes.clear();
+    return;
+  }
+
+  std::vector<VkWriteDescriptorSet> writes(pending_writes.size());
+  for (size_t i = 0; i < pending_writes.size(); i++)
+  {
+    const PendingWrite &pending = pending_writes[i];
+
+    VkWriteDescriptorSet &write = writes[i];
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_set;
+    write.dstBinding = pending.binding;
+    write.dstArrayElement = pending.index;
+    write.descriptorCount = 1;
+
+    switch (pending.binding)
+    {
+    case BINDLESS_BINDING_TEXTURES:
+      write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      write.pImageInfo = &pending.image;
+      break;
+    case BINDLESS_BINDING_SAMPLERS:
+      write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+      write.pImageInfo = &pending.image;
+      break;
+    case BINDLESS_BINDING_BUFFERS:
+      write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      write.pBufferInfo = &pending.buffer;
+      break;
+    }
+  }
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+  pending_writes.clear();
+}
+
+/*
+* Descriptor buffer backend: the descriptor goes straight to its array element
+  in the mapped buffer. Host coherent, so it is visible to the next submission.
+*/
+void BindlessHeap::writeDescriptor(const PendingWrite &pending)
+{
+  VkDescriptorGetInfoEXT get_info{};
+  get_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+
+  VkDescriptorAddressInfoEXT address_info{};
+  address_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+
+  switch (pending.binding)
+  {
+  case BINDLESS_BINDING_TEXTURES:
+    get_info.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    get_info.data.pSampledImage = &pending.image;
+    break;
+  case BINDLESS_BINDING_SAMPLERS:
+    get_info.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    get_info.data.pSampler = &pending.image.sampler;
+    break;
+  case BINDLESS_BINDING_BUFFERS:
+    address_info.address = bufferAddress(device, pending.buffer.buffer) + pending.buffer.offset;
+    address_info.range = pending.buffer.range;
+    get_info.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    get_info.data.pStorageBuffer = &address_info;
+    break;
+  }
+
+  size_t descriptor_size = descriptor_sizes[pending.binding];
+  uint8_t *destination = static_cast<uint8_t*>(descriptor_buffer.mapped) + binding_offsets[pending.binding] + pending.index * descriptor_size;
+  get_descriptor(device, &get_info, descriptor_size, destination);
+}
+
+void BindlessHeap::bind(VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point) const
+{
+  if (heap_backend == BINDLESS_BACKEND_DESCRIPTOR_SET)
+  {
+    vkCmdBindDescriptorSets(command_buffer, bind_point, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+    return;
+  }
+
+  VkDescriptorBufferBindingInfoEXT binding_info{};
+  binding_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+  binding_info.address = descriptor_buffer_address;
+  binding_info.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
+  bind_descriptor_buffers(command_buffer, 1, &binding_info);
+
+  uint32_t buffer_index = 0;
+  VkDeviceSize offset = 0;
+  set_descriptor_buffer_offsets(command_buffer, bind_point, pipeline_layout, 0, 1, &buffer_index, &offset);
+}
+
+VkPipelineCreateFlags BindlessHeap::pipelineCreateFlags() const
+{
+  return heap_backend == BINDLESS_BACKEND_DESCRIPTOR_BUFFER ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+}
+
+void BindlessHeap::pushConstants(VkCommandBuffer command_buffer, const BindlessDrawConstants &constants) const
+{
+  vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_ALL, 0, std::min<uint32_t>(sizeof(constants), push_constant_size), &constants);
+}
+
+BindlessStats BindlessHeap::stats() const
+{
+  BindlessStats heap_stats;
+  heap_stats.textures = textures.live;
+  heap_stats.samplers = samplers.live;
+  heap_stats.buffers = buffers.live;
+  heap_stats.writes = last_writes;
+  return heap_stats;
+}
+
+BindlessHeap::IndexAllocator &BindlessHeap::indexAllocator(BindlessBinding binding)
+{
+  switch (binding)
+  {
+  case BINDLESS_BINDING_TEXTURES:
+    return textures;
+  case BINDLESS_BINDING_SAMPLERS:
+    return samplers;
+  default:
+    return buffers;
+  }
+}
+
+BindlessIndex BindlessHeap::acquire(BindlessBinding binding)
+{
+  IndexAllocator &indices = indexAllocator(binding);
+
+  BindlessIndex index;
+  if (!indices.free.empty())
+  {
+    index = indices.free.back();
+    indices.free.pop_back();
+  }
+  else if (indices.next < indices.capacity)
+  {
+    index = indices.next++;
+  }
+  else
+  {
+    throw std::runtime_error("Bindless heap is full!");
+  }
+
+  indices.live++;
+  return index;
+}
+
+void BindlessHeap::release(BindlessBinding binding, BindlessIndex index)
+{
+  if (index == BINDLESS_NONE)
+  {
+    return;
+  }
+
+  // A write still pending for the index is dropped; the descriptor frames in flight may read stays
+  pending_writes.erase(std::remove_if(pending_writes.begin(), pending_writes.end(), [&](const PendingWrite &write)
+  {
+    return write.binding == binding && write.index == index;
+  }), pending_writes.end());
+
+  IndexAllocator &indices = indexAllocator(binding);
+  indices.retired.push_back({index, frame});
+  indices.live--;
+}
+
+void BindlessHeap::recycle(IndexAllocator &indices)
+{
+  // Removed in frame f, the index may be read by the frames_in_flight frames recorded up to then
+  auto reusable = std::partition(indices.retired.begin(), indices.retired.end(), [&](const std::pair<BindlessIndex, uint64_t> &retired)
+  {
+    return frame < retired.second + frames_in_flight;
+  });
+
+  for (auto it = reusable; it != indices.retired.end(); ++it)
+  {
+    indices.free.push_back(it->first);
+  }
+
+  indices.retired.erase(reusable, indices.retired.end());
+}
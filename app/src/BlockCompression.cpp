@@ -0,0 +1,719 @@
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+  // BC7 4-bit index weights, out of 64
+  const uint32_t BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+  /**
+   * Ends of the line through the block's colors along their principal axis,
+   * pulled in by 1/16 of the extent so the interpolated colors land closer
+   */
+  void fitEndpoints(const float pixels[16][4], uint32_t channels, float low[4], float high[4])
+  {
+    float mean[4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      for (uint32_t c = 0; c < channels; c++)
+      {
+        mean[c] += pixels[i][c] / 16.0f;
+      }
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      for (uint32_t a = 0; a < channels; a++)
+      {
+        for (uint32_t b = 0; b < channels; b++)
+        {
+          covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+        }
+      }
+    }
+
+    // Power iteration, started on the diagonal so gray ramps converge at once
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+      float next[4] = {};
+      float length = 0.0f;
+      for (uint32_t a = 0; a < channels; a++)
+      {
+        for (uint32_t b = 0; b < channels; b++)
+        {
+          next[a] += covariance[a][b] * axis[b];
+        }
+        length = std::max(length, std::abs(next[a]));
+      }
+
+      if (length < 1e-6f)
+      {
+        break;
+      }
+      for (uint32_t a = 0; a < channels; a++)
+      {
+        axis[a] = next[a] / length;
+      }
+    }
+
+    float axis_length_sq = 0.0f;
+    for (uint32_t c = 0; c < channels; c++)
+    {
+      axis_length_sq += axis[c] * axis[c];
+    }
+
+    float t_min = 0.0f;
+    float t_max = 0.0f;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      float t = 0.0f;
+      for (uint32_t c = 0; c < channels; c++)
+      {
+        t += (pixels[i][c] - mean[c]) * axis[c];
+      }
+      t /= std::max(axis_length_sq, 1e-6f);
+      t_min = std::min(t_min, t);
+      t_max = std::max(t_max, t);
+    }
+
+    float inset = (t_max - t_min) / 16.0f;
+    for (uint32_t c = 0; c < channels; c++)
+    {
+      low[c] = std::clamp(mean[c] + (t_min + inset) * axis[c], 0.0f, 255.0f);
+      high[c] = std::clamp(mean[c] + (t_max - inset) * axis[c], 0.0f, 255.0f);
+    }
+  }
+
+  uint16_t packColor565(const float color[4])
+  {
+    uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+  }
+
+  void unpackColor565(uint16_t color, uint32_t rgb[3])
+  {
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+  }
+
+  void encodeColorBlock(const uint8_t rgba[64], uint8_t block[8])
+  {
+    float pixels[16][4];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        pixels[i][c] = rgba[i * 4 + c];
+      }
+    }
+
+    float low[4];
+    float high[4];
+    fitEndpoints(pixels, 3, low, high);
+
+    // color0 > color1 selects the four color mode
+    uint16_t color0 = packColor565(high);
+    uint16_t color1 = packColor565(low);
+    if (color0 < color1)
+    {
+      std::swap(color0, color1);
+    }
+
+    uint32_t palette[4][3];
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        uint32_t best = 0;
+        uint32_t best_error = UINT32_MAX;
+        for (uint32_t p = 0; p < 4; p++)
+        {
+          uint32_t error = 0;
+          for (uint32_t c = 0; c < 3; c++)
+          {
+            int32_t d = int32_t(rgba[i * 4 + c]) - int32_t(palette[p][c]);
+            error += d * d;
+          }
+          if (error < best_error)
+          {
+            best = p;
+            best_error = error;
+          }
+        }
+        indices |= best << (i * 2);
+      }
+    }
+
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    std::memcpy(block + 4, &indices, 4);
+  }
+
+  // four_colors: BC2/BC3 color blocks ignore the endpoint order
+  void decodeColorBlock(const uint8_t block[8], bool four_colors, uint8_t rgba[64])
+  {
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    uint32_t indices;
+    std::memcpy(&indices, block + 4, 4);
+
+    uint32_t palette[4][4];
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      if (four_colors || color0 > color1)
+      {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      else
+      {
+        palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = 0;
+      }
+    }
+    if (!four_colors && color0 <= color1)
+    {
+      palette[3][3] = 0;
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      uint32_t index = (indices >> (i * 2)) & 3;
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        rgba[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+      }
+    }
+  }
+
+  // One channel, `stride` bytes apart
+  void encodeChannelBlock(const uint8_t *values, uint32_t stride, uint8_t block[8])
+  {
+    uint32_t low = 255;
+    uint32_t high = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      low = std::min<uint32_t>(low, values[i * stride]);
+      high = std::max<uint32_t>(high, values[i * stride]);
+    }
+
+    // value0 > value1 selects the eight value mode
+    uint32_t palette[8] = {high, low};
+    for (uint32_t p = 2; p < 8; p++)
+    {
+      palette[p] = ((8 - p) * high + (p - 1) * low + 3) / 7;
+    }
+
+    uint64_t indices = 0;
+    if (high != low)
+    {
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        uint32_t best = 0;
+        uint32_t best_error = UINT32_MAX;
+        for (uint32_t p = 0; p < 8; p++)
+        {
+          uint32_t error = static_cast<uint32_t>(std::abs(int32_t(values[i * stride]) - int32_t(palette[p])));
+          if (error < best_error)
+          {
+            best = p;
+            best_error = error;
+          }
+        }
+        indices |= uint64_t(best) << (i * 3);
+      }
+    }
+
+    block[0] = static_cast<uint8_t>(high);
+    block[1] = static_cast<uint8_t>(low);
+    for (uint32_t b = 0; b < 6; b++)
+    {
+      block[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+    }
+  }
+
+  void decodeChannelBlock(const uint8_t block[8], uint8_t *values, uint32_t stride)
+  {
+    uint32_t value0 = block[0];
+    uint32_t value1 = block[1];
+    uint32_t palette[8] = {value0, value1};
+
+    if (value0 > value1)
+    {
+      for (uint32_t p = 2; p < 8; p++)
+      {
+        palette[p] = ((8 - p) * value0 + (p - 1) * value1 + 3) / 7;
+      }
+    }
+    else
+    {
+      for (uint32_t p = 2; p < 6; p++)
+      {
+        palette[p] = ((6 - p) * value0 + (p - 1) * value1 + 2) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (uint32_t b = 0; b < 6; b++)
+    {
+      indices |= uint64_t(block[2 + b]) << (b * 8);
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      values[i * stride] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+    }
+  }
+
+  // BC7 fields are packed from the least significant bit of byte 0
+  struct BitWriter
+  {
+    uint8_t *block;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t bits)
+    {
+      for (uint32_t i = 0; i < bits; i++, position++)
+      {
+        block[position / 8] |= ((value >> i) & 1) << (position % 8);
+      }
+    }
+  };
+
+  struct BitReader
+  {
+    const uint8_t *block;
+    uint32_t position = 0;
+
+    uint32_t read(uint32_t bits)
+    {
+      uint32_t value = 0;
+      for (uint32_t i = 0; i < bits; i++, position++)
+      {
+        value |= ((block[position / 8] >> (position % 8)) & 1) << i;
+      }
+      return value;
+    }
+  };
+
+  uint32_t interpolateBc7(uint32_t e0, uint32_t e1, uint32_t weight)
+  {
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+  }
+
+  void quantizeBc7Endpoints(const float ends[2][4], uint32_t quantized[2][4], uint32_t p_bits[2], uint32_t endpoints[2][4])
+  {
+    for (uint32_t e = 0; e < 2; e++)
+    {
+      float best_error = 1e30f;
+      for (uint32_t p = 0; p < 2; p++)
+      {
+        uint32_t candidate[4];
+        float error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          candidate[c] = static_cast<uint32_t>(std::clamp(std::floor((ends[e][c] - p) / 2.0f + 0.5f), 0.0f, 127.0f));
+          float d = float(candidate[c] * 2 + p) - ends[e][c];
+          error += d * d;
+        }
+
+        if (error < best_error)
+        {
+          best_error = error;
+          p_bits[e] = p;
+          std::copy(candidate, candidate + 4, quantized[e]);
+        }
+      }
+
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        endpoints[e][c] = quantized[e][c] * 2 + p_bits[e];
+      }
+    }
+  }
+
+  void selectBc7Indices(const uint8_t rgba[64], const uint32_t endpoints[2][4], uint32_t indices[16])
+  {
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      uint32_t best_error = UINT32_MAX;
+      for (uint32_t w = 0; w < 16; w++)
+      {
+        uint32_t error = 0;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          int32_t d = int32_t(rgba[i * 4 + c]) - int32_t(interpolateBc7(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS[w]));
+          error += d * d;
+        }
+        if (error < best_error)
+        {
+          best_error = error;
+          indices[i] = w;
+        }
+      }
+    }
+  }
+
+  void refitEndpoints(const float pixels[16][4], const uint32_t indices[16], float ends[2][4])
+  {
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = {};
+    float bx[4] = {};
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      float b = BC7_WEIGHTS[indices[i]] / 64.0f;
+      float a = 1.0f - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        ax[c] += a * pixels[i][c];
+        bx[c] += b * pixels[i][c];
+      }
+    }
+
+    // All pixels on one index: keep the fitted line
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+    {
+      return;
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      ends[0][c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+      ends[1][c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+  }
+
+  // Mode 6: 7-bit RGBA endpoints, a shared low bit per endpoint, 4-bit indices
+  void encodeBc7Block(const uint8_t rgba[64], uint8_t block[16])
+  {
+    float pixels[16][4];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        pixels[i][c] = rgba[i * 4 + c];
+      }
+    }
+
+    float ends[2][4];
+    fitEndpoints(pixels, 4, ends[0], ends[1]);
+
+    uint32_t quantized[2][4];
+    uint32_t p_bits[2];
+    uint32_t endpoints[2][4];
+    uint32_t indices[16];
+
+    // Second pass refits the endpoints to the first pass's indices by least squares
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+      if (pass == 1)
+      {
+        refitEndpoints(pixels, indices, ends);
+      }
+
+      quantizeBc7Endpoints(ends, quantized, p_bits, endpoints);
+      selectBc7Indices(rgba, endpoints, indices);
+    }
+
+    // The first index is stored without its top bit, so it must be below 8
+    if (indices[0] >= 8)
+    {
+      std::swap(quantized[0], quantized[1]);
+      std::swap(p_bits[0], p_bits[1]);
+      for (uint32_t &index : indices)
+      {
+        index = 15 - index;
+      }
+    }
+
+    std::memset(block, 0, 16);
+    BitWriter writer{block};
+    writer.write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      writer.write(quantized[0][c], 7);
+      writer.write(quantized[1][c], 7);
+    }
+    writer.write(p_bits[0], 1);
+    writer.write(p_bits[1], 1);
+    writer.write(indices[0], 3);
+    for (uint32_t i = 1; i < 16; i++)
+    {
+      writer.write(indices[i], 4);
+    }
+  }
+
+  void decodeBc7Block(const uint8_t block[16], uint8_t rgba[64])
+  {
+    // Mode n starts with n zero bits and a one
+    if ((block[0] & 0x7F) != 0x40)
+    {
+      throw std::runtime_error("only BC7 mode 6 blocks can be decoded!");
+    }
+
+    BitReader reader{block, 7};
+    uint32_t endpoints[2][4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      endpoints[0][c] = reader.read(7) << 1;
+      endpoints[1][c] = reader.read(7) << 1;
+    }
+    uint32_t p0 = reader.read(1);
+    uint32_t p1 = reader.read(1);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      endpoints[0][c] |= p0;
+      endpoints[1][c] |= p1;
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      uint32_t index = reader.read(i == 0 ? 3 : 4);
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        rgba[i * 4 + c] = static_cast<uint8_t>(interpolateBc7(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS[index]));
+      }
+    }
+  }
+
+  void encodeBlock(const uint8_t rgba[64], TextureFormat format, uint8_t *block)
+  {
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+      encodeColorBlock(rgba, block);
+      break;
+    case TEXTURE_FORMAT_BC3:
+      encodeChannelBlock(rgba + 3, 4, block);
+      encodeColorBlock(rgba, block + 8);
+      break;
+    case TEXTURE_FORMAT_BC4:
+      encodeChannelBlock(rgba, 4, block);
+      break;
+    case TEXTURE_FORMAT_BC5:
+      encodeChannelBlock(rgba, 4, block);
+      encodeChannelBlock(rgba + 1, 4, block + 8);
+      break;
+    case TEXTURE_FORMAT_BC7:
+      encodeBc7Block(rgba, block);
+      break;
+    default:
+      throw std::runtime_error("no encoder for texture format!");
+    }
+  }
+
+  void decodeBlock(const uint8_t *block, TextureFormat format, uint8_t rgba[64])
+  {
+    // Channels a format does not store read as 0, alpha as 1
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+      rgba[i * 4 + 3] = 255;
+    }
+
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+      decodeColorBlock(block, false, rgba);
+      break;
+    case TEXTURE_FORMAT_BC3:
+      decodeColorBlock(block + 8, true, rgba);
+      decodeChannelBlock(block, rgba + 3, 4);
+      break;
+    case TEXTURE_FORMAT_BC4:
+      decodeChannelBlock(block, rgba, 4);
+      break;
+    case TEXTURE_FORMAT_BC5:
+      decodeChannelBlock(block, rgba, 4);
+      decodeChannelBlock(block + 8, rgba + 1, 4);
+      break;
+    case TEXTURE_FORMAT_BC7:
+      decodeBc7Block(block, rgba);
+      break;
+    default:
+      throw std::runtime_error("no decoder for texture format!");
+    }
+  }
+}
+
+TextureFormatInfo textureFormatInfo(TextureFormat format)
+{
+  switch (format)
+  {
+  case TEXTURE_FORMAT_RGBA8:
+    return {1, 4};
+  case TEXTURE_FORMAT_BC1:
+  case TEXTURE_FORMAT_BC4:
+    return {4, 8};
+  case TEXTURE_FORMAT_BC3:
+  case TEXTURE_FORMAT_BC5:
+  case TEXTURE_FORMAT_BC7:
+  case TEXTURE_FORMAT_ASTC_4x4:
+    return {4, 16};
+  }
+
+  throw std::runtime_error("unknown texture format!");
+}
+
+const char *textureFormatName(TextureFormat format)
+{
+  switch (format)
+  {
+  case TEXTURE_FORMAT_RGBA8: return "RGBA8";
+  case TEXTURE_FORMAT_BC1: return "BC1";
+  case TEXTURE_FORMAT_BC3: return "BC3";
+  case TEXTURE_FORMAT_BC4: return "BC4";
+  case TEXTURE_FORMAT_BC5: return "BC5";
+  case TEXTURE_FORMAT_BC7: return "BC7";
+  case TEXTURE_FORMAT_ASTC_4x4: return "ASTC 4x4";
+  }
+
+  return "unknown";
+}
+
+size_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+  TextureFormatInfo info = textureFormatInfo(format);
+  size_t blocks_x = (width + info.block_extent - 1) / info.block_extent;
+  size_t blocks_y = (height + info.block_extent - 1) / info.block_extent;
+  return blocks_x * blocks_y * info.block_size;
+}
+
+bool hasBlockCodec(TextureFormat format)
+{
+  return format != TEXTURE_FORMAT_ASTC_4x4;
+}
+
+bool hasSrgbVariant(TextureFormat format)
+{
+  return format != TEXTURE_FORMAT_BC4 && format != TEXTURE_FORMAT_BC5;
+}
+
+bool canDecompress(const uint8_t *data, size_t size, TextureFormat format)
+{
+  if (!hasBlockCodec(format))
+  {
+    return false;
+  }
+
+  if (format == TEXTURE_FORMAT_BC7)
+  {
+    // Mode n starts with n zero bits and a one
+    for (size_t offset = 0; offset + 16 <= size; offset += 16)
+    {
+      if ((data[offset] & 0x7F) != 0x40)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<uint8_t> compressImage(const ImageData &image, TextureFormat format)
+{
+  if (format == TEXTURE_FORMAT_RGBA8)
+  {
+    return image.pixels;
+  }
+
+  TextureFormatInfo info = textureFormatInfo(format);
+  uint32_t blocks_x = (image.width + 3) / 4;
+  uint32_t blocks_y = (image.height + 3) / 4;
+  std::vector<uint8_t> blocks(size_t(blocks_x) * blocks_y * info.block_size);
+
+  uint8_t rgba[64];
+  for (uint32_t by = 0; by < blocks_y; by++)
+  {
+    for (uint32_t bx = 0; bx < blocks_x; bx++)
+    {
+      for (uint32_t y = 0; y < 4; y++)
+      {
+        uint32_t sy = std::min(by * 4 + y, image.height - 1);
+        for (uint32_t x = 0; x < 4; x++)
+        {
+          uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+          std::memcpy(rgba + (y * 4 + x) * 4, &image.pixels[(size_t(sy) * image.width + sx) * 4], 4);
+        }
+      }
+
+      encodeBlock(rgba, format, &blocks[(size_t(by) * blocks_x + bx) * info.block_size]);
+    }
+  }
+
+  return blocks;
+}
+
+ImageData decompressImage(const uint8_t *data, uint32_t width, uint32_t height, TextureFormat format)
+{
+  ImageData image;
+  image.width = width;
+  image.height = height;
+
+  if (format == TEXTURE_FORMAT_RGBA8)
+  {
+    image.pixels.assign(data, data + size_t(width) * height * 4);
+    return image;
+  }
+
+  image.pixels.resize(size_t(width) * height * 4);
+  TextureFormatInfo info = textureFormatInfo(format);
+  uint32_t blocks_x = (width + 3) / 4;
+  uint32_t blocks_y = (height + 3) / 4;
+
+  uint8_t rgba[64];
+  for (uint32_t by = 0; by < blocks_y; by++)
+  {
+    for (uint32_t bx = 0; bx < blocks_x; bx++)
+    {
+      decodeBlock(data + (size_t(by) * blocks_x + bx) * info.block_size, format, rgba);
+
+      // Edge blocks hang over the level, keep the texels inside it
+      for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+      {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+        {
+          std::memcpy(&image.pixels[(size_t(by * 4 + y) * width + bx * 4 + x) * 4], rgba + (y * 4 + x) * 4, 4);
+        }
+      }
+    }
+  }
+
+  return image;
+}
@@ -0,0 +1,338 @@
+#include "ClusterPages.hpp"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+  const uint32_t NOT_IN_PAGE = std::numeric_limits<uint32_t>::max();
+
+  uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+  {
+    return (offset + alignment - 1) & ~(alignment - 1);
+  }
+
+  /**
+   * Triangles of one level of one cell, as offsets into mesh.indices
+   */
+  struct CellLevel
+  {
+    std::vector<uint32_t> triangles;
+    float error = 0.0f;
+  };
+
+  struct CellBuild
+  {
+    std::vector<CellLevel> levels;
+    glm::vec3 bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+  };
+
+  /**
+   * Packs triangles into fixed size pages, each with its own copy of the
+   * vertices it references
+   */
+  class PageWriter
+  {
+  public:
+    PageWriter(const uint8_t *vertex_data, uint32_t vertex_stride, size_t vertex_count)
+      : vertex_data(vertex_data), vertex_stride(vertex_stride), local_index(vertex_count, NOT_IN_PAGE)
+    {
+    }
+
+    void add(const uint32_t triangle[3], uint32_t cell, uint32_t lod)
+    {
+      uint32_t new_vertices = 0;
+      for (int i = 0; i < 3; i++)
+      {
+        new_vertices += local_index[triangle[i]] == NOT_IN_PAGE ? 1 : 0;
+      }
+
+      if (pageBytes(page_vertices.size() + new_vertices, page_indices.size() + 3) > CLUSTER_PAGE_SIZE)
+      {
+        finishPage();
+      }
+
+      if (page_indices.empty())
+      {
+        current = {cell, lod, 0, 0, 0, 0};
+      }
+
+      for (int i = 0; i < 3; i++)
+      {
+        if (local_index[triangle[i]] == NOT_IN_PAGE)
+        {
+          local_index[triangle[i]] = static_cast<uint32_t>(page_vertices.size());
+          page_vertices.push_back(triangle[i]);
+        }
+        page_indices.push_back(static_cast<uint16_t>(local_index[triangle[i]]));
+      }
+    }
+
+    void finishPage()
+    {
+      if (page_indices.empty())
+      {
+        return;
+      }
+
+      current.vertex_count = static_cast<uint32_t>(page_vertices.size());
+      current.index_count = static_cast<uint32_t>(page_indices.size());
+      current.index_offset = static_cast<uint32_t>(alignOffset(size_t(current.vertex_count) * vertex_stride, 4));
+      current.size = current.index_offset + current.index_count * static_cast<uint32_t>(sizeof(uint16_t));
+
+      size_t page_start = blob.size();
+      blob.resize(page_start + CLUSTER_PAGE_SIZE, 0);
+      uint8_t *page = blob.data() + page_start;
+
+      for (size_t i = 0; i < page_vertices.size(); i++)
+      {
+        std::memcpy(page + i * vertex_stride, vertex_data + size_t(page_vertices[i]) * vertex_stride, vertex_stride);
+        local_index[page_vertices[i]] = NOT_IN_PAGE;
+      }
+      std::memcpy(page + current.index_offset, page_indices.data(), page_indices.size() * sizeof(uint16_t));
+
+      infos.push_back(current);
+      page_vertices.clear();
+      page_indices.clear();
+    }
+
+    std::vector<ClusterPageInfo> infos;
+    std::vector<uint8_t> blob;
+
+  private:
+    size_t pageBytes(size_t vertex_count, size_t index_count) const
+    {
+      return alignOffset(vertex_count * vertex_stride, 4) + index_count * sizeof(uint16_t);
+    }
+
+    const uint8_t *vertex_data;
+    uint32_t vertex_stride;
+    std::vector<uint32_t> local_index;
+    std::vector<uint32_t> page_vertices;
+    std::vector<uint16_t> page_indices;
+    ClusterPageInfo current{};
+  };
+}
+
+ClusterPagesReport writeClusterPages(const std::string &file_name, const MeshData &mesh, const QuantizedMesh *quantized, uint32_t cell_triangles)
+{
+  uint32_t lod_count = mesh.lods.empty() ? 1 : mesh.lod_count;
+
+  std::vector<Submesh> submeshes = mesh.submeshes;
+  if (submeshes.empty())
+  {
+    submeshes.push_back({0, static_cast<uint32_t>(mesh.indices.size())});
+  }
+
+  auto levelRange = [&](size_t submesh, uint32_t lod)
+  {
+    return mesh.lods.empty() ? MeshLod{submeshes[submesh].index_offset, submeshes[submesh].index_count, 0.0f} : mesh.lods[submesh * lod_count + lod];
+  };
+
+  // Grid resolution from the level 0 triangle count
+  size_t lod0_triangles = 0;
+  for (size_t s = 0; s < submeshes.size(); s++)
+  {
+    lod0_triangles += levelRange(s, 0).index_count / 3;
+  }
+  uint32_t grid = std::max(1u, static_cast<uint32_t>(std::round(std::cbrt(double(lod0_triangles) / std::max(cell_triangles, 1u)))));
+
+  glm::vec3 extent = glm::max(mesh.bounds_max - mesh.bounds_min, glm::vec3(1e-6f));
+
+  auto gridCell = [&](const glm::vec3 &position)
+  {
+    glm::ivec3 cell = glm::clamp(glm::ivec3((position - mesh.bounds_min) / extent * float(grid)), glm::ivec3(0), glm::ivec3(grid - 1));
+    return (uint32_t(cell.z) * grid + uint32_t(cell.y)) * grid + uint32_t(cell.x);
+  };
+
+  // Every level uses the same grid so a cell covers the same region at each level
+  std::unordered_map<uint32_t, uint32_t> cell_of_grid;
+  std::vector<CellBuild> cells;
+
+  for (size_t s = 0; s < submeshes.size(); s++)
+  {
+    for (uint32_t lod = 0; lod < lod_count; lod++)
+    {
+      MeshLod range = levelRange(s, lod);
+
+      for (uint32_t i = 0; i + 2 < range.index_count; i += 3)
+      {
+        uint32_t first = range.index_offset + i;
+        glm::vec3 a = mesh.vertices[mesh.indices[first]].position;
+        glm::vec3 b = mesh.vertices[mesh.indices[first + 1]].position;
+        glm::vec3 c = mesh.vertices[mesh.indices[first + 2]].position;
+
+        auto inserted = cell_of_grid.emplace(gridCell((a + b + c) / 3.0f), static_cast<uint32_t>(cells.size()));
+        if (inserted.second)
+        {
+          cells.emplace_back();
+          cells.back().levels.resize(lod_count);
+        }
+
+        CellBuild &cell = cells[inserted.first->second];
+        cell.levels[lod].triangles.push_back(first);
+        cell.levels[lod].error = std::max(cell.levels[lod].error, range.error);
+        cell.bounds_min = glm::min(cell.bounds_min, glm::min(a, glm::min(b, c)));
+        cell.bounds_max = glm::max(cell.bounds_max, glm::max(a, glm::max(b, c)));
+      }
+    }
+  }
+
+  const uint8_t *vertex_data = quantized != nullptr ? reinterpret_cast<const uint8_t*>(quantized->vertices.data()) : reinterpret_cast<const uint8_t*>(mesh.vertices.data());
+  uint32_t vertex_stride = quantized != nullptr ? sizeof(QuantizedVertex) : sizeof(Vertex);
+
+  PageWriter writer(vertex_data, vertex_stride, mesh.vertices.size());
+  std::vector<ClusterCell> cell_table(cells.size());
+  std::vector<ClusterCellLod> cell_lods(cells.size() * lod_count);
+
+  for (uint32_t c = 0; c < cells.size(); c++)
+  {
+    glm::vec3 center = (cells[c].bounds_min + cells[c].bounds_max) * 0.5f;
+    cell_table[c] = {{center.x, center.y, center.z}, glm::length(cells[c].bounds_max - center)};
+
+    for (uint32_t lod = 0; lod < lod_count; lod++)
+    {
+      const CellLevel &level = cells[c].levels[lod];
+      ClusterCellLod &entry = cell_lods[c * lod_count + lod];
+      entry.first_page = static_cast<uint32_t>(writer.infos.size());
+      entry.triangle_count = static_cast<uint32_t>(level.triangles.size());
+      entry.error = level.error;
+
+      for (uint32_t first : level.triangles)
+      {
+        writer.add(&mesh.indices[first], c, lod);
+      }
+      writer.finishPage();
+
+      entry.page_count = static_cast<uint32_t>(writer.infos.size()) - entry.first_page;
+    }
+  }
+
+  ClusterPagesHeader header{};
+  header.magic = CLUSTER_PAGES_MAGIC;
+  header.version = CLUSTER_PAGES_VERSION;
+  header.vertex_encoding = quantized != nullptr ? VERTEX_ENCODING_QUANTIZED : VERTEX_ENCODING_FLOAT;
+  header.lod_count = lod_count;
+  header.cell_count = static_cast<uint32_t>(cell_table.size());
+  header.page_count = static_cast<uint32_t>(writer.infos.size());
+  header.page_data_offset = alignOffset(sizeof(ClusterPagesHeader) + cell_table.size() * sizeof(ClusterCell) +
+    cell_lods.size() * sizeof(ClusterCellLod) + writer.infos.size() * sizeof(ClusterPageInfo), CLUSTER_PAGE_SIZE);
+  header.quantization = quantized != nullptr ? quantized->params : QuantizationParams{};
+
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(cell_table.data()), cell_table.size() * sizeof(ClusterCell));
+  file.write(reinterpret_cast<const char*>(cell_lods.data()), cell_lods.size() * sizeof(ClusterCellLod));
+  file.write(reinterpret_cast<const char*>(writer.infos.data()), writer.infos.size() * sizeof(ClusterPageInfo));
+
+  std::vector<char> padding(header.page_data_offset - static_cast<uint64_t>(file.tellp()), 0);
+  file.write(padding.data(), padding.size());
+  file.write(reinterpret_cast<const char*>(writer.blob.data()), writer.blob.size());
+
+  if (!file.good())
+  {
+    throw std::runtime_error("failed to write cluster pages!");
+  }
+
+  ClusterPagesReport report;
+  report.cell_count = header.cell_count;
+  report.page_count = header.page_count;
+
+  size_t used_bytes = 0;
+  size_t lod0_vertices = 0;
+  for (const ClusterPageInfo &info : writer.infos)
+  {
+    used_bytes += info.size;
+    lod0_vertices += info.lod == 0 ? info.vertex_count : 0;
+  }
+  report.page_fill = float(double(used_bytes) / std::max<double>(double(writer.infos.size()) * CLUSTER_PAGE_SIZE, 1.0));
+  report.vertex_duplication = float(double(lod0_vertices) / std::max<size_t>(mesh.vertices.size(), 1));
+
+  return report;
+}
+
+ClusterPageFile::ClusterPageFile(const std::string &file_name)
+  : file(file_name)
+{
+  if (file.size() < sizeof(ClusterPagesHeader))
+  {
+    throw std::runtime_error("cluster pages are truncated!");
+  }
+
+  const ClusterPagesHeader &pages_header = header();
+
+  if (pages_header.magic != CLUSTER_PAGES_MAGIC)
+  {
+    throw std::runtime_error("file is not a cluster page file!");
+  }
+
+  if (pages_header.version != CLUSTER_PAGES_VERSION)
+  {
+    throw std::runtime_error("cluster page version mismatch, re-run the mesh converter!");
+  }
+
+  size_t tables_size = sizeof(ClusterPagesHeader) + size_t(pages_header.cell_count) * sizeof(ClusterCell) +
+    size_t(pages_header.cell_count) * pages_header.lod_count * sizeof(ClusterCellLod) + size_t(pages_header.page_count) * sizeof(ClusterPageInfo);
+
+  if (pages_header.lod_count == 0 || tables_size > pages_header.page_data_offset || pages_header.page_data_offset % CLUSTER_PAGE_SIZE != 0 ||
+    pages_header.page_data_offset + uint64_t(pages_header.page_count) * CLUSTER_PAGE_SIZE > file.size())
+  {
+    throw std::runtime_error("cluster pages are truncated!");
+  }
+
+  const uint8_t *tables = file.data() + sizeof(ClusterPagesHeader);
+  cell_table = reinterpret_cast<const ClusterCell*>(tables);
+  cell_lods = reinterpret_cast<const ClusterCellLod*>(cell_table + pages_header.cell_count);
+  page_table = reinterpret_cast<const ClusterPageInfo*>(cell_lods + size_t(pages_header.cell_count) * pages_header.lod_count);
+
+  for (uint32_t i = 0; i < pages_header.page_count; i++)
+  {
+    const ClusterPageInfo &info = page_table[i];
+    bool fits = info.size <= CLUSTER_PAGE_SIZE && info.index_offset + uint64_t(info.index_count) * sizeof(uint16_t) <= info.size &&
+      uint64_t(info.vertex_count) * vertexStride() <= info.index_offset && info.vertex_count <= 0x10000;
+
+    if (!fits || info.cell >= pages_header.cell_count || info.lod >= pages_header.lod_count)
+    {
+      throw std::runtime_error("cluster page is out of bounds!");
+    }
+  }
+
+  for (uint32_t i = 0; i < pages_header.cell_count * pages_header.lod_count; i++)
+  {
+    if (uint64_t(cell_lods[i].first_page) + cell_lods[i].page_count > pages_header.page_count)
+    {
+      throw std::runtime_error("cluster cell references missing pages!");
+    }
+  }
+}
+
+const ClusterPagesHeader &ClusterPageFile::header() const
+{
+  return *reinterpret_cast<const ClusterPagesHeader*>(file.data());
+}
+
+uint32_t ClusterPageFile::vertexStride() const
+{
+  return vertexEncoding() == VERTEX_ENCODING_QUANTIZED ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+const uint8_t *ClusterPageFile::pageData(uint32_t page) const
+{
+  return file.data() + header().page_data_offset + uint64_t(page) * CLUSTER_PAGE_SIZE;
+}
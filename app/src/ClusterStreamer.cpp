@@ -0,0 +1,345 @@
+#include "ClusterStreamer.hpp"
+#include "GpuMesh.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+void ClusterStreamer::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, const std::string &file_name, VkDeviceSize memory_budget, uint32_t frames_in_flight)
+{
+  this->device = device;
+  this->uploader = &uploader;
+  this->jobs = &jobs;
+  this->frames_in_flight = std::max(frames_in_flight, 1u);
+  pages = std::make_unique<ClusterPageFile>(file_name);
+
+  if (!isVertexEncodingSupported(physical_device, pages->vertexEncoding()))
+  {
+    throw std::runtime_error("Cluster page vertex encoding is not supported!");
+  }
+
+  // A whole number of vertices per slot, so a page's vertices are addressed with vertexOffset
+  vertex_stride = pages->vertexStride();
+  slot_size = (CLUSTER_PAGE_SIZE + vertex_stride - 1) / vertex_stride * vertex_stride;
+
+  uint32_t coarsest = pages->lodCount() - 1;
+  uint32_t pinned_count = 0;
+  for (uint32_t cell = 0; cell < pages->cellCount(); cell++)
+  {
+    pinned_count += pages->cellLod(cell, coarsest).page_count;
+  }
+
+  uint32_t slot_count = static_cast<uint32_t>(std::min<VkDeviceSize>(memory_budget / slot_size, UINT32_MAX));
+  if (slot_count < std::max(pinned_count, 1u))
+  {
+    throw std::runtime_error("Cluster streaming budget is smaller than the coarsest level!");
+  }
+
+  pool = createBuffer(device, physical_device, slot_count * slot_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  // Popped from the back, lowest slot first
+  free_slots.resize(slot_count);
+  for (uint32_t i = 0; i < slot_count; i++)
+  {
+    free_slots[i] = static_cast<int32_t>(slot_count - 1 - i);
+  }
+
+  page_states.assign(pages->pageCount(), PageState{});
+  cell_chains.resize(pages->cellCount());
+  cell_bounds.clear();
+
+  for (uint32_t cell = 0; cell < pages->cellCount(); cell++)
+  {
+    const ClusterCell &bounds = pages->cells()[cell];
+    cell_bounds.add(glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]), bounds.radius);
+
+    LodChain &chain = cell_chains[cell];
+    for (uint32_t lod = 0; lod < pages->lodCount(); lod++)
+    {
+      chain.errors.push_back(pages->cellLod(cell, lod).error);
+      chain.triangle_counts.push_back(pages->cellLod(cell, lod).triangle_count);
+    }
+
+    const ClusterCellLod &level = pages->cellLod(cell, coarsest);
+    for (uint32_t page = level.first_page; page < level.first_page + level.page_count; page++)
+    {
+      int32_t slot = free_slots.back();
+      free_slots.pop_back();
+      uploadPage(page, slot, pages->pageData(page));
+      page_states[page].pinned = true;
+    }
+  }
+
+  uploader.flush();
+
+  frame_stats = {};
+  frame_stats.pinned_pages = pinned_count;
+  frame_stats.budget_bytes = slot_count * slot_size;
+}
+
+void ClusterStreamer::cleanup()
+{
+  // Read jobs hold on to this object and the mapping
+  if (jobs != nullptr)
+  {
+    jobs->waitIdle();
+  }
+
+  destroyBuffer(device, pool);
+
+  free_slots.clear();
+  page_states.clear();
+  lru_pages.clear();
+  finished_reads.clear();
+  pending_reads = 0;
+  draws.clear();
+  pages.reset();
+  jobs = nullptr;
+  uploader = nullptr;
+}
+
+bool ClusterStreamer::isLevelResident(uint32_t cell, uint32_t lod) const
+{
+  const ClusterCellLod &level = pages->cellLod(cell, lod);
+  for (uint32_t page = level.first_page; page < level.first_page + level.page_count; page++)
+  {
+    if (page_states[page].slot == NO_SLOT)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ClusterStreamer::touchLevel(uint32_t cell, uint32_t lod)
+{
+  const ClusterCellLod &level = pages->cellLod(cell, lod);
+  for (uint32_t page = level.first_page; page < level.first_page + level.page_count; page++)
+  {
+    PageState &state = page_states[page];
+    state.last_used = frame;
+
+    if (state.slot != NO_SLOT && !state.pinned)
+    {
+      lru_pages.splice(lru_pages.begin(), lru_pages, state.lru);
+    }
+  }
+}
+
+bool ClusterStreamer::isEvictable(uint32_t page) const
+{
+  // Not drawn by any frame that may still be executing
+  return page_states[page].last_used + frames_in_flight <= frame;
+}
+
+uint32_t ClusterStreamer::availableSlots() const
+{
+  uint32_t available = static_cast<uint32_t>(free_slots.size());
+
+  for (auto it = lru_pages.rbegin(); it != lru_pages.rend() && available < max_pending_reads + pending_reads; ++it)
+  {
+    if (!isEvictable(*it))
+    {
+      break;
+    }
+    available++;
+  }
+
+  return available;
+}
+
+int32_t ClusterStreamer::allocateSlot()
+{
+  if (free_slots.empty())
+  {
+    if (lru_pages.empty() || !isEvictable(lru_pages.back()))
+    {
+      return NO_SLOT;
+    }
+
+    PageState &victim = page_states[lru_pages.back()];
+    lru_pages.pop_back();
+    free_slots.push_back(victim.slot);
+    victim.slot = NO_SLOT;
+    frame_stats.evicted++;
+  }
+
+  int32_t slot = free_slots.back();
+  free_slots.pop_back();
+  return slot;
+}
+
+void ClusterStreamer::uploadPage(uint32_t page, int32_t slot, const uint8_t *data)
+{
+  uint32_t size = pages->pages()[page].size;
+  std::memcpy(uploader->stageBuffer(pool.buffer, slot * slot_size, size), data, size);
+
+  PageState &state = page_states[page];
+  state.slot = slot;
+  state.last_used = frame;
+}
+
+void ClusterStreamer::receiveReads()
+{
+  std::vector<PageRead> reads;
+  {
+    std::lock_guard<std::mutex> lock(read_mutex);
+    reads.swap(finished_reads);
+  }
+
+  for (PageRead &read : reads)
+  {
+    pending_reads--;
+    PageState &state = page_states[read.page];
+    state.requested = false;
+
+    int32_t slot = allocateSlot();
+    if (slot == NO_SLOT)
+    {
+      // Requested again if the camera still needs it
+      frame_stats.dropped++;
+      continue;
+    }
+
+    uploadPage(read.page, slot, read.data.data());
+    lru_pages.push_front(read.page);
+    state.lru = lru_pages.begin();
+    frame_stats.loaded++;
+  }
+}
+
+void ClusterStreamer::requestPages()
+{
+  // Cells furthest from their selected level first, then the nearest
+  std::sort(requests.begin(), requests.end(), [](const LevelRequest &a, const LevelRequest &b)
+  {
+    return a.deficit != b.deficit ? a.deficit > b.deficit : a.distance < b.distance;
+  });
+
+  uint32_t available = availableSlots();
+
+  for (const LevelRequest &request : requests)
+  {
+    const ClusterCellLod &level = pages->cellLod(request.cell, request.lod);
+
+    for (uint32_t page = level.first_page; page < level.first_page + level.page_count; page++)
+    {
+      PageState &state = page_states[page];
+      if (state.slot != NO_SLOT || state.requested)
+      {
+        continue;
+      }
+
+      if (pending_reads >= max_pending_reads || pending_reads >= available)
+      {
+        return;
+      }
+
+      state.requested = true;
+      pending_reads++;
+
+      // Copying out of the mapping is what faults the page in, keep it off the render thread
+      jobs->submit([this, page]()
+      {
+        PageRead read{page, {}};
+        const uint8_t *data = pages->pageData(page);
+        read.data.assign(data, data + pages->pages()[page].size);
+
+        std::lock_guard<std::mutex> lock(read_mutex);
+        finished_reads.push_back(std::move(read));
+      });
+    }
+  }
+}
+
+void ClusterStreamer::update(const glm::mat4 &view, const glm::mat4 &proj, float viewport_height)
+{
+  frame++;
+  frame_stats.loaded = 0;
+  frame_stats.evicted = 0;
+  frame_stats.dropped = 0;
+  frame_stats.cells_drawn = 0;
+  frame_stats.cells_refining = 0;
+  frame_stats.triangles_drawn = 0;
+
+  receiveReads();
+
+  glm::vec3 camera_position = glm::vec3(glm::inverse(view)[3]);
+  selector.max_pixel_error = max_pixel_error;
+  selector.beginFrame(view, proj, viewport_height);
+  cullSpheres(extractFrustum(proj * view), cell_bounds, visible_cells);
+
+  draws.clear();
+  requests.clear();
+  uint32_t lod_count = pages->lodCount();
+
+  for (uint32_t cell : visible_cells)
+  {
+    glm::vec3 center(cell_bounds.center_x[cell], cell_bounds.center_y[cell], cell_bounds.center_z[cell]);
+    uint32_t selected = selector.select(cell, center, cell_bounds.radius[cell], 1.0f, cell_chains[cell]);
+
+    // The coarsest level is pinned, so this always finds one
+    uint32_t drawn = selected;
+    while (drawn + 1 < lod_count && !isLevelResident(cell, drawn))
+    {
+      drawn++;
+    }
+
+    touchLevel(cell, drawn);
+    if (drawn != selected)
+    {
+      // Keeps a partially streamed level from being evicted before it completes
+      touchLevel(cell, selected);
+      requests.push_back({cell, selected, drawn - selected, glm::length(center - camera_position)});
+      frame_stats.cells_refining++;
+    }
+
+    const ClusterCellLod &level = pages->cellLod(cell, drawn);
+    for (uint32_t page = level.first_page; page < level.first_page + level.page_count; page++)
+    {
+      const ClusterPageInfo &info = pages->pages()[page];
+      VkDeviceSize slot_offset = page_states[page].slot * slot_size;
+
+      VkDrawIndexedIndirectCommand command{};
+      command.indexCount = info.index_count;
+      command.instanceCount = 1;
+      command.firstIndex = static_cast<uint32_t>((slot_offset + info.index_offset) / sizeof(uint16_t));
+      command.vertexOffset = static_cast<int32_t>(slot_offset / vertex_stride);
+      draws.push_back(command);
+    }
+
+    frame_stats.cells_drawn++;
+    frame_stats.triangles_drawn += level.triangle_count;
+  }
+
+  requestPages();
+
+  if (uploader->pendingBytes() > 0)
+  {
+    uploader->flush();
+  }
+
+  frame_stats.resident_pages = static_cast<uint32_t>(lru_pages.size()) + frame_stats.pinned_pages;
+  frame_stats.resident_bytes = frame_stats.resident_pages * slot_size;
+  frame_stats.pending_reads = pending_reads;
+}
+
+void ClusterStreamer::draw(VkCommandBuffer command_buffer) const
+{
+  if (draws.empty())
+  {
+    return;
+  }
+
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(command_buffer, 0, 1, &pool.buffer, &offset);
+  vkCmdBindIndexBuffer(command_buffer, pool.buffer, 0, VK_INDEX_TYPE_UINT16);
+
+  for (const VkDrawIndexedIndirectCommand &command : draws)
+  {
+    vkCmdDrawIndexed(command_buffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+  }
+}
@@ -0,0 +1,258 @@
+#include "ClusterStreamer.hpp"
+#include "ClusterPages.hpp"
+#include "FrustumCulling.hpp"
+#include "StagingUploader.hpp"
+#include "JobSystem.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/geometric.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+/**
+ * Streams one .vpages file (MeshConverter --pages output) through
+ * ClusterStreamer with a small memory budget while the camera circles the
+ * mesh, diving in close and pulling back out twice. Prints the streaming
+ * stats once a simulated second, then the pages loaded, evicted and dropped
+ * and the update cost. Fails when the resident pages outgrow the budget or a
+ * visible cell is not drawn at least at its coarsest level.
+ * Usage: ClusterStreamingBenchmark <mesh.vpages> [budget MiB]
+ * The default budget holds the coarsest level and a quarter of the other pages.
+ */
+namespace
+{
+  const int FRAMES = 600;
+  const int FRAMES_PER_SECOND = 60;
+  const uint32_t FRAMES_IN_FLIGHT = 2;
+  const float VIEWPORT_HEIGHT = 1080.0f;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Cluster Streaming Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Uploads only, so any graphics queue will do
+    for (VkPhysicalDevice device : devices)
+    {
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      for (uint32_t i = 0; i < family_count && context.physical_device == VK_NULL_HANDLE; i++)
+      {
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+        }
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with a graphics queue!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: ClusterStreamingBenchmark <mesh.vpages> [budget MiB]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    // The same tables the streamer reads, for the camera path and the checks
+    ClusterPageFile pages(argv[1]);
+    uint32_t coarsest = pages.lodCount() - 1;
+
+    CullingBounds bounds;
+    glm::vec3 bounds_min(INFINITY);
+    glm::vec3 bounds_max(-INFINITY);
+    std::vector<uint32_t> coarsest_triangles(pages.cellCount());
+    uint32_t pinned_pages = 0;
+    uint64_t full_triangles = 0;
+
+    for (uint32_t cell = 0; cell < pages.cellCount(); cell++)
+    {
+      const ClusterCell &sphere = pages.cells()[cell];
+      glm::vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+      bounds.add(center, sphere.radius);
+      bounds_min = glm::min(bounds_min, center - sphere.radius);
+      bounds_max = glm::max(bounds_max, center + sphere.radius);
+
+      coarsest_triangles[cell] = pages.cellLod(cell, coarsest).triangle_count;
+      pinned_pages += pages.cellLod(cell, coarsest).page_count;
+      full_triangles += pages.cellLod(cell, 0).triangle_count;
+    }
+
+    // Slots are a page rounded up to whole vertices
+    VkDeviceSize slot_size = CLUSTER_PAGE_SIZE + pages.vertexStride();
+    VkDeviceSize budget = argc > 2 ? VkDeviceSize(std::strtod(argv[2], nullptr) * 1024.0 * 1024.0)
+      : (pinned_pages + (pages.pageCount() - pinned_pages) / 4) * slot_size;
+
+    glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+    float radius = std::max(glm::length(bounds_max - bounds_min) * 0.5f, 1e-3f);
+
+    std::cout << pages.cellCount() << " cells, " << pages.lodCount() << " levels, " << pages.pageCount() << " pages ("
+      << pinned_pages << " pinned), budget " << budget / 1024 << " KiB" << std::endl;
+
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    JobSystem jobs;
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    ClusterStreamer streamer;
+    streamer.init(device, context.physical_device, uploader, jobs, argv[1], budget, FRAMES_IN_FLIGHT);
+
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, radius * 0.01f, radius * 20.0f);
+    proj[1][1] *= -1.0f;
+
+    std::vector<uint32_t> visible;
+    uint32_t loaded = 0;
+    uint32_t evicted = 0;
+    uint32_t dropped = 0;
+    double update_ms = 0.0;
+    double triangles = 0.0;
+    int over_budget_frames = 0;
+    int undrawn_frames = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+      // One orbit, closing in from six radii to just off the surface and back, twice
+      float t = float(frame) / (FRAMES - 1);
+      float angle = t * glm::radians(360.0f);
+      float distance = radius * (1.1f + 4.9f * (0.5f + 0.5f * std::cos(t * glm::radians(720.0f))));
+      glm::vec3 eye = center + glm::vec3(std::sin(angle), 0.3f, std::cos(angle)) * distance;
+      glm::mat4 view = glm::lookAtRH(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+      auto start = std::chrono::high_resolution_clock::now();
+      streamer.update(view, proj, VIEWPORT_HEIGHT);
+      auto end = std::chrono::high_resolution_clock::now();
+
+      const ClusterStreamingStats &stats = streamer.stats();
+      update_ms += std::chrono::duration<double, std::milli>(end - start).count();
+      triangles += double(stats.triangles_drawn);
+      loaded += stats.loaded;
+      evicted += stats.evicted;
+      dropped += stats.dropped;
+
+      over_budget_frames += stats.resident_bytes > stats.budget_bytes || stats.budget_bytes > budget ? 1 : 0;
+
+      // Every visible cell draws, at worst with the pinned coarsest level
+      cullSpheres(extractFrustum(proj * view), bounds, visible);
+      uint64_t coarsest_visible = 0;
+      for (uint32_t cell : visible)
+      {
+        coarsest_visible += coarsest_triangles[cell];
+      }
+      undrawn_frames += stats.cells_drawn != visible.size() || stats.triangles_drawn < coarsest_visible ? 1 : 0;
+
+      if (frame % FRAMES_PER_SECOND == 0)
+      {
+        std::cout << "frame " << frame << ": " << stats.resident_pages << " pages (" << stats.resident_bytes / 1024 << " of "
+          << stats.budget_bytes / 1024 << " KiB), " << stats.pending_reads << " pending, " << stats.cells_drawn << " cells drawn, "
+          << stats.cells_refining << " refining, " << stats.triangles_drawn << " triangles" << std::endl;
+      }
+    }
+
+    streamer.cleanup();
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    std::cout << "average of " << FRAMES << " frames: " << update_ms / FRAMES << " ms per update, "
+      << triangles / FRAMES << " triangles drawn of " << full_triangles << " at level 0" << std::endl;
+    std::cout << "pages: " << loaded << " loaded, " << evicted << " evicted, " << dropped << " dropped" << std::endl;
+
+    if (over_budget_frames > 0)
+    {
+      std::cerr << "resident pages exceeded the budget in " << over_budget_frames << " frames!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (undrawn_frames > 0)
+    {
+      std::cerr << "visible cells were not drawn in " << undrawn_frames << " frames!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include "FrustumCulling.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdlib>
+
+/**
+ * Times the scalar and SIMD sphere culling paths on the same random scene
+ * and checks that they agree.
+ */
+typedef void (*CullFunction)(const Frustum&, const CullingBounds&, std::vector<uint32_t>&);
+
+double timeCull(CullFunction cull, const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible, int iterations)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+
+  for (int i = 0; i < iterations; i++)
+  {
+    cull(frustum, bounds, visible);
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t object_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const int ITERATIONS = 50;
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+  CullingBounds bounds;
+  for (size_t i = 0; i < object_count; i++)
+  {
+    bounds.add(glm::vec3(position(rng), position(rng), position(rng)), size(rng));
+  }
+
+  glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.2f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = extractFrustum(proj * view);
+
+  std::vector<uint32_t> scalar_visible, sse_visible, avx_visible;
+
+  double scalar_ms = timeCull(cullSpheresScalar, frustum, bounds, scalar_visible, ITERATIONS);
+  double sse_ms = timeCull(cullSpheresSSE, frustum, bounds, sse_visible, ITERATIONS);
+  double avx_ms = timeCull(cullSpheresAVX, frustum, bounds, avx_visible, ITERATIONS);
+
+  std::cout << object_count << " spheres, " << scalar_visible.size() << " visible (widest path: " << cullSpheresPath() << ")" << std::endl;
+  std::cout << "scalar: " << scalar_ms << " ms" << std::endl;
+  std::cout << "sse:    " << sse_ms << " ms (" << scalar_ms / sse_ms << "x)" << std::endl;
+  std::cout << "avx:    " << avx_ms << " ms (" << scalar_ms / avx_ms << "x)" << std::endl;
+
+  if (sse_visible != scalar_visible || avx_visible != scalar_visible)
+  {
+    std::cerr << "SIMD results do not match the scalar baseline!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
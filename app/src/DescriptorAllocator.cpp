@@ -0,0 +1,295 @@
+#include "DescriptorAllocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+  const uint32_t MAX_SETS_PER_POOL = 4096;
+
+  const VkDescriptorPoolSize DEFAULT_POOL_RATIOS[] =
+  {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2},
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}
+  };
+
+  bool isBufferDescriptor(VkDescriptorType type)
+  {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+      type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+  }
+
+  bool isImageDescriptor(VkDescriptorType type)
+  {
+    return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+      type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+  }
+
+  // FNV-1a over 64-bit words
+  uint64_t hashWord(uint64_t hash, uint64_t word)
+  {
+    return (hash ^ word) * 1099511628211ull;
+  }
+
+  uint64_t hashSet(VkDescriptorSetLayout layout, const DescriptorWrite *writes, uint32_t write_count)
+  {
+    uint64_t hash = hashWord(14695981039346656037ull, reinterpret_cast<uint64_t>(layout));
+
+    for (uint32_t i = 0; i < write_count; i++)
+    {
+      const DescriptorWrite &write = writes[i];
+      hash = hashWord(hash, (uint64_t(write.binding) << 32) | write.array_element);
+      hash = hashWord(hash, (uint64_t(write.type) << 32) | write.layout);
+      hash = hashWord(hash, reinterpret_cast<uint64_t>(write.buffer));
+      hash = hashWord(hash, write.offset);
+      hash = hashWord(hash, write.range);
+      hash = hashWord(hash, reinterpret_cast<uint64_t>(write.sampler));
+      hash = hashWord(hash, reinterpret_cast<uint64_t>(write.view));
+    }
+
+    return hash;
+  }
+}
+
+bool DescriptorWrite::operator==(const DescriptorWrite &other) const
+{
+  return binding == other.binding && array_element == other.array_element && type == other.type &&
+    buffer == other.buffer && offset == other.offset && range == other.range &&
+    sampler == other.sampler && view == other.view && layout == other.layout;
+}
+
+DescriptorWrite bufferDescriptor(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+  DescriptorWrite write;
+  write.binding = binding;
+  write.type = type;
+  write.buffer = buffer;
+  write.offset = offset;
+  write.range = range;
+  return write;
+}
+
+DescriptorWrite imageDescriptor(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+  DescriptorWrite write;
+  write.binding = binding;
+  write.type = type;
+  write.view = view;
+  write.sampler = sampler;
+  write.layout = view != VK_NULL_HANDLE ? layout : VK_IMAGE_LAYOUT_UNDEFINED;
+  return write;
+}
+
+VkWriteDescriptorSet descriptorSetWrite(VkDescriptorSet set, const DescriptorWrite &write, VkDescriptorBufferInfo &buffer_info, VkDescriptorImageInfo &image_info)
+{
+  VkWriteDescriptorSet set_write{};
+  set_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  set_write.dstSet = set;
+  set_write.dstBinding = write.binding;
+  set_write.dstArrayElement = write.array_element;
+  set_write.descriptorCount = 1;
+  set_write.descriptorType = write.type;
+
+  if (isBufferDescriptor(write.type))
+  {
+    buffer_info = {write.buffer, write.offset, write.range};
+    set_write.pBufferInfo = &buffer_info;
+  }
+  else if (isImageDescriptor(write.type))
+  {
+    image_info = {write.sampler, write.view, write.layout};
+    set_write.pImageInfo = &image_info;
+  }
+  else
+  {
+    throw std::runtime_error("Unsupported descriptor type!");
+  }
+
+  return set_write;
+}
+
+void DescriptorAllocator::init(VkDevice device, uint32_t frames_in_flight, uint32_t sets_per_pool, const std::vector<VkDescriptorPoolSize> &pool_ratios)
+{
+  this->device = device;
+  this->sets_per_pool = std::min(std::max(sets_per_pool, 1u), MAX_SETS_PER_POOL);
+  this->pool_ratios = pool_ratios;
+
+  if (this->pool_ratios.empty())
+  {
+    this->pool_ratios.assign(std::begin(DEFAULT_POOL_RATIOS), std::end(DEFAULT_POOL_RATIOS));
+  }
+
+  frames.resize(frames_in_flight);
+  current_frame = 0;
+}
+
+void DescriptorAllocator::cleanup()
+{
+  for (FramePools &frame : frames)
+  {
+    for (VkDescriptorPool pool : frame.pools)
+    {
+      vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+  }
+
+  frames.clear();
+  pool_ratios.clear();
+  set_writes.clear();
+  buffer_infos.clear();
+  image_infos.clear();
+  device = VK_NULL_HANDLE;
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frame_index)
+{
+  current_frame = frame_index;
+  FramePools &frame = frames[frame_index];
+
+  for (size_t i = 0; i < frame.pools.size() && i <= frame.current_pool; i++)
+  {
+    vkResetDescriptorPool(device, frame.pools[i], 0);
+  }
+
+  frame.current_pool = 0;
+  frame.cache.clear();
+  frame.entries.clear();
+  frame.writes.clear();
+  frame.stats = DescriptorStats{};
+  frame.stats.pools = static_cast<uint32_t>(frame.pools.size());
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const DescriptorWrite *writes, uint32_t write_count)
+{
+  FramePools &frame = frames[current_frame];
+  uint64_t hash = hashSet(layout, writes, write_count);
+
+  if (const CachedSet *cached = findSet(frame, hash, layout, writes, write_count))
+  {
+    frame.stats.reused++;
+    return cached->set;
+  }
+
+  VkDescriptorSet set = allocateSet(frame, layout);
+  writeSet(set, writes, write_count);
+
+  CachedSet entry{};
+  entry.layout = layout;
+  entry.first_write = static_cast<uint32_t>(frame.writes.size());
+  entry.write_count = write_count;
+  entry.set = set;
+  frame.writes.insert(frame.writes.end(), writes, writes + write_count);
+
+  // New entries go to the front of their hash's chain
+  auto found = frame.cache.find(hash);
+  entry.next = found != frame.cache.end() ? found->second : NO_ENTRY;
+  frame.cache[hash] = static_cast<uint32_t>(frame.entries.size());
+  frame.entries.push_back(entry);
+
+  frame.stats.allocated++;
+  return set;
+}
+
+const DescriptorAllocator::CachedSet *DescriptorAllocator::findSet(const FramePools &frame, uint64_t hash, VkDescriptorSetLayout layout,
+  const DescriptorWrite *writes, uint32_t write_count) const
+{
+  auto found = frame.cache.find(hash);
+  if (found == frame.cache.end())
+  {
+    return nullptr;
+  }
+
+  // Hashes can collide, compare the requests themselves
+  for (uint32_t i = found->second; i != NO_ENTRY; i = frame.entries[i].next)
+  {
+    const CachedSet &entry = frame.entries[i];
+    if (entry.layout == layout && entry.write_count == write_count &&
+        std::equal(writes, writes + write_count, frame.writes.begin() + entry.first_write))
+    {
+      return &entry;
+    }
+  }
+
+  return nullptr;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t max_sets) const
+{
+  std::vector<VkDescriptorPoolSize> pool_sizes = pool_ratios;
+  for (VkDescriptorPoolSize &size : pool_sizes)
+  {
+    size.descriptorCount *= max_sets;
+  }
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = max_sets;
+  pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+  pool_info.pPoolSizes = pool_sizes.data();
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create descriptor pool!");
+  }
+
+  return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateSet(FramePools &frame, VkDescriptorSetLayout layout)
+{
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &layout;
+
+  // Move on to the frame's next pool when the current one is exhausted, growing the list when there is none
+  while (true)
+  {
+    bool fresh_pool = false;
+    if (frame.current_pool == frame.pools.size())
+    {
+      uint32_t max_sets = std::min(sets_per_pool << std::min<size_t>(frame.pools.size(), 12), MAX_SETS_PER_POOL);
+      frame.pools.push_back(createPool(max_sets));
+      frame.stats.pools = static_cast<uint32_t>(frame.pools.size());
+      fresh_pool = true;
+    }
+
+    alloc_info.descriptorPool = frame.pools[frame.current_pool];
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(device, &alloc_info, &set);
+
+    if (result == VK_SUCCESS)
+    {
+      return set;
+    }
+
+    if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || fresh_pool)
+    {
+      throw std::runtime_error("Failed to allocate descriptor set!");
+    }
+
+    frame.current_pool++;
+  }
+}
+
+void DescriptorAllocator::writeSet(VkDescriptorSet set, const DescriptorWrite *writes, uint32_t write_count)
+{
+  // Sized up front, the writes point into them
+  set_writes.resize(write_count);
+  buffer_infos.resize(write_count);
+  image_infos.resize(write_count);
+
+  for (uint32_t i = 0; i < write_count; i++)
+  {
+    set_writes[i] = descriptorSetWrite(set, writes[i], buffer_infos[i], image_infos[i]);
+  }
+
+  vkUpdateDescriptorSets(device, write_count, set_writes.data(), 0, nullptr);
+}
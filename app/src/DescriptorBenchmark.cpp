@@ -0,0 +1,664 @@
+#include "BindlessHeap.hpp"
+#include "DescriptorAllocator.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+/**
+ * Headless descriptor update throughput on one scene: every draw reads its own
+ * texture and a slice of the object buffer. Each frame writes the descriptors
+ * of every draw through
+ *  - DescriptorAllocator, one set per draw (the per-draw binding model)
+ *  - BindlessHeap on the descriptor set backend
+ *  - BindlessHeap on the descriptor buffer backend, when supported
+ * and is timed on the CPU. Each heap then draws the scene in one frame: the
+ * heap is bound once and every draw selects its material and object with
+ * BindlessDrawConstants alone (BindlessQuad.vert, Bindless.frag). Needs the
+ * .spv files in the working directory.
+ * Usage: DescriptorBenchmark [draws] [all|set|buffer]
+ */
+namespace
+{
+  const uint32_t TEXTURE_COUNT = 256;
+  const VkDeviceSize OBJECT_SIZE = 256; // no device needs a larger storage buffer offset alignment
+  const int ITERATIONS = 50;
+  const uint32_t WIDTH = 512;
+  const uint32_t HEIGHT = 512;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    bool descriptor_buffer = false;
+  };
+
+  /**
+   * What the bindless frames render into, shared by every heap
+   */
+  struct FrameTarget
+  {
+    Image color;
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+  };
+
+  struct FrameResult
+  {
+    double record_ms = 0.0;
+    double gpu_ms = 0.0; // submit to idle, timed on the CPU
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Descriptor Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Prefer a device that can run every backend
+    for (VkPhysicalDevice device : devices)
+    {
+      if (!isBindlessSupported(context.instance, device))
+      {
+        continue;
+      }
+
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      uint32_t graphics_family = family_count;
+      for (uint32_t i = 0; i < family_count && graphics_family == family_count; i++)
+      {
+        graphics_family = families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT ? i : family_count;
+      }
+
+      if (graphics_family == family_count)
+      {
+        continue;
+      }
+
+      bool descriptor_buffer = isDescriptorBufferSupported(context.instance, device);
+      if (context.physical_device == VK_NULL_HANDLE || (descriptor_buffer && !context.descriptor_buffer))
+      {
+        context.physical_device = device;
+        context.queue_family = graphics_family;
+        context.descriptor_buffer = descriptor_buffer;
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with descriptor indexing!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    std::vector<const char*> extensions = {VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexing_features = bindlessFeatures();
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures address_features{};
+    address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    address_features.bufferDeviceAddress = VK_TRUE;
+
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_features{};
+    descriptor_buffer_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    descriptor_buffer_features.descriptorBuffer = VK_TRUE;
+
+    if (context.descriptor_buffer)
+    {
+      extensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+      indexing_features.pNext = &address_features;
+      address_features.pNext = &descriptor_buffer_features;
+    }
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &indexing_features;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    device_info.ppEnabledExtensionNames = extensions.data();
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  FrameTarget createFrameTarget(const HeadlessContext &context)
+  {
+    FrameTarget target;
+    target.color = createImage(context.device, context.physical_device, WIDTH, HEIGHT, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkAttachmentDescription attachment{};
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(context.device, &render_pass_info, nullptr, &target.render_pass) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create render pass!");
+    }
+
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = target.render_pass;
+    framebuffer_info.attachmentCount = 1;
+    framebuffer_info.pAttachments = &target.color.view;
+    framebuffer_info.width = WIDTH;
+    framebuffer_info.height = HEIGHT;
+    framebuffer_info.layers = 1;
+
+    if (vkCreateFramebuffer(context.device, &framebuffer_info, nullptr, &target.framebuffer) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create framebuffer!");
+    }
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = context.queue_family;
+
+    if (vkCreateCommandPool(context.device, &pool_info, nullptr, &target.command_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = target.command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    vkAllocateCommandBuffers(context.device, &alloc_info, &target.command_buffer);
+
+    return target;
+  }
+
+  void destroyFrameTarget(VkDevice device, FrameTarget &target)
+  {
+    vkDestroyCommandPool(device, target.command_pool, nullptr);
+    vkDestroyFramebuffer(device, target.framebuffer, nullptr);
+    vkDestroyRenderPass(device, target.render_pass, nullptr);
+    destroyImage(device, target.color);
+  }
+
+  /**
+   * BindlessQuad.vert and Bindless.frag on the heap's layout, the only layout
+   * any bindless pipeline needs
+   */
+  VkPipeline createBindlessPipeline(VkDevice device, const BindlessHeap &heap, VkRenderPass render_pass)
+  {
+    VkShaderModule vert_module = loadShaderModule(device, "bindless_quad_vert.spv");
+    VkShaderModule frag_module = loadShaderModule(device, "bindless_frag.spv");
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vert_module;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = frag_module;
+    stages[1].pName = "main";
+
+    // Corners come from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    VkViewport viewport{0.0f, 0.0f, float(WIDTH), float(HEIGHT), 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+
+    VkPipelineViewportStateCreateInfo viewport_state_info{};
+    viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_info.viewportCount = 1;
+    viewport_state_info.pViewports = &viewport;
+    viewport_state_info.scissorCount = 1;
+    viewport_state_info.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_info{};
+    rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_info.lineWidth = 1.0f;
+    rasterization_info.cullMode = VK_CULL_MODE_NONE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling_info{};
+    multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling_info.minSampleShading = 1.0f;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment{};
+    color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_info{};
+    color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_info.attachmentCount = 1;
+    color_blend_info.pAttachments = &color_blend_attachment;
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.flags = heap.pipelineCreateFlags();
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = stages;
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state_info;
+    pipeline_info.pRasterizationState = &rasterization_info;
+    pipeline_info.pMultisampleState = &multisampling_info;
+    pipeline_info.pColorBlendState = &color_blend_info;
+    pipeline_info.layout = heap.pipelineLayout();
+    pipeline_info.renderPass = render_pass;
+    pipeline_info.subpass = 0;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, frag_module, nullptr);
+    vkDestroyShaderModule(device, vert_module, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create bindless pipeline!");
+    }
+
+    return pipeline;
+  }
+
+  /**
+   * Runs `frame` ITERATIONS times after a warm-up run and returns the average in milliseconds
+   */
+  template <typename Frame>
+  double timeFrames(Frame frame)
+  {
+    frame();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+      frame();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+  }
+
+  double timeBindless(const HeadlessContext &context, BindlessBackend backend, uint32_t draw_count, const std::vector<Image> &textures, const Buffer &objects)
+  {
+    BindlessLimits limits;
+    limits.max_textures = draw_count;
+    limits.max_buffers = draw_count;
+
+    BindlessHeap heap;
+    heap.init(context.instance, context.device, context.physical_device, 1, backend, limits);
+
+    std::vector<BindlessIndex> texture_indices(draw_count);
+    std::vector<BindlessIndex> object_indices(draw_count);
+
+    // The whole scene streams in and out every frame; removed indices come back at the next beginFrame
+    double ms = timeFrames([&]()
+    {
+      for (uint32_t draw = 0; draw < draw_count; draw++)
+      {
+        texture_indices[draw] = heap.addTexture(textures[draw % TEXTURE_COUNT].view);
+        object_indices[draw] = heap.addBuffer(objects.buffer, draw * OBJECT_SIZE, OBJECT_SIZE);
+      }
+
+      heap.flush();
+
+      for (uint32_t draw = 0; draw < draw_count; draw++)
+      {
+        heap.removeTexture(texture_indices[draw]);
+        heap.removeBuffer(object_indices[draw]);
+      }
+
+      heap.beginFrame();
+    });
+
+    heap.cleanup();
+    return ms;
+  }
+
+  /**
+   * Draws the scene once through a heap holding every texture, one buffer of
+   * materials and one of quads: a single bind for the frame, then per draw
+   * only push constants and vkCmdDraw
+   */
+  FrameResult drawBindless(const HeadlessContext &context, BindlessBackend backend, uint32_t draw_count, const std::vector<Image> &textures, FrameTarget &target)
+  {
+    VkDevice device = context.device;
+
+    BindlessLimits limits;
+    limits.max_textures = TEXTURE_COUNT;
+    limits.max_buffers = 2;
+
+    BindlessHeap heap;
+    heap.init(context.instance, device, context.physical_device, 1, backend, limits);
+
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    VkSampler sampler;
+    if (vkCreateSampler(device, &sampler_info, nullptr, &sampler) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create texture sampler!");
+    }
+
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | (backend == BINDLESS_BACKEND_DESCRIPTOR_BUFFER ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0);
+    VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    Buffer materials = createBuffer(device, context.physical_device, TEXTURE_COUNT * sizeof(BindlessMaterial), usage, host_visible);
+    Buffer quads = createBuffer(device, context.physical_device, draw_count * sizeof(float) * 4, usage, host_visible);
+
+    BindlessIndex sampler_index = heap.addSampler(sampler);
+    BindlessMaterial *material_data = static_cast<BindlessMaterial*>(materials.mapped);
+    for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+    {
+      material_data[i] = BindlessMaterial{};
+      material_data[i].albedo = heap.addTexture(textures[i].view);
+      material_data[i].sampler = sampler_index;
+      material_data[i].base_color = glm::vec4((i & 7) / 7.0f, ((i >> 3) & 7) / 7.0f, ((i >> 6) & 3) / 3.0f, 1.0f);
+    }
+
+    // Draws in a grid covering the target
+    uint32_t side = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(double(draw_count)))));
+    float *rects = static_cast<float*>(quads.mapped);
+    for (uint32_t draw = 0; draw < draw_count; draw++)
+    {
+      float x = -1.0f + 2.0f * (draw % side) / side;
+      float y = -1.0f + 2.0f * (draw / side) / side;
+      rects[draw * 4 + 0] = x;
+      rects[draw * 4 + 1] = y;
+      rects[draw * 4 + 2] = x + 2.0f / side;
+      rects[draw * 4 + 3] = y + 2.0f / side;
+    }
+
+    BindlessDrawConstants constants;
+    constants.materials = heap.addBuffer(materials.buffer, 0, materials.size);
+    constants.objects = heap.addBuffer(quads.buffer, 0, quads.size);
+    heap.flush();
+
+    VkPipeline pipeline = createBindlessPipeline(device, heap, target.render_pass);
+
+    VkCommandBuffer command_buffer = target.command_buffer;
+    vkResetCommandBuffer(command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+
+    // Never written, the contents do not matter; only the layout has to be right
+    std::vector<VkImageMemoryBarrier> barriers(TEXTURE_COUNT);
+    for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+    {
+      barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barriers[i].image = textures[i].image;
+      barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    }
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, TEXTURE_COUNT, barriers.data());
+
+    VkClearValue clear_value{};
+
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = target.render_pass;
+    render_pass_info.framebuffer = target.framebuffer;
+    render_pass_info.renderArea = {{0, 0}, {WIDTH, HEIGHT}};
+    render_pass_info.clearValueCount = 1;
+    render_pass_info.pClearValues = &clear_value;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    heap.bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    for (uint32_t draw = 0; draw < draw_count; draw++)
+    {
+      constants.material = draw % TEXTURE_COUNT;
+      constants.object = draw;
+      heap.pushConstants(command_buffer, constants);
+      vkCmdDraw(command_buffer, 4, 1, 0, 0);
+    }
+
+    vkCmdEndRenderPass(command_buffer);
+    vkEndCommandBuffer(command_buffer);
+
+    auto recorded = std::chrono::high_resolution_clock::now();
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to submit bindless frame!");
+    }
+    vkQueueWaitIdle(context.queue);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    FrameResult result;
+    result.record_ms = std::chrono::duration<double, std::milli>(recorded - start).count();
+    result.gpu_ms = std::chrono::duration<double, std::milli>(end - recorded).count();
+
+    vkDestroyPipeline(device, pipeline, nullptr);
+    heap.cleanup();
+    destroyBuffer(device, quads);
+    destroyBuffer(device, materials);
+    vkDestroySampler(device, sampler, nullptr);
+    return result;
+  }
+
+  double timeDescriptorSets(const HeadlessContext &context, uint32_t draw_count, const std::vector<Image> &textures, const Buffer &objects)
+  {
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 2;
+    layout_info.pBindings = bindings;
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(context.device, &layout_info, nullptr, &layout) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    DescriptorAllocator allocator;
+    allocator.init(context.device, 1, 1024, {{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+
+    // Every draw's set differs, so the cache never hits
+    double ms = timeFrames([&]()
+    {
+      allocator.beginFrame(0);
+
+      for (uint32_t draw = 0; draw < draw_count; draw++)
+      {
+        allocator.allocate(layout,
+        {
+          imageDescriptor(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textures[draw % TEXTURE_COUNT].view),
+          bufferDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objects.buffer, draw * OBJECT_SIZE, OBJECT_SIZE)
+        });
+      }
+    });
+
+    allocator.cleanup();
+    vkDestroyDescriptorSetLayout(context.device, layout, nullptr);
+    return ms;
+  }
+
+  void report(const char *name, double ms, uint32_t draw_count, double baseline_ms)
+  {
+    std::cout << name << ms << " ms, " << 2.0 * draw_count / (ms * 1e-3) * 1e-6 << " M descriptors/s";
+    if (baseline_ms > 0.0)
+    {
+      std::cout << " (" << baseline_ms / ms << "x per-draw sets)";
+    }
+    std::cout << std::endl;
+  }
+
+  void reportFrame(const FrameResult &frame, uint32_t draw_count)
+  {
+    std::cout << "  one frame, heap bound once: " << draw_count << " draws recorded in " << frame.record_ms << " ms, "
+      << frame.gpu_ms << " ms to submit and finish" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t draw_count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 10000;
+  std::string backends = argc > 2 ? argv[2] : "all";
+
+  try
+  {
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    bool run_set = backends == "all" || backends == "set";
+    bool run_buffer = backends == "all" || backends == "buffer";
+
+    if (run_buffer && !context.descriptor_buffer)
+    {
+      std::cout << "VK_EXT_descriptor_buffer is not supported, skipping the descriptor buffer backend" << std::endl;
+      run_buffer = false;
+    }
+
+    // Contents never matter, only the bindless frames sample them
+    std::vector<Image> textures;
+    for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+    {
+      textures.push_back(createImage(device, context.physical_device, 4, 4, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT));
+    }
+
+    VkBufferUsageFlags object_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | (context.descriptor_buffer ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0);
+    Buffer objects = createBuffer(device, context.physical_device, draw_count * OBJECT_SIZE, object_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    double sets_ms = timeDescriptorSets(context, draw_count, textures, objects);
+    FrameTarget target = createFrameTarget(context);
+
+    std::cout << draw_count << " draws, 2 descriptors each, average of " << ITERATIONS << " frames" << std::endl;
+    report("per-draw sets:     ", sets_ms, draw_count, 0.0);
+
+    if (run_set)
+    {
+      report("bindless set:      ", timeBindless(context, BINDLESS_BACKEND_DESCRIPTOR_SET, draw_count, textures, objects), draw_count, sets_ms);
+      reportFrame(drawBindless(context, BINDLESS_BACKEND_DESCRIPTOR_SET, draw_count, textures, target), draw_count);
+    }
+
+    if (run_buffer)
+    {
+      report("descriptor buffer: ", timeBindless(context, BINDLESS_BACKEND_DESCRIPTOR_BUFFER, draw_count, textures, objects), draw_count, sets_ms);
+      reportFrame(drawBindless(context, BINDLESS_BACKEND_DESCRIPTOR_BUFFER, draw_count, textures, target), draw_count);
+    }
+
+    destroyFrameTarget(device, target);
+    destroyBuffer(device, objects);
+    for (Image &texture : textures)
+    {
+      destroyImage(device, texture);
+    }
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,327 @@
+#include "DrawList.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  const uint32_t RADIX_BITS = 8;
+  const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+  const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+  // Below this a single chunk is faster than waking the workers
+  const size_t PARALLEL_SORT_THRESHOLD = 16384;
+
+  uint64_t field(uint32_t value, uint32_t bits, uint32_t shift)
+  {
+    return (uint64_t(value) & ((uint64_t(1) << bits) - 1)) << shift;
+  }
+
+  uint32_t digit(uint64_t key, uint32_t pass)
+  {
+    return static_cast<uint32_t>(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+  }
+}
+
+uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth)
+{
+  const uint32_t MATERIAL_SHIFT = SORT_KEY_DEPTH_BITS;
+  const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + SORT_KEY_MATERIAL_BITS;
+  const uint32_t PASS_SHIFT = PIPELINE_SHIFT + SORT_KEY_PIPELINE_BITS;
+
+  return field(pass, SORT_KEY_PASS_BITS, PASS_SHIFT) |
+    field(pipeline, SORT_KEY_PIPELINE_BITS, PIPELINE_SHIFT) |
+    field(material, SORT_KEY_MATERIAL_BITS, MATERIAL_SHIFT) |
+    field(depth, SORT_KEY_DEPTH_BITS, 0);
+}
+
+uint32_t sortKeyDepth(float view_depth, bool back_to_front)
+{
+  // The bits of a non-negative float compare like the float itself
+  float depth = std::max(view_depth, 0.0f);
+  uint32_t bits;
+  std::memcpy(&bits, &depth, sizeof(bits));
+
+  return back_to_front ? ~bits : bits;
+}
+
+void radixSortDraws(std::vector<DrawSortItem> &items, std::vector<DrawSortItem> &scratch, JobSystem *jobs)
+{
+  size_t count = items.size();
+  scratch.resize(count);
+
+  uint32_t chunk_count = 1;
+  if (jobs != nullptr && count >= PARALLEL_SORT_THRESHOLD)
+  {
+    chunk_count = jobs->workerCount() + 1;
+  }
+  size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+  auto forEachChunk = [&](const std::function<void(uint32_t, size_t, size_t)> &fn)
+  {
+    auto runChunks = [&](uint32_t begin, uint32_t end)
+    {
+      for (uint32_t chunk = begin; chunk < end; chunk++)
+      {
+        fn(chunk, std::min(chunk * chunk_size, count), std::min((chunk + 1) * chunk_size, count));
+      }
+    };
+
+    if (chunk_count > 1)
+    {
+      jobs->parallelFor(chunk_count, 1, runChunks);
+    }
+    else
+    {
+      runChunks(0, 1);
+    }
+  };
+
+  // One read gives the histograms of every pass. The totals tell which passes
+  // can be skipped; the per chunk counts stay valid until the first scatter
+  std::vector<uint32_t> histograms(size_t(chunk_count) * RADIX_PASSES * RADIX_SIZE, 0);
+
+  auto histogramChunk = [&](uint32_t chunk, size_t begin, size_t end, uint32_t first_pass, uint32_t last_pass)
+  {
+    for (uint32_t pass = first_pass; pass <= last_pass; pass++)
+    {
+      uint32_t *histogram = &histograms[(size_t(chunk) * RADIX_PASSES + pass) * RADIX_SIZE];
+      for (size_t i = begin; i < end; i++)
+      {
+        histogram[digit(items[i].key, pass)]++;
+      }
+    }
+  };
+
+  forEachChunk([&](uint32_t chunk, size_t begin, size_t end)
+  {
+    histogramChunk(chunk, begin, end, 0, RADIX_PASSES - 1);
+  });
+
+  std::vector<bool> skip_pass(RADIX_PASSES, false);
+  for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+  {
+    for (uint32_t d = 0; d < RADIX_SIZE; d++)
+    {
+      uint32_t digit_total = 0;
+      for (uint32_t chunk = 0; chunk < chunk_count; chunk++)
+      {
+        digit_total += histograms[(size_t(chunk) * RADIX_PASSES + pass) * RADIX_SIZE + d];
+      }
+      if (digit_total == count)
+      {
+        skip_pass[pass] = true;
+      }
+    }
+  }
+
+  std::vector<uint32_t> offsets(size_t(chunk_count) * RADIX_SIZE);
+  bool reordered = false;
+
+  for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+  {
+    if (skip_pass[pass])
+    {
+      continue;
+    }
+
+    if (reordered && chunk_count > 1)
+    {
+      forEachChunk([&](uint32_t chunk, size_t begin, size_t end)
+      {
+        std::fill_n(&histograms[(size_t(chunk) * RADIX_PASSES + pass) * RADIX_SIZE], RADIX_SIZE, 0);
+        histogramChunk(chunk, begin, end, pass, pass);
+      });
+    }
+
+    // Digit-major, chunk-minor prefix sum keeps the sort stable across chunks
+    uint32_t total = 0;
+    for (uint32_t d = 0; d < RADIX_SIZE; d++)
+    {
+      for (uint32_t chunk = 0; chunk < chunk_count; chunk++)
+      {
+        offsets[chunk * RADIX_SIZE + d] = total;
+        total += histograms[(size_t(chunk) * RADIX_PASSES + pass) * RADIX_SIZE + d];
+      }
+    }
+
+    forEachChunk([&](uint32_t chunk, size_t begin, size_t end)
+    {
+      uint32_t *offset = &offsets[chunk * RADIX_SIZE];
+      for (size_t i = begin; i < end; i++)
+      {
+        scratch[offset[digit(items[i].key, pass)]++] = items[i];
+      }
+    });
+
+    items.swap(scratch);
+    reordered = true;
+  }
+}
+
+void DrawList::clear()
+{
+  packets.clear();
+  payloads.clear();
+  constants.clear();
+  writes.clear();
+  items.clear();
+}
+
+void DrawList::add(uint64_t key, const DrawPacket &packet)
+{
+  items.push_back({key, static_cast<uint32_t>(packets.size())});
+  packets.push_back(packet);
+  payloads.push_back(DrawPayload{});
+}
+
+void DrawList::add(uint64_t key, const DrawPacket &packet, const DrawData &data)
+{
+  DrawPayload payload;
+  payload.first_constant = static_cast<uint32_t>(constants.size());
+  payload.constant_size = data.constant_size;
+  payload.constant_stages = data.constant_stages;
+  payload.first_write = static_cast<uint32_t>(writes.size());
+  payload.write_count = data.write_count;
+  payload.push_set = data.push_set;
+
+  const uint8_t *bytes = static_cast<const uint8_t*>(data.constants);
+  constants.insert(constants.end(), bytes, bytes + data.constant_size);
+  writes.insert(writes.end(), data.writes, data.writes + data.write_count);
+
+  items.push_back({key, static_cast<uint32_t>(packets.size())});
+  packets.push_back(packet);
+  payloads.push_back(payload);
+}
+
+DrawData DrawList::data(size_t i) const
+{
+  const DrawPayload &payload = payloads[items[i].packet];
+
+  DrawData data;
+  data.constants = constants.data() + payload.first_constant;
+  data.constant_size = payload.constant_size;
+  data.constant_stages = payload.constant_stages;
+  data.writes = writes.data() + payload.first_write;
+  data.write_count = payload.write_count;
+  data.push_set = payload.push_set;
+  return data;
+}
+
+void DrawList::sort(JobSystem *jobs)
+{
+  radixSortDraws(items, scratch, jobs);
+}
+
+DrawStats recordDrawList(VkCommandBuffer command_buffer, const DrawList &list, PFN_vkCmdPushDescriptorSetKHR push_descriptor_set)
+{
+  DrawStats stats;
+
+  VkPipeline bound_pipeline = VK_NULL_HANDLE;
+  VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+  VkDescriptorSet bound_descriptor_set = VK_NULL_HANDLE;
+  VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+  VkDeviceSize bound_vertex_offset = 0;
+  VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+  VkIndexType bound_index_type = VK_INDEX_TYPE_UINT32;
+
+  // Last per-draw data, compared by value so runs of equal data push once
+  VkPipelineLayout pushed_constant_layout = VK_NULL_HANDLE;
+  DrawData pushed_constants;
+  VkPipelineLayout pushed_descriptor_layout = VK_NULL_HANDLE;
+  DrawData pushed_descriptors;
+
+  for (size_t i = 0; i < list.size(); i++)
+  {
+    const DrawPacket &packet = list.packet(i);
+    DrawData data = list.data(i);
+
+    if (packet.pipeline != bound_pipeline)
+    {
+      vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+      bound_pipeline = packet.pipeline;
+      stats.pipeline_binds++;
+    }
+
+    // A different layout may disturb set 0, so the set is rebound with it
+    if (packet.descriptor_set != VK_NULL_HANDLE && (packet.descriptor_set != bound_descriptor_set || packet.pipeline_layout != bound_layout))
+    {
+      vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline_layout, 0, 1, &packet.descriptor_set, 0, nullptr);
+      bound_descriptor_set = packet.descriptor_set;
+      bound_layout = packet.pipeline_layout;
+      stats.descriptor_binds++;
+
+      // The bind may have replaced the pushed set, the next push must not be skipped
+      pushed_descriptor_layout = VK_NULL_HANDLE;
+    }
+
+    if (data.constant_size > 0 && (packet.pipeline_layout != pushed_constant_layout || data.constant_stages != pushed_constants.constant_stages ||
+      data.constant_size != pushed_constants.constant_size || std::memcmp(data.constants, pushed_constants.constants, data.constant_size) != 0))
+    {
+      vkCmdPushConstants(command_buffer, packet.pipeline_layout, data.constant_stages, 0, data.constant_size, data.constants);
+      pushed_constant_layout = packet.pipeline_layout;
+      pushed_constants = data;
+      stats.constant_pushes++;
+    }
+
+    if (data.write_count > 0 && (packet.pipeline_layout != pushed_descriptor_layout || data.push_set != pushed_descriptors.push_set ||
+      !std::equal(data.writes, data.writes + data.write_count, pushed_descriptors.writes, pushed_descriptors.writes + pushed_descriptors.write_count)))
+    {
+      if (push_descriptor_set == nullptr)
+      {
+        throw std::runtime_error("Draw has push descriptors but vkCmdPushDescriptorSetKHR is not loaded!");
+      }
+
+      pushDescriptors(command_buffer, push_descriptor_set, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline_layout, data.push_set, data.writes, data.write_count);
+      pushed_descriptor_layout = packet.pipeline_layout;
+      pushed_descriptors = data;
+      stats.descriptor_pushes++;
+
+      // A push to set 0 replaced the bound set, the next bind must not be skipped
+      if (data.push_set == 0)
+      {
+        bound_descriptor_set = VK_NULL_HANDLE;
+      }
+    }
+
+    if (packet.vertex_buffer != VK_NULL_HANDLE && (packet.vertex_buffer != bound_vertex_buffer || packet.vertex_buffer_offset != bound_vertex_offset))
+    {
+      vkCmdBindVertexBuffers(command_buffer, 0, 1, &packet.vertex_buffer, &packet.vertex_buffer_offset);
+      bound_vertex_buffer = packet.vertex_buffer;
+      bound_vertex_offset = packet.vertex_buffer_offset;
+      stats.vertex_buffer_binds++;
+    }
+
+    if (packet.index_buffer != VK_NULL_HANDLE)
+    {
+      if (packet.index_buffer != bound_index_buffer || packet.index_type != bound_index_type)
+      {
+        vkCmdBindIndexBuffer(command_buffer, packet.index_buffer, 0, packet.index_type);
+        bound_index_buffer = packet.index_buffer;
+        bound_index_type = packet.index_type;
+        stats.index_buffer_binds++;
+      }
+
+      if (packet.indirect_buffer != VK_NULL_HANDLE)
+      {
+        vkCmdDrawIndexedIndirect(command_buffer, packet.indirect_buffer, packet.indirect_offset, packet.draw_count, sizeof(VkDrawIndexedIndirectCommand));
+      }
+      else
+      {
+        vkCmdDrawIndexed(command_buffer, packet.element_count, packet.instance_count, packet.first_element, packet.base_vertex, packet.first_instance);
+      }
+    }
+    else if (packet.indirect_buffer != VK_NULL_HANDLE)
+    {
+      vkCmdDrawIndirect(command_buffer, packet.indirect_buffer, packet.indirect_offset, packet.draw_count, sizeof(VkDrawIndirectCommand));
+    }
+    else
+    {
+      vkCmdDraw(command_buffer, packet.element_count, packet.instance_count, packet.first_element, packet.first_instance);
+    }
+
+    stats.draws++;
+  }
+
+  return stats;
+}
@@ -0,0 +1,214 @@
+#include "FrustumCulling.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/simd/platform.h>
+
+#include <limits>
+
+namespace
+{
+  // Padding spheres fail every plane test
+  const float PADDING_RADIUS = -std::numeric_limits<float>::infinity();
+
+  glm::vec4 normalizePlane(const glm::vec4 &plane)
+  {
+    return plane / glm::length(glm::vec3(plane));
+  }
+
+  /*
+  * Writes base + lane for every set bit of mask without branching.
+  * `out` must have room for `lanes` more entries past `count`.
+  */
+  inline size_t compactLanes(uint32_t *out, size_t count, uint32_t base, int mask, int lanes)
+  {
+    for (int lane = 0; lane < lanes; lane++)
+    {
+      out[count] = base + lane;
+      count += (mask >> lane) & 1;
+    }
+    return count;
+  }
+}
+
+Frustum extractFrustum(const glm::mat4 &view_proj)
+{
+  // glm is column-major, view_proj[c][r]
+  glm::vec4 row0(view_proj[0][0], view_proj[1][0], view_proj[2][0], view_proj[3][0]);
+  glm::vec4 row1(view_proj[0][1], view_proj[1][1], view_proj[2][1], view_proj[3][1]);
+  glm::vec4 row2(view_proj[0][2], view_proj[1][2], view_proj[2][2], view_proj[3][2]);
+  glm::vec4 row3(view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]);
+
+  Frustum frustum;
+  frustum.planes[0] = normalizePlane(row3 + row0);
+  frustum.planes[1] = normalizePlane(row3 - row0);
+  frustum.planes[2] = normalizePlane(row3 + row1);
+  frustum.planes[3] = normalizePlane(row3 - row1);
+  frustum.planes[4] = normalizePlane(row2);
+  frustum.planes[5] = normalizePlane(row3 - row2);
+
+  return frustum;
+}
+
+uint32_t CullingBounds::add(const glm::vec3 &center, float sphere_radius)
+{
+  uint32_t index = static_cast<uint32_t>(count);
+
+  if (count == center_x.size())
+  {
+    size_t padded_size = center_x.size() + CULL_BATCH_SIZE;
+    center_x.resize(padded_size, 0.0f);
+    center_y.resize(padded_size, 0.0f);
+    center_z.resize(padded_size, 0.0f);
+    radius.resize(padded_size, PADDING_RADIUS);
+  }
+
+  count++;
+  set(index, center, sphere_radius);
+
+  return index;
+}
+
+void CullingBounds::set(uint32_t index, const glm::vec3 &center, float sphere_radius)
+{
+  center_x[index] = center.x;
+  center_y[index] = center.y;
+  center_z[index] = center.z;
+  radius[index] = sphere_radius;
+}
+
+void CullingBounds::clear()
+{
+  center_x.clear();
+  center_y.clear();
+  center_z.clear();
+  radius.clear();
+  count = 0;
+}
+
+void cullSpheresScalar(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible)
+{
+  visible.resize(bounds.size());
+  size_t visible_count = 0;
+
+  for (size_t i = 0; i < bounds.size(); i++)
+  {
+    bool inside = true;
+
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+      float distance = plane.x * bounds.center_x[i] + plane.y * bounds.center_y[i] + plane.z * bounds.center_z[i] + plane.w;
+
+      if (distance + bounds.radius[i] < 0.0f)
+      {
+        inside = false;
+        break;
+      }
+    }
+
+    if (inside)
+    {
+      visible[visible_count++] = static_cast<uint32_t>(i);
+    }
+  }
+
+  visible.resize(visible_count);
+}
+
+void cullSpheresSSE(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+  visible.resize(bounds.paddedSize());
+  size_t visible_count = 0;
+
+  const __m128 zero = _mm_setzero_ps();
+
+  for (size_t i = 0; i < bounds.paddedSize(); i += 4)
+  {
+    __m128 x = _mm_loadu_ps(&bounds.center_x[i]);
+    __m128 y = _mm_loadu_ps(&bounds.center_y[i]);
+    __m128 z = _mm_loadu_ps(&bounds.center_z[i]);
+    __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+      __m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+      distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+      distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+    }
+
+    visible_count = compactLanes(visible.data(), visible_count, static_cast<uint32_t>(i), _mm_movemask_ps(inside), 4);
+  }
+
+  visible.resize(visible_count);
+#else
+  cullSpheresScalar(frustum, bounds, visible);
+#endif
+}
+
+void cullSpheresAVX(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible)
+{
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+  visible.resize(bounds.paddedSize());
+  size_t visible_count = 0;
+
+  const __m256 zero = _mm256_setzero_ps();
+
+  __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (int p = 0; p < 6; p++)
+  {
+    plane_x[p] = _mm256_set1_ps(frustum.planes[p].x);
+    plane_y[p] = _mm256_set1_ps(frustum.planes[p].y);
+    plane_z[p] = _mm256_set1_ps(frustum.planes[p].z);
+    plane_w[p] = _mm256_set1_ps(frustum.planes[p].w);
+  }
+
+  for (size_t i = 0; i < bounds.paddedSize(); i += 8)
+  {
+    __m256 x = _mm256_loadu_ps(&bounds.center_x[i]);
+    __m256 y = _mm256_loadu_ps(&bounds.center_y[i]);
+    __m256 z = _mm256_loadu_ps(&bounds.center_z[i]);
+    __m256 r = _mm256_loadu_ps(&bounds.radius[i]);
+
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+    for (int p = 0; p < 6; p++)
+    {
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+      __m256 distance = _mm256_fmadd_ps(x, plane_x[p], plane_w[p]);
+      distance = _mm256_fmadd_ps(y, plane_y[p], distance);
+      distance = _mm256_fmadd_ps(z, plane_z[p], distance);
+#else
+      __m256 distance = _mm256_add_ps(_mm256_mul_ps(x, plane_x[p]), plane_w[p]);
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(y, plane_y[p]));
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(z, plane_z[p]));
+#endif
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+    }
+
+    visible_count = compactLanes(visible.data(), visible_count, static_cast<uint32_t>(i), _mm256_movemask_ps(inside), 8);
+  }
+
+  visible.resize(visible_count);
+#else
+  cullSpheresSSE(frustum, bounds, visible);
+#endif
+}
+
+void cullSpheres(const Frustum &frustum, const CullingBounds &bounds, std::vector<uint32_t> &visible)
+{
+  cullSpheresAVX(frustum, bounds, visible);
+}
+
+const char *cullSpheresPath()
+{
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+  return "AVX";
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+  return "SSE";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,105 @@
+#include "GpuMesh.hpp"
+
+#include <algorithm>
+
+VertexInputLayout vertexInputLayout(VertexEncoding encoding)
+{
+  if (encoding == VERTEX_ENCODING_QUANTIZED)
+  {
+    using Input = VertexInput<QuantizedVertex>;
+    return {Input::binding_description, Input::attribute_descriptions.data(), Input::attribute_count};
+  }
+
+  using Input = VertexInput<Vertex>;
+  return {Input::binding_description, Input::attribute_descriptions.data(), Input::attribute_count};
+}
+
+bool isVertexEncodingSupported(VkPhysicalDevice physical_device, VertexEncoding encoding)
+{
+  VertexInputLayout layout = vertexInputLayout(encoding);
+
+  for (uint32_t i = 0; i < layout.attribute_count; i++)
+  {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physical_device, layout.attributes[i].format, &properties);
+
+    if (!(properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+GpuMesh uploadMesh(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const MeshCache &cache)
+{
+  const MeshCacheSection &vertices = cache.vertexSection();
+  const MeshCacheSection &indices = *cache.findSection(MESH_SECTION_INDICES);
+
+  GpuMesh mesh;
+  mesh.vertex_count = cache.vertexCount();
+  mesh.index_count = cache.indexCount();
+  mesh.index_type = cache.indexSize() == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  mesh.encoding = cache.vertexEncoding();
+  mesh.quantization = cache.quantizationParams();
+  mesh.submeshes.assign(cache.submeshes(), cache.submeshes() + cache.submeshCount());
+  mesh.lod_count = cache.lodCount();
+
+  if (cache.lods() != nullptr)
+  {
+    mesh.lods.assign(cache.lods(), cache.lods() + mesh.submeshes.size() * mesh.lod_count);
+  }
+  else
+  {
+    for (const Submesh &submesh : mesh.submeshes)
+    {
+      mesh.lods.push_back({submesh.index_offset, submesh.index_count, 0.0f});
+    }
+  }
+  mesh.bounds_min = glm::vec3(cache.header().bounds_min[0], cache.header().bounds_min[1], cache.header().bounds_min[2]);
+  mesh.bounds_max = glm::vec3(cache.header().bounds_max[0], cache.header().bounds_max[1], cache.header().bounds_max[2]);
+
+  bool expand_vertices = mesh.encoding == VERTEX_ENCODING_QUANTIZED && !isVertexEncodingSupported(physical_device, mesh.encoding);
+  VkDeviceSize vertex_buffer_size = expand_vertices ? mesh.vertex_count * sizeof(Vertex) : vertices.size;
+
+  mesh.vertex_buffer = createBuffer(device, physical_device, vertex_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  mesh.index_buffer = createBuffer(device, physical_device, indices.size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if (expand_vertices)
+  {
+    // Slow path: the device lacks a 16-bit vertex format, decode into staging memory
+    const QuantizedVertex *quantized = reinterpret_cast<const QuantizedVertex*>(cache.sectionData(vertices));
+    uint32_t chunk_vertices = static_cast<uint32_t>(uploader.capacity() / sizeof(Vertex));
+
+    for (uint32_t first = 0; first < mesh.vertex_count; first += chunk_vertices)
+    {
+      uint32_t count = std::min(chunk_vertices, mesh.vertex_count - first);
+      Vertex *expanded = static_cast<Vertex*>(uploader.stageBuffer(mesh.vertex_buffer.buffer, first * sizeof(Vertex), count * sizeof(Vertex)));
+
+      for (uint32_t i = 0; i < count; i++)
+      {
+        expanded[i] = dequantizeVertex(quantized[first + i], mesh.quantization);
+      }
+    }
+
+    mesh.encoding = VERTEX_ENCODING_FLOAT;
+  }
+  else
+  {
+    // The mapping is the only CPU copy; it goes directly into staging memory
+    uploader.uploadBuffer(mesh.vertex_buffer.buffer, 0, cache.sectionData(vertices), vertices.size);
+  }
+
+  uploader.uploadBuffer(mesh.index_buffer.buffer, 0, cache.sectionData(indices), indices.size);
+
+  return mesh;
+}
+
+void destroyGpuMesh(VkDevice device, GpuMesh &mesh)
+{
+  destroyBuffer(device, mesh.vertex_buffer);
+  destroyBuffer(device, mesh.index_buffer);
+  mesh.submeshes.clear();
+  mesh.lods.clear();
+}
@@ -4,8 +4,21 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <glfw3native.h>
 
+#include "DescriptorAllocator.hpp"
+#include "DrawList.hpp"
+#include "HiZPyramid.hpp"
+#include "MipGenerator.hpp"
+#include "OcclusionCuller.hpp"
+#include "PipelineLayoutBuilder.hpp"
+#include "SpirvReflection.hpp"
+#include "StagingUploader.hpp"
+#include "VkHelpers.hpp"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/trigonometric.hpp>
+
 #include <iostream>
-#include <fstream>
 #include <optional>
 #include <limits>
 #include <vector>
@@ -13,6 +26,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <cstdlib>
+#include <cmath>
 
 struct VkContext
 {
@@ -27,7 +41,10 @@ struct VkContext
   VkFormat swap_chain_image_format;
   VkExtent2D swap_chain_extent;
   std::vector<VkImageView> swap_chain_image_views;
-  VkRenderPass render_pass;
+  Image depth_image;
+  VkFormat depth_format;
+  VkRenderPass render_pass;      // clears color and depth
+  VkRenderPass render_pass_load; // continues the frame after the Hi-Z build
   VkPipelineLayout pipeline_layout;
   VkPipeline graphics_pipeline;
   std::vector<VkFramebuffer> swap_chain_framebuffers;
@@ -81,6 +98,27 @@ private:
 
   GLFWwindow *window;
   VkContext context;
+  DrawList draw_list;
+  DrawStats draw_stats;
+  DescriptorAllocator descriptors;
+  DescriptorStats descriptor_stats;
+  bool push_descriptors_enabled = false;
+
+  // Grid of cubes behind a few large ones, drawn with two-phase occlusion culling
+  MipGenerator mips;
+  HiZPyramid hiz;
+  OcclusionCuller occlusion_culler;
+  OcclusionStats occlusion_stats;
+  Buffer cube_index_buffer;
+  PipelineLayout scene_layout; // the object buffer is per-draw, pushed where supported
+  VkPipeline scene_pipeline;
+
+  const uint32_t SCENE_GRID_SIZE = 32;
+  const float SCENE_GRID_SPACING = 3.0f;
+
+  // Pipeline field of the sort keys, the scene goes first
+  const uint32_t SCENE_PIPELINE_KEY = 0;
+  const uint32_t TRIANGLE_PIPELINE_KEY = 1;
 
   const uint32_t WIDTH = 800;
   const uint32_t HEIGHT = 600;
@@ -114,7 +152,8 @@ private:
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = "No Engine";
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 for subgroup operations in the mip downsampler
+    app_info.apiVersion = VK_API_VERSION_1_1;
 
     uint32_t glfw_extension_count = 0;
     const char **glfw_extensions;
@@ -311,15 +350,34 @@ private:
       queue_create_infos.push_back(queue_create_info);
     }
 
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(context.physical_device, &supported_features);
+
+    // Lets each occlusion culled phase go out in one indirect call
     VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+    // Occlusion culled draws find their object through gl_InstanceIndex
+    device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+    // The mip downsampler writes any storage format through one shader
+    device_features.shaderStorageImageWriteWithoutFormat = supported_features.shaderStorageImageWriteWithoutFormat;
+
+    std::vector<const char*> extensions = device_extensions;
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     create_info.pQueueCreateInfos = queue_create_infos.data();
     create_info.pEnabledFeatures = &device_features;
-    create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
-    create_info.ppEnabledExtensionNames = device_extensions.data();
+
+    // Per-draw bindings are recorded into the command buffer instead of allocated
+    push_descriptors_enabled = isPushDescriptorSupported(context.physical_device);
+    if (push_descriptors_enabled)
+    {
+      extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
     create_info.enabledLayerCount = 0;
 
     if (vkCreateDevice(context.physical_device, &create_info, nullptr, &context.device) != VK_SUCCESS)
@@ -472,94 +530,109 @@ private:
     }
   }
 
-  void createRenderPass()
+  void createDepthResources()
+  {
+    context.depth_image = createImage(context.device, context.physical_device, context.swap_chain_extent.width, context.swap_chain_extent.height, 1, context.depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    hiz.init(context.device, context.physical_device, context.depth_image.view, context.swap_chain_extent, mips);
+  }
+
+  /*
+  * The frame is split in two passes around the Hi-Z build.
+    - The first clears and leaves depth readable by compute shaders.
+    - The second loads both attachments and presents.
+    Load ops and layouts do not affect compatibility, so both share the framebuffers and pipelines.
+  */
+  VkRenderPass createRenderPass(bool clear)
   {
     VkAttachmentDescription color_attachment{};
     color_attachment.format = context.swap_chain_image_format;
     color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
     color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment.initialLayout = clear ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.finalLayout = clear ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkAttachmentDescription depth_attachment{};
+    depth_attachment.format = context.depth_format;
+    depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    depth_attachment.storeOp = clear ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.initialLayout = clear ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depth_attachment.finalLayout = clear ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
     color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 1;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
+    subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+    const VkPipelineStageFlags depth_stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    VkSubpassDependency dependencies[2]{};
+
+    // The previous frame's Hi-Z build and this frame's culling come before the attachments are written
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | depth_stages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | depth_stages;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    // Depth of the first pass feeds the Hi-Z build
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | depth_stages;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
 
     VkRenderPassCreateInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
+    render_pass_info.attachmentCount = 2;
+    render_pass_info.pAttachments = attachments;
     render_pass_info.subpassCount = 1;
     render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
+    render_pass_info.dependencyCount = 2;
+    render_pass_info.pDependencies = dependencies;
 
-    if (vkCreateRenderPass(context.device, &render_pass_info, nullptr, &context.render_pass) != VK_SUCCESS)
+    VkRenderPass render_pass;
+    if (vkCreateRenderPass(context.device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
     {
       throw std::runtime_error("Failed to create render pass!");
     }
 
+    return render_pass;
   }
 
-  static std::vector<char> readFile(const std::string &file_name)
+  void createRenderPasses()
   {
-    std::ifstream file(file_name, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-    {
-      throw std::runtime_error("failed to open file!");
-    }
-
-    size_t file_size = (size_t) file.tellg();
-    std::vector<char> buffer(file_size);
-
-    file.seekg(0);
-    file.read(buffer.data(), file_size);
-
-    file.close();
-
-    return buffer;
-  }
-
-  VkShaderModule createShaderModule(const std::vector<char> &code)
-  {
-    VkShaderModuleCreateInfo create_info{};
-    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    create_info.codeSize = code.size();
-    create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shader_module;
-    if (vkCreateShaderModule(context.device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
-    {
-      throw std::runtime_error("Failed to create shader module!");
-    }
-
-    return shader_module;
+    context.depth_format = findDepthFormat(context.physical_device);
+    context.render_pass = createRenderPass(true);
+    context.render_pass_load = createRenderPass(false);
   }
 
   void createGraphicsPipeline()
   {
-    std::vector<char> vert_shader_code = readFile("vert.spv");
-    std::vector<char> frag_shader_code = readFile("frag.spv");
+    std::vector<uint32_t> vert_shader_code = readSpirv("vert.spv");
+    verifyShaderBlock<DrawConstants>(reflectSpirv(vert_shader_code), SPIRV_BLOCK_PUSH_CONSTANT);
 
-    VkShaderModule vert_shader_module = createShaderModule(vert_shader_code);
-    VkShaderModule frag_shader_module = createShaderModule(frag_shader_code);
+    VkShaderModule vert_shader_module = loadShaderModule(context.device, vert_shader_code);
+    VkShaderModule frag_shader_module = loadShaderModule(context.device, "frag.spv");
 
     VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
     vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -634,6 +707,12 @@ private:
     color_blend_info.blendConstants[1] = 0.0f; // Optional
     color_blend_info.blendConstants[2] = 0.0f; // Optional
     color_blend_info.blendConstants[3] = 0.0f; // Optional
+
+    // The triangle is an overlay on top of the scene
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+    depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_info.depthTestEnable = VK_FALSE;
+    depth_stencil_info.depthWriteEnable = VK_FALSE;
     
     std::vector<VkDynamicState> dynamic_states = 
     {
@@ -646,17 +725,10 @@ private:
     dynamic_state.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
     dynamic_state.pDynamicStates = dynamic_states.data();
 
-    VkPipelineLayoutCreateInfo pipeline_layout_info{};
-    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_info.setLayoutCount = 0; // Optional
-    pipeline_layout_info.pSetLayouts = nullptr; // Optional
-    pipeline_layout_info.pushConstantRangeCount = 0; // Optional
-    pipeline_layout_info.pPushConstantRanges = nullptr; // Optional
-
-    if (vkCreatePipelineLayout(context.device, &pipeline_layout_info, nullptr, &context.pipeline_layout) != VK_SUCCESS)
-    {
-      throw std::runtime_error("Failed to create pipeline layout!");
-    }
+    // No sets, the triangle's transform comes with its draw
+    context.pipeline_layout = PipelineLayoutBuilder()
+      .pushConstants<DrawConstants>(VK_SHADER_STAGE_VERTEX_BIT)
+      .build(context.device, false).layout;
 
     VkGraphicsPipelineCreateInfo pipeline_info{};
     pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -667,7 +739,7 @@ private:
     pipeline_info.pViewportState = &viewport_state_info;
     pipeline_info.pRasterizationState = &rasterization_info;
     pipeline_info.pMultisampleState = &multisampling_info;
-    pipeline_info.pDepthStencilState = nullptr; // Optional
+    pipeline_info.pDepthStencilState = &depth_stencil_info;
     pipeline_info.pColorBlendState = &color_blend_info;
     pipeline_info.pDynamicState = &dynamic_state;
     pipeline_info.layout = context.pipeline_layout;
@@ -685,6 +757,146 @@ private:
     vkDestroyShaderModule(context.device, vert_shader_module, nullptr);
   }
 
+  void createScenePipeline()
+  {
+    scene_layout = PipelineLayoutBuilder()
+      .pushConstants<glm::mat4>(VK_SHADER_STAGE_VERTEX_BIT)
+      .pushDescriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+      .build(context.device, push_descriptors_enabled);
+
+    VkShaderModule vert_shader_module = loadShaderModule(context.device, "object_vert.spv");
+    VkShaderModule frag_shader_module = loadShaderModule(context.device, "frag.spv");
+
+    VkPipelineShaderStageCreateInfo shader_stages[2]{};
+    shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shader_stages[0].module = vert_shader_module;
+    shader_stages[0].pName = "main";
+    shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shader_stages[1].module = frag_shader_module;
+    shader_stages[1].pName = "main";
+
+    // Cube corners come from the index values, there are no vertex attributes
+    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewport_state_info{};
+    viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_info.viewportCount = 1;
+    viewport_state_info.scissorCount = 1;
+
+    // The projection flips Y, so counter-clockwise faces stay counter-clockwise on screen
+    VkPipelineRasterizationStateCreateInfo rasterization_info{};
+    rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_info.lineWidth = 1.0f;
+    rasterization_info.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterization_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling_info{};
+    multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling_info.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+    depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_info.depthTestEnable = VK_TRUE;
+    depth_stencil_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment{};
+    color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_info{};
+    color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_info.attachmentCount = 1;
+    color_blend_info.pAttachments = &color_blend_attachment;
+
+    VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state{};
+    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state.dynamicStateCount = 2;
+    dynamic_state.pDynamicStates = dynamic_states;
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = shader_stages;
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state_info;
+    pipeline_info.pRasterizationState = &rasterization_info;
+    pipeline_info.pMultisampleState = &multisampling_info;
+    pipeline_info.pDepthStencilState = &depth_stencil_info;
+    pipeline_info.pColorBlendState = &color_blend_info;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = scene_layout.layout;
+    pipeline_info.renderPass = context.render_pass;
+    pipeline_info.subpass = 0;
+
+    if (vkCreateGraphicsPipelines(context.device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &scene_pipeline) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create scene pipeline!");
+    }
+
+    vkDestroyShaderModule(context.device, frag_shader_module, nullptr);
+    vkDestroyShaderModule(context.device, vert_shader_module, nullptr);
+  }
+
+  void createScene()
+  {
+    std::vector<CullObject> objects;
+
+    // The index values double as cube corners, see Object.vert
+    const uint32_t cube_indices[] =
+    {
+      4, 6, 2, 4, 2, 0,  1, 3, 7, 1, 7, 5,
+      0, 1, 5, 0, 5, 4,  6, 7, 3, 6, 3, 2,
+      2, 3, 1, 2, 1, 0,  4, 5, 7, 4, 7, 6
+    };
+
+    auto addCube = [&](const glm::vec3 &center, float half_extent)
+    {
+      // Radius of the sphere through the corners
+      objects.push_back({glm::vec4(center, half_extent * 1.7320508f), 36, 0, 0, 0});
+    };
+
+    float grid_offset = (SCENE_GRID_SIZE - 1) * SCENE_GRID_SPACING * 0.5f;
+    for (uint32_t z = 0; z < SCENE_GRID_SIZE; z++)
+    {
+      for (uint32_t x = 0; x < SCENE_GRID_SIZE; x++)
+      {
+        addCube(glm::vec3(x * SCENE_GRID_SPACING - grid_offset, 0.5f, z * SCENE_GRID_SPACING - grid_offset), 0.5f);
+      }
+    }
+
+    // Occluders
+    addCube(glm::vec3(-12.0f, 4.0f, 0.0f), 4.0f);
+    addCube(glm::vec3(12.0f, 4.0f, 0.0f), 4.0f);
+    addCube(glm::vec3(0.0f, 4.0f, -12.0f), 4.0f);
+    addCube(glm::vec3(0.0f, 4.0f, 12.0f), 4.0f);
+
+    QueueFamilyIndices indices = findQueueFamilies(context.physical_device);
+
+    StagingUploader uploader;
+    uploader.init(context.device, context.physical_device, context.graphics_queue, indices.graphics_family.value(), 1 << 20);
+
+    cube_index_buffer = createBuffer(context.device, context.physical_device, sizeof(cube_indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uploader.uploadBuffer(cube_index_buffer.buffer, 0, cube_indices, sizeof(cube_indices));
+
+    occlusion_culler.init(context.device, context.physical_device, uploader, objects, MAX_FRAMES_IN_FLIGHT);
+    occlusion_culler.setHiZ(hiz);
+
+    uploader.flush();
+    uploader.cleanup();
+  }
+
   void createFramebuffers()
   {
     context.swap_chain_framebuffers.resize(context.swap_chain_image_views.size());
@@ -693,13 +905,14 @@ private:
     {
       VkImageView attachments[] =
       {
-        context.swap_chain_image_views[i]
+        context.swap_chain_image_views[i],
+        context.depth_image.view
       };
 
       VkFramebufferCreateInfo framebuffer_info{};
       framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
       framebuffer_info.renderPass = context.render_pass;
-      framebuffer_info.attachmentCount = 1;
+      framebuffer_info.attachmentCount = 2;
       framebuffer_info.pAttachments = attachments;
       framebuffer_info.width = context.swap_chain_extent.width;
       framebuffer_info.height = context.swap_chain_extent.height;
@@ -728,6 +941,54 @@ private:
     }
   }
 
+  glm::mat4 cameraViewProj()
+  {
+    // Slow orbit at eye height, so cubes keep moving behind the occluders
+    float angle = static_cast<float>(glfwGetTime()) * 0.2f;
+    glm::vec3 eye(std::cos(angle) * 40.0f, 3.0f, std::sin(angle) * 40.0f);
+
+    glm::mat4 view = glm::lookAtRH(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), context.swap_chain_extent.width / static_cast<float>(context.swap_chain_extent.height), 0.1f, 200.0f);
+    proj[1][1] *= -1.0f;
+
+    return proj * view;
+  }
+
+  /**
+   * Adds the phase's indirect draws to draw_list, one packet per multi-draw call
+   */
+  void addScene(const glm::mat4 &view_proj, CullPhase phase)
+  {
+    DescriptorWrite objects = bufferDescriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, occlusion_culler.objectBuffer());
+
+    DrawPacket state;
+    state.pipeline = scene_pipeline;
+    state.pipeline_layout = scene_layout.layout;
+    state.index_buffer = cube_index_buffer.buffer;
+
+    DrawData data;
+    data.constants = &view_proj;
+    data.constant_size = sizeof(glm::mat4);
+    data.constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+
+    if (scene_layout.push_descriptors)
+    {
+      data.writes = &objects;
+      data.write_count = 1;
+      data.push_set = scene_layout.push_set;
+    }
+    else
+    {
+      // Both phases ask for the same set, the second one gets it from the cache
+      state.descriptor_set = descriptors.allocate(scene_layout.push_set_layout, &objects, 1);
+    }
+
+    for (uint32_t call = 0; call < occlusion_culler.drawPacketCount(); call++)
+    {
+      draw_list.add(makeSortKey(0, SCENE_PIPELINE_KEY, 0, 0), occlusion_culler.drawPacket(state, phase, call), data);
+    }
+  }
+
   void recordCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index)
   {
     VkCommandBufferBeginInfo buffer_begin_info{};
@@ -740,19 +1001,7 @@ private:
       throw std::runtime_error("Failed to begin recording command buffer!");
     }
 
-    VkRenderPassBeginInfo render_pass_info{};
-    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    render_pass_info.renderPass = context.render_pass;
-    render_pass_info.framebuffer = context.swap_chain_framebuffers[image_index];
-    render_pass_info.renderArea.offset = {0, 0};
-    render_pass_info.renderArea.extent = context.swap_chain_extent;
-
-    VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    render_pass_info.clearValueCount = 1;
-    render_pass_info.pClearValues = &clear_color;
-
-    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.graphics_pipeline);
+    // Viewport and scissor are dynamic in every pipeline, so they survive pipeline binds and both passes
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -768,7 +1017,59 @@ private:
     scissor.extent = context.swap_chain_extent;
     vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    glm::mat4 view_proj = cameraViewProj();
+
+    // First phase: what was visible last frame
+    occlusion_culler.cullFirstPhase(command_buffer, view_proj, context.current_frame);
+
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = context.render_pass;
+    render_pass_info.framebuffer = context.swap_chain_framebuffers[image_index];
+    render_pass_info.renderArea.offset = {0, 0};
+    render_pass_info.renderArea.extent = context.swap_chain_extent;
+
+    VkClearValue clear_values[2]{};
+    clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clear_values[1].depthStencil = {1.0f, 0};
+    render_pass_info.clearValueCount = 2;
+    render_pass_info.pClearValues = clear_values;
+
+    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    draw_list.clear();
+    addScene(view_proj, CULL_PHASE_FIRST);
+    draw_list.sort();
+    draw_stats = recordDrawList(command_buffer, draw_list, scene_layout.push_descriptor_set);
+    vkCmdEndRenderPass(command_buffer);
+
+    // Second phase: everything else against the depth drawn so far
+    hiz.build(command_buffer);
+    occlusion_culler.cullSecondPhase(command_buffer, context.current_frame);
+
+    render_pass_info.renderPass = context.render_pass_load;
+    render_pass_info.clearValueCount = 0;
+    render_pass_info.pClearValues = nullptr;
+
+    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    draw_list.clear();
+    addScene(view_proj, CULL_PHASE_SECOND);
+
+    DrawPacket triangle;
+    triangle.pipeline = context.graphics_pipeline;
+    triangle.pipeline_layout = context.pipeline_layout;
+    triangle.element_count = 3;
+
+    DrawConstants triangle_constants;
+    triangle_constants.transform = glm::rotate(glm::mat4(1.0f), static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    DrawData triangle_data;
+    triangle_data.constants = &triangle_constants;
+    triangle_data.constant_size = sizeof(DrawConstants);
+    triangle_data.constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+    draw_list.add(makeSortKey(0, TRIANGLE_PIPELINE_KEY, 0, 0), triangle, triangle_data);
+
+    draw_list.sort();
+    draw_stats += recordDrawList(command_buffer, draw_list, scene_layout.push_descriptor_set);
 
     vkCmdEndRenderPass(command_buffer);
 
@@ -821,6 +1122,11 @@ private:
   {
     vkWaitForFences(context.device, 1, &context.in_flight_fences[context.current_frame], VK_TRUE, UINT64_MAX);
 
+    // Counts of the last frame that used this slot
+    occlusion_stats = occlusion_culler.stats(context.current_frame);
+    descriptor_stats = descriptors.stats();
+    descriptors.beginFrame(context.current_frame);
+
     uint32_t image_index;
     VkResult result = vkAcquireNextImageKHR(context.device, context.swap_chain, UINT64_MAX, context.image_available_semaphores[context.current_frame], VK_NULL_HANDLE, &image_index);
 
@@ -899,6 +1205,9 @@ private:
       vkDestroyImageView(context.device, context.swap_chain_image_views[i], nullptr);
     }
 
+    hiz.cleanup();
+    destroyImage(context.device, context.depth_image);
+
     vkDestroySwapchainKHR(context.device, context.swap_chain, nullptr);
   }
 
@@ -918,6 +1227,8 @@ private:
 
     createSwapChain();
     createImageViews();
+    createDepthResources();
+    occlusion_culler.setHiZ(hiz);
     createFramebuffers();
   }
 
@@ -929,20 +1240,39 @@ private:
     createLogicalDevice();
     createSwapChain();
     createImageViews();
-    createRenderPass();
+    createRenderPasses();
     createGraphicsPipeline();
+    createScenePipeline();
+    mips.init(context.device, context.physical_device, isSubgroupQuadSupported(context.instance, context.physical_device));
+    createDepthResources();
     createFramebuffers();
     createCommandPool();
+    createScene();
+    descriptors.init(context.device, MAX_FRAMES_IN_FLIGHT);
     createCommandBuffers();
     createSyncObjects();
   }
 
   void mainLoop()
   {
+    double last_report = glfwGetTime();
+
     while (!glfwWindowShouldClose(window))
     {
       glfwPollEvents();
       drawFrame();
+
+      if (glfwGetTime() - last_report >= 1.0)
+      {
+        std::cout << "draws: " << draw_stats.draws << ", state changes: " << draw_stats.stateChanges() << std::endl;
+        std::cout << "objects: " << occlusion_culler.objectCount()
+          << ", frustum culled: " << occlusion_stats.frustum_culled
+          << ", occluded: " << occlusion_stats.occluded
+          << ", drawn: " << occlusion_stats.drawn_first_phase << " + " << occlusion_stats.drawn_second_phase << std::endl;
+        std::cout << "descriptor sets: " << descriptor_stats.allocated << " allocated, " << descriptor_stats.reused << " reused, "
+          << descriptor_stats.pools << " pools" << std::endl;
+        last_report = glfwGetTime();
+      }
     }
 
     vkDeviceWaitIdle(context.device);
@@ -951,10 +1281,19 @@ private:
   void cleanup()
   {
     cleanupSwapChain();
+    mips.cleanup();
+
+    occlusion_culler.cleanup();
+    destroyBuffer(context.device, cube_index_buffer);
+
+    vkDestroyPipeline(context.device, scene_pipeline, nullptr);
+    destroyPipelineLayout(context.device, scene_layout);
+    descriptors.cleanup();
 
     vkDestroyPipeline(context.device, context.graphics_pipeline, nullptr);
     vkDestroyPipelineLayout(context.device, context.pipeline_layout, nullptr);
     vkDestroyRenderPass(context.device, context.render_pass, nullptr);
+    vkDestroyRenderPass(context.device, context.render_pass_load, nullptr);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
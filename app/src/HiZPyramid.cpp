@@ -0,0 +1,270 @@
+#include "HiZPyramid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t GROUP_SIZE = 8;
+
+  struct HiZLevel
+  {
+    uint32_t source_size[2];
+    uint32_t destination_size[2];
+  };
+
+  uint32_t previousPowerOfTwo(uint32_t value)
+  {
+    uint32_t result = 1;
+    while (result * 2 <= value)
+    {
+      result *= 2;
+    }
+    return result;
+  }
+
+  uint32_t mipSize(uint32_t size, uint32_t level)
+  {
+    return std::max(size >> level, 1u);
+  }
+}
+
+void HiZPyramid::init(VkDevice device, VkPhysicalDevice physical_device, VkImageView depth_view, VkExtent2D depth_extent, MipGenerator &mips)
+{
+  this->device = device;
+  this->depth_extent = depth_extent;
+
+  uint32_t width = previousPowerOfTwo(depth_extent.width);
+  uint32_t height = previousPowerOfTwo(depth_extent.height);
+  uint32_t mip_levels = 1;
+  while ((std::max(width, height) >> mip_levels) > 0)
+  {
+    mip_levels++;
+  }
+
+  pyramid = createImage(device, physical_device, width, height, mip_levels, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+  for (uint32_t level = 0; level < mip_levels; level++)
+  {
+    mip_views.push_back(createImageView(device, pyramid.image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+  }
+
+  // Reads use texelFetch, filtering would blend depths
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_NEAREST;
+  sampler_info.minFilter = VK_FILTER_NEAREST;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.maxLod = static_cast<float>(mip_levels);
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &nearest_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create Hi-Z sampler!");
+  }
+
+  if (mips.supportsCompute(VK_FORMAT_R32_SFLOAT))
+  {
+    this->mips = &mips;
+    mip_chain = mips.addChain(pyramid.image, VK_FORMAT_R32_SFLOAT, {width, height}, mip_levels, MIP_REDUCTION_MAX);
+  }
+
+  createDescriptors(depth_view);
+  createPipeline();
+}
+
+void HiZPyramid::createDescriptors(VkImageView depth_view)
+{
+  VkDescriptorSetLayoutBinding bindings[2]{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = 2;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create Hi-Z descriptor set layout!");
+  }
+
+  uint32_t level_count = mips != nullptr ? 1 : pyramid.mip_levels;
+
+  VkDescriptorPoolSize pool_sizes[] =
+  {
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, level_count},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, level_count}
+  };
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = level_count;
+  pool_info.poolSizeCount = 2;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create Hi-Z descriptor pool!");
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(level_count, descriptor_set_layout);
+
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool;
+  alloc_info.descriptorSetCount = level_count;
+  alloc_info.pSetLayouts = layouts.data();
+
+  descriptor_sets.resize(level_count);
+  if (vkAllocateDescriptorSets(device, &alloc_info, descriptor_sets.data()) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate Hi-Z descriptor sets!");
+  }
+
+  for (uint32_t level = 0; level < level_count; level++)
+  {
+    VkDescriptorImageInfo source_info{};
+    source_info.sampler = nearest_sampler;
+    source_info.imageView = level == 0 ? depth_view : mip_views[level - 1];
+    source_info.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+    VkDescriptorImageInfo destination_info{};
+    destination_info.imageView = mip_views[level];
+    destination_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet writes[2]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = descriptor_sets[level];
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &source_info;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = descriptor_sets[level];
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = &destination_info;
+
+    vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+  }
+}
+
+void HiZPyramid::createPipeline()
+{
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push_constant_range.size = sizeof(HiZLevel);
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create Hi-Z pipeline layout!");
+  }
+
+  VkShaderModule build_module = loadShaderModule(device, "hiz_build.spv");
+
+  VkComputePipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = build_module;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.layout = pipeline_layout;
+
+  VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+  vkDestroyShaderModule(device, build_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create Hi-Z pipeline!");
+  }
+}
+
+void HiZPyramid::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  if (mips != nullptr)
+  {
+    mips->removeChain(mip_chain);
+  }
+
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+  vkDestroySampler(device, nearest_sampler, nullptr);
+
+  for (VkImageView mip_view : mip_views)
+  {
+    vkDestroyImageView(device, mip_view, nullptr);
+  }
+
+  destroyImage(device, pyramid);
+
+  *this = HiZPyramid{};
+}
+
+void HiZPyramid::build(VkCommandBuffer command_buffer)
+{
+  // The previous frame's culling may still read the pyramid; its contents are not needed
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = pyramid.image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.mip_levels, 0, 1};
+
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+  for (uint32_t level = 0; level < descriptor_sets.size(); level++)
+  {
+    HiZLevel level_size{};
+    level_size.source_size[0] = level == 0 ? depth_extent.width : mipSize(pyramid.width, level - 1);
+    level_size.source_size[1] = level == 0 ? depth_extent.height : mipSize(pyramid.height, level - 1);
+    level_size.destination_size[0] = mipSize(pyramid.width, level);
+    level_size.destination_size[1] = mipSize(pyramid.height, level);
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_sets[level], 0, nullptr);
+    vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZLevel), &level_size);
+    vkCmdDispatch(command_buffer, (level_size.destination_size[0] + GROUP_SIZE - 1) / GROUP_SIZE, (level_size.destination_size[1] + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+    // The next level reads this one; after the last level this publishes the pyramid
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+
+  if (mips != nullptr)
+  {
+    mips->generate(command_buffer, mip_chain, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+  }
+}
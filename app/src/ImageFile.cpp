@@ -0,0 +1,311 @@
+#include "ImageFile.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+namespace
+{
+  // Largest side we accept, keeps width * height * 4 far from overflowing
+  const uint32_t MAX_IMAGE_SIZE = 16384;
+
+  ImageData allocateImage(uint32_t width, uint32_t height)
+  {
+    if (width == 0 || height == 0 || width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE)
+    {
+      throw std::runtime_error("image size is out of range!");
+    }
+
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    return image;
+  }
+
+  uint16_t readU16(const uint8_t *data)
+  {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+  }
+
+  // One source pixel to RGBA; TGA stores blue first
+  void writeTgaPixel(const uint8_t *src, uint32_t channels, uint8_t *dst)
+  {
+    if (channels == 1)
+    {
+      dst[0] = dst[1] = dst[2] = src[0];
+      dst[3] = 255;
+      return;
+    }
+
+    dst[0] = src[2];
+    dst[1] = src[1];
+    dst[2] = src[0];
+    dst[3] = channels == 4 ? src[3] : 255;
+  }
+
+  ImageData decodeTga(const uint8_t *data, size_t size)
+  {
+    const size_t HEADER_SIZE = 18;
+    if (size < HEADER_SIZE)
+    {
+      throw std::runtime_error("TGA file is truncated!");
+    }
+
+    uint8_t id_length = data[0];
+    uint8_t color_map_type = data[1];
+    uint8_t image_type = data[2];
+    uint16_t color_map_length = readU16(data + 5);
+    uint8_t color_map_entry_bits = data[7];
+    uint32_t width = readU16(data + 12);
+    uint32_t height = readU16(data + 14);
+    uint8_t bits_per_pixel = data[16];
+    uint8_t descriptor = data[17];
+
+    bool rle = image_type == 10 || image_type == 11;
+    bool gray = image_type == 3 || image_type == 11;
+
+    if (image_type != 2 && image_type != 3 && !rle)
+    {
+      throw std::runtime_error("unsupported TGA image type!");
+    }
+
+    uint32_t channels = bits_per_pixel / 8;
+    if (gray ? bits_per_pixel != 8 : (bits_per_pixel != 24 && bits_per_pixel != 32))
+    {
+      throw std::runtime_error("unsupported TGA pixel depth!");
+    }
+
+    // A color map on a true color image is unused, skip over it
+    size_t offset = HEADER_SIZE + id_length;
+    if (color_map_type != 0)
+    {
+      offset += size_t(color_map_length) * ((color_map_entry_bits + 7) / 8);
+    }
+
+    ImageData image = allocateImage(width, height);
+    size_t pixel_count = size_t(width) * height;
+    uint8_t *dst = image.pixels.data();
+
+    if (!rle)
+    {
+      if (offset + pixel_count * channels > size)
+      {
+        throw std::runtime_error("TGA file is truncated!");
+      }
+
+      for (size_t i = 0; i < pixel_count; i++)
+      {
+        writeTgaPixel(data + offset + i * channels, channels, dst + i * 4);
+      }
+    }
+    else
+    {
+      // Packets may cross scanlines, so decode into one run of pixels
+      size_t written = 0;
+      while (written < pixel_count)
+      {
+        if (offset >= size)
+        {
+          throw std::runtime_error("TGA file is truncated!");
+        }
+
+        uint8_t packet = data[offset++];
+        size_t count = std::min<size_t>((packet & 0x7F) + 1, pixel_count - written);
+
+        if (packet & 0x80)
+        {
+          if (offset + channels > size)
+          {
+            throw std::runtime_error("TGA file is truncated!");
+          }
+
+          for (size_t i = 0; i < count; i++)
+          {
+            writeTgaPixel(data + offset, channels, dst + (written + i) * 4);
+          }
+          offset += channels;
+        }
+        else
+        {
+          if (offset + count * channels > size)
+          {
+            throw std::runtime_error("TGA file is truncated!");
+          }
+
+          for (size_t i = 0; i < count; i++)
+          {
+            writeTgaPixel(data + offset + i * channels, channels, dst + (written + i) * 4);
+          }
+          offset += count * channels;
+        }
+
+        written += count;
+      }
+    }
+
+    // Bit 4 set: right to left, bit 5 clear: bottom row first
+    uint32_t row_bytes = width * 4;
+    if (descriptor & 0x10)
+    {
+      for (uint32_t y = 0; y < height; y++)
+      {
+        uint32_t *row = reinterpret_cast<uint32_t*>(dst + size_t(y) * row_bytes);
+        std::reverse(row, row + width);
+      }
+    }
+
+    if (!(descriptor & 0x20))
+    {
+      for (uint32_t y = 0; y < height / 2; y++)
+      {
+        std::swap_ranges(dst + size_t(y) * row_bytes, dst + size_t(y + 1) * row_bytes, dst + size_t(height - 1 - y) * row_bytes);
+      }
+    }
+
+    return image;
+  }
+
+  // Reads one whitespace separated PNM header number, skipping # comments
+  uint32_t readPnmValue(const uint8_t *data, size_t size, size_t &offset)
+  {
+    while (offset < size)
+    {
+      if (data[offset] == '#')
+      {
+        while (offset < size && data[offset] != '\n')
+        {
+          offset++;
+        }
+      }
+      else if (std::isspace(data[offset]))
+      {
+        offset++;
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    if (offset >= size || !std::isdigit(data[offset]))
+    {
+      throw std::runtime_error("malformed PNM header!");
+    }
+
+    uint32_t value = 0;
+    while (offset < size && std::isdigit(data[offset]))
+    {
+      value = value * 10 + (data[offset++] - '0');
+      if (value > MAX_IMAGE_SIZE)
+      {
+        throw std::runtime_error("PNM header value is out of range!");
+      }
+    }
+
+    return value;
+  }
+
+  ImageData decodePnm(const uint8_t *data, size_t size)
+  {
+    uint32_t channels = data[1] == '6' ? 3 : 1;
+
+    size_t offset = 2;
+    uint32_t width = readPnmValue(data, size, offset);
+    uint32_t height = readPnmValue(data, size, offset);
+    uint32_t max_value = readPnmValue(data, size, offset);
+
+    if (max_value == 0 || max_value > 255)
+    {
+      throw std::runtime_error("only 8-bit PNM images are supported!");
+    }
+
+    // Exactly one whitespace byte separates the header from the samples
+    offset++;
+
+    ImageData image = allocateImage(width, height);
+    size_t pixel_count = size_t(width) * height;
+
+    if (offset + pixel_count * channels > size)
+    {
+      throw std::runtime_error("PNM file is truncated!");
+    }
+
+    const uint8_t *src = data + offset;
+    uint8_t *dst = image.pixels.data();
+
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        uint32_t sample = src[i * channels + (channels == 3 ? c : 0)];
+        dst[i * 4 + c] = static_cast<uint8_t>(max_value == 255 ? sample : std::min(sample, max_value) * 255 / max_value);
+      }
+      dst[i * 4 + 3] = 255;
+    }
+
+    return image;
+  }
+}
+
+ImageData decodeImage(const uint8_t *data, size_t size)
+{
+  // PNM has a magic number, TGA does not
+  if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6'))
+  {
+    return decodePnm(data, size);
+  }
+
+  return decodeTga(data, size);
+}
+
+ImageData loadImage(const std::string &file_name)
+{
+  MappedFile file(file_name);
+  return decodeImage(file.data(), file.size());
+}
+
+ImageData downsampleImage(const ImageData &image)
+{
+  ImageData level;
+  level.width = std::max(image.width / 2, 1u);
+  level.height = std::max(image.height / 2, 1u);
+  level.pixels.resize(size_t(level.width) * level.height * 4);
+
+  // Clamped source coordinates cover the 1 pixel wide or high levels
+  for (uint32_t y = 0; y < level.height; y++)
+  {
+    uint32_t y0 = std::min(y * 2, image.height - 1);
+    uint32_t y1 = std::min(y * 2 + 1, image.height - 1);
+
+    for (uint32_t x = 0; x < level.width; x++)
+    {
+      uint32_t x0 = std::min(x * 2, image.width - 1);
+      uint32_t x1 = std::min(x * 2 + 1, image.width - 1);
+
+      const uint8_t *p00 = &image.pixels[(size_t(y0) * image.width + x0) * 4];
+      const uint8_t *p01 = &image.pixels[(size_t(y0) * image.width + x1) * 4];
+      const uint8_t *p10 = &image.pixels[(size_t(y1) * image.width + x0) * 4];
+      const uint8_t *p11 = &image.pixels[(size_t(y1) * image.width + x1) * 4];
+      uint8_t *dst = &level.pixels[(size_t(y) * level.width + x) * 4];
+
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        dst[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+      }
+    }
+  }
+
+  return level;
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+  {
+    levels++;
+  }
+  return levels;
+}
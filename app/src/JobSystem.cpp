@@ -0,0 +1,158 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+  /*
+  * Shared between the caller and the helper jobs of one parallelFor.
+    - Helpers can start after the caller returned, so it is reference counted.
+    - fn is only dereferenced after claiming a valid batch, and the caller
+      does not return before every valid batch completed.
+  */
+  struct ParallelForState
+  {
+    const std::function<void(uint32_t, uint32_t)> *fn;
+    uint32_t count;
+    uint32_t batch_size;
+    uint32_t batch_count;
+    std::atomic<uint32_t> next_batch{0};
+    std::atomic<uint32_t> completed_batches{0};
+
+    void run()
+    {
+      for (;;)
+      {
+        uint32_t batch = next_batch.fetch_add(1, std::memory_order_relaxed);
+        if (batch >= batch_count)
+        {
+          return;
+        }
+
+        uint32_t begin = batch * batch_size;
+        uint32_t end = std::min(begin + batch_size, count);
+        (*fn)(begin, end);
+
+        completed_batches.fetch_add(1, std::memory_order_release);
+      }
+    }
+  };
+}
+
+JobSystem::JobSystem(uint32_t worker_count)
+{
+  if (worker_count == 0)
+  {
+    uint32_t hardware_threads = std::thread::hardware_concurrency();
+    worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+  }
+
+  workers.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; i++)
+  {
+    workers.emplace_back(&JobSystem::workerLoop, this);
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  job_available.notify_all();
+
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+}
+
+void JobSystem::submit(std::function<void()> job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(std::move(job));
+  }
+  job_available.notify_one();
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t, uint32_t)> &fn)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  batch_size = std::max(batch_size, 1u);
+  uint32_t batch_count = (count + batch_size - 1) / batch_size;
+
+  if (batch_count == 1 || workers.empty())
+  {
+    fn(0, count);
+    return;
+  }
+
+  auto state = std::make_shared<ParallelForState>();
+  state->fn = &fn;
+  state->count = count;
+  state->batch_size = batch_size;
+  state->batch_count = batch_count;
+
+  uint32_t helpers = std::min(workerCount(), batch_count - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < helpers; i++)
+    {
+      jobs.push_back([state]() { state->run(); });
+    }
+  }
+  job_available.notify_all();
+
+  state->run();
+
+  while (state->completed_batches.load(std::memory_order_acquire) < batch_count)
+  {
+    std::this_thread::yield();
+  }
+}
+
+void JobSystem::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this]() { return jobs.empty() && running == 0; });
+}
+
+void JobSystem::workerLoop()
+{
+  for (;;)
+  {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+      if (stopping && jobs.empty())
+      {
+        return;
+      }
+
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      running++;
+    }
+
+    job();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      running--;
+      if (jobs.empty() && running == 0)
+      {
+        idle.notify_all();
+      }
+    }
+  }
+}
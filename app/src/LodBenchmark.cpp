@@ -0,0 +1,172 @@
+#include "LodSelector.hpp"
+#include "MeshCache.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+/**
+ * Per-frame LOD selection over a field of instances of one .vmesh built with
+ * levels (MeshConverter output), while the camera flies low across it. Prints
+ * printLodStats once a simulated second, then the triangles drawn against
+ * always drawing level 0, the selection cost and how often objects change
+ * level with and without hysteresis.
+ * Usage: LodBenchmark <mesh.vmesh> [instances]
+ */
+namespace
+{
+  const int FRAMES = 600;
+  const int FRAMES_PER_SECOND = 60;
+  const float VIEWPORT_HEIGHT = 1080.0f;
+
+  struct Instance
+  {
+    glm::vec3 center;
+    float radius;
+    float scale;
+  };
+
+  struct FlightResult
+  {
+    double select_ms = 0.0;
+    double triangles = 0.0;
+    double level_changes = 0.0;
+  };
+
+  /**
+   * Runs the whole flight once, returns per-frame averages
+   */
+  FlightResult fly(LodSelector &selector, const std::vector<Instance> &instances, const LodChain &chain, float field_size, float street_x, float eye_height, bool print)
+  {
+    FlightResult result;
+    std::vector<uint32_t> previous(instances.size(), 0);
+
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, field_size * 2.0f);
+    proj[1][1] *= -1.0f;
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+      // Down the street between two columns, from one edge of the field to the other
+      float t = float(frame) / (FRAMES - 1);
+      glm::vec3 eye(street_x, eye_height, (t - 0.5f) * field_size);
+      glm::mat4 view = glm::lookAtRH(eye, eye + glm::vec3(0.0f, -0.1f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+      auto start = std::chrono::high_resolution_clock::now();
+
+      selector.beginFrame(view, proj, VIEWPORT_HEIGHT);
+      uint32_t changes = 0;
+      for (uint32_t i = 0; i < instances.size(); i++)
+      {
+        const Instance &instance = instances[i];
+        uint32_t lod = selector.select(i, instance.center, instance.radius, instance.scale, chain);
+        changes += frame > 0 && lod != previous[i] ? 1 : 0;
+        previous[i] = lod;
+      }
+
+      auto end = std::chrono::high_resolution_clock::now();
+
+      result.select_ms += std::chrono::duration<double, std::milli>(end - start).count();
+      result.triangles += double(selector.stats().total_triangles);
+      result.level_changes += changes;
+
+      if (print && frame % FRAMES_PER_SECOND == 0)
+      {
+        printLodStats(selector.stats());
+      }
+    }
+
+    result.select_ms /= FRAMES;
+    result.triangles /= FRAMES;
+    result.level_changes /= FRAMES - 1;
+    return result;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: LodBenchmark <mesh.vmesh> [instances]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t instance_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+
+  try
+  {
+    MeshCache cache(argv[1]);
+
+    if (cache.lods() == nullptr || cache.lodCount() < 2)
+    {
+      std::cerr << "mesh cache has no levels of detail, re-run the mesh converter!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::vector<MeshLod> lods(cache.lods(), cache.lods() + size_t(cache.submeshCount()) * cache.lodCount());
+    LodChain chain = buildLodChain(lods, cache.lodCount());
+
+    const MeshCacheHeader &header = cache.header();
+    glm::vec3 bounds_min(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+    glm::vec3 bounds_max(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+    glm::vec3 mesh_center = (bounds_min + bounds_max) * 0.5f;
+    float mesh_radius = std::max(glm::length(bounds_max - bounds_min) * 0.5f, 1e-3f);
+
+    // Square field, a few radii between neighbours
+    size_t side = std::max<size_t>(1, size_t(std::ceil(std::sqrt(double(instance_count)))));
+    float spacing = mesh_radius * 6.0f;
+    float field_size = side * spacing;
+    float street_x = (side / 2) * spacing - field_size * 0.5f + spacing * 0.5f;
+    float eye_height = mesh_radius * 2.0f;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter(-mesh_radius, mesh_radius);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    std::vector<Instance> instances(instance_count);
+    for (size_t i = 0; i < instance_count; i++)
+    {
+      float scale = size(rng);
+      glm::vec3 position((i % side) * spacing - field_size * 0.5f + jitter(rng), 0.0f, (i / side) * spacing - field_size * 0.5f + jitter(rng));
+      instances[i] = {position + mesh_center * scale, mesh_radius * scale, scale};
+    }
+
+    std::cout << instance_count << " instances, " << cache.lodCount() << " levels, level triangles:";
+    for (size_t lod = 0; lod < chain.triangle_counts.size(); lod++)
+    {
+      std::cout << " " << chain.triangle_counts[lod] << " (error " << chain.errors[lod] << ")";
+    }
+    std::cout << std::endl;
+
+    LodSelector selector;
+    FlightResult with_hysteresis = fly(selector, instances, chain, field_size, street_x, eye_height, true);
+
+    LodSelector flat_selector;
+    flat_selector.hysteresis = 0.0f;
+    FlightResult without_hysteresis = fly(flat_selector, instances, chain, field_size, street_x, eye_height, false);
+
+    double full_triangles = double(chain.triangle_counts[0]) * instance_count;
+
+    std::cout << "average of " << FRAMES << " frames, max " << selector.max_pixel_error << " px error" << std::endl;
+    std::cout << "triangles:     " << with_hysteresis.triangles << " of " << full_triangles << " at level 0 ("
+      << 100.0 * (1.0 - with_hysteresis.triangles / full_triangles) << "% fewer)" << std::endl;
+    std::cout << "selection:     " << with_hysteresis.select_ms << " ms per frame" << std::endl;
+    std::cout << "level changes: " << with_hysteresis.level_changes << " per frame with hysteresis "
+      << selector.hysteresis << ", " << without_hysteresis.level_changes << " without" << std::endl;
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
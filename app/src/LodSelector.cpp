@@ -0,0 +1,95 @@
+#include "LodSelector.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const uint8_t NO_LOD = 0xFF;
+  // Keeps objects that surround the camera from dividing by zero
+  const float MIN_DISTANCE = 1e-3f;
+}
+
+LodChain buildLodChain(const std::vector<MeshLod> &lods, uint32_t lod_count)
+{
+  LodChain chain;
+  chain.errors.assign(lod_count, 0.0f);
+  chain.triangle_counts.assign(lod_count, 0);
+
+  for (size_t i = 0; i < lods.size(); i++)
+  {
+    uint32_t lod = static_cast<uint32_t>(i % lod_count);
+    chain.errors[lod] = std::max(chain.errors[lod], lods[i].error);
+    chain.triangle_counts[lod] += lods[i].index_count / 3;
+  }
+
+  return chain;
+}
+
+void LodSelector::beginFrame(const glm::mat4 &view, const glm::mat4 &proj, float viewport_height)
+{
+  camera_position = glm::vec3(glm::inverse(view)[3]);
+  // proj[1][1] = 1 / tan(fov_y / 2): one unit at distance one covers this many pixels
+  pixels_per_unit_at_one = std::abs(proj[1][1]) * viewport_height * 0.5f;
+
+  std::fill(frame_stats.objects.begin(), frame_stats.objects.end(), 0);
+  std::fill(frame_stats.triangles.begin(), frame_stats.triangles.end(), 0);
+  frame_stats.total_triangles = 0;
+}
+
+uint32_t LodSelector::select(uint32_t object, const glm::vec3 &center, float radius, float scale, const LodChain &chain)
+{
+  uint32_t lod_count = static_cast<uint32_t>(chain.errors.size());
+
+  if (object >= current_lods.size())
+  {
+    current_lods.resize(object + 1, NO_LOD);
+  }
+  if (frame_stats.objects.size() < lod_count)
+  {
+    frame_stats.objects.resize(lod_count, 0);
+    frame_stats.triangles.resize(lod_count, 0);
+  }
+
+  // Nearest point of the bounding sphere decides the projected size
+  float distance = std::max(glm::length(center - camera_position) - radius, MIN_DISTANCE);
+  float pixels_per_unit = pixels_per_unit_at_one * scale / distance;
+
+  auto pixelError = [&](uint32_t lod)
+  {
+    return chain.errors[lod] * pixels_per_unit;
+  };
+
+  uint32_t lod = current_lods[object] == NO_LOD ? 0 : std::min<uint32_t>(current_lods[object], lod_count - 1);
+
+  while (lod > 0 && pixelError(lod) > max_pixel_error * (1.0f + hysteresis))
+  {
+    lod--;
+  }
+  while (lod + 1 < lod_count && pixelError(lod + 1) <= max_pixel_error * (1.0f - hysteresis))
+  {
+    lod++;
+  }
+
+  current_lods[object] = static_cast<uint8_t>(lod);
+
+  frame_stats.objects[lod]++;
+  frame_stats.triangles[lod] += chain.triangle_counts[lod];
+  frame_stats.total_triangles += chain.triangle_counts[lod];
+
+  return lod;
+}
+
+void printLodStats(const LodStats &stats)
+{
+  std::cout << "lod triangles: " << stats.total_triangles;
+  for (size_t lod = 0; lod < stats.triangles.size(); lod++)
+  {
+    std::cout << " | " << lod << ": " << stats.triangles[lod] << " (" << stats.objects[lod] << " objects)";
+  }
+  std::cout << std::endl;
+}
@@ -0,0 +1,146 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &file_name)
+{
+  open(file_name);
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+  *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    std::swap(mapping, other.mapping);
+    std::swap(file_size, other.file_size);
+#ifdef _WIN32
+    std::swap(file_handle, other.file_handle);
+    std::swap(mapping_handle, other.mapping_handle);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string &file_name)
+{
+  close();
+
+  HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    throw std::runtime_error("failed to map empty file!");
+  }
+
+  HANDLE file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (file_mapping == nullptr)
+  {
+    CloseHandle(file);
+    throw std::runtime_error("failed to map file!");
+  }
+
+  void *view = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr)
+  {
+    CloseHandle(file_mapping);
+    CloseHandle(file);
+    throw std::runtime_error("failed to map file!");
+  }
+
+  file_handle = file;
+  mapping_handle = file_mapping;
+  mapping = view;
+  file_size = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::close()
+{
+  if (mapping != nullptr)
+  {
+    UnmapViewOfFile(mapping);
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+  }
+
+  mapping = nullptr;
+  mapping_handle = nullptr;
+  file_handle = nullptr;
+  file_size = 0;
+}
+
+#else
+
+void MappedFile::open(const std::string &file_name)
+{
+  close();
+
+  int file = ::open(file_name.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  struct stat file_stat;
+  if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    ::close(file);
+    throw std::runtime_error("failed to map empty file!");
+  }
+
+  void *view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+  // The mapping keeps its own reference to the file
+  ::close(file);
+
+  if (view == MAP_FAILED)
+  {
+    throw std::runtime_error("failed to map file!");
+  }
+
+  mapping = view;
+  file_size = static_cast<size_t>(file_stat.st_size);
+}
+
+void MappedFile::close()
+{
+  if (mapping != nullptr)
+  {
+    munmap(mapping, file_size);
+  }
+
+  mapping = nullptr;
+  file_size = 0;
+}
+
+#endif
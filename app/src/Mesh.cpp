@@ -0,0 +1,274 @@
+#include "Mesh.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <stdexcept>
+#include <cmath>
+
+namespace
+{
+  struct ObjIndex
+  {
+    int position = 0;
+    int uv = 0;
+    int normal = 0;
+
+    bool operator==(const ObjIndex &other) const
+    {
+      return position == other.position && uv == other.uv && normal == other.normal;
+    }
+  };
+
+  struct ObjIndexHash
+  {
+    size_t operator()(const ObjIndex &index) const
+    {
+      return (size_t(index.position) * 73856093u) ^ (size_t(index.uv) * 19349663u) ^ (size_t(index.normal) * 83492791u);
+    }
+  };
+
+  // OBJ indices are 1-based, negative values are relative to the end
+  int resolveIndex(int index, size_t count)
+  {
+    return index < 0 ? static_cast<int>(count) + index : index - 1;
+  }
+
+  ObjIndex parseFaceVertex(const std::string &token, size_t position_count, size_t uv_count, size_t normal_count)
+  {
+    ObjIndex index;
+    index.uv = -1;
+    index.normal = -1;
+
+    size_t first_slash = token.find('/');
+    index.position = resolveIndex(std::stoi(token.substr(0, first_slash)), position_count);
+
+    if (first_slash != std::string::npos)
+    {
+      size_t second_slash = token.find('/', first_slash + 1);
+      std::string uv = token.substr(first_slash + 1, second_slash - first_slash - 1);
+
+      if (!uv.empty())
+      {
+        index.uv = resolveIndex(std::stoi(uv), uv_count);
+      }
+      if (second_slash != std::string::npos)
+      {
+        index.normal = resolveIndex(std::stoi(token.substr(second_slash + 1)), normal_count);
+      }
+    }
+
+    return index;
+  }
+
+  void closeSubmesh(MeshData &mesh, uint32_t &submesh_start)
+  {
+    uint32_t index_count = static_cast<uint32_t>(mesh.indices.size());
+    if (index_count > submesh_start)
+    {
+      mesh.submeshes.push_back({submesh_start, index_count - submesh_start});
+    }
+    submesh_start = index_count;
+  }
+}
+
+MeshData loadObj(const std::string &file_name)
+{
+  std::ifstream file(file_name);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> unique_vertices;
+
+  MeshData mesh;
+  uint32_t submesh_start = 0;
+  bool has_normals = true;
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::istringstream stream(line);
+    std::string type;
+    stream >> type;
+
+    if (type == "v")
+    {
+      glm::vec3 position;
+      stream >> position.x >> position.y >> position.z;
+      positions.push_back(position);
+    }
+    else if (type == "vt")
+    {
+      glm::vec2 uv;
+      stream >> uv.x >> uv.y;
+      // OBJ has its origin bottom-left, Vulkan samples top-left
+      uvs.push_back(glm::vec2(uv.x, 1.0f - uv.y));
+    }
+    else if (type == "vn")
+    {
+      glm::vec3 normal;
+      stream >> normal.x >> normal.y >> normal.z;
+      normals.push_back(normal);
+    }
+    else if (type == "o" || type == "g" || type == "usemtl")
+    {
+      closeSubmesh(mesh, submesh_start);
+    }
+    else if (type == "f")
+    {
+      std::vector<uint32_t> face;
+      std::string token;
+
+      while (stream >> token)
+      {
+        ObjIndex index = parseFaceVertex(token, positions.size(), uvs.size(), normals.size());
+
+        if (index.position < 0 || index.position >= static_cast<int>(positions.size()))
+        {
+          throw std::runtime_error("OBJ face references a missing vertex!");
+        }
+
+        auto it = unique_vertices.find(index);
+        if (it == unique_vertices.end())
+        {
+          Vertex vertex{};
+          vertex.position = positions[index.position];
+          vertex.uv = index.uv >= 0 ? uvs[index.uv] : glm::vec2(0.0f);
+          vertex.normal = index.normal >= 0 ? normals[index.normal] : glm::vec3(0.0f);
+          has_normals = has_normals && index.normal >= 0;
+
+          it = unique_vertices.emplace(index, static_cast<uint32_t>(mesh.vertices.size())).first;
+          mesh.vertices.push_back(vertex);
+        }
+
+        face.push_back(it->second);
+      }
+
+      // Fan triangulation for quads and n-gons
+      for (size_t i = 2; i < face.size(); i++)
+      {
+        mesh.indices.push_back(face[0]);
+        mesh.indices.push_back(face[i - 1]);
+        mesh.indices.push_back(face[i]);
+      }
+    }
+  }
+
+  closeSubmesh(mesh, submesh_start);
+
+  if (!has_normals)
+  {
+    for (Vertex &vertex : mesh.vertices)
+    {
+      vertex.normal = glm::vec3(0.0f);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+      Vertex &v0 = mesh.vertices[mesh.indices[i]];
+      Vertex &v1 = mesh.vertices[mesh.indices[i + 1]];
+      Vertex &v2 = mesh.vertices[mesh.indices[i + 2]];
+
+      // Area weighted face normal
+      glm::vec3 face_normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+      v0.normal += face_normal;
+      v1.normal += face_normal;
+      v2.normal += face_normal;
+    }
+
+    for (Vertex &vertex : mesh.vertices)
+    {
+      float length = glm::length(vertex.normal);
+      vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+  }
+
+  computeTangents(mesh);
+  computeBounds(mesh);
+
+  return mesh;
+}
+
+void computeBounds(MeshData &mesh)
+{
+  if (mesh.vertices.empty())
+  {
+    mesh.bounds_min = mesh.bounds_max = glm::vec3(0.0f);
+    return;
+  }
+
+  mesh.bounds_min = mesh.bounds_max = mesh.vertices[0].position;
+
+  for (const Vertex &vertex : mesh.vertices)
+  {
+    mesh.bounds_min = glm::min(mesh.bounds_min, vertex.position);
+    mesh.bounds_max = glm::max(mesh.bounds_max, vertex.position);
+  }
+}
+
+void computeTangents(MeshData &mesh)
+{
+  std::vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3(0.0f));
+  std::vector<glm::vec3> bitangents(mesh.vertices.size(), glm::vec3(0.0f));
+
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    uint32_t i0 = mesh.indices[i], i1 = mesh.indices[i + 1], i2 = mesh.indices[i + 2];
+    const Vertex &v0 = mesh.vertices[i0];
+    const Vertex &v1 = mesh.vertices[i1];
+    const Vertex &v2 = mesh.vertices[i2];
+
+    glm::vec3 edge1 = v1.position - v0.position;
+    glm::vec3 edge2 = v2.position - v0.position;
+    glm::vec2 delta_uv1 = v1.uv - v0.uv;
+    glm::vec2 delta_uv2 = v2.uv - v0.uv;
+
+    float determinant = delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y;
+    if (std::fabs(determinant) < 1e-12f)
+    {
+      continue;
+    }
+
+    float r = 1.0f / determinant;
+    glm::vec3 tangent = (edge1 * delta_uv2.y - edge2 * delta_uv1.y) * r;
+    glm::vec3 bitangent = (edge2 * delta_uv1.x - edge1 * delta_uv2.x) * r;
+
+    for (uint32_t index : {i0, i1, i2})
+    {
+      tangents[index] += tangent;
+      bitangents[index] += bitangent;
+    }
+  }
+
+  for (size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    const glm::vec3 &normal = mesh.vertices[i].normal;
+
+    // Gram-Schmidt orthogonalize against the normal
+    glm::vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+    float length = glm::length(tangent);
+
+    if (length < 1e-6f)
+    {
+      // No usable UV gradient, pick any vector perpendicular to the normal
+      glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+      tangent = glm::normalize(glm::cross(axis, normal));
+    }
+    else
+    {
+      tangent /= length;
+    }
+
+    float handedness = glm::dot(glm::cross(normal, tangent), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+    mesh.vertices[i].tangent = glm::vec4(tangent, handedness);
+  }
+}
@@ -0,0 +1,276 @@
+#include "MeshCache.hpp"
+
+#include <fstream>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+
+static_assert(sizeof(Vertex) == 48, "Vertex must stay tightly packed for the mesh cache");
+static_assert(sizeof(MeshletBounds) == 48, "MeshletBounds must match the std430 layout of the culling shaders");
+
+namespace
+{
+  struct PendingSection
+  {
+    MeshCacheSectionType type;
+    uint32_t element_size;
+    const void *data;
+    uint64_t size;
+  };
+
+  uint64_t alignOffset(uint64_t offset)
+  {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+  }
+}
+
+void writeMeshCache(const std::string &file_name, const MeshData &mesh, const QuantizedMesh *quantized)
+{
+  std::vector<uint16_t> short_indices;
+  bool use_short_indices = mesh.vertices.size() <= std::numeric_limits<uint16_t>::max();
+
+  if (use_short_indices)
+  {
+    short_indices.assign(mesh.indices.begin(), mesh.indices.end());
+  }
+
+  std::vector<PendingSection> pending =
+  {
+    quantized != nullptr
+      ? PendingSection{MESH_SECTION_QUANTIZED_VERTICES, sizeof(QuantizedVertex), quantized->vertices.data(), quantized->vertices.size() * sizeof(QuantizedVertex)}
+      : PendingSection{MESH_SECTION_VERTICES, sizeof(Vertex), mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex)},
+    use_short_indices
+      ? PendingSection{MESH_SECTION_INDICES, sizeof(uint16_t), short_indices.data(), short_indices.size() * sizeof(uint16_t)}
+      : PendingSection{MESH_SECTION_INDICES, sizeof(uint32_t), mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)},
+    {MESH_SECTION_SUBMESHES, sizeof(Submesh), mesh.submeshes.data(), mesh.submeshes.size() * sizeof(Submesh)}
+  };
+
+  if (!mesh.lods.empty())
+  {
+    pending.push_back({MESH_SECTION_LODS, sizeof(MeshLod), mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod)});
+  }
+
+  if (!mesh.meshlets.empty())
+  {
+    pending.push_back({MESH_SECTION_MESHLETS, sizeof(Meshlet), mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet)});
+    pending.push_back({MESH_SECTION_MESHLET_BOUNDS, sizeof(MeshletBounds), mesh.meshlet_bounds.data(), mesh.meshlet_bounds.size() * sizeof(MeshletBounds)});
+    pending.push_back({MESH_SECTION_MESHLET_VERTICES, sizeof(uint32_t), mesh.meshlet_vertices.data(), mesh.meshlet_vertices.size() * sizeof(uint32_t)});
+    pending.push_back({MESH_SECTION_MESHLET_TRIANGLES, sizeof(uint32_t), mesh.meshlet_triangles.data(), mesh.meshlet_triangles.size() * sizeof(uint32_t)});
+  }
+
+  if (quantized != nullptr)
+  {
+    pending.push_back({MESH_SECTION_QUANTIZATION, sizeof(QuantizationParams), &quantized->params, sizeof(QuantizationParams)});
+  }
+
+  MeshCacheHeader header{};
+  header.magic = MESH_CACHE_MAGIC;
+  header.version = MESH_CACHE_VERSION;
+  header.section_count = static_cast<uint32_t>(pending.size());
+  header.lod_count = mesh.lods.empty() ? 1 : mesh.lod_count;
+  for (int i = 0; i < 3; i++)
+  {
+    header.bounds_min[i] = mesh.bounds_min[i];
+    header.bounds_max[i] = mesh.bounds_max[i];
+  }
+
+  std::vector<MeshCacheSection> sections(pending.size());
+  uint64_t offset = alignOffset(sizeof(MeshCacheHeader) + sections.size() * sizeof(MeshCacheSection));
+
+  for (size_t i = 0; i < pending.size(); i++)
+  {
+    sections[i].type = pending[i].type;
+    sections[i].element_size = pending[i].element_size;
+    sections[i].offset = offset;
+    sections[i].size = pending[i].size;
+    offset = alignOffset(offset + pending[i].size);
+  }
+
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(MeshCacheSection));
+
+  const char padding[MESH_CACHE_ALIGNMENT] = {};
+
+  for (size_t i = 0; i < pending.size(); i++)
+  {
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(padding, sections[i].offset - position);
+    file.write(static_cast<const char*>(pending[i].data), pending[i].size);
+  }
+
+  // Pad the tail so the last blob can be read in whole aligned chunks
+  uint64_t position = static_cast<uint64_t>(file.tellp());
+  file.write(padding, alignOffset(position) - position);
+
+  if (!file.good())
+  {
+    throw std::runtime_error("failed to write mesh cache!");
+  }
+}
+
+MeshCache::MeshCache(const std::string &file_name)
+  : file(file_name)
+{
+  if (file.size() < sizeof(MeshCacheHeader))
+  {
+    throw std::runtime_error("mesh cache is truncated!");
+  }
+
+  const MeshCacheHeader &cache_header = header();
+
+  if (cache_header.magic != MESH_CACHE_MAGIC)
+  {
+    throw std::runtime_error("file is not a mesh cache!");
+  }
+
+  if (cache_header.version != MESH_CACHE_VERSION)
+  {
+    throw std::runtime_error("mesh cache version mismatch, re-run the mesh converter!");
+  }
+
+  if (sizeof(MeshCacheHeader) + cache_header.section_count * sizeof(MeshCacheSection) > file.size())
+  {
+    throw std::runtime_error("mesh cache is truncated!");
+  }
+
+  sections = reinterpret_cast<const MeshCacheSection*>(file.data() + sizeof(MeshCacheHeader));
+
+  for (uint32_t i = 0; i < cache_header.section_count; i++)
+  {
+    if (sections[i].element_size == 0 || sections[i].offset % MESH_CACHE_ALIGNMENT != 0 || sections[i].offset + sections[i].size > file.size())
+    {
+      throw std::runtime_error("mesh cache section is out of bounds!");
+    }
+  }
+
+  bool has_vertices = findSection(MESH_SECTION_VERTICES) != nullptr ||
+    (findSection(MESH_SECTION_QUANTIZED_VERTICES) != nullptr && findSection(MESH_SECTION_QUANTIZATION) != nullptr);
+
+  if (!has_vertices || findSection(MESH_SECTION_INDICES) == nullptr)
+  {
+    throw std::runtime_error("mesh cache is missing geometry!");
+  }
+
+  const MeshCacheSection *lod_section = findSection(MESH_SECTION_LODS);
+  if (lod_section != nullptr && lod_section->size / sizeof(MeshLod) != size_t(submeshCount()) * cache_header.lod_count)
+  {
+    throw std::runtime_error("mesh cache LOD table does not match its submeshes!");
+  }
+
+  const MeshCacheSection *meshlet_section = findSection(MESH_SECTION_MESHLETS);
+  if (meshlet_section != nullptr)
+  {
+    const MeshCacheSection *bounds_section = findSection(MESH_SECTION_MESHLET_BOUNDS);
+
+    if (bounds_section == nullptr || findSection(MESH_SECTION_MESHLET_VERTICES) == nullptr || findSection(MESH_SECTION_MESHLET_TRIANGLES) == nullptr ||
+      bounds_section->size / sizeof(MeshletBounds) != meshlet_section->size / sizeof(Meshlet))
+    {
+      throw std::runtime_error("mesh cache meshlet sections are incomplete!");
+    }
+  }
+}
+
+const MeshCacheHeader &MeshCache::header() const
+{
+  return *reinterpret_cast<const MeshCacheHeader*>(file.data());
+}
+
+const MeshCacheSection *MeshCache::findSection(MeshCacheSectionType type) const
+{
+  for (uint32_t i = 0; i < header().section_count; i++)
+  {
+    if (sections[i].type == type)
+    {
+      return &sections[i];
+    }
+  }
+
+  return nullptr;
+}
+
+const uint8_t *MeshCache::sectionData(const MeshCacheSection &section) const
+{
+  return file.data() + section.offset;
+}
+
+VertexEncoding MeshCache::vertexEncoding() const
+{
+  return findSection(MESH_SECTION_VERTICES) != nullptr ? VERTEX_ENCODING_FLOAT : VERTEX_ENCODING_QUANTIZED;
+}
+
+const MeshCacheSection &MeshCache::vertexSection() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_VERTICES);
+  return section != nullptr ? *section : *findSection(MESH_SECTION_QUANTIZED_VERTICES);
+}
+
+QuantizationParams MeshCache::quantizationParams() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_QUANTIZATION);
+  return section != nullptr ? *reinterpret_cast<const QuantizationParams*>(sectionData(*section)) : QuantizationParams{};
+}
+
+uint32_t MeshCache::vertexCount() const
+{
+  const MeshCacheSection &section = vertexSection();
+  return static_cast<uint32_t>(section.size / section.element_size);
+}
+
+uint32_t MeshCache::indexCount() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_INDICES);
+  return static_cast<uint32_t>(section->size / section->element_size);
+}
+
+uint32_t MeshCache::indexSize() const
+{
+  return findSection(MESH_SECTION_INDICES)->element_size;
+}
+
+uint32_t MeshCache::submeshCount() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_SUBMESHES);
+  return section != nullptr ? static_cast<uint32_t>(section->size / sizeof(Submesh)) : 0;
+}
+
+const Submesh *MeshCache::submeshes() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_SUBMESHES);
+  return section != nullptr ? reinterpret_cast<const Submesh*>(sectionData(*section)) : nullptr;
+}
+
+uint32_t MeshCache::lodCount() const
+{
+  return findSection(MESH_SECTION_LODS) != nullptr ? header().lod_count : 1;
+}
+
+const MeshLod *MeshCache::lods() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_LODS);
+  return section != nullptr ? reinterpret_cast<const MeshLod*>(sectionData(*section)) : nullptr;
+}
+
+uint32_t MeshCache::meshletCount() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_MESHLETS);
+  return section != nullptr ? static_cast<uint32_t>(section->size / sizeof(Meshlet)) : 0;
+}
+
+const Meshlet *MeshCache::meshlets() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_MESHLETS);
+  return section != nullptr ? reinterpret_cast<const Meshlet*>(sectionData(*section)) : nullptr;
+}
+
+const MeshletBounds *MeshCache::meshletBounds() const
+{
+  const MeshCacheSection *section = findSection(MESH_SECTION_MESHLET_BOUNDS);
+  return section != nullptr ? reinterpret_cast<const MeshletBounds*>(sectionData(*section)) : nullptr;
+}
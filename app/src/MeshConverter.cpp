@@ -0,0 +1,148 @@
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "VertexQuantization.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "Meshlets.hpp"
+#include "ClusterPages.hpp"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+
+void printQuantizationReport(const QuantizationReport &report)
+{
+  std::cout << "quantization: " << report.source_bytes << " -> " << report.quantized_bytes << " vertex bytes ("
+    << 100.0 * report.quantized_bytes / std::max<size_t>(report.source_bytes, 1) << "%)" << std::endl;
+  std::cout << "\tmax position error: " << report.max_position_error << std::endl;
+  std::cout << "\tmax normal error:   " << report.max_normal_error << " deg" << std::endl;
+  std::cout << "\tmax tangent error:  " << report.max_tangent_error << " deg" << std::endl;
+  std::cout << "\tmax uv error:       " << report.max_uv_error << std::endl;
+}
+
+void printVertexCacheStats(const VertexCacheStats &before, const VertexCacheStats &after)
+{
+  std::cout << "vertex cache: ACMR " << before.acmr << " -> " << after.acmr
+    << ", ATVR " << before.atvr << " -> " << after.atvr
+    << " (" << before.transformed << " -> " << after.transformed << " vertex shader invocations)" << std::endl;
+}
+
+void printLods(const MeshData &mesh)
+{
+  for (size_t i = 0; i < mesh.lods.size(); i++)
+  {
+    std::cout << "submesh " << i / mesh.lod_count << " lod " << i % mesh.lod_count << ": "
+      << mesh.lods[i].index_count / 3 << " triangles, error " << mesh.lods[i].error << std::endl;
+  }
+}
+
+void printMeshlets(const MeshData &mesh)
+{
+  size_t meshlet_count = std::max<size_t>(mesh.meshlets.size(), 1);
+  size_t cone_culled = 0;
+  glm::vec3 camera = mesh.bounds_max + (mesh.bounds_max - mesh.bounds_min);
+
+  for (const MeshletBounds &bounds : mesh.meshlet_bounds)
+  {
+    cone_culled += isMeshletBackfacing(bounds, camera) ? 1 : 0;
+  }
+
+  std::cout << "meshlets: " << mesh.meshlets.size() << ", " << float(mesh.meshlet_vertices.size()) / meshlet_count << " vertices and "
+    << float(mesh.meshlet_triangles.size()) / meshlet_count << " triangles on average, "
+    << 100.0 * cone_culled / meshlet_count << "% backfacing from a corner" << std::endl;
+}
+
+void printClusterPages(const std::string &file_name, const ClusterPagesReport &report)
+{
+  std::cout << file_name << ": " << report.cell_count << " cells, " << report.page_count << " pages of " << CLUSTER_PAGE_SIZE / 1024 << " KiB, "
+    << 100.0f * report.page_fill << "% filled, " << report.vertex_duplication << "x level 0 vertices" << std::endl;
+}
+
+/**
+ * Offline converter: OBJ in, .vmesh out, optionally streaming pages (.vpages) as well
+ */
+int main(int argc, char *argv[])
+{
+  bool quantize = true;
+  std::string pages_output;
+  int arg = 1;
+
+  while (arg < argc && std::string(argv[arg]).rfind("--", 0) == 0)
+  {
+    std::string option = argv[arg++];
+
+    if (option == "--float")
+    {
+      quantize = false;
+    }
+    else if (option == "--pages" && arg < argc)
+    {
+      pages_output = argv[arg++];
+    }
+    else
+    {
+      arg = argc;
+    }
+  }
+
+  if (argc - arg < 2)
+  {
+    std::cerr << "usage: MeshConverter [--float] [--pages <output.vpages>] <input.obj> <output.vmesh>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const char *input = argv[arg];
+  const char *output = argv[arg + 1];
+
+  try
+  {
+    MeshData mesh = loadObj(input);
+
+    generateLods(mesh);
+    printLods(mesh);
+
+    // Only level 0 is measured, it is what the cache statistics are usually quoted for
+    uint32_t lod0_index_count = mesh.submeshes.empty() ? static_cast<uint32_t>(mesh.indices.size()) : mesh.submeshes.back().index_offset + mesh.submeshes.back().index_count;
+    VertexCacheStats before = analyzeVertexCache(mesh.indices.data(), lod0_index_count, mesh.vertices.size());
+    optimizeMesh(mesh);
+    VertexCacheStats after = analyzeVertexCache(mesh.indices.data(), lod0_index_count, mesh.vertices.size());
+    printVertexCacheStats(before, after);
+
+    buildMeshlets(mesh);
+    printMeshlets(mesh);
+
+    if (quantize)
+    {
+      QuantizedMesh quantized = quantizeMesh(mesh);
+      printQuantizationReport(quantized.report);
+      writeMeshCache(output, mesh, &quantized);
+
+      if (!pages_output.empty())
+      {
+        printClusterPages(pages_output, writeClusterPages(pages_output, mesh, &quantized));
+      }
+    }
+    else
+    {
+      writeMeshCache(output, mesh);
+
+      if (!pages_output.empty())
+      {
+        printClusterPages(pages_output, writeClusterPages(pages_output, mesh));
+      }
+    }
+
+    MeshCache cache(output);
+    std::cout << output << ": " << cache.vertexCount() << " vertices, " << cache.indexCount() / 3 << " triangles, "
+      << cache.submeshCount() << " submeshes, " << cache.meshletCount() << " meshlets, " << cache.indexSize() * 8 << "-bit indices" << std::endl;
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,376 @@
+#include "MeshOptimizer.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  const uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+  /*
+  * FIFO cache simulation with timestamps
+    - A vertex is resident if it missed within the last cache_size misses.
+    - Bumping `time` by cache_size + 1 flushes the whole cache.
+  */
+  struct CacheSimulator
+  {
+    std::vector<uint32_t> timestamps;
+    uint32_t time;
+    uint32_t cache_size;
+
+    CacheSimulator(size_t vertex_count, uint32_t cache_size)
+      : timestamps(vertex_count, 0), time(cache_size + 1), cache_size(cache_size)
+    {
+    }
+
+    uint32_t triangleMisses(const uint32_t *triangle)
+    {
+      uint32_t misses = 0;
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t vertex = triangle[k];
+        if (time - timestamps[vertex] > cache_size)
+        {
+          timestamps[vertex] = time++;
+          misses++;
+        }
+      }
+      return misses;
+    }
+
+    void flush()
+    {
+      time += cache_size + 1;
+    }
+  };
+
+  struct Cluster
+  {
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    float sort_key;
+  };
+
+  uint32_t skipDeadEnd(const std::vector<uint32_t> &live, std::vector<uint32_t> &dead_end, size_t &cursor)
+  {
+    while (!dead_end.empty())
+    {
+      uint32_t vertex = dead_end.back();
+      dead_end.pop_back();
+
+      if (live[vertex] > 0)
+      {
+        return vertex;
+      }
+    }
+
+    while (cursor < live.size())
+    {
+      if (live[cursor] > 0)
+      {
+        return static_cast<uint32_t>(cursor);
+      }
+      cursor++;
+    }
+
+    return NO_VERTEX;
+  }
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size)
+{
+  VertexCacheStats stats;
+  CacheSimulator cache(vertex_count, cache_size);
+  std::vector<bool> referenced(vertex_count, false);
+
+  for (size_t i = 0; i + 2 < index_count; i += 3)
+  {
+    stats.transformed += cache.triangleMisses(&indices[i]);
+  }
+
+  for (size_t i = 0; i < index_count; i++)
+  {
+    if (!referenced[indices[i]])
+    {
+      referenced[indices[i]] = true;
+      stats.vertices++;
+    }
+  }
+
+  stats.triangles = static_cast<uint32_t>(index_count / 3);
+  stats.acmr = stats.triangles > 0 ? float(stats.transformed) / stats.triangles : 0.0f;
+  stats.atvr = stats.vertices > 0 ? float(stats.transformed) / stats.vertices : 0.0f;
+
+  return stats;
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t index_count, size_t vertex_count, std::vector<uint32_t> *cluster_starts, uint32_t cache_size)
+{
+  size_t triangle_count = index_count / 3;
+
+  // Vertex -> triangle adjacency
+  std::vector<uint32_t> live(vertex_count, 0);
+  for (size_t i = 0; i < triangle_count * 3; i++)
+  {
+    live[indices[i]]++;
+  }
+
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (size_t v = 0; v < vertex_count; v++)
+  {
+    adjacency_offsets[v + 1] = adjacency_offsets[v] + live[v];
+  }
+
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+  for (size_t i = 0; i < triangle_count * 3; i++)
+  {
+    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<uint32_t> timestamps(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  dead_end.reserve(triangle_count * 3);
+  result.reserve(triangle_count * 3);
+
+  uint32_t time = cache_size + 1;
+  size_t cursor = 0;
+
+  if (cluster_starts != nullptr)
+  {
+    cluster_starts->clear();
+    cluster_starts->push_back(0);
+  }
+
+  uint32_t fanning = skipDeadEnd(live, dead_end, cursor);
+
+  while (fanning != NO_VERTEX)
+  {
+    candidates.clear();
+
+    // Emit every remaining triangle around the fanning vertex
+    for (uint32_t a = adjacency_offsets[fanning]; a < adjacency_offsets[fanning + 1]; a++)
+    {
+      uint32_t triangle = adjacency[a];
+      if (emitted[triangle])
+      {
+        continue;
+      }
+      emitted[triangle] = true;
+
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t vertex = indices[triangle * 3 + k];
+        result.push_back(vertex);
+        dead_end.push_back(vertex);
+        candidates.push_back(vertex);
+        live[vertex]--;
+
+        if (time - timestamps[vertex] > cache_size)
+        {
+          timestamps[vertex] = time++;
+        }
+      }
+    }
+
+    // Prefer a vertex that will still be in the cache once all its triangles are emitted
+    uint32_t best = NO_VERTEX;
+    int best_priority = -1;
+
+    for (uint32_t vertex : candidates)
+    {
+      if (live[vertex] == 0)
+      {
+        continue;
+      }
+
+      int priority = 0;
+      if (time - timestamps[vertex] + 2 * live[vertex] <= cache_size)
+      {
+        priority = static_cast<int>(time - timestamps[vertex]);
+      }
+
+      if (priority > best_priority)
+      {
+        best_priority = priority;
+        best = vertex;
+      }
+    }
+
+    if (best == NO_VERTEX)
+    {
+      best = skipDeadEnd(live, dead_end, cursor);
+
+      if (cluster_starts != nullptr && best != NO_VERTEX)
+      {
+        cluster_starts->push_back(static_cast<uint32_t>(result.size() / 3));
+      }
+    }
+
+    fanning = best;
+  }
+
+  std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t *indices, size_t index_count, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &cluster_starts, float threshold, uint32_t cache_size)
+{
+  uint32_t triangle_count = static_cast<uint32_t>(index_count / 3);
+  if (triangle_count == 0)
+  {
+    return;
+  }
+
+  // Split the hard clusters wherever the running ACMR is within threshold of the cluster ACMR
+  std::vector<uint32_t> boundaries;
+  CacheSimulator cache(vertices.size(), cache_size);
+
+  for (size_t c = 0; c < cluster_starts.size(); c++)
+  {
+    uint32_t start = cluster_starts[c];
+    uint32_t end = c + 1 < cluster_starts.size() ? cluster_starts[c + 1] : triangle_count;
+
+    cache.flush();
+    uint32_t cluster_misses = 0;
+    for (uint32_t t = start; t < end; t++)
+    {
+      cluster_misses += cache.triangleMisses(&indices[t * 3]);
+    }
+    float cluster_threshold = threshold * cluster_misses / float(end - start);
+
+    cache.flush();
+    boundaries.push_back(start);
+    uint32_t running_misses = 0;
+    uint32_t running_triangles = 0;
+
+    for (uint32_t t = start; t < end; t++)
+    {
+      running_misses += cache.triangleMisses(&indices[t * 3]);
+      running_triangles++;
+
+      if (t + 1 < end && running_misses <= running_triangles * cluster_threshold)
+      {
+        boundaries.push_back(t + 1);
+        cache.flush();
+        running_misses = 0;
+        running_triangles = 0;
+      }
+    }
+  }
+
+  glm::vec3 mesh_centroid(0.0f);
+  for (size_t i = 0; i < triangle_count * 3; i++)
+  {
+    mesh_centroid += vertices[indices[i]].position;
+  }
+  mesh_centroid /= float(triangle_count * 3);
+
+  std::vector<Cluster> clusters;
+  clusters.reserve(boundaries.size());
+
+  for (size_t b = 0; b < boundaries.size(); b++)
+  {
+    Cluster cluster;
+    cluster.first_triangle = boundaries[b];
+    cluster.triangle_count = (b + 1 < boundaries.size() ? boundaries[b + 1] : triangle_count) - cluster.first_triangle;
+
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+
+    for (uint32_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.triangle_count; t++)
+    {
+      const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+      const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+      const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+
+      glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+      float face_area = glm::length(face_normal);
+
+      centroid += (p0 + p1 + p2) * (face_area / 3.0f);
+      normal += face_normal;
+      area += face_area;
+    }
+
+    centroid = area > 0.0f ? centroid / area : mesh_centroid;
+    float normal_length = glm::length(normal);
+    normal = normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f);
+
+    // Clusters far out along their own normal are likely to occlude the rest
+    cluster.sort_key = glm::dot(centroid - mesh_centroid, normal);
+    clusters.push_back(cluster);
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b)
+  {
+    return a.sort_key > b.sort_key;
+  });
+
+  std::vector<uint32_t> result;
+  result.reserve(triangle_count * 3);
+
+  for (const Cluster &cluster : clusters)
+  {
+    result.insert(result.end(), indices + cluster.first_triangle * 3, indices + (cluster.first_triangle + cluster.triangle_count) * 3);
+  }
+
+  std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+  std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+  std::vector<Vertex> reordered;
+  reordered.reserve(vertices.size());
+
+  for (uint32_t &index : indices)
+  {
+    if (remap[index] == NO_VERTEX)
+    {
+      remap[index] = static_cast<uint32_t>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  vertices.swap(reordered);
+}
+
+void optimizeMesh(MeshData &mesh)
+{
+  std::vector<Submesh> submeshes = mesh.submeshes;
+  if (submeshes.empty())
+  {
+    submeshes.push_back({0, static_cast<uint32_t>(mesh.indices.size())});
+  }
+
+  std::vector<uint32_t> cluster_starts;
+
+  for (const Submesh &submesh : submeshes)
+  {
+    uint32_t *indices = mesh.indices.data() + submesh.index_offset;
+
+    optimizeVertexCache(indices, submesh.index_count, mesh.vertices.size(), &cluster_starts);
+    optimizeOverdraw(indices, submesh.index_count, mesh.vertices, cluster_starts);
+  }
+
+  // Coarser levels are small on screen, overdraw matters less than the cache there
+  std::vector<uint32_t> optimized_offsets;
+  for (const MeshLod &lod : mesh.lods)
+  {
+    if (lod.error == 0.0f || std::find(optimized_offsets.begin(), optimized_offsets.end(), lod.index_offset) != optimized_offsets.end())
+    {
+      continue;
+    }
+
+    optimizeVertexCache(mesh.indices.data() + lod.index_offset, lod.index_count, mesh.vertices.size());
+    optimized_offsets.push_back(lod.index_offset);
+  }
+
+  optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
@@ -0,0 +1,344 @@
+#include "MeshSimplifier.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+
+namespace
+{
+  /*
+  * Symmetric 4x4 quadric, stored as the upper triangle of A, b and c:
+    error(p) = p^T A p + 2 b.p + c
+    Quadrics are area weighted, error(p) / weight is the mean squared plane distance.
+  */
+  struct Quadric
+  {
+    double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::vec3 &normal, float distance, float plane_weight)
+    {
+      double nx = normal.x, ny = normal.y, nz = normal.z, d = distance, w = plane_weight;
+      a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+      a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+      b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+      c += w * d * d;
+      weight += w;
+    }
+
+    void add(const Quadric &other)
+    {
+      a00 += other.a00; a11 += other.a11; a22 += other.a22;
+      a01 += other.a01; a02 += other.a02; a12 += other.a12;
+      b0 += other.b0; b1 += other.b1; b2 += other.b2;
+      c += other.c;
+      weight += other.weight;
+    }
+
+    double error(const glm::vec3 &p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+      double result =
+        a00 * x * x + a11 * y * y + a22 * z * z +
+        2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+        2.0 * (b0 * x + b1 * y + b2 * z) + c;
+      return std::max(result, 0.0);
+    }
+  };
+
+  struct Collapse
+  {
+    uint32_t from;
+    uint32_t to;
+    double cost; // mean squared distance
+  };
+
+  struct PositionHash
+  {
+    size_t operator()(const glm::vec3 &p) const
+    {
+      const uint32_t *bits = reinterpret_cast<const uint32_t*>(&p);
+      return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+  };
+
+  /*
+  * Vertices that must keep their position
+    - seams: another vertex has the same position (UV or normal discontinuity)
+    - borders: lie on an edge used by a single triangle
+  */
+  std::vector<bool> findLockedVertices(const std::vector<Vertex> &vertices, const uint32_t *indices, size_t index_count)
+  {
+    std::vector<bool> locked(vertices.size(), false);
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> first_at_position;
+    for (uint32_t v = 0; v < vertices.size(); v++)
+    {
+      auto inserted = first_at_position.emplace(vertices[v].position, v);
+      if (!inserted.second)
+      {
+        locked[v] = true;
+        locked[inserted.first->second] = true;
+      }
+    }
+
+    std::unordered_map<uint64_t, int> edge_use;
+    for (size_t i = 0; i + 2 < index_count; i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+        uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+        edge_use[key]++;
+      }
+    }
+
+    for (const auto &edge : edge_use)
+    {
+      if (edge.second == 1)
+      {
+        locked[uint32_t(edge.first >> 32)] = true;
+        locked[uint32_t(edge.first & 0xFFFFFFFFu)] = true;
+      }
+    }
+
+    return locked;
+  }
+
+  bool flipsTriangle(const std::vector<Vertex> &vertices, const uint32_t *triangle, uint32_t from, const glm::vec3 &target)
+  {
+    glm::vec3 before[3], after[3];
+    for (int k = 0; k < 3; k++)
+    {
+      before[k] = vertices[triangle[k]].position;
+      after[k] = triangle[k] == from ? target : before[k];
+    }
+
+    glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+    glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+    // Reject flips and collapses that turn the triangle more than ~75 degrees
+    return glm::dot(normal_before, normal_after) <= 0.25f * glm::length(normal_before) * glm::length(normal_after);
+  }
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex> &vertices, const uint32_t *indices, size_t index_count, size_t target_index_count, float target_error, float *result_error)
+{
+  std::vector<uint32_t> result(indices, indices + index_count - index_count % 3);
+  std::vector<bool> locked = findLockedVertices(vertices, indices, result.size());
+
+  std::vector<Quadric> quadrics(vertices.size());
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    const glm::vec3 &p0 = vertices[result[i]].position;
+    const glm::vec3 &p1 = vertices[result[i + 1]].position;
+    const glm::vec3 &p2 = vertices[result[i + 2]].position;
+
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float area = glm::length(normal);
+    if (area == 0.0f)
+    {
+      continue;
+    }
+    normal /= area;
+
+    for (int k = 0; k < 3; k++)
+    {
+      quadrics[result[i + k]].addPlane(normal, -glm::dot(normal, p0), area);
+    }
+  }
+
+  double max_cost = double(target_error) * target_error;
+  double worst_cost = 0.0;
+
+  std::vector<uint32_t> adjacency_offsets(vertices.size() + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> remap(vertices.size());
+  std::vector<bool> touched(vertices.size());
+  std::vector<Collapse> collapses;
+
+  while (result.size() > target_index_count)
+  {
+    // Vertex -> triangle adjacency of the current index list
+    std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+    for (uint32_t index : result)
+    {
+      adjacency_offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+      adjacency_offsets[v + 1] += adjacency_offsets[v];
+    }
+    adjacency.resize(result.size());
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t i = 0; i < result.size(); i++)
+    {
+      adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // Cheapest direction of every edge
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+        if (a > b || (locked[a] && locked[b]))
+        {
+          continue;
+        }
+
+        Quadric combined = quadrics[a];
+        combined.add(quadrics[b]);
+        double weight = std::max(combined.weight, 1e-12);
+
+        double cost_ab = locked[a] ? HUGE_VAL : combined.error(vertices[b].position) / weight;
+        double cost_ba = locked[b] ? HUGE_VAL : combined.error(vertices[a].position) / weight;
+
+        collapses.push_back(cost_ab <= cost_ba ? Collapse{a, b, cost_ab} : Collapse{b, a, cost_ba});
+      }
+    }
+
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y)
+    {
+      return x.cost < y.cost;
+    });
+
+    for (uint32_t v = 0; v < vertices.size(); v++)
+    {
+      remap[v] = v;
+    }
+    std::fill(touched.begin(), touched.end(), false);
+
+    size_t triangles_to_remove = (result.size() - target_index_count) / 3;
+    size_t removed = 0;
+    size_t performed = 0;
+
+    for (const Collapse &collapse : collapses)
+    {
+      if (collapse.cost > max_cost || removed >= triangles_to_remove)
+      {
+        break;
+      }
+
+      if (touched[collapse.from] || touched[collapse.to])
+      {
+        continue;
+      }
+
+      const glm::vec3 &target = vertices[collapse.to].position;
+      bool rejected = false;
+      uint32_t shared = 0;
+
+      for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1] && !rejected; a++)
+      {
+        const uint32_t *triangle = &result[adjacency[a] * 3];
+        bool degenerates = triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to;
+
+        if (degenerates)
+        {
+          shared++;
+        }
+        else
+        {
+          rejected = flipsTriangle(vertices, triangle, collapse.from, target);
+        }
+      }
+
+      if (rejected)
+      {
+        continue;
+      }
+
+      // Freeze the neighbourhood: adjacency is only rebuilt between passes
+      for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; a++)
+      {
+        const uint32_t *triangle = &result[adjacency[a] * 3];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].add(quadrics[collapse.from]);
+      worst_cost = std::max(worst_cost, collapse.cost);
+      removed += shared;
+      performed++;
+    }
+
+    if (performed == 0)
+    {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+
+      if (a != b && b != c && a != c)
+      {
+        result[write++] = a;
+        result[write++] = b;
+        result[write++] = c;
+      }
+    }
+    result.resize(write);
+  }
+
+  if (result_error != nullptr)
+  {
+    *result_error = static_cast<float>(std::sqrt(worst_cost));
+  }
+
+  return result;
+}
+
+void generateLods(MeshData &mesh, uint32_t lod_count, float ratio)
+{
+  std::vector<Submesh> submeshes = mesh.submeshes;
+  if (submeshes.empty())
+  {
+    submeshes.push_back({0, static_cast<uint32_t>(mesh.indices.size())});
+  }
+
+  glm::vec3 extent = mesh.bounds_max - mesh.bounds_min;
+  // Caps the error so far levels never collapse into something unrecognizable
+  float max_error = 0.1f * std::max(extent.x, std::max(extent.y, extent.z));
+
+  mesh.lods.clear();
+  mesh.lod_count = lod_count;
+
+  for (const Submesh &submesh : submeshes)
+  {
+    MeshLod previous = {submesh.index_offset, submesh.index_count, 0.0f};
+    mesh.lods.push_back(previous);
+
+    for (uint32_t lod = 1; lod < lod_count; lod++)
+    {
+      size_t target_index_count = static_cast<size_t>(previous.index_count / 3 * ratio) * 3;
+
+      float error = 0.0f;
+      std::vector<uint32_t> simplified = simplifyMesh(mesh.vertices, mesh.indices.data() + previous.index_offset, previous.index_count, target_index_count, max_error, &error);
+
+      if (simplified.empty() || simplified.size() >= previous.index_count)
+      {
+        // Could not simplify further, repeat the previous level
+        mesh.lods.push_back(previous);
+        continue;
+      }
+
+      MeshLod level;
+      level.index_offset = static_cast<uint32_t>(mesh.indices.size());
+      level.index_count = static_cast<uint32_t>(simplified.size());
+      // Errors are measured against the previous level, summing keeps a bound to the source
+      level.error = previous.error + error;
+
+      mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+      mesh.lods.push_back(level);
+      previous = level;
+    }
+  }
+}
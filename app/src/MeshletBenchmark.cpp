@@ -0,0 +1,438 @@
+#include "MeshletRenderer.hpp"
+#include "MeshCache.hpp"
+#include "GpuMesh.hpp"
+#include "Meshlets.hpp"
+#include "StagingUploader.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Headless meshlet culling and drawing of one .vmesh (MeshConverter output)
+ * into an offscreen 1920x1080 target, timed with GPU timestamps, on the
+ * compute path and, when the device has VK_EXT_mesh_shader, the mesh shader
+ * path. Needs the .spv files in the working directory.
+ * Usage: MeshletBenchmark <mesh.vmesh> [all|compute|mesh]
+ */
+namespace
+{
+  const uint32_t WIDTH = 1920;
+  const uint32_t HEIGHT = 1080;
+  const int ITERATIONS = 50;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    float timestamp_period = 1.0f;
+    bool mesh_shader = false;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Meshlet Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Any device runs the compute path, prefer one that also runs the mesh shader path
+    for (VkPhysicalDevice device : devices)
+    {
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      for (uint32_t i = 0; i < family_count; i++)
+      {
+        bool graphics_compute = (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT);
+        if (!graphics_compute || families[i].timestampValidBits == 0)
+        {
+          continue;
+        }
+
+        bool mesh_shader = isMeshShaderSupported(context.instance, device);
+        if (context.physical_device == VK_NULL_HANDLE || (mesh_shader && !context.mesh_shader))
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+          context.mesh_shader = mesh_shader;
+        }
+        break;
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with graphics, compute and timestamps!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    context.timestamp_period = properties.limits.timestampPeriod;
+    std::cout << properties.deviceName << std::endl;
+
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(context.physical_device, &supported_features);
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_features{};
+    mesh_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    mesh_features.taskShader = VK_TRUE;
+    mesh_features.meshShader = VK_TRUE;
+
+    // The compute path submits all its draws in one call with multiDrawIndirect
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.features.multiDrawIndirect = supported_features.multiDrawIndirect;
+
+    std::vector<const char*> extensions;
+    if (context.mesh_shader)
+    {
+      extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+      extensions.push_back(VK_KHR_SPIRV_1_4_EXTENSION_NAME);
+      features.pNext = &mesh_features;
+    }
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &features;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    device_info.ppEnabledExtensionNames = extensions.data();
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  /**
+   * Color only: the meshlet pipelines have no depth state
+   */
+  VkRenderPass createRenderPass(VkDevice device)
+  {
+    VkAttachmentDescription attachment{};
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+
+    // Iterations run back to back on the same attachment
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    VkRenderPass render_pass;
+    if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create render pass!");
+    }
+
+    return render_pass;
+  }
+
+  /**
+   * Records with `record`, submits, waits, and returns the GPU time between
+   * consecutive timestamps in milliseconds
+   */
+  template <typename Record>
+  std::vector<double> timeCommands(const HeadlessContext &context, VkCommandBuffer command_buffer, VkQueryPool query_pool, uint32_t query_count, Record record)
+  {
+    std::vector<double> totals(query_count - 1, 0.0);
+
+    for (int iteration = -1; iteration < ITERATIONS; iteration++)
+    {
+      vkResetCommandBuffer(command_buffer, 0);
+
+      VkCommandBufferBeginInfo begin_info{};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vkBeginCommandBuffer(command_buffer, &begin_info);
+      vkCmdResetQueryPool(command_buffer, query_pool, 0, query_count);
+      record(command_buffer);
+      vkEndCommandBuffer(command_buffer);
+
+      VkSubmitInfo submit_info{};
+      submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submit_info.commandBufferCount = 1;
+      submit_info.pCommandBuffers = &command_buffer;
+
+      if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to submit benchmark commands!");
+      }
+      vkQueueWaitIdle(context.queue);
+
+      std::vector<uint64_t> timestamps(query_count);
+      vkGetQueryPoolResults(context.device, query_pool, 0, query_count, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+      // The first run warms up caches and clocks
+      if (iteration < 0)
+      {
+        continue;
+      }
+
+      for (uint32_t i = 0; i + 1 < query_count; i++)
+      {
+        totals[i] += double(timestamps[i + 1] - timestamps[i]) * context.timestamp_period * 1e-6;
+      }
+    }
+
+    for (double &total : totals)
+    {
+      total /= ITERATIONS;
+    }
+
+    return totals;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: MeshletBenchmark <mesh.vmesh> [all|compute|mesh]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string paths = argc > 2 ? argv[2] : "all";
+
+  try
+  {
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    bool run_compute = paths == "all" || paths == "compute";
+    bool run_mesh = paths == "all" || paths == "mesh";
+
+    if (run_mesh && !context.mesh_shader)
+    {
+      std::cout << "VK_EXT_mesh_shader is not supported, skipping the mesh shader path" << std::endl;
+      run_mesh = false;
+    }
+
+    MeshCache cache(argv[1]);
+
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+    GpuMesh mesh = uploadMesh(device, context.physical_device, uploader, cache);
+
+    uint64_t triangle_count = 0;
+    for (uint32_t i = 0; i < cache.meshletCount(); i++)
+    {
+      triangle_count += cache.meshlets()[i].triangle_count;
+    }
+
+    Image color = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkRenderPass render_pass = createRenderPass(device);
+
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = render_pass;
+    framebuffer_info.attachmentCount = 1;
+    framebuffer_info.pAttachments = &color.view;
+    framebuffer_info.width = WIDTH;
+    framebuffer_info.height = HEIGHT;
+    framebuffer_info.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create framebuffer!");
+    }
+
+    // Both renderers stage their buffers up front, one flush covers them
+    MeshletRenderer compute_renderer;
+    MeshletRenderer mesh_renderer;
+    if (run_compute)
+    {
+      compute_renderer.init(device, context.physical_device, uploader, cache, mesh, render_pass, MESHLET_PATH_COMPUTE);
+    }
+    if (run_mesh)
+    {
+      mesh_renderer.init(device, context.physical_device, uploader, cache, mesh, render_pass, MESHLET_PATH_MESH_SHADER);
+    }
+    uploader.flush();
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = context.queue_family;
+
+    VkCommandPool command_pool;
+    if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+
+    VkQueryPoolCreateInfo query_info{};
+    query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_info.queryCount = 3;
+
+    VkQueryPool query_pool;
+    if (vkCreateQueryPool(device, &query_info, nullptr, &query_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create query pool!");
+    }
+
+    // Whole mesh in view, so only backfacing clusters are culled
+    glm::vec3 center = (mesh.bounds_min + mesh.bounds_max) * 0.5f;
+    float radius = std::max(glm::length(mesh.bounds_max - mesh.bounds_min) * 0.5f, 1e-3f);
+    glm::vec3 camera_position = center + glm::normalize(glm::vec3(0.3f, 0.4f, 1.0f)) * radius * 2.5f;
+
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(45.0f), float(WIDTH) / HEIGHT, radius * 0.05f, radius * 10.0f);
+    proj[1][1] *= -1.0f;
+    glm::mat4 view_proj = proj * glm::lookAtRH(camera_position, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 model(1.0f);
+
+    VkClearValue clear_value{};
+
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = render_pass;
+    render_pass_info.framebuffer = framebuffer;
+    render_pass_info.renderArea = {{0, 0}, {WIDTH, HEIGHT}};
+    render_pass_info.clearValueCount = 1;
+    render_pass_info.pClearValues = &clear_value;
+
+    VkViewport viewport{0.0f, 0.0f, float(WIDTH), float(HEIGHT), 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+
+    auto time_renderer = [&](MeshletRenderer &renderer)
+    {
+      return timeCommands(context, command_buffer, query_pool, 3, [&](VkCommandBuffer cmd)
+      {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+        renderer.cull(cmd, model, view_proj, camera_position);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, query_pool, 1);
+        vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+        renderer.draw(cmd);
+        vkCmdEndRenderPass(cmd);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 2);
+      });
+    };
+
+    auto report = [&](const char *label, const std::vector<double> &ms)
+    {
+      double total_ms = ms[0] + ms[1];
+      std::cout << label << total_ms << " ms (" << ms[0] << " ms cull + " << ms[1] << " ms draw), "
+        << triangle_count / (total_ms * 1e-3) * 1e-9 << " G input triangles/s" << std::endl;
+    };
+
+    std::cout << cache.meshletCount() << " meshlets, " << triangle_count << " triangles, " << WIDTH << "x" << HEIGHT
+      << ", average of " << ITERATIONS << " runs" << std::endl;
+
+    if (run_compute)
+    {
+      report("compute path:     ", time_renderer(compute_renderer));
+    }
+
+    // The task shader culls while drawing, so its cull time is only the frame data update
+    if (run_mesh)
+    {
+      report("mesh shader path: ", time_renderer(mesh_renderer));
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyQueryPool(device, query_pool, nullptr);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    mesh_renderer.cleanup();
+    compute_renderer.cleanup();
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    vkDestroyRenderPass(device, render_pass, nullptr);
+    destroyImage(device, color);
+    destroyGpuMesh(device, mesh);
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
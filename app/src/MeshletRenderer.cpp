@@ -0,0 +1,499 @@
+#include "MeshletRenderer.hpp"
+#include "FrustumCulling.hpp"
+#include "Meshlets.hpp"
+#include "SpirvReflection.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t TASK_GROUP_SIZE = 32;
+  const uint32_t CULL_GROUP_SIZE = 64;
+
+  enum MeshletBinding : uint32_t
+  {
+    BINDING_FRAME = 0,
+    BINDING_MESHLETS = 1,
+    BINDING_BOUNDS = 2,
+    BINDING_MESHLET_VERTICES = 3,
+    BINDING_MESHLET_TRIANGLES = 4,
+    BINDING_VERTICES = 5,
+    BINDING_DRAW_COMMANDS = 6,
+    BINDING_COUNT = 7
+  };
+
+  const VkPipelineStageFlags MESH_SHADER_STAGES = VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+  const VkPipelineStageFlags COMPUTE_PATH_STAGES = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+  Buffer createDeviceBuffer(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage)
+  {
+    return createBuffer(device, physical_device, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  Buffer uploadSection(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const MeshCache &cache, MeshCacheSectionType type)
+  {
+    const MeshCacheSection &section = *cache.findSection(type);
+    Buffer buffer = createDeviceBuffer(device, physical_device, section.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    uploader.uploadBuffer(buffer.buffer, 0, cache.sectionData(section), section.size);
+    return buffer;
+  }
+
+  void globalBarrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+  {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+
+    vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+}
+
+bool isMeshShaderSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+  if (properties.apiVersion < VK_API_VERSION_1_1 || get_features2 == nullptr)
+  {
+    return false;
+  }
+
+  uint32_t extension_count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+
+  bool has_extension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties &extension)
+  {
+    return std::strcmp(extension.extensionName, VK_EXT_MESH_SHADER_EXTENSION_NAME) == 0;
+  });
+
+  if (!has_extension)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceMeshShaderFeaturesEXT mesh_features{};
+  mesh_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &mesh_features;
+  get_features2(physical_device, &features);
+
+  return mesh_features.taskShader && mesh_features.meshShader;
+}
+
+void MeshletRenderer::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const MeshCache &cache, const GpuMesh &mesh, VkRenderPass render_pass, MeshletPath path)
+{
+  if (cache.meshletCount() == 0)
+  {
+    throw std::runtime_error("mesh cache has no meshlets, re-run the mesh converter!");
+  }
+
+  this->device = device;
+  meshlet_path = path;
+  meshlet_count = cache.meshletCount();
+  vertex_buffer = mesh.vertex_buffer.buffer;
+
+  if (path == MESHLET_PATH_MESH_SHADER)
+  {
+    cmd_draw_mesh_tasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT"));
+    if (cmd_draw_mesh_tasks == nullptr)
+    {
+      throw std::runtime_error("VK_EXT_mesh_shader is not enabled on the device!");
+    }
+  }
+
+  frame_buffer = createDeviceBuffer(device, physical_device, sizeof(MeshletFrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+  meshlet_buffer = uploadSection(device, physical_device, uploader, cache, MESH_SECTION_MESHLETS);
+  bounds_buffer = uploadSection(device, physical_device, uploader, cache, MESH_SECTION_MESHLET_BOUNDS);
+  meshlet_vertex_buffer = uploadSection(device, physical_device, uploader, cache, MESH_SECTION_MESHLET_VERTICES);
+  meshlet_triangle_buffer = uploadSection(device, physical_device, uploader, cache, MESH_SECTION_MESHLET_TRIANGLES);
+
+  if (path == MESHLET_PATH_COMPUTE)
+  {
+    VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceFeatures(physical_device, &features);
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    max_draws_per_call = features.multiDrawIndirect ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+
+    indirect_buffer = createDeviceBuffer(device, physical_device, meshlet_count * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+    // The vertex shader path cannot read 8-bit local indices, expand them to vertex buffer indices
+    const Meshlet *meshlets = cache.meshlets();
+    const uint32_t *meshlet_vertices = reinterpret_cast<const uint32_t*>(cache.sectionData(*cache.findSection(MESH_SECTION_MESHLET_VERTICES)));
+    const uint32_t *meshlet_triangles = reinterpret_cast<const uint32_t*>(cache.sectionData(*cache.findSection(MESH_SECTION_MESHLET_TRIANGLES)));
+    const Meshlet &last = meshlets[meshlet_count - 1];
+    VkDeviceSize index_bytes = VkDeviceSize(last.triangle_offset + last.triangle_count) * 3 * sizeof(uint32_t);
+
+    index_buffer = createDeviceBuffer(device, physical_device, index_bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+    uint32_t first = 0;
+    while (first < meshlet_count)
+    {
+      // Meshlet triangles are contiguous, so a run of meshlets is one copy
+      uint32_t end = first;
+      VkDeviceSize chunk_bytes = 0;
+      while (end < meshlet_count && chunk_bytes + meshlets[end].triangle_count * 3 * sizeof(uint32_t) <= uploader.capacity())
+      {
+        chunk_bytes += meshlets[end].triangle_count * 3 * sizeof(uint32_t);
+        end++;
+      }
+
+      uint32_t *indices = static_cast<uint32_t*>(uploader.stageBuffer(index_buffer.buffer, VkDeviceSize(meshlets[first].triangle_offset) * 3 * sizeof(uint32_t), chunk_bytes));
+
+      for (uint32_t m = first; m < end; m++)
+      {
+        const Meshlet &meshlet = meshlets[m];
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+        {
+          uint32_t packed = meshlet_triangles[meshlet.triangle_offset + t];
+          *indices++ = meshlet_vertices[meshlet.vertex_offset + (packed & 0xFF)];
+          *indices++ = meshlet_vertices[meshlet.vertex_offset + ((packed >> 8) & 0xFF)];
+          *indices++ = meshlet_vertices[meshlet.vertex_offset + ((packed >> 16) & 0xFF)];
+        }
+      }
+
+      first = end;
+    }
+  }
+
+  frame_data.position_offset = mesh.quantization.position_offset;
+  frame_data.position_scale = mesh.quantization.position_scale;
+  frame_data.meshlet_count = meshlet_count;
+
+  VkShaderStageFlags stages = path == MESHLET_PATH_MESH_SHADER
+    ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT
+    : VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+
+  createDescriptors(stages);
+  createGraphicsPipeline(render_pass, mesh.encoding);
+
+  if (path == MESHLET_PATH_COMPUTE)
+  {
+    createCullPipeline(mesh.encoding);
+  }
+}
+
+void MeshletRenderer::createDescriptors(VkShaderStageFlags stages)
+{
+  std::vector<VkDescriptorSetLayoutBinding> bindings(BINDING_COUNT);
+  for (uint32_t i = 0; i < BINDING_COUNT; i++)
+  {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = i == BINDING_FRAME ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = stages;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+  layout_info.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create meshlet descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize pool_sizes[] =
+  {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BINDING_COUNT - 1}
+  };
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 2;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create meshlet descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &descriptor_set_layout;
+
+  if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate meshlet descriptor set!");
+  }
+
+  VkBuffer buffers[BINDING_COUNT] =
+  {
+    frame_buffer.buffer, meshlet_buffer.buffer, bounds_buffer.buffer, meshlet_vertex_buffer.buffer,
+    meshlet_triangle_buffer.buffer, vertex_buffer, indirect_buffer.buffer
+  };
+
+  // The draw command binding only exists on the compute path
+  std::vector<VkDescriptorBufferInfo> buffer_infos;
+  std::vector<VkWriteDescriptorSet> writes;
+  buffer_infos.reserve(BINDING_COUNT);
+
+  for (uint32_t i = 0; i < BINDING_COUNT; i++)
+  {
+    if (buffers[i] == VK_NULL_HANDLE)
+    {
+      continue;
+    }
+
+    buffer_infos.push_back({buffers[i], 0, VK_WHOLE_SIZE});
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_set;
+    write.dstBinding = i;
+    write.descriptorCount = 1;
+    write.descriptorType = bindings[i].descriptorType;
+    write.pBufferInfo = &buffer_infos.back();
+    writes.push_back(write);
+  }
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create meshlet pipeline layout!");
+  }
+}
+
+void MeshletRenderer::createGraphicsPipeline(VkRenderPass render_pass, VertexEncoding encoding)
+{
+  bool mesh_shading = meshlet_path == MESHLET_PATH_MESH_SHADER;
+
+  std::vector<uint32_t> first_code = readSpirv(mesh_shading ? "meshlet_task.spv" : "meshlet_vert.spv");
+  if (mesh_shading)
+  {
+    // The task shader culls, so it reads the whole frame block
+    verifyShaderBlock<MeshletFrameData>(reflectSpirv(first_code), SPIRV_BLOCK_UNIFORM, 0, BINDING_FRAME);
+  }
+
+  VkShaderModule first_module = loadShaderModule(device, first_code);
+  VkShaderModule mesh_module = mesh_shading ? loadShaderModule(device, "meshlet_mesh.spv") : VK_NULL_HANDLE;
+  VkShaderModule frag_module = loadShaderModule(device, "frag.spv");
+
+  uint32_t vertex_encoding = encoding;
+  VkSpecializationMapEntry specialization_entry{0, 0, sizeof(uint32_t)};
+  VkSpecializationInfo specialization{1, &specialization_entry, sizeof(uint32_t), &vertex_encoding};
+
+  std::vector<VkPipelineShaderStageCreateInfo> stages;
+
+  VkPipelineShaderStageCreateInfo stage_info{};
+  stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stage_info.pName = "main";
+
+  stage_info.stage = mesh_shading ? VK_SHADER_STAGE_TASK_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+  stage_info.module = first_module;
+  stage_info.pSpecializationInfo = &specialization;
+  stages.push_back(stage_info);
+
+  if (mesh_shading)
+  {
+    stage_info.stage = VK_SHADER_STAGE_MESH_BIT_EXT;
+    stage_info.module = mesh_module;
+    stages.push_back(stage_info);
+  }
+
+  stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  stage_info.module = frag_module;
+  stage_info.pSpecializationInfo = nullptr;
+  stages.push_back(stage_info);
+
+  // Vertices are pulled from the storage buffer on both paths
+  VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+  vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+  input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewport_state_info{};
+  viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport_state_info.viewportCount = 1;
+  viewport_state_info.scissorCount = 1;
+
+  // Meshes are counter-clockwise; view_proj is expected to flip Y for Vulkan
+  VkPipelineRasterizationStateCreateInfo rasterization_info{};
+  rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterization_info.lineWidth = 1.0f;
+  rasterization_info.cullMode = VK_CULL_MODE_BACK_BIT;
+  rasterization_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling_info{};
+  multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling_info.minSampleShading = 1.0f;
+
+  VkPipelineColorBlendAttachmentState color_blend_attachment{};
+  color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  VkPipelineColorBlendStateCreateInfo color_blend_info{};
+  color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  color_blend_info.attachmentCount = 1;
+  color_blend_info.pAttachments = &color_blend_attachment;
+
+  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+  VkPipelineDynamicStateCreateInfo dynamic_state{};
+  dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic_state.dynamicStateCount = 2;
+  dynamic_state.pDynamicStates = dynamic_states;
+
+  VkGraphicsPipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipeline_info.stageCount = static_cast<uint32_t>(stages.size());
+  pipeline_info.pStages = stages.data();
+  pipeline_info.pVertexInputState = mesh_shading ? nullptr : &vertex_input_info;
+  pipeline_info.pInputAssemblyState = mesh_shading ? nullptr : &input_assembly;
+  pipeline_info.pViewportState = &viewport_state_info;
+  pipeline_info.pRasterizationState = &rasterization_info;
+  pipeline_info.pMultisampleState = &multisampling_info;
+  pipeline_info.pColorBlendState = &color_blend_info;
+  pipeline_info.pDynamicState = &dynamic_state;
+  pipeline_info.layout = pipeline_layout;
+  pipeline_info.renderPass = render_pass;
+  pipeline_info.subpass = 0;
+
+  VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline);
+
+  vkDestroyShaderModule(device, frag_module, nullptr);
+  if (mesh_module != VK_NULL_HANDLE)
+  {
+    vkDestroyShaderModule(device, mesh_module, nullptr);
+  }
+  vkDestroyShaderModule(device, first_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create meshlet graphics pipeline!");
+  }
+}
+
+void MeshletRenderer::createCullPipeline(VertexEncoding encoding)
+{
+  std::vector<uint32_t> cull_code = readSpirv("meshlet_cull.spv");
+  verifyShaderBlock<MeshletFrameData>(reflectSpirv(cull_code), SPIRV_BLOCK_UNIFORM, 0, BINDING_FRAME);
+
+  VkShaderModule cull_module = loadShaderModule(device, cull_code);
+
+  uint32_t vertex_encoding = encoding;
+  VkSpecializationMapEntry specialization_entry{0, 0, sizeof(uint32_t)};
+  VkSpecializationInfo specialization{1, &specialization_entry, sizeof(uint32_t), &vertex_encoding};
+
+  VkComputePipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = cull_module;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.stage.pSpecializationInfo = &specialization;
+  pipeline_info.layout = pipeline_layout;
+
+  VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &cull_pipeline);
+  vkDestroyShaderModule(device, cull_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create meshlet cull pipeline!");
+  }
+}
+
+void MeshletRenderer::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(device, cull_pipeline, nullptr);
+  vkDestroyPipeline(device, graphics_pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+  for (Buffer *buffer : {&frame_buffer, &meshlet_buffer, &bounds_buffer, &meshlet_vertex_buffer, &meshlet_triangle_buffer, &index_buffer, &indirect_buffer})
+  {
+    if (buffer->buffer != VK_NULL_HANDLE)
+    {
+      destroyBuffer(device, *buffer);
+    }
+  }
+
+  *this = MeshletRenderer{};
+}
+
+void MeshletRenderer::cull(VkCommandBuffer command_buffer, const glm::mat4 &model, const glm::mat4 &view_proj, const glm::vec3 &camera_position)
+{
+  Frustum frustum = extractFrustum(view_proj);
+
+  frame_data.model = model;
+  frame_data.view_proj = view_proj;
+  std::copy(frustum.planes, frustum.planes + 6, frame_data.planes);
+  frame_data.camera_position = glm::vec4(camera_position, 1.0f);
+  frame_data.model_scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+  bool mesh_shading = meshlet_path == MESHLET_PATH_MESH_SHADER;
+  VkPipelineStageFlags reader_stages = mesh_shading ? MESH_SHADER_STAGES : COMPUTE_PATH_STAGES;
+
+  // The previous frame may still be reading the frame data and the draw commands
+  VkPipelineStageFlags previous_readers = mesh_shading ? MESH_SHADER_STAGES : COMPUTE_PATH_STAGES | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+  globalBarrier(command_buffer, previous_readers, 0, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+  vkCmdUpdateBuffer(command_buffer, frame_buffer.buffer, 0, sizeof(MeshletFrameData), &frame_data);
+  globalBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, reader_stages, VK_ACCESS_UNIFORM_READ_BIT);
+
+  if (mesh_shading)
+  {
+    // The task shader culls while drawing
+    return;
+  }
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+  vkCmdDispatch(command_buffer, (meshlet_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+  globalBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void MeshletRenderer::draw(VkCommandBuffer command_buffer)
+{
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+
+  if (meshlet_path == MESHLET_PATH_MESH_SHADER)
+  {
+    cmd_draw_mesh_tasks(command_buffer, (meshlet_count + TASK_GROUP_SIZE - 1) / TASK_GROUP_SIZE, 1, 1);
+    return;
+  }
+
+  vkCmdBindIndexBuffer(command_buffer, index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+  // Culled meshlets are zero-instance draws, so the whole command array is submitted
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  for (uint32_t first = 0; first < meshlet_count; first += max_draws_per_call)
+  {
+    uint32_t count = std::min(max_draws_per_call, meshlet_count - first);
+    vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer.buffer, VkDeviceSize(first) * stride, count, stride);
+  }
+}
@@ -0,0 +1,278 @@
+#include "Meshlets.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+  const uint32_t NOT_IN_MESHLET = std::numeric_limits<uint32_t>::max();
+  // Cones wider than this (dot of the widest normal with the axis) are never culled
+  const float MIN_CONE_SPREAD = 0.1f;
+  // Above any dot product, disables the cone test
+  const float NO_CONE_CUTOFF = 2.0f;
+
+  glm::vec3 meshletVertex(const MeshData &mesh, const Meshlet &meshlet, uint32_t local)
+  {
+    return mesh.vertices[mesh.meshlet_vertices[meshlet.vertex_offset + local]].position;
+  }
+
+  void unpackTriangle(uint32_t packed, uint32_t local[3])
+  {
+    local[0] = packed & 0xFF;
+    local[1] = (packed >> 8) & 0xFF;
+    local[2] = (packed >> 16) & 0xFF;
+  }
+}
+
+void buildMeshlets(MeshData &mesh, uint32_t max_vertices, uint32_t max_triangles)
+{
+  mesh.meshlets.clear();
+  mesh.meshlet_bounds.clear();
+  mesh.meshlet_vertices.clear();
+  mesh.meshlet_triangles.clear();
+
+  std::vector<Submesh> submeshes = mesh.submeshes;
+  if (submeshes.empty())
+  {
+    submeshes.push_back({0, static_cast<uint32_t>(mesh.indices.size())});
+  }
+
+  // Local index of each vertex in the meshlet being built
+  std::vector<uint32_t> local_index(mesh.vertices.size(), NOT_IN_MESHLET);
+
+  std::vector<uint32_t> adjacency_offsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<bool> emitted;
+
+  for (const Submesh &submesh : submeshes)
+  {
+    const uint32_t *indices = mesh.indices.data() + submesh.index_offset;
+    uint32_t triangle_count = submesh.index_count / 3;
+
+    // Vertex -> triangle adjacency of the submesh
+    adjacency_offsets.assign(mesh.vertices.size() + 1, 0);
+    for (uint32_t i = 0; i < triangle_count * 3; i++)
+    {
+      adjacency_offsets[indices[i] + 1]++;
+    }
+    for (size_t v = 1; v < adjacency_offsets.size(); v++)
+    {
+      adjacency_offsets[v] += adjacency_offsets[v - 1];
+    }
+    adjacency.resize(triangle_count * 3);
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (uint32_t i = 0; i < triangle_count * 3; i++)
+    {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    emitted.assign(triangle_count, false);
+    uint32_t cursor = 0;
+
+    Meshlet meshlet{static_cast<uint32_t>(mesh.meshlet_vertices.size()), static_cast<uint32_t>(mesh.meshlet_triangles.size()), 0, 0};
+
+    glm::vec3 position_sum(0.0f);
+
+    auto centroid = [&](uint32_t triangle)
+    {
+      return (mesh.vertices[indices[triangle * 3]].position + mesh.vertices[indices[triangle * 3 + 1]].position + mesh.vertices[indices[triangle * 3 + 2]].position) / 3.0f;
+    };
+
+    auto newVertices = [&](uint32_t triangle)
+    {
+      uint32_t count = 0;
+      for (int k = 0; k < 3; k++)
+      {
+        count += local_index[indices[triangle * 3 + k]] == NOT_IN_MESHLET ? 1 : 0;
+      }
+      return count;
+    };
+
+    auto finishMeshlet = [&]()
+    {
+      for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+      {
+        local_index[mesh.meshlet_vertices[meshlet.vertex_offset + i]] = NOT_IN_MESHLET;
+      }
+      mesh.meshlets.push_back(meshlet);
+
+      meshlet.vertex_offset = static_cast<uint32_t>(mesh.meshlet_vertices.size());
+      meshlet.triangle_offset = static_cast<uint32_t>(mesh.meshlet_triangles.size());
+      meshlet.vertex_count = 0;
+      meshlet.triangle_count = 0;
+      position_sum = glm::vec3(0.0f);
+    };
+
+    for (uint32_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+    {
+      // Grow the meshlet through its own vertices, preferring triangles that add
+      // the fewest new vertices and then the ones closest to its center, which
+      // keeps it round and its cone narrow; otherwise continue in index order
+      uint32_t best = NOT_IN_MESHLET;
+      uint32_t best_new_vertices = 4;
+      float best_distance = std::numeric_limits<float>::max();
+      glm::vec3 center = meshlet.triangle_count > 0 ? position_sum / float(meshlet.triangle_count) : glm::vec3(0.0f);
+
+      for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+      {
+        uint32_t vertex = mesh.meshlet_vertices[meshlet.vertex_offset + i];
+        for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; a++)
+        {
+          uint32_t triangle = adjacency[a];
+          if (emitted[triangle])
+          {
+            continue;
+          }
+
+          uint32_t new_vertices = newVertices(triangle);
+          float distance = glm::length(centroid(triangle) - center);
+          if (new_vertices < best_new_vertices || (new_vertices == best_new_vertices && distance < best_distance))
+          {
+            best = triangle;
+            best_new_vertices = new_vertices;
+            best_distance = distance;
+          }
+        }
+      }
+
+      if (best == NOT_IN_MESHLET)
+      {
+        while (emitted[cursor])
+        {
+          cursor++;
+        }
+        best = cursor;
+        best_new_vertices = newVertices(best);
+      }
+
+      if (meshlet.vertex_count + best_new_vertices > max_vertices || meshlet.triangle_count + 1 > max_triangles)
+      {
+        finishMeshlet();
+        emitted_count--;
+        continue;
+      }
+
+      uint32_t local[3];
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t vertex = indices[best * 3 + k];
+        if (local_index[vertex] == NOT_IN_MESHLET)
+        {
+          local_index[vertex] = meshlet.vertex_count++;
+          mesh.meshlet_vertices.push_back(vertex);
+        }
+        local[k] = local_index[vertex];
+      }
+
+      mesh.meshlet_triangles.push_back(packMeshletTriangle(local[0], local[1], local[2]));
+      meshlet.triangle_count++;
+      position_sum += centroid(best);
+      emitted[best] = true;
+    }
+
+    if (meshlet.triangle_count > 0)
+    {
+      finishMeshlet();
+    }
+  }
+
+  mesh.meshlet_bounds.reserve(mesh.meshlets.size());
+  for (const Meshlet &meshlet : mesh.meshlets)
+  {
+    mesh.meshlet_bounds.push_back(computeMeshletBounds(mesh, meshlet));
+  }
+}
+
+MeshletBounds computeMeshletBounds(const MeshData &mesh, const Meshlet &meshlet)
+{
+  MeshletBounds bounds{};
+
+  glm::vec3 min_position(std::numeric_limits<float>::max());
+  glm::vec3 max_position(-std::numeric_limits<float>::max());
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+  {
+    glm::vec3 position = meshletVertex(mesh, meshlet, i);
+    min_position = glm::min(min_position, position);
+    max_position = glm::max(max_position, position);
+  }
+
+  bounds.center = (min_position + max_position) * 0.5f;
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+  {
+    bounds.radius = std::max(bounds.radius, glm::length(meshletVertex(mesh, meshlet, i) - bounds.center));
+  }
+
+  // Cone axis: area weighted average normal; the cutoff covers the widest face normal
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec3> corners;
+  normals.reserve(meshlet.triangle_count);
+  corners.reserve(meshlet.triangle_count);
+  glm::vec3 axis(0.0f);
+
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+  {
+    uint32_t local[3];
+    unpackTriangle(mesh.meshlet_triangles[meshlet.triangle_offset + t], local);
+
+    glm::vec3 p0 = meshletVertex(mesh, meshlet, local[0]);
+    glm::vec3 p1 = meshletVertex(mesh, meshlet, local[1]);
+    glm::vec3 p2 = meshletVertex(mesh, meshlet, local[2]);
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(normal);
+
+    if (length > 0.0f)
+    {
+      axis += normal;
+      normals.push_back(normal / length);
+      corners.push_back(p0);
+    }
+  }
+
+  bounds.cone_apex = bounds.center;
+  bounds.cone_cutoff = NO_CONE_CUTOFF;
+  float axis_length = glm::length(axis);
+
+  if (normals.empty() || axis_length == 0.0f)
+  {
+    return bounds;
+  }
+
+  axis /= axis_length;
+  bounds.cone_axis = axis;
+
+  float min_dot = 1.0f;
+  for (const glm::vec3 &normal : normals)
+  {
+    min_dot = std::min(min_dot, glm::dot(normal, axis));
+  }
+
+  if (min_dot <= MIN_CONE_SPREAD)
+  {
+    return bounds;
+  }
+
+  // Move the apex back along the axis until every triangle plane is in front of it
+  float max_t = 0.0f;
+  for (size_t i = 0; i < normals.size(); i++)
+  {
+    float t = glm::dot(bounds.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+    max_t = std::max(max_t, t);
+  }
+
+  bounds.cone_apex = bounds.center - axis * max_t;
+  bounds.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+
+  return bounds;
+}
+
+bool isMeshletBackfacing(const MeshletBounds &bounds, const glm::vec3 &camera_position)
+{
+  glm::vec3 direction = bounds.cone_apex - camera_position;
+  float distance = glm::length(direction);
+
+  return distance > 0.0f && glm::dot(direction / distance, bounds.cone_axis) >= bounds.cone_cutoff;
+}
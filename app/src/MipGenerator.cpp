@@ -0,0 +1,490 @@
+#include "MipGenerator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t MAX_DISPATCH_LEVELS = 12;
+  const uint32_t TILE_LEVELS = 6;
+  const uint32_t TAIL_SIZE = 64;
+  const uint32_t MAX_DISPATCHES_PER_CHAIN = 3; // 6 + 6 + 12 levels covers 2^24 texels
+
+  struct MipDownsampleConstants
+  {
+    uint32_t source_size[2];
+    uint32_t level_count;
+    uint32_t group_count;
+  };
+
+  uint32_t mipSize(uint32_t size, uint32_t level)
+  {
+    return std::max(size >> level, 1u);
+  }
+
+  VkImageMemoryBarrier levelBarrier(VkImage image, uint32_t base_level, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access)
+  {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, base_level, level_count, 0, 1};
+    return barrier;
+  }
+}
+
+bool isSubgroupQuadSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  auto get_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+
+  if (properties.apiVersion < VK_API_VERSION_1_1 || get_properties2 == nullptr)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceSubgroupProperties subgroup_properties{};
+  subgroup_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+  VkPhysicalDeviceProperties2 properties2{};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &subgroup_properties;
+  get_properties2(physical_device, &properties2);
+
+  // Quads need at least four invocations per subgroup
+  return subgroup_properties.subgroupSize >= 4 && (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 &&
+    (subgroup_properties.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) != 0;
+}
+
+void MipGenerator::init(VkDevice device, VkPhysicalDevice physical_device, bool subgroup_quads, uint32_t max_chains)
+{
+  this->device = device;
+  this->physical_device = physical_device;
+
+  VkPhysicalDeviceFeatures features;
+  vkGetPhysicalDeviceFeatures(physical_device, &features);
+  storage_write_without_format = features.shaderStorageImageWriteWithoutFormat == VK_TRUE;
+
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_NEAREST;
+  sampler_info.minFilter = VK_FILTER_NEAREST;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &nearest_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create mip generator sampler!");
+  }
+
+  VkDeviceSize scratch_size = 16 + TAIL_SIZE * TAIL_SIZE * 16;
+  scratch = createBuffer(device, physical_device, scratch_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  scratch_cleared = false;
+
+  createDescriptors(max_chains);
+
+  if (storage_write_without_format)
+  {
+    createPipelines(subgroup_quads);
+  }
+}
+
+void MipGenerator::createDescriptors(uint32_t max_chains)
+{
+  VkDescriptorSetLayoutBinding bindings[3]{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[1].descriptorCount = MAX_DISPATCH_LEVELS;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[2].binding = 2;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[2].descriptorCount = 1;
+  bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = 3;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create mip generator descriptor set layout!");
+  }
+
+  uint32_t set_count = max_chains * MAX_DISPATCHES_PER_CHAIN;
+
+  VkDescriptorPoolSize pool_sizes[] =
+  {
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set_count},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, set_count * MAX_DISPATCH_LEVELS},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set_count}
+  };
+
+  // Chains come and go with the images they belong to
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+  pool_info.maxSets = set_count;
+  pool_info.poolSizeCount = 3;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create mip generator descriptor pool!");
+  }
+
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push_constant_range.size = sizeof(MipDownsampleConstants);
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create mip generator pipeline layout!");
+  }
+}
+
+void MipGenerator::createPipelines(bool subgroup_quads)
+{
+  VkShaderModule downsample_module = loadShaderModule(device, subgroup_quads ? "mip_downsample_quad.spv" : "mip_downsample.spv");
+
+  for (uint32_t reduction = MIP_REDUCTION_AVERAGE; reduction <= MIP_REDUCTION_MAX; reduction++)
+  {
+    VkSpecializationMapEntry specialization_entry{0, 0, sizeof(uint32_t)};
+    VkSpecializationInfo specialization{1, &specialization_entry, sizeof(uint32_t), &reduction};
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = downsample_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.stage.pSpecializationInfo = &specialization;
+    pipeline_info.layout = pipeline_layout;
+
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipelines[reduction]) != VK_SUCCESS)
+    {
+      vkDestroyShaderModule(device, downsample_module, nullptr);
+      throw std::runtime_error("Failed to create mip downsample pipeline!");
+    }
+  }
+
+  vkDestroyShaderModule(device, downsample_module, nullptr);
+}
+
+void MipGenerator::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  for (MipChainHandle chain = 0; chain < chains.size(); chain++)
+  {
+    if (chains[chain].image != VK_NULL_HANDLE)
+    {
+      removeChain(chain);
+    }
+  }
+
+  for (VkPipeline pipeline : pipelines)
+  {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+  vkDestroySampler(device, nearest_sampler, nullptr);
+  destroyBuffer(device, scratch);
+
+  *this = MipGenerator{};
+}
+
+bool MipGenerator::supportsBlit(VkFormat format) const
+{
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+  VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (properties.optimalTilingFeatures & required) == required;
+}
+
+bool MipGenerator::supportsCompute(VkFormat format) const
+{
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+  VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  return storage_write_without_format && (properties.optimalTilingFeatures & required) == required;
+}
+
+VkImageUsageFlags MipGenerator::requiredUsage(VkFormat format, MipReduction reduction) const
+{
+  if (reduction == MIP_REDUCTION_AVERAGE && supportsBlit(format))
+  {
+    return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
+  if (supportsCompute(format))
+  {
+    return VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  }
+
+  return 0;
+}
+
+MipChainHandle MipGenerator::addChain(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mip_levels, MipReduction reduction)
+{
+  MipChain chain;
+  chain.image = image;
+  chain.extent = extent;
+  chain.mip_levels = mip_levels;
+  chain.reduction = reduction;
+
+  if (reduction == MIP_REDUCTION_AVERAGE && supportsBlit(format))
+  {
+    chain.path = MIP_PATH_BLIT;
+  }
+  else if (supportsCompute(format))
+  {
+    chain.path = MIP_PATH_COMPUTE;
+    planDispatches(chain, format);
+  }
+  else
+  {
+    throw std::runtime_error("Format supports neither blits nor storage images for mip generation!");
+  }
+
+  MipChainHandle handle = static_cast<MipChainHandle>(chains.size());
+  if (!free_chains.empty())
+  {
+    handle = free_chains.back();
+    free_chains.pop_back();
+    chains[handle] = std::move(chain);
+  }
+  else
+  {
+    chains.push_back(std::move(chain));
+  }
+
+  return handle;
+}
+
+/*
+* A dispatch writes up to twelve levels when its sixth level fits the 64x64
+  scratch tail, otherwise six; the next dispatch starts where it stopped.
+*/
+void MipGenerator::planDispatches(MipChain &chain, VkFormat format)
+{
+  for (uint32_t level = 0; level < chain.mip_levels; level++)
+  {
+    chain.mip_views.push_back(createImageView(device, chain.image, format, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+  }
+
+  uint32_t base_level = 0;
+  while (base_level + 1 < chain.mip_levels)
+  {
+    uint32_t width = mipSize(chain.extent.width, base_level);
+    uint32_t height = mipSize(chain.extent.height, base_level);
+    bool tail_fits = mipSize(width, TILE_LEVELS) <= TAIL_SIZE && mipSize(height, TILE_LEVELS) <= TAIL_SIZE;
+
+    MipDispatch dispatch{};
+    dispatch.base_level = base_level;
+    dispatch.level_count = std::min(chain.mip_levels - 1 - base_level, tail_fits ? MAX_DISPATCH_LEVELS : TILE_LEVELS);
+
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = descriptor_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &descriptor_set_layout;
+
+    if (vkAllocateDescriptorSets(device, &alloc_info, &dispatch.descriptor_set) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to allocate mip generator descriptor set!");
+    }
+
+    VkDescriptorImageInfo source_info{};
+    source_info.sampler = nearest_sampler;
+    source_info.imageView = chain.mip_views[base_level];
+    source_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    // Slots past the chain repeat its last level, the shader never writes them
+    VkDescriptorImageInfo level_infos[MAX_DISPATCH_LEVELS]{};
+    for (uint32_t i = 0; i < MAX_DISPATCH_LEVELS; i++)
+    {
+      level_infos[i].imageView = chain.mip_views[base_level + 1 + std::min(i, dispatch.level_count - 1)];
+      level_infos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo scratch_info{scratch.buffer, 0, scratch.size};
+
+    VkWriteDescriptorSet writes[3]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = dispatch.descriptor_set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &source_info;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = dispatch.descriptor_set;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = MAX_DISPATCH_LEVELS;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = level_infos;
+    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[2].dstSet = dispatch.descriptor_set;
+    writes[2].dstBinding = 2;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &scratch_info;
+
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+
+    chain.dispatches.push_back(dispatch);
+    base_level += dispatch.level_count;
+  }
+}
+
+void MipGenerator::removeChain(MipChainHandle handle)
+{
+  MipChain &chain = chains[handle];
+
+  for (const MipDispatch &dispatch : chain.dispatches)
+  {
+    vkFreeDescriptorSets(device, descriptor_pool, 1, &dispatch.descriptor_set);
+  }
+
+  for (VkImageView mip_view : chain.mip_views)
+  {
+    vkDestroyImageView(device, mip_view, nullptr);
+  }
+
+  chain = MipChain{};
+  free_chains.push_back(handle);
+}
+
+void MipGenerator::generate(VkCommandBuffer command_buffer, MipChainHandle handle, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout)
+{
+  const MipChain &chain = chains[handle];
+
+  if (chain.path == MIP_PATH_BLIT)
+  {
+    generateBlit(command_buffer, chain, base_layout, base_stages, base_access, final_layout);
+  }
+  else
+  {
+    generateCompute(command_buffer, chain, base_layout, base_stages, base_access, final_layout);
+  }
+}
+
+void MipGenerator::generateBlit(VkCommandBuffer command_buffer, const MipChain &chain, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout)
+{
+  // The lower levels may still be read by the previous use of the image
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.push_back(levelBarrier(chain.image, 0, 1, base_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, base_access, VK_ACCESS_TRANSFER_READ_BIT));
+  if (chain.mip_levels > 1)
+  {
+    barriers.push_back(levelBarrier(chain.image, 1, chain.mip_levels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+  }
+
+  vkCmdPipelineBarrier(command_buffer, base_stages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  for (uint32_t level = 1; level < chain.mip_levels; level++)
+  {
+    VkImageBlit blit{};
+    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+    blit.srcOffsets[1] = {static_cast<int32_t>(mipSize(chain.extent.width, level - 1)), static_cast<int32_t>(mipSize(chain.extent.height, level - 1)), 1};
+    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+    blit.dstOffsets[1] = {static_cast<int32_t>(mipSize(chain.extent.width, level)), static_cast<int32_t>(mipSize(chain.extent.height, level)), 1};
+
+    vkCmdBlitImage(command_buffer, chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, chain.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+    // The next blit reads this level
+    VkImageMemoryBarrier barrier = levelBarrier(chain.image, level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+
+  VkImageMemoryBarrier barrier = levelBarrier(chain.image, 0, chain.mip_levels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, final_layout, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void MipGenerator::generateCompute(VkCommandBuffer command_buffer, const MipChain &chain, VkImageLayout base_layout, VkPipelineStageFlags base_stages, VkAccessFlags base_access, VkImageLayout final_layout)
+{
+  // The last group of each dispatch resets the counter, it only starts out undefined
+  if (!scratch_cleared)
+  {
+    vkCmdFillBuffer(command_buffer, scratch.buffer, 0, 4, 0);
+
+    VkMemoryBarrier clear_barrier{};
+    clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+    scratch_cleared = true;
+  }
+
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.push_back(levelBarrier(chain.image, 0, 1, base_layout, VK_IMAGE_LAYOUT_GENERAL, base_access, VK_ACCESS_SHADER_READ_BIT));
+  if (chain.mip_levels > 1)
+  {
+    barriers.push_back(levelBarrier(chain.image, 1, chain.mip_levels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+  }
+
+  vkCmdPipelineBarrier(command_buffer, base_stages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[chain.reduction]);
+
+  for (const MipDispatch &dispatch : chain.dispatches)
+  {
+    uint32_t width = mipSize(chain.extent.width, dispatch.base_level);
+    uint32_t height = mipSize(chain.extent.height, dispatch.base_level);
+
+    // A group covers 64x64 source texels, 32x32 of the first level it writes
+    uint32_t groups_x = (mipSize(width, 1) + 31) / 32;
+    uint32_t groups_y = (mipSize(height, 1) + 31) / 32;
+
+    MipDownsampleConstants constants{};
+    constants.source_size[0] = width;
+    constants.source_size[1] = height;
+    constants.level_count = dispatch.level_count;
+    constants.group_count = groups_x * groups_y;
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &dispatch.descriptor_set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(command_buffer, groups_x, groups_y, 1);
+
+    // The next dispatch reads the last level written and reuses the scratch buffer
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
+  VkImageMemoryBarrier barrier = levelBarrier(chain.image, 0, chain.mip_levels, VK_IMAGE_LAYOUT_GENERAL, final_layout, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,142 @@
+#include "SoftwareOcclusion.hpp"
+#include "FrustumCulling.hpp"
+#include "JobSystem.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+#include <cstdlib>
+
+/**
+ * Street level view of a city block grid: frustum culling alone against
+ * frustum plus software occlusion culling, on one thread and on the job
+ * system, with the scalar and AVX2 rasterizers.
+ */
+double timeMs(const std::function<void()> &fn, int iterations)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+
+  for (int i = 0; i < iterations; i++)
+  {
+    fn();
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+OccluderMesh unitBox()
+{
+  OccluderMesh box;
+  for (int i = 0; i < 8; i++)
+  {
+    box.positions.push_back(glm::vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 0.5f : -0.5f));
+  }
+  box.indices = {4, 6, 2, 4, 2, 0, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4, 6, 7, 3, 6, 3, 2, 2, 3, 1, 2, 1, 0, 4, 5, 7, 4, 7, 6};
+  return box;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t object_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  const int ITERATIONS = 20;
+  const int BLOCKS = 24;
+  const float BLOCK_SIZE = 40.0f;
+  const float STREET_WIDTH = 12.0f;
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> height(15.0f, 80.0f);
+
+  // Buildings are the occluders
+  OccluderMesh box = unitBox();
+  std::vector<Occluder> occluders;
+  float city_size = BLOCKS * (BLOCK_SIZE + STREET_WIDTH);
+
+  for (int z = 0; z < BLOCKS; z++)
+  {
+    for (int x = 0; x < BLOCKS; x++)
+    {
+      glm::vec3 position(x * (BLOCK_SIZE + STREET_WIDTH) - city_size * 0.5f, 0.0f, z * (BLOCK_SIZE + STREET_WIDTH) - city_size * 0.5f);
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(BLOCK_SIZE, height(rng), BLOCK_SIZE));
+      occluders.push_back({&box, model});
+    }
+  }
+
+  // Props and detail meshes spread over the streets and roofs
+  std::uniform_real_distribution<float> coordinate(-city_size * 0.5f, city_size * 0.5f);
+  std::uniform_real_distribution<float> elevation(0.0f, 30.0f);
+  std::uniform_real_distribution<float> size(0.3f, 3.0f);
+
+  CullingBounds bounds;
+  for (size_t i = 0; i < object_count; i++)
+  {
+    bounds.add(glm::vec3(coordinate(rng), elevation(rng), coordinate(rng)), size(rng));
+  }
+
+  // Looking down a street from the middle of the city
+  glm::vec3 eye((BLOCK_SIZE + STREET_WIDTH) * 0.5f, 2.0f, 0.0f);
+  glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 2000.0f);
+  glm::mat4 view = glm::lookAtRH(eye, eye + glm::vec3(0.1f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 view_proj = proj * view;
+  Frustum frustum = extractFrustum(view_proj);
+
+  JobSystem jobs;
+  SoftwareOcclusion occlusion(256, 128);
+
+  std::vector<uint32_t> frustum_visible, scalar_visible, avx_visible;
+
+  double frustum_ms = timeMs([&]() { cullSpheres(frustum, bounds, frustum_visible); }, ITERATIONS);
+
+  occlusion.setPath(OCCLUSION_PATH_SCALAR);
+  double scalar_raster_ms = timeMs([&]() { occlusion.render(occluders, view_proj); }, ITERATIONS);
+  double scalar_test_ms = timeMs([&]() { occlusion.cullSpheres(bounds, frustum_visible, scalar_visible); }, ITERATIONS);
+  std::vector<float> scalar_depth;
+  for (uint32_t y = 0; y < occlusion.height(); y++)
+  {
+    for (uint32_t x = 0; x < occlusion.width(); x++)
+    {
+      scalar_depth.push_back(occlusion.depth(x, y));
+    }
+  }
+
+  occlusion.setPath(OCCLUSION_PATH_AVX2);
+  double avx_raster_ms = timeMs([&]() { occlusion.render(occluders, view_proj); }, ITERATIONS);
+  double avx_test_ms = timeMs([&]() { occlusion.cullSpheres(bounds, frustum_visible, avx_visible); }, ITERATIONS);
+  double jobs_raster_ms = timeMs([&]() { occlusion.render(occluders, view_proj, &jobs); }, ITERATIONS);
+  double jobs_test_ms = timeMs([&]() { occlusion.cullSpheres(bounds, frustum_visible, avx_visible, &jobs); }, ITERATIONS);
+
+  size_t depth_mismatches = 0;
+  for (uint32_t y = 0; y < occlusion.height(); y++)
+  {
+    for (uint32_t x = 0; x < occlusion.width(); x++)
+    {
+      depth_mismatches += occlusion.depth(x, y) != scalar_depth[y * occlusion.width() + x] ? 1 : 0;
+    }
+  }
+
+  std::cout << object_count << " objects, " << occluders.size() << " occluders (" << occlusion.triangleCount() << " triangles after clipping), "
+    << occlusion.width() << "x" << occlusion.height() << " depth, " << jobs.workerCount() + 1 << " threads" << std::endl;
+  std::cout << "draws after frustum culling:   " << frustum_visible.size() << " (" << frustum_ms << " ms)" << std::endl;
+  std::cout << "draws after occlusion culling: " << avx_visible.size() << " (" << 100.0 * (1.0 - double(avx_visible.size()) / frustum_visible.size()) << "% fewer)" << std::endl;
+  std::cout << "scalar:      rasterize " << scalar_raster_ms << " ms, test " << scalar_test_ms << " ms" << std::endl;
+  std::cout << "avx2:        rasterize " << avx_raster_ms << " ms, test " << avx_test_ms << " ms" << std::endl;
+  std::cout << "avx2 + jobs: rasterize " << jobs_raster_ms << " ms, test " << jobs_test_ms << " ms" << std::endl;
+
+  if (occlusion.path() != OCCLUSION_PATH_AVX2)
+  {
+    std::cout << "(AVX2 not compiled in, both rows ran the scalar path)" << std::endl;
+  }
+
+  if (depth_mismatches != 0 || avx_visible != scalar_visible)
+  {
+    std::cerr << "AVX2 results do not match the scalar path!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
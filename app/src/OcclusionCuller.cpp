@@ -0,0 +1,318 @@
+#include "OcclusionCuller.hpp"
+#include "FrustumCulling.hpp"
+#include "SpirvReflection.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t CULL_GROUP_SIZE = 64;
+
+  enum CullBinding : uint32_t
+  {
+    BINDING_FRAME = 0,
+    BINDING_OBJECTS = 1,
+    BINDING_VISIBILITY = 2,
+    BINDING_DRAW_COMMANDS = 3,
+    BINDING_STATS = 4,
+    BINDING_HIZ = 5,
+    BINDING_COUNT = 6
+  };
+
+  void globalBarrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+  {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+
+    vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+}
+
+void OcclusionCuller::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const std::vector<CullObject> &objects, uint32_t frames_in_flight)
+{
+  if (objects.empty())
+  {
+    throw std::runtime_error("Nothing to cull!");
+  }
+
+  VkPhysicalDeviceFeatures features;
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceFeatures(physical_device, &features);
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  if (!features.drawIndirectFirstInstance)
+  {
+    throw std::runtime_error("Occlusion culling needs drawIndirectFirstInstance!");
+  }
+
+  this->device = device;
+  object_count = static_cast<uint32_t>(objects.size());
+  max_draws_per_call = features.multiDrawIndirect ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+
+  const VkMemoryPropertyFlags device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  uniforms.init(device, physical_device, sizeof(CullFrameData), frames_in_flight);
+  object_buffer = createBuffer(device, physical_device, object_count * sizeof(CullObject), storage, device_local);
+  visibility_buffer = createBuffer(device, physical_device, object_count * sizeof(uint32_t), storage, device_local);
+  draw_buffer = createBuffer(device, physical_device, 2 * object_count * sizeof(VkDrawIndexedIndirectCommand), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, device_local);
+  stats_buffer = createBuffer(device, physical_device, sizeof(OcclusionStats), storage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, device_local);
+  readback_buffer = createBuffer(device, physical_device, frames_in_flight * sizeof(OcclusionStats), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  std::fill_n(static_cast<OcclusionStats*>(readback_buffer.mapped), frames_in_flight, OcclusionStats{});
+
+  uploader.uploadBuffer(object_buffer.buffer, 0, objects.data(), object_buffer.size);
+
+  // Nothing was visible before the first frame, its second phase draws everything in view
+  std::vector<uint32_t> visibility(object_count, 0);
+  uploader.uploadBuffer(visibility_buffer.buffer, 0, visibility.data(), visibility_buffer.size);
+
+  frame_data.object_count = object_count;
+
+  createDescriptors();
+  createPipeline();
+}
+
+void OcclusionCuller::createDescriptors()
+{
+  VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+  for (uint32_t i = 0; i < BINDING_COUNT; i++)
+  {
+    bindings[i].binding = i;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  }
+  bindings[BINDING_FRAME].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  bindings[BINDING_HIZ].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = BINDING_COUNT;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create occlusion descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize pool_sizes[] =
+  {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}
+  };
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 3;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create occlusion descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &descriptor_set_layout;
+
+  if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate occlusion descriptor set!");
+  }
+
+  // The Hi-Z binding is written by setHiZ; the frame data moves through the ring by dynamic offset
+  VkDescriptorBufferInfo buffer_infos[] =
+  {
+    {uniforms.ringBuffer(), 0, sizeof(CullFrameData)},
+    {object_buffer.buffer, 0, VK_WHOLE_SIZE},
+    {visibility_buffer.buffer, 0, VK_WHOLE_SIZE},
+    {draw_buffer.buffer, 0, VK_WHOLE_SIZE},
+    {stats_buffer.buffer, 0, VK_WHOLE_SIZE}
+  };
+
+  VkWriteDescriptorSet writes[BINDING_HIZ]{};
+  for (uint32_t i = 0; i < BINDING_HIZ; i++)
+  {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptor_set;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = bindings[i].descriptorType;
+    writes[i].pBufferInfo = &buffer_infos[i];
+  }
+
+  vkUpdateDescriptorSets(device, BINDING_HIZ, writes, 0, nullptr);
+}
+
+void OcclusionCuller::createPipeline()
+{
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push_constant_range.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create occlusion pipeline layout!");
+  }
+
+  std::vector<uint32_t> cull_code = readSpirv("occlusion_cull.spv");
+  verifyShaderBlock<CullFrameData>(reflectSpirv(cull_code), SPIRV_BLOCK_UNIFORM, 0, BINDING_FRAME);
+
+  VkShaderModule cull_module = loadShaderModule(device, cull_code);
+
+  VkComputePipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = cull_module;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.layout = pipeline_layout;
+
+  VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+  vkDestroyShaderModule(device, cull_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create occlusion pipeline!");
+  }
+}
+
+void OcclusionCuller::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+  uniforms.cleanup();
+
+  for (Buffer *buffer : {&object_buffer, &visibility_buffer, &draw_buffer, &stats_buffer, &readback_buffer})
+  {
+    destroyBuffer(device, *buffer);
+  }
+
+  *this = OcclusionCuller{};
+}
+
+void OcclusionCuller::setHiZ(const HiZPyramid &hiz)
+{
+  frame_data.hiz_mip_count = hiz.mipCount();
+  frame_data.hiz_size = glm::vec2(static_cast<float>(hiz.width()), static_cast<float>(hiz.height()));
+
+  VkDescriptorImageInfo image_info{};
+  image_info.sampler = hiz.sampler();
+  image_info.imageView = hiz.view();
+  image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = descriptor_set;
+  write.dstBinding = BINDING_HIZ;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.pImageInfo = &image_info;
+
+  vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void OcclusionCuller::dispatch(VkCommandBuffer command_buffer, CullPhase phase)
+{
+  uint32_t phase_index = phase;
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 1, &frame_offset);
+  vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase_index);
+  vkCmdDispatch(command_buffer, (object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void OcclusionCuller::cullFirstPhase(VkCommandBuffer command_buffer, const glm::mat4 &view_proj, uint32_t frame)
+{
+  Frustum frustum = extractFrustum(view_proj);
+
+  frame_data.view_proj = view_proj;
+  std::copy(frustum.planes, frustum.planes + 6, frame_data.planes);
+
+  // Host writes before the submit need no barrier
+  uniforms.beginFrame(frame);
+  frame_offset = uniforms.write(frame_data).offset;
+
+  // The previous frame still reads the draw commands, and wrote the visibility
+  globalBarrier(command_buffer,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  vkCmdFillBuffer(command_buffer, stats_buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+  globalBarrier(command_buffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  dispatch(command_buffer, CULL_PHASE_FIRST);
+
+  globalBarrier(command_buffer,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void OcclusionCuller::cullSecondPhase(VkCommandBuffer command_buffer, uint32_t frame)
+{
+  dispatch(command_buffer, CULL_PHASE_SECOND);
+
+  globalBarrier(command_buffer,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+  VkBufferCopy copy_region{0, frame * sizeof(OcclusionStats), sizeof(OcclusionStats)};
+  vkCmdCopyBuffer(command_buffer, stats_buffer.buffer, readback_buffer.buffer, 1, &copy_region);
+
+  globalBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+void OcclusionCuller::draw(VkCommandBuffer command_buffer, CullPhase phase)
+{
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize phase_offset = VkDeviceSize(phase) * object_count * stride;
+
+  for (uint32_t first = 0; first < object_count; first += max_draws_per_call)
+  {
+    uint32_t count = std::min(max_draws_per_call, object_count - first);
+    vkCmdDrawIndexedIndirect(command_buffer, draw_buffer.buffer, phase_offset + VkDeviceSize(first) * stride, count, stride);
+  }
+}
+
+DrawPacket OcclusionCuller::drawPacket(const DrawPacket &state, CullPhase phase, uint32_t call) const
+{
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  uint32_t first = call * max_draws_per_call;
+
+  DrawPacket packet = state;
+  packet.indirect_buffer = draw_buffer.buffer;
+  packet.indirect_offset = (VkDeviceSize(phase) * object_count + first) * stride;
+  packet.draw_count = std::min(max_draws_per_call, object_count - first);
+  return packet;
+}
+
+OcclusionStats OcclusionCuller::stats(uint32_t frame) const
+{
+  return static_cast<const OcclusionStats*>(readback_buffer.mapped)[frame];
+}
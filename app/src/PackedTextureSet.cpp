@@ -0,0 +1,62 @@
+#include "PackedTextureSet.hpp"
+
+void PackedTextureSet::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, const std::vector<TexturePackInput> &textures, const TexturePackSettings &settings)
+{
+  this->device = device;
+  this->uploader = &uploader;
+
+  packed = packTextures(textures, settings);
+  images.reserve(packed.bindGroupCount());
+
+  const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  auto format = [](bool srgb) { return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM; };
+
+  for (AtlasPage &page : packed.pages)
+  {
+    images.push_back(createImage(device, physical_device, page.image.width, page.image.height, page.mip_count, format(page.srgb), usage, VK_IMAGE_ASPECT_COLOR_BIT));
+    uploadChain(images.back(), page.image, 0);
+    page.image = ImageData{};
+  }
+
+  for (const TextureArrayGroup &group : packed.arrays)
+  {
+    uint32_t layer_count = static_cast<uint32_t>(group.textures.size());
+    images.push_back(createImageArray(device, physical_device, group.width, group.height, mipLevelCount(group.width, group.height), layer_count, format(group.srgb), usage, VK_IMAGE_ASPECT_COLOR_BIT));
+
+    for (uint32_t layer = 0; layer < layer_count; layer++)
+    {
+      uploadChain(images.back(), *textures[group.textures[layer]].image, layer);
+    }
+  }
+
+  for (uint32_t texture : packed.standalone)
+  {
+    const ImageData &image = *textures[texture].image;
+    images.push_back(createImage(device, physical_device, image.width, image.height, mipLevelCount(image.width, image.height), format(textures[texture].srgb), usage, VK_IMAGE_ASPECT_COLOR_BIT));
+    uploadChain(images.back(), image, 0);
+  }
+
+  uploader.flush();
+}
+
+void PackedTextureSet::cleanup()
+{
+  for (Image &image : images)
+  {
+    destroyImage(device, image);
+  }
+
+  *this = PackedTextureSet{};
+}
+
+void PackedTextureSet::uploadChain(const Image &image, const ImageData &base, uint32_t layer)
+{
+  uploader->uploadImage(image.image, 0, base.width, base.height, 4, base.pixels.data(), 1, layer);
+
+  ImageData level = base;
+  for (uint32_t mip = 1; mip < image.mip_levels; mip++)
+  {
+    level = downsampleImage(level);
+    uploader->uploadImage(image.image, mip, level.width, level.height, 4, level.pixels.data(), 1, layer);
+  }
+}
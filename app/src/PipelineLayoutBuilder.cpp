@@ -0,0 +1,170 @@
+#include "PipelineLayoutBuilder.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+bool isPushDescriptorSupported(VkPhysicalDevice physical_device)
+{
+  uint32_t extension_count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+
+  return std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties &extension)
+  {
+    return std::strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0;
+  });
+}
+
+void destroyPipelineLayout(VkDevice device, PipelineLayout &layout)
+{
+  vkDestroyPipelineLayout(device, layout.layout, nullptr);
+  vkDestroyDescriptorSetLayout(device, layout.push_set_layout, nullptr);
+  layout = PipelineLayout{};
+}
+
+void pushDescriptors(VkCommandBuffer command_buffer, const PipelineLayout &layout, VkPipelineBindPoint bind_point, const DescriptorWrite *writes, uint32_t write_count)
+{
+  if (!layout.push_descriptors)
+  {
+    throw std::runtime_error("Pipeline layout has no push descriptor set!");
+  }
+
+  pushDescriptors(command_buffer, layout.push_descriptor_set, bind_point, layout.layout, layout.push_set, writes, write_count);
+}
+
+void pushDescriptors(VkCommandBuffer command_buffer, PFN_vkCmdPushDescriptorSetKHR push_descriptor_set, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set,
+  const DescriptorWrite *writes, uint32_t write_count)
+{
+  if (write_count > PUSH_DESCRIPTOR_GUARANTEED_COUNT)
+  {
+    throw std::runtime_error("Too many push descriptors!");
+  }
+
+  // The builder caps the set at the guaranteed count, so the writes fit on the stack
+  VkWriteDescriptorSet set_writes[PUSH_DESCRIPTOR_GUARANTEED_COUNT];
+  VkDescriptorBufferInfo buffer_infos[PUSH_DESCRIPTOR_GUARANTEED_COUNT];
+  VkDescriptorImageInfo image_infos[PUSH_DESCRIPTOR_GUARANTEED_COUNT];
+
+  for (uint32_t i = 0; i < write_count; i++)
+  {
+    set_writes[i] = descriptorSetWrite(VK_NULL_HANDLE, writes[i], buffer_infos[i], image_infos[i]);
+  }
+
+  push_descriptor_set(command_buffer, bind_point, layout, set, write_count, set_writes);
+}
+
+PipelineLayoutBuilder &PipelineLayoutBuilder::setLayout(VkDescriptorSetLayout layout)
+{
+  set_layouts.push_back(layout);
+  return *this;
+}
+
+PipelineLayoutBuilder &PipelineLayoutBuilder::pushConstants(VkShaderStageFlags stages, uint32_t offset, uint32_t size)
+{
+  if (size == 0 || offset % 4 != 0 || size % 4 != 0)
+  {
+    throw std::runtime_error("Push constant ranges must be non-empty multiples of 4 bytes!");
+  }
+
+  // Larger ranges work on most desktop GPUs, which is how they end up failing on the rest
+  if (offset + size > PUSH_CONSTANT_GUARANTEED_SIZE)
+  {
+    throw std::runtime_error("Push constant range exceeds the guaranteed 128 bytes!");
+  }
+
+  for (const VkPushConstantRange &range : ranges)
+  {
+    if (range.stageFlags & stages)
+    {
+      throw std::runtime_error("Shader stage is in two push constant ranges!");
+    }
+  }
+
+  ranges.push_back({stages, offset, size});
+  return *this;
+}
+
+PipelineLayoutBuilder &PipelineLayoutBuilder::pushDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count)
+{
+  if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+  {
+    throw std::runtime_error("Push descriptor sets cannot hold dynamic buffers!");
+  }
+
+  bool duplicate = std::any_of(push_bindings.begin(), push_bindings.end(), [binding](const VkDescriptorSetLayoutBinding &existing)
+  {
+    return existing.binding == binding;
+  });
+
+  if (duplicate)
+  {
+    throw std::runtime_error("Push descriptor binding added twice!");
+  }
+
+  if (push_descriptor_count + count > PUSH_DESCRIPTOR_GUARANTEED_COUNT)
+  {
+    throw std::runtime_error("Push descriptor set exceeds the guaranteed 32 descriptors!");
+  }
+
+  VkDescriptorSetLayoutBinding layout_binding{};
+  layout_binding.binding = binding;
+  layout_binding.descriptorType = type;
+  layout_binding.descriptorCount = count;
+  layout_binding.stageFlags = stages;
+
+  push_bindings.push_back(layout_binding);
+  push_descriptor_count += count;
+  return *this;
+}
+
+PipelineLayout PipelineLayoutBuilder::build(VkDevice device, bool push_descriptors) const
+{
+  PipelineLayout layout;
+  std::vector<VkDescriptorSetLayout> layouts = set_layouts;
+
+  if (!push_bindings.empty())
+  {
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.flags = push_descriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+    set_layout_info.bindingCount = static_cast<uint32_t>(push_bindings.size());
+    set_layout_info.pBindings = push_bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &layout.push_set_layout) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create per-draw descriptor set layout!");
+    }
+
+    if (push_descriptors)
+    {
+      layout.push_descriptor_set = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR"));
+
+      if (layout.push_descriptor_set == nullptr)
+      {
+        vkDestroyDescriptorSetLayout(device, layout.push_set_layout, nullptr);
+        throw std::runtime_error("Failed to load vkCmdPushDescriptorSetKHR!");
+      }
+    }
+
+    layout.push_set = static_cast<uint32_t>(layouts.size());
+    layout.push_descriptors = push_descriptors;
+    layouts.push_back(layout.push_set_layout);
+  }
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(layouts.size());
+  pipeline_layout_info.pSetLayouts = layouts.data();
+  pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(ranges.size());
+  pipeline_layout_info.pPushConstantRanges = ranges.data();
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &layout.layout) != VK_SUCCESS)
+  {
+    vkDestroyDescriptorSetLayout(device, layout.push_set_layout, nullptr);
+    throw std::runtime_error("Failed to create pipeline layout!");
+  }
+
+  return layout;
+}
@@ -0,0 +1,515 @@
+#include "PointRasterizer.hpp"
+#include "StagingUploader.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+/**
+ * Headless point throughput: the same cloud drawn as VK_PRIMITIVE_TOPOLOGY_POINT_LIST
+ * and by PointRasterizer, both into an offscreen 1920x1080 target, timed with
+ * GPU timestamps. Needs the .spv files in the working directory.
+ */
+namespace
+{
+  const uint32_t WIDTH = 1920;
+  const uint32_t HEIGHT = 1080;
+  const int ITERATIONS = 10;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    float timestamp_period = 1.0f;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Point Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    for (VkPhysicalDevice device : devices)
+    {
+      if (!isPointRasterizerSupported(context.instance, device))
+      {
+        continue;
+      }
+
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      for (uint32_t i = 0; i < family_count; i++)
+      {
+        bool graphics_compute = (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT);
+        if (graphics_compute && families[i].timestampValidBits > 0)
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+          break;
+        }
+      }
+
+      if (context.physical_device != VK_NULL_HANDLE)
+      {
+        break;
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with 64-bit buffer atomics and timestamps!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    context.timestamp_period = properties.limits.timestampPeriod;
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceShaderAtomicInt64Features atomic_features{};
+    atomic_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
+    atomic_features.shaderBufferInt64Atomics = VK_TRUE;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &atomic_features;
+    features.features.shaderInt64 = VK_TRUE;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &features;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  VkRenderPass createRenderPass(VkDevice device, VkFormat depth_format)
+  {
+    VkAttachmentDescription attachments[2]{};
+    attachments[0].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachments[1].format = depth_format;
+    attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depth_reference{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+    subpass.pDepthStencilAttachment = &depth_reference;
+
+    // Iterations run back to back on the same attachments
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 2;
+    render_pass_info.pAttachments = attachments;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    VkRenderPass render_pass;
+    if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create render pass!");
+    }
+
+    return render_pass;
+  }
+
+  VkPipeline createPointListPipeline(VkDevice device, VkRenderPass render_pass, VkPipelineLayout pipeline_layout)
+  {
+    VkShaderModule vert_module = loadShaderModule(device, "point_list_vert.spv");
+    VkShaderModule frag_module = loadShaderModule(device, "frag.spv");
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vert_module;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = frag_module;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_info = VertexInput<PointVertex>::createInfo();
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+
+    VkViewport viewport{0.0f, 0.0f, float(WIDTH), float(HEIGHT), 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+
+    VkPipelineViewportStateCreateInfo viewport_state_info{};
+    viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_info.viewportCount = 1;
+    viewport_state_info.pViewports = &viewport;
+    viewport_state_info.scissorCount = 1;
+    viewport_state_info.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_info{};
+    rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_info.lineWidth = 1.0f;
+    rasterization_info.cullMode = VK_CULL_MODE_NONE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling_info{};
+    multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling_info.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+    depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_info.depthTestEnable = VK_TRUE;
+    depth_stencil_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment{};
+    color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_info{};
+    color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_info.attachmentCount = 1;
+    color_blend_info.pAttachments = &color_blend_attachment;
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = stages;
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state_info;
+    pipeline_info.pRasterizationState = &rasterization_info;
+    pipeline_info.pMultisampleState = &multisampling_info;
+    pipeline_info.pDepthStencilState = &depth_stencil_info;
+    pipeline_info.pColorBlendState = &color_blend_info;
+    pipeline_info.layout = pipeline_layout;
+    pipeline_info.renderPass = render_pass;
+    pipeline_info.subpass = 0;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, frag_module, nullptr);
+    vkDestroyShaderModule(device, vert_module, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create point list pipeline!");
+    }
+
+    return pipeline;
+  }
+
+  /**
+   * Scanned-terrain-like cloud: a noisy height field seen from above at an angle,
+   * so most points land on screen and many share a pixel
+   */
+  std::vector<PointVertex> generatePoints(size_t count)
+  {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+
+    std::vector<PointVertex> points(count);
+    for (PointVertex &point : points)
+    {
+      float x = coordinate(rng);
+      float z = coordinate(rng);
+      float height = 4.0f * std::sin(x * 0.1f) * std::cos(z * 0.13f) + noise(rng);
+
+      uint32_t shade = static_cast<uint32_t>(std::clamp((height + 4.0f) / 8.0f, 0.0f, 1.0f) * 255.0f);
+      point.position = glm::vec3(x, height, z);
+      point.color = (255u - shade) | (shade << 8) | (128u << 16) | (255u << 24);
+    }
+
+    return points;
+  }
+
+  /**
+   * Records with `record`, submits, waits, and returns the GPU time between
+   * consecutive timestamps in milliseconds
+   */
+  template <typename Record>
+  std::vector<double> timeCommands(const HeadlessContext &context, VkCommandBuffer command_buffer, VkQueryPool query_pool, uint32_t query_count, Record record)
+  {
+    std::vector<double> totals(query_count - 1, 0.0);
+
+    for (int iteration = -1; iteration < ITERATIONS; iteration++)
+    {
+      vkResetCommandBuffer(command_buffer, 0);
+
+      VkCommandBufferBeginInfo begin_info{};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vkBeginCommandBuffer(command_buffer, &begin_info);
+      vkCmdResetQueryPool(command_buffer, query_pool, 0, query_count);
+      record(command_buffer);
+      vkEndCommandBuffer(command_buffer);
+
+      VkSubmitInfo submit_info{};
+      submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submit_info.commandBufferCount = 1;
+      submit_info.pCommandBuffers = &command_buffer;
+
+      if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to submit benchmark commands!");
+      }
+      vkQueueWaitIdle(context.queue);
+
+      std::vector<uint64_t> timestamps(query_count);
+      vkGetQueryPoolResults(context.device, query_pool, 0, query_count, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+      // The first run warms up caches and clocks
+      if (iteration < 0)
+      {
+        continue;
+      }
+
+      for (uint32_t i = 0; i + 1 < query_count; i++)
+      {
+        totals[i] += double(timestamps[i + 1] - timestamps[i]) * context.timestamp_period * 1e-6;
+      }
+    }
+
+    for (double &total : totals)
+    {
+      total /= ITERATIONS;
+    }
+
+    return totals;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  size_t point_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000000;
+
+  try
+  {
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    std::vector<PointVertex> points = generatePoints(point_count);
+
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    Buffer point_buffer = createBuffer(device, context.physical_device, points.size() * sizeof(PointVertex),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uploader.uploadBuffer(point_buffer.buffer, 0, points.data(), point_buffer.size);
+    uploader.flush();
+
+    VkFormat depth_format = findDepthFormat(context.physical_device);
+    Image color = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+    Image depth = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+    VkRenderPass render_pass = createRenderPass(device, depth_format);
+
+    VkImageView attachments[2] = {color.view, depth.view};
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = render_pass;
+    framebuffer_info.attachmentCount = 2;
+    framebuffer_info.pAttachments = attachments;
+    framebuffer_info.width = WIDTH;
+    framebuffer_info.height = HEIGHT;
+    framebuffer_info.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create framebuffer!");
+    }
+
+    VkPushConstantRange camera_range{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4)};
+    VkPipelineLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &camera_range;
+
+    VkPipelineLayout point_list_layout;
+    if (vkCreatePipelineLayout(device, &layout_info, nullptr, &point_list_layout) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create pipeline layout!");
+    }
+    VkPipeline point_list_pipeline = createPointListPipeline(device, render_pass, point_list_layout);
+
+    PointRasterizer rasterizer;
+    rasterizer.init(device, context.physical_device, render_pass, {WIDTH, HEIGHT}, point_buffer.buffer, static_cast<uint32_t>(point_count));
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = context.queue_family;
+
+    VkCommandPool command_pool;
+    if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+
+    VkQueryPoolCreateInfo query_info{};
+    query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_info.queryCount = 3;
+
+    VkQueryPool query_pool;
+    if (vkCreateQueryPool(device, &query_info, nullptr, &query_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create query pool!");
+    }
+
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), float(WIDTH) / HEIGHT, 0.5f, 500.0f);
+    proj[1][1] *= -1.0f;
+    glm::mat4 view_proj = proj * glm::lookAtRH(glm::vec3(0.0f, 60.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    VkClearValue clear_values[2]{};
+    clear_values[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = render_pass;
+    render_pass_info.framebuffer = framebuffer;
+    render_pass_info.renderArea = {{0, 0}, {WIDTH, HEIGHT}};
+    render_pass_info.clearValueCount = 2;
+    render_pass_info.pClearValues = clear_values;
+
+    std::vector<double> point_list_ms = timeCommands(context, command_buffer, query_pool, 2, [&](VkCommandBuffer cmd)
+    {
+      VkDeviceSize offset = 0;
+      vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+      vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+      vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, point_list_pipeline);
+      vkCmdBindVertexBuffers(cmd, 0, 1, &point_buffer.buffer, &offset);
+      vkCmdPushConstants(cmd, point_list_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &view_proj);
+      vkCmdDraw(cmd, static_cast<uint32_t>(point_count), 1, 0, 0);
+      vkCmdEndRenderPass(cmd);
+      vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+    });
+
+    std::vector<double> compute_ms = timeCommands(context, command_buffer, query_pool, 3, [&](VkCommandBuffer cmd)
+    {
+      vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+      rasterizer.rasterize(cmd, view_proj);
+      vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool, 1);
+      vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+      rasterizer.resolve(cmd);
+      vkCmdEndRenderPass(cmd);
+      vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 2);
+    });
+
+    double compute_total_ms = compute_ms[0] + compute_ms[1];
+
+    std::cout << point_count << " points, " << WIDTH << "x" << HEIGHT << ", average of " << ITERATIONS << " runs" << std::endl;
+    std::cout << "point list:       " << point_list_ms[0] << " ms, " << point_count / (point_list_ms[0] * 1e-3) * 1e-9 << " G points/s" << std::endl;
+    std::cout << "compute raster:   " << compute_ms[0] << " ms (+ " << compute_ms[1] << " ms resolve), "
+      << point_count / (compute_total_ms * 1e-3) * 1e-9 << " G points/s" << std::endl;
+    std::cout << "speedup:          " << point_list_ms[0] / compute_total_ms << "x" << std::endl;
+
+    vkDeviceWaitIdle(device);
+    vkDestroyQueryPool(device, query_pool, nullptr);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    rasterizer.cleanup();
+    vkDestroyPipeline(device, point_list_pipeline, nullptr);
+    vkDestroyPipelineLayout(device, point_list_layout, nullptr);
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    vkDestroyRenderPass(device, render_pass, nullptr);
+    destroyImage(device, depth);
+    destroyImage(device, color);
+    destroyBuffer(device, point_buffer);
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
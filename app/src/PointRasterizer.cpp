@@ -0,0 +1,324 @@
+#include "PointRasterizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t RASTER_GROUP_SIZE = 256;
+  // Enough groups to fill any GPU; the shader loops over the rest of the points
+  const uint32_t MAX_RASTER_GROUPS = 65535;
+  // Farther than any depth, and no color
+  const uint32_t EMPTY_PIXEL = 0xFFFFFFFF;
+
+  enum PointBinding : uint32_t
+  {
+    BINDING_POINTS = 0,
+    BINDING_PIXELS = 1,
+    BINDING_COUNT = 2
+  };
+
+  struct RasterConstants
+  {
+    glm::mat4 view_proj;
+    uint32_t size[2];
+    uint32_t point_count;
+    uint32_t padding;
+  };
+}
+
+bool isPointRasterizerSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+  if (properties.apiVersion < VK_API_VERSION_1_2 || get_features2 == nullptr)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceShaderAtomicInt64Features atomic_features{};
+  atomic_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
+
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &atomic_features;
+  get_features2(physical_device, &features);
+
+  return features.features.shaderInt64 && atomic_features.shaderBufferInt64Atomics;
+}
+
+void PointRasterizer::init(VkDevice device, VkPhysicalDevice physical_device, VkRenderPass render_pass, VkExtent2D extent, VkBuffer points, uint32_t point_count)
+{
+  this->device = device;
+  this->extent = extent;
+  this->point_count = point_count;
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+  max_group_count = std::min(properties.limits.maxComputeWorkGroupCount[0], MAX_RASTER_GROUPS);
+
+  pixel_buffer = createBuffer(device, physical_device, VkDeviceSize(extent.width) * extent.height * sizeof(uint64_t),
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  createDescriptors(points);
+  createPipelines(render_pass);
+}
+
+void PointRasterizer::createDescriptors(VkBuffer points)
+{
+  VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+  bindings[BINDING_POINTS].binding = BINDING_POINTS;
+  bindings[BINDING_POINTS].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[BINDING_POINTS].descriptorCount = 1;
+  bindings[BINDING_POINTS].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[BINDING_PIXELS].binding = BINDING_PIXELS;
+  bindings[BINDING_PIXELS].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[BINDING_PIXELS].descriptorCount = 1;
+  bindings[BINDING_PIXELS].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = BINDING_COUNT;
+  layout_info.pBindings = bindings;
+
+  if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create point descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BINDING_COUNT};
+
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 1;
+  pool_info.pPoolSizes = &pool_size;
+
+  if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create point descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &descriptor_set_layout;
+
+  if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate point descriptor set!");
+  }
+
+  VkDescriptorBufferInfo buffer_infos[BINDING_COUNT] =
+  {
+    {points, 0, VK_WHOLE_SIZE},
+    {pixel_buffer.buffer, 0, VK_WHOLE_SIZE}
+  };
+
+  VkWriteDescriptorSet writes[BINDING_COUNT]{};
+  for (uint32_t i = 0; i < BINDING_COUNT; i++)
+  {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptor_set;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].pBufferInfo = &buffer_infos[i];
+  }
+
+  vkUpdateDescriptorSets(device, BINDING_COUNT, writes, 0, nullptr);
+
+  // The resolve reads the size from the same block
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  push_constant_range.size = sizeof(RasterConstants);
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+  if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create point pipeline layout!");
+  }
+}
+
+void PointRasterizer::createPipelines(VkRenderPass render_pass)
+{
+  VkShaderModule raster_module = loadShaderModule(device, "point_raster.spv");
+
+  VkComputePipelineCreateInfo compute_info{};
+  compute_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  compute_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  compute_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  compute_info.stage.module = raster_module;
+  compute_info.stage.pName = "main";
+  compute_info.layout = pipeline_layout;
+
+  VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compute_info, nullptr, &raster_pipeline);
+  vkDestroyShaderModule(device, raster_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create point raster pipeline!");
+  }
+
+  VkShaderModule vert_module = loadShaderModule(device, "point_resolve_vert.spv");
+  VkShaderModule frag_module = loadShaderModule(device, "point_resolve_frag.spv");
+
+  VkPipelineShaderStageCreateInfo stages[2]{};
+  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  stages[0].module = vert_module;
+  stages[0].pName = "main";
+  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  stages[1].module = frag_module;
+  stages[1].pName = "main";
+
+  // Full screen triangle from gl_VertexIndex
+  VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+  vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+  input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewport_state_info{};
+  viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport_state_info.viewportCount = 1;
+  viewport_state_info.scissorCount = 1;
+
+  VkPipelineRasterizationStateCreateInfo rasterization_info{};
+  rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterization_info.lineWidth = 1.0f;
+  rasterization_info.cullMode = VK_CULL_MODE_NONE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling_info{};
+  multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling_info.minSampleShading = 1.0f;
+
+  // Ignored by render passes without a depth attachment
+  VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+  depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depth_stencil_info.depthTestEnable = VK_TRUE;
+  depth_stencil_info.depthWriteEnable = VK_TRUE;
+  depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+  VkPipelineColorBlendAttachmentState color_blend_attachment{};
+  color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  VkPipelineColorBlendStateCreateInfo color_blend_info{};
+  color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  color_blend_info.attachmentCount = 1;
+  color_blend_info.pAttachments = &color_blend_attachment;
+
+  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+  VkPipelineDynamicStateCreateInfo dynamic_state{};
+  dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic_state.dynamicStateCount = 2;
+  dynamic_state.pDynamicStates = dynamic_states;
+
+  VkGraphicsPipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipeline_info.stageCount = 2;
+  pipeline_info.pStages = stages;
+  pipeline_info.pVertexInputState = &vertex_input_info;
+  pipeline_info.pInputAssemblyState = &input_assembly;
+  pipeline_info.pViewportState = &viewport_state_info;
+  pipeline_info.pRasterizationState = &rasterization_info;
+  pipeline_info.pMultisampleState = &multisampling_info;
+  pipeline_info.pDepthStencilState = &depth_stencil_info;
+  pipeline_info.pColorBlendState = &color_blend_info;
+  pipeline_info.pDynamicState = &dynamic_state;
+  pipeline_info.layout = pipeline_layout;
+  pipeline_info.renderPass = render_pass;
+  pipeline_info.subpass = 0;
+
+  result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &resolve_pipeline);
+
+  vkDestroyShaderModule(device, frag_module, nullptr);
+  vkDestroyShaderModule(device, vert_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create point resolve pipeline!");
+  }
+}
+
+void PointRasterizer::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyPipeline(device, resolve_pipeline, nullptr);
+  vkDestroyPipeline(device, raster_pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+  vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+  destroyBuffer(device, pixel_buffer);
+
+  *this = PointRasterizer{};
+}
+
+void PointRasterizer::rasterize(VkCommandBuffer command_buffer, const glm::mat4 &view_proj)
+{
+  // The previous resolve must be done reading before the clear
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = pixel_buffer.buffer;
+  barrier.size = VK_WHOLE_SIZE;
+
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+  vkCmdFillBuffer(command_buffer, pixel_buffer.buffer, 0, VK_WHOLE_SIZE, EMPTY_PIXEL);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+  RasterConstants constants{};
+  constants.view_proj = view_proj;
+  constants.size[0] = extent.width;
+  constants.size[1] = extent.height;
+  constants.point_count = point_count;
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, raster_pipeline);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+  vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(RasterConstants), &constants);
+  vkCmdDispatch(command_buffer, std::max(std::min((point_count + RASTER_GROUP_SIZE - 1) / RASTER_GROUP_SIZE, max_group_count), 1u), 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void PointRasterizer::resolve(VkCommandBuffer command_buffer)
+{
+  VkViewport viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+  VkRect2D scissor{{0, 0}, extent};
+  uint32_t size[2] = {extent.width, extent.height};
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, resolve_pipeline);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+  vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, offsetof(RasterConstants, size), sizeof(size), size);
+  vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+  vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+  vkCmdDraw(command_buffer, 3, 1, 0, 0);
+}
@@ -0,0 +1,496 @@
+#include "SoftwareOcclusion.hpp"
+
+#include <glm/simd/platform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  const uint32_t TILE_PIXELS = SoftwareOcclusion::TILE_WIDTH * SoftwareOcclusion::TILE_HEIGHT;
+  const float FAR_DEPTH = 1.0f;
+  // Tile rows per rasterization job
+  const uint32_t BAND_ROWS = 2;
+  const uint32_t OCCLUDER_BATCH = 4;
+  const uint32_t TEST_BATCH = 1024;
+
+  uint32_t tileOffset(uint32_t tiles_x, uint32_t tile_x, uint32_t tile_y)
+  {
+    return (tile_y * tiles_x + tile_x) * TILE_PIXELS;
+  }
+
+  // Sutherland-Hodgman against the near plane (z >= 0), a triangle becomes at most a quad
+  uint32_t clipNear(const glm::vec4 in[3], glm::vec4 out[4])
+  {
+    uint32_t count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+      const glm::vec4 &a = in[i];
+      const glm::vec4 &b = in[(i + 1) % 3];
+
+      if (a.z >= 0.0f)
+      {
+        out[count++] = a;
+      }
+      if ((a.z >= 0.0f) != (b.z >= 0.0f))
+      {
+        float t = a.z / (a.z - b.z);
+        out[count++] = a + (b - a) * t;
+      }
+    }
+    return count;
+  }
+}
+
+SoftwareOcclusion::SoftwareOcclusion(uint32_t width, uint32_t height)
+{
+  tiles_x = (std::max(width, 1u) + TILE_WIDTH - 1) / TILE_WIDTH;
+  tiles_y = (std::max(height, 1u) + TILE_HEIGHT - 1) / TILE_HEIGHT;
+  buffer_width = tiles_x * TILE_WIDTH;
+  buffer_height = tiles_y * TILE_HEIGHT;
+
+  tile_depth.assign(size_t(tiles_x) * tiles_y * TILE_PIXELS, FAR_DEPTH);
+  tile_max.assign(size_t(tiles_x) * tiles_y, FAR_DEPTH);
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+  raster_path = OCCLUSION_PATH_AVX2;
+#else
+  raster_path = OCCLUSION_PATH_SCALAR;
+#endif
+}
+
+void SoftwareOcclusion::setPath(OcclusionRasterPath path)
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+  raster_path = path;
+#else
+  (void)path;
+  raster_path = OCCLUSION_PATH_SCALAR;
+#endif
+}
+
+size_t SoftwareOcclusion::triangleCount() const
+{
+  size_t count = 0;
+  for (const std::vector<RasterTriangle> &triangles : occluder_triangles)
+  {
+    count += triangles.size();
+  }
+  return count;
+}
+
+float SoftwareOcclusion::depth(uint32_t x, uint32_t y) const
+{
+  uint32_t offset = tileOffset(tiles_x, x / TILE_WIDTH, y / TILE_HEIGHT);
+  return tile_depth[offset + (y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH];
+}
+
+void SoftwareOcclusion::render(const std::vector<Occluder> &occluders, const glm::mat4 &view_proj, JobSystem *jobs)
+{
+  this->view_proj = view_proj;
+  occluder_triangles.resize(occluders.size());
+
+  auto transformRange = [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      transformOccluder(occluders[i], occluder_triangles[i]);
+    }
+  };
+
+  auto rasterizeRange = [&](uint32_t begin, uint32_t end)
+  {
+    rasterizeTileRows(begin * BAND_ROWS, std::min(end * BAND_ROWS, tiles_y));
+  };
+
+  uint32_t occluder_count = static_cast<uint32_t>(occluders.size());
+  uint32_t band_count = (tiles_y + BAND_ROWS - 1) / BAND_ROWS;
+
+  if (jobs != nullptr)
+  {
+    jobs->parallelFor(occluder_count, OCCLUDER_BATCH, transformRange);
+    jobs->parallelFor(band_count, 1, rasterizeRange);
+  }
+  else
+  {
+    transformRange(0, occluder_count);
+    rasterizeRange(0, band_count);
+  }
+}
+
+void SoftwareOcclusion::transformOccluder(const Occluder &occluder, std::vector<RasterTriangle> &triangles) const
+{
+  triangles.clear();
+
+  const OccluderMesh &mesh = *occluder.mesh;
+  glm::mat4 model_view_proj = view_proj * occluder.model;
+
+  std::vector<glm::vec4> clip(mesh.positions.size());
+  for (size_t i = 0; i < mesh.positions.size(); i++)
+  {
+    clip[i] = model_view_proj * glm::vec4(mesh.positions[i], 1.0f);
+  }
+
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    glm::vec4 corners[3] = {clip[mesh.indices[i]], clip[mesh.indices[i + 1]], clip[mesh.indices[i + 2]]};
+
+    if (corners[0].z >= 0.0f && corners[1].z >= 0.0f && corners[2].z >= 0.0f)
+    {
+      setupTriangle(corners, triangles);
+      continue;
+    }
+
+    glm::vec4 clipped[4];
+    uint32_t count = clipNear(corners, clipped);
+    for (uint32_t k = 2; k < count; k++)
+    {
+      glm::vec4 fan[3] = {clipped[0], clipped[k - 1], clipped[k]};
+      setupTriangle(fan, triangles);
+    }
+  }
+}
+
+void SoftwareOcclusion::setupTriangle(const glm::vec4 clip[3], std::vector<RasterTriangle> &triangles) const
+{
+  float x[3], y[3], z[3];
+  for (int i = 0; i < 3; i++)
+  {
+    // Past the near plane z >= 0 and w > 0
+    if (clip[i].w <= 0.0f)
+    {
+      return;
+    }
+    float inv_w = 1.0f / clip[i].w;
+    x[i] = (clip[i].x * inv_w * 0.5f + 0.5f) * buffer_width;
+    y[i] = (clip[i].y * inv_w * 0.5f + 0.5f) * buffer_height;
+    z[i] = std::min(clip[i].z * inv_w, FAR_DEPTH);
+  }
+
+  float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+  if (area == 0.0f || !std::isfinite(area))
+  {
+    return;
+  }
+
+  RasterTriangle triangle;
+  triangle.min_x = std::max(static_cast<int32_t>(std::floor(std::min({x[0], x[1], x[2]}))), 0);
+  triangle.max_x = std::min(static_cast<int32_t>(std::ceil(std::max({x[0], x[1], x[2]}))), static_cast<int32_t>(buffer_width) - 1);
+  triangle.min_y = std::max(static_cast<int32_t>(std::floor(std::min({y[0], y[1], y[2]}))), 0);
+  triangle.max_y = std::min(static_cast<int32_t>(std::ceil(std::max({y[0], y[1], y[2]}))), static_cast<int32_t>(buffer_height) - 1);
+
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+  {
+    return;
+  }
+
+  // Both windings are rasterized, the edges are flipped to be positive inside
+  float sign = area > 0.0f ? 1.0f : -1.0f;
+  for (int i = 0; i < 3; i++)
+  {
+    int j = (i + 1) % 3;
+    triangle.edge_a[i] = sign * (y[i] - y[j]);
+    triangle.edge_b[i] = sign * (x[j] - x[i]);
+    triangle.edge_c[i] = sign * (x[i] * y[j] - y[i] * x[j]);
+  }
+
+  triangle.z_a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+  triangle.z_b = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+  // Farthest depth of the plane within the pixel around the sample
+  triangle.z_c = z[0] - triangle.z_a * x[0] - triangle.z_b * y[0] + 0.5f * (std::abs(triangle.z_a) + std::abs(triangle.z_b));
+  triangle.z_min = std::min({z[0], z[1], z[2]});
+  triangle.z_max = std::max({z[0], z[1], z[2]});
+
+  triangles.push_back(triangle);
+}
+
+void SoftwareOcclusion::rasterizeTileRows(uint32_t first_row, uint32_t end_row)
+{
+  std::fill(tile_depth.begin() + tileOffset(tiles_x, 0, first_row), tile_depth.begin() + tileOffset(tiles_x, 0, end_row), FAR_DEPTH);
+  std::fill(tile_max.begin() + first_row * tiles_x, tile_max.begin() + end_row * tiles_x, FAR_DEPTH);
+
+  int32_t band_min_y = first_row * TILE_HEIGHT;
+  int32_t band_max_y = end_row * TILE_HEIGHT - 1;
+
+  for (const std::vector<RasterTriangle> &triangles : occluder_triangles)
+  {
+    for (const RasterTriangle &triangle : triangles)
+    {
+      if (triangle.max_y < band_min_y || triangle.min_y > band_max_y)
+      {
+        continue;
+      }
+
+      uint32_t tile_y_begin = std::max<uint32_t>(triangle.min_y / TILE_HEIGHT, first_row);
+      uint32_t tile_y_end = std::min<uint32_t>(triangle.max_y / TILE_HEIGHT + 1, end_row);
+      uint32_t tile_x_begin = triangle.min_x / TILE_WIDTH;
+      uint32_t tile_x_end = triangle.max_x / TILE_WIDTH + 1;
+
+      for (uint32_t tile_y = tile_y_begin; tile_y < tile_y_end; tile_y++)
+      {
+        for (uint32_t tile_x = tile_x_begin; tile_x < tile_x_end; tile_x++)
+        {
+          // Already nearer than anything this triangle could write
+          if (triangle.z_min >= tile_max[tile_y * tiles_x + tile_x])
+          {
+            continue;
+          }
+
+          if (raster_path == OCCLUSION_PATH_AVX2)
+          {
+            rasterizeTileAVX2(triangle, tile_x, tile_y);
+          }
+          else
+          {
+            rasterizeTileScalar(triangle, tile_x, tile_y);
+          }
+        }
+      }
+    }
+  }
+}
+
+void SoftwareOcclusion::rasterizeTileScalar(const RasterTriangle &triangle, uint32_t tile_x, uint32_t tile_y)
+{
+  float *depth = &tile_depth[tileOffset(tiles_x, tile_x, tile_y)];
+  float farthest = 0.0f;
+
+  for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+  {
+    float y = static_cast<float>(tile_y * TILE_HEIGHT + row) + 0.5f;
+    float row_edge[3];
+    for (int e = 0; e < 3; e++)
+    {
+      row_edge[e] = std::fma(triangle.edge_b[e], y, triangle.edge_c[e]);
+    }
+    float row_z = std::fma(triangle.z_b, y, triangle.z_c);
+
+    for (uint32_t column = 0; column < TILE_WIDTH; column++)
+    {
+      float x = static_cast<float>(tile_x * TILE_WIDTH + column) + 0.5f;
+      float &pixel = depth[row * TILE_WIDTH + column];
+
+      bool inside = std::fma(triangle.edge_a[0], x, row_edge[0]) >= 0.0f &&
+        std::fma(triangle.edge_a[1], x, row_edge[1]) >= 0.0f &&
+        std::fma(triangle.edge_a[2], x, row_edge[2]) >= 0.0f;
+
+      if (inside)
+      {
+        pixel = std::min(pixel, std::min(std::fma(triangle.z_a, x, row_z), triangle.z_max));
+      }
+      farthest = std::max(farthest, pixel);
+    }
+  }
+
+  tile_max[tile_y * tiles_x + tile_x] = farthest;
+}
+
+void SoftwareOcclusion::rasterizeTileAVX2(const RasterTriangle &triangle, uint32_t tile_x, uint32_t tile_y)
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+  float *depth = &tile_depth[tileOffset(tiles_x, tile_x, tile_y)];
+
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(tile_x * TILE_WIDTH) + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+  const __m256 z_max = _mm256_set1_ps(triangle.z_max);
+
+  __m256 edge_a[3];
+  for (int e = 0; e < 3; e++)
+  {
+    edge_a[e] = _mm256_set1_ps(triangle.edge_a[e]);
+  }
+  __m256 z_a = _mm256_set1_ps(triangle.z_a);
+  __m256 farthest = zero;
+
+  for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+  {
+    float y = static_cast<float>(tile_y * TILE_HEIGHT + row) + 0.5f;
+
+    __m256 inside = _mm256_cmp_ps(_mm256_fmadd_ps(edge_a[0], x, _mm256_set1_ps(std::fma(triangle.edge_b[0], y, triangle.edge_c[0]))), zero, _CMP_GE_OQ);
+    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(edge_a[1], x, _mm256_set1_ps(std::fma(triangle.edge_b[1], y, triangle.edge_c[1]))), zero, _CMP_GE_OQ));
+    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(edge_a[2], x, _mm256_set1_ps(std::fma(triangle.edge_b[2], y, triangle.edge_c[2]))), zero, _CMP_GE_OQ));
+
+    __m256 z = _mm256_min_ps(_mm256_fmadd_ps(z_a, x, _mm256_set1_ps(std::fma(triangle.z_b, y, triangle.z_c))), z_max);
+
+    __m256 pixels = _mm256_loadu_ps(depth + row * TILE_WIDTH);
+    pixels = _mm256_blendv_ps(pixels, _mm256_min_ps(pixels, z), inside);
+    _mm256_storeu_ps(depth + row * TILE_WIDTH, pixels);
+
+    farthest = _mm256_max_ps(farthest, pixels);
+  }
+
+  __m128 half = _mm_max_ps(_mm256_castps256_ps128(farthest), _mm256_extractf128_ps(farthest, 1));
+  half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+
+  tile_max[tile_y * tiles_x + tile_x] = _mm_cvtss_f32(half);
+#else
+  rasterizeTileScalar(triangle, tile_x, tile_y);
+#endif
+}
+
+bool SoftwareOcclusion::isSphereVisible(const glm::vec3 &center, float radius) const
+{
+  float min_x = std::numeric_limits<float>::max();
+  float max_x = -std::numeric_limits<float>::max();
+  float min_y = min_x;
+  float max_y = max_x;
+  float nearest = FAR_DEPTH;
+
+  // The projection is linear before the divide, so the corners are the
+  // projected center plus or minus the scaled matrix columns
+  glm::vec4 center_clip = view_proj * glm::vec4(center, 1.0f);
+  glm::vec4 axis_x = view_proj[0] * radius;
+  glm::vec4 axis_y = view_proj[1] * radius;
+  glm::vec4 axis_z = view_proj[2] * radius;
+
+  for (int i = 0; i < 8; i++)
+  {
+    glm::vec4 clip = center_clip + ((i & 1) ? axis_x : -axis_x) + ((i & 2) ? axis_y : -axis_y) + ((i & 4) ? axis_z : -axis_z);
+
+    // Reaches past the near plane, nothing can be in front of it
+    if (clip.w <= 0.0f || clip.z < 0.0f)
+    {
+      return true;
+    }
+
+    float inv_w = 1.0f / clip.w;
+    float x = (clip.x * inv_w * 0.5f + 0.5f) * buffer_width;
+    float y = (clip.y * inv_w * 0.5f + 0.5f) * buffer_height;
+
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y);
+    max_y = std::max(max_y, y);
+    nearest = std::min(nearest, clip.z * inv_w);
+  }
+
+  // Every pixel the box touches, not only the sampled centers
+  int32_t pixel_min_x = std::max(static_cast<int32_t>(std::floor(min_x)), 0);
+  int32_t pixel_max_x = std::min(static_cast<int32_t>(std::floor(max_x)), static_cast<int32_t>(buffer_width) - 1);
+  int32_t pixel_min_y = std::max(static_cast<int32_t>(std::floor(min_y)), 0);
+  int32_t pixel_max_y = std::min(static_cast<int32_t>(std::floor(max_y)), static_cast<int32_t>(buffer_height) - 1);
+
+  // Off screen; frustum culling decides
+  if (pixel_min_x > pixel_max_x || pixel_min_y > pixel_max_y)
+  {
+    return true;
+  }
+
+  if (raster_path == OCCLUSION_PATH_AVX2)
+  {
+    return isRectVisibleAVX2(pixel_min_x, pixel_max_x, pixel_min_y, pixel_max_y, nearest);
+  }
+
+  return isRectVisibleScalar(pixel_min_x, pixel_max_x, pixel_min_y, pixel_max_y, nearest);
+}
+
+bool SoftwareOcclusion::isRectVisibleScalar(int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y, float nearest) const
+{
+  for (int32_t tile_y = min_y / TILE_HEIGHT; tile_y <= max_y / int32_t(TILE_HEIGHT); tile_y++)
+  {
+    for (int32_t tile_x = min_x / TILE_WIDTH; tile_x <= max_x / int32_t(TILE_WIDTH); tile_x++)
+    {
+      if (tile_max[tile_y * tiles_x + tile_x] < nearest)
+      {
+        continue;
+      }
+
+      const float *depth = &tile_depth[tileOffset(tiles_x, tile_x, tile_y)];
+      for (int32_t y = std::max(min_y, tile_y * int32_t(TILE_HEIGHT)); y <= std::min(max_y, (tile_y + 1) * int32_t(TILE_HEIGHT) - 1); y++)
+      {
+        for (int32_t x = std::max(min_x, tile_x * int32_t(TILE_WIDTH)); x <= std::min(max_x, (tile_x + 1) * int32_t(TILE_WIDTH) - 1); x++)
+        {
+          if (depth[(y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH] >= nearest)
+          {
+            return true;
+          }
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+bool SoftwareOcclusion::isRectVisibleAVX2(int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y, float nearest) const
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+  const __m256 nearest_depth = _mm256_set1_ps(nearest);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for (int32_t tile_y = min_y / TILE_HEIGHT; tile_y <= max_y / int32_t(TILE_HEIGHT); tile_y++)
+  {
+    for (int32_t tile_x = min_x / TILE_WIDTH; tile_x <= max_x / int32_t(TILE_WIDTH); tile_x++)
+    {
+      if (tile_max[tile_y * tiles_x + tile_x] < nearest)
+      {
+        continue;
+      }
+
+      // Lanes of the tile row inside [min_x, max_x]
+      int32_t first_column = std::max(min_x - tile_x * int32_t(TILE_WIDTH), 0);
+      int32_t last_column = std::min(max_x - tile_x * int32_t(TILE_WIDTH), int32_t(TILE_WIDTH) - 1);
+      __m256i columns = _mm256_and_si256(
+        _mm256_cmpgt_epi32(lanes, _mm256_set1_epi32(first_column - 1)),
+        _mm256_cmpgt_epi32(_mm256_set1_epi32(last_column + 1), lanes));
+
+      const float *depth = &tile_depth[tileOffset(tiles_x, tile_x, tile_y)];
+      int32_t first_row = std::max(min_y - tile_y * int32_t(TILE_HEIGHT), 0);
+      int32_t last_row = std::min(max_y - tile_y * int32_t(TILE_HEIGHT), int32_t(TILE_HEIGHT) - 1);
+
+      for (int32_t row = first_row; row <= last_row; row++)
+      {
+        __m256 behind = _mm256_cmp_ps(_mm256_loadu_ps(depth + row * TILE_WIDTH), nearest_depth, _CMP_GE_OQ);
+        if (_mm256_movemask_ps(_mm256_and_ps(behind, _mm256_castsi256_ps(columns))) != 0)
+        {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+#else
+  return isRectVisibleScalar(min_x, max_x, min_y, max_y, nearest);
+#endif
+}
+
+void SoftwareOcclusion::cullSpheres(const CullingBounds &bounds, const std::vector<uint32_t> &candidates, std::vector<uint32_t> &visible, JobSystem *jobs) const
+{
+  std::vector<uint8_t> keep(candidates.size());
+
+  auto testRange = [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      uint32_t index = candidates[i];
+      glm::vec3 center(bounds.center_x[index], bounds.center_y[index], bounds.center_z[index]);
+      keep[i] = isSphereVisible(center, bounds.radius[index]) ? 1 : 0;
+    }
+  };
+
+  uint32_t count = static_cast<uint32_t>(candidates.size());
+  if (jobs != nullptr)
+  {
+    jobs->parallelFor(count, TEST_BATCH, testRange);
+  }
+  else
+  {
+    testRange(0, count);
+  }
+
+  visible.clear();
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (keep[i])
+    {
+      visible.push_back(candidates[i]);
+    }
+  }
+}
@@ -0,0 +1,410 @@
+#include "SpirvReflection.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  const uint32_t SPIRV_MAGIC = 0x07230203;
+  const uint32_t SPIRV_HEADER_WORDS = 5;
+
+  enum SpirvOp : uint32_t
+  {
+    OP_NAME = 5,
+    OP_MEMBER_NAME = 6,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_SPEC_CONSTANT = 50,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72
+  };
+
+  enum SpirvDecoration : uint32_t
+  {
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ROW_MAJOR = 4,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35
+  };
+
+  enum SpirvStorageClass : uint32_t
+  {
+    STORAGE_UNIFORM = 2,
+    STORAGE_PUSH_CONSTANT = 9,
+    STORAGE_STORAGE_BUFFER = 12
+  };
+
+  struct MemberInfo
+  {
+    std::string name;
+    uint32_t offset = 0;
+    uint32_t matrix_stride = 0;
+    bool row_major = false;
+  };
+
+  /**
+   * Everything known about one result id. operands are the words after the
+   * result id of the instruction that defined it.
+   */
+  struct IdInfo
+  {
+    uint32_t opcode = 0;
+    std::vector<uint32_t> operands;
+    std::string name;
+    bool block = false;
+    bool buffer_block = false;
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    uint32_t array_stride = 0;
+    std::vector<MemberInfo> members;
+  };
+
+  std::string readString(const uint32_t *words, size_t word_count)
+  {
+    const char *chars = reinterpret_cast<const char*>(words);
+    return std::string(chars, strnlen(chars, word_count * sizeof(uint32_t)));
+  }
+
+  class Module
+  {
+  public:
+    explicit Module(const std::vector<uint32_t> &code)
+    {
+      if (code.size() < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC)
+      {
+        throw std::runtime_error("file is not a SPIR-V module!");
+      }
+
+      ids.resize(code[3]);
+
+      for (size_t i = SPIRV_HEADER_WORDS; i < code.size();)
+      {
+        uint32_t opcode = code[i] & 0xffff;
+        uint32_t word_count = code[i] >> 16;
+
+        if (word_count == 0 || i + word_count > code.size())
+        {
+          throw std::runtime_error("SPIR-V module is truncated!");
+        }
+
+        parse(opcode, &code[i + 1], word_count - 1);
+        i += word_count;
+      }
+    }
+
+    SpirvReflection reflect() const
+    {
+      SpirvReflection reflection;
+      for (const IdInfo &variable : ids)
+      {
+        if (variable.opcode != OP_VARIABLE)
+        {
+          continue;
+        }
+
+        // operands: result type (pointer) ... storage class after the result id
+        const IdInfo &pointer = id(variable.operands[0]);
+        uint32_t storage_class = variable.operands[1];
+        const IdInfo &type = id(pointer.operands[1]);
+
+        // Arrays of blocks are checked through their element
+        const IdInfo *block_type = &type;
+        if (type.opcode == OP_TYPE_ARRAY || type.opcode == OP_TYPE_RUNTIME_ARRAY)
+        {
+          block_type = &id(type.operands[0]);
+        }
+
+        if (block_type->opcode != OP_TYPE_STRUCT || !(block_type->block || block_type->buffer_block))
+        {
+          continue;
+        }
+
+        SpirvBlock block;
+        block.name = block_type->name;
+        block.set = variable.set;
+        block.binding = variable.binding;
+
+        if (storage_class == STORAGE_PUSH_CONSTANT)
+        {
+          block.kind = SPIRV_BLOCK_PUSH_CONSTANT;
+        }
+        else if (storage_class == STORAGE_STORAGE_BUFFER || (storage_class == STORAGE_UNIFORM && block_type->buffer_block))
+        {
+          block.kind = SPIRV_BLOCK_STORAGE;
+        }
+        else if (storage_class == STORAGE_UNIFORM)
+        {
+          block.kind = SPIRV_BLOCK_UNIFORM;
+        }
+        else
+        {
+          continue;
+        }
+
+        for (size_t i = 0; i < block_type->operands.size(); i++)
+        {
+          const MemberInfo &info = block_type->members[i];
+          const IdInfo &member_type = id(block_type->operands[i]);
+
+          SpirvBlockMember member;
+          member.name = info.name;
+          member.offset = info.offset;
+          member.size = typeSize(member_type, info);
+          member.array_stride = member_type.array_stride;
+          block.members.push_back(member);
+        }
+
+        block.size = structSize(*block_type);
+        reflection.blocks.push_back(block);
+      }
+      return reflection;
+    }
+
+  private:
+    const IdInfo &id(uint32_t result) const
+    {
+      if (result >= ids.size())
+      {
+        throw std::runtime_error("SPIR-V id is out of bounds!");
+      }
+      return ids[result];
+    }
+
+    IdInfo &id(uint32_t result)
+    {
+      return const_cast<IdInfo&>(static_cast<const Module*>(this)->id(result));
+    }
+
+    MemberInfo &member(uint32_t type, uint32_t index)
+    {
+      IdInfo &info = id(type);
+      if (info.members.size() <= index)
+      {
+        info.members.resize(index + 1);
+      }
+      return info.members[index];
+    }
+
+    void parse(uint32_t opcode, const uint32_t *operands, uint32_t operand_count)
+    {
+      switch (opcode)
+      {
+        case OP_NAME:
+          if (operand_count >= 1)
+          {
+            id(operands[0]).name = readString(operands + 1, operand_count - 1);
+          }
+          break;
+        case OP_MEMBER_NAME:
+          if (operand_count >= 2)
+          {
+            member(operands[0], operands[1]).name = readString(operands + 2, operand_count - 2);
+          }
+          break;
+        case OP_TYPE_INT: case OP_TYPE_FLOAT: case OP_TYPE_VECTOR: case OP_TYPE_MATRIX:
+        case OP_TYPE_ARRAY: case OP_TYPE_RUNTIME_ARRAY: case OP_TYPE_STRUCT: case OP_TYPE_POINTER:
+          if (operand_count >= 1)
+          {
+            define(opcode, operands[0], operands + 1, operand_count - 1);
+          }
+          break;
+        case OP_CONSTANT: case OP_SPEC_CONSTANT: case OP_VARIABLE:
+          // the result type comes before the result id
+          if (operand_count >= 2)
+          {
+            std::vector<uint32_t> rest(operands + 2, operands + operand_count);
+            rest.insert(rest.begin(), operands[0]);
+            define(opcode, operands[1], rest.data(), static_cast<uint32_t>(rest.size()));
+          }
+          break;
+        case OP_DECORATE:
+          if (operand_count >= 2)
+          {
+            decorate(id(operands[0]), operands[1], operand_count >= 3 ? operands[2] : 0);
+          }
+          break;
+        case OP_MEMBER_DECORATE:
+          if (operand_count >= 3)
+          {
+            decorateMember(member(operands[0], operands[1]), operands[2], operand_count >= 4 ? operands[3] : 0);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+
+    void define(uint32_t opcode, uint32_t result, const uint32_t *operands, uint32_t operand_count)
+    {
+      IdInfo &info = id(result);
+      info.opcode = opcode;
+      info.operands.assign(operands, operands + operand_count);
+
+      if (opcode == OP_TYPE_STRUCT && info.members.size() < operand_count)
+      {
+        info.members.resize(operand_count);
+      }
+
+      if (operand_count < operandsRead(opcode))
+      {
+        throw std::runtime_error("SPIR-V instruction is truncated!");
+      }
+    }
+
+    /**
+     * Operands after the result id that reflect() and typeSize() read
+     */
+    static uint32_t operandsRead(uint32_t opcode)
+    {
+      switch (opcode)
+      {
+        case OP_TYPE_INT: case OP_TYPE_FLOAT: case OP_TYPE_RUNTIME_ARRAY:
+          return 1;
+        case OP_TYPE_VECTOR: case OP_TYPE_MATRIX: case OP_TYPE_ARRAY: case OP_TYPE_POINTER:
+        case OP_CONSTANT: case OP_SPEC_CONSTANT: case OP_VARIABLE:
+          return 2;
+        default:
+          return 0;
+      }
+    }
+
+    static void decorate(IdInfo &info, uint32_t decoration, uint32_t value)
+    {
+      switch (decoration)
+      {
+        case DECORATION_BLOCK: info.block = true; break;
+        case DECORATION_BUFFER_BLOCK: info.buffer_block = true; break;
+        case DECORATION_ARRAY_STRIDE: info.array_stride = value; break;
+        case DECORATION_BINDING: info.binding = value; break;
+        case DECORATION_DESCRIPTOR_SET: info.set = value; break;
+        default: break;
+      }
+    }
+
+    static void decorateMember(MemberInfo &info, uint32_t decoration, uint32_t value)
+    {
+      switch (decoration)
+      {
+        case DECORATION_OFFSET: info.offset = value; break;
+        case DECORATION_MATRIX_STRIDE: info.matrix_stride = value; break;
+        case DECORATION_ROW_MAJOR: info.row_major = true; break;
+        default: break;
+      }
+    }
+
+    /**
+     * Bytes a member of this type covers in its block; matrix stride and
+     * majorness come from the struct member that holds it
+     */
+    uint32_t typeSize(const IdInfo &type, const MemberInfo &holder) const
+    {
+      switch (type.opcode)
+      {
+        case OP_TYPE_INT: case OP_TYPE_FLOAT:
+          return type.operands[0] / 8;
+        case OP_TYPE_VECTOR:
+          return type.operands[1] * typeSize(id(type.operands[0]), holder);
+        case OP_TYPE_MATRIX:
+        {
+          const IdInfo &column = id(type.operands[0]);
+          return (holder.row_major ? column.operands[1] : type.operands[1]) * holder.matrix_stride;
+        }
+        case OP_TYPE_ARRAY:
+        {
+          const IdInfo &length = id(type.operands[1]);
+          if (length.opcode != OP_CONSTANT && length.opcode != OP_SPEC_CONSTANT)
+          {
+            throw std::runtime_error("SPIR-V array length is not a constant!");
+          }
+          return length.operands[1] * type.array_stride;
+        }
+        case OP_TYPE_RUNTIME_ARRAY:
+          return 0;
+        case OP_TYPE_STRUCT:
+          return structSize(type);
+        case OP_TYPE_POINTER:
+          return 8; // buffer references
+        default:
+          throw std::runtime_error("SPIR-V block member has an unsupported type!");
+      }
+    }
+
+    uint32_t structSize(const IdInfo &type) const
+    {
+      uint32_t size = 0;
+      for (size_t i = 0; i < type.operands.size() && i < type.members.size(); i++)
+      {
+        const MemberInfo &info = type.members[i];
+        size = std::max(size, info.offset + typeSize(id(type.operands[i]), info));
+      }
+      return size;
+    }
+
+    std::vector<IdInfo> ids;
+  };
+
+  std::string memberError(const SpirvBlock &block, const SpirvBlockMember &member, uint32_t index, const char *what, uint32_t shader_value, uint32_t host_value)
+  {
+    std::string name = member.name.empty() ? "#" + std::to_string(index) : member.name;
+    return "Shader block " + block.name + " member " + name + " has " + what + " " + std::to_string(shader_value) +
+      ", its host struct " + std::to_string(host_value) + "!";
+  }
+}
+
+const SpirvBlock *SpirvReflection::findBlock(SpirvBlockKind kind, uint32_t set, uint32_t binding) const
+{
+  auto block = std::find_if(blocks.begin(), blocks.end(), [kind, set, binding](const SpirvBlock &block)
+  {
+    return block.kind == kind && (kind == SPIRV_BLOCK_PUSH_CONSTANT || (block.set == set && block.binding == binding));
+  });
+
+  return block == blocks.end() ? nullptr : &*block;
+}
+
+SpirvReflection reflectSpirv(const std::vector<uint32_t> &code)
+{
+  return Module(code).reflect();
+}
+
+void verifyBlockLayout(const SpirvBlock &block, BlockLayout layout, const BlockMember *members, uint32_t member_count)
+{
+  if (block.members.size() != member_count)
+  {
+    throw std::runtime_error("Shader block " + block.name + " has " + std::to_string(block.members.size()) + " members, its host struct " +
+      std::to_string(member_count) + "!");
+  }
+
+  for (uint32_t i = 0; i < member_count; i++)
+  {
+    const SpirvBlockMember &member = block.members[i];
+    const BlockRules &rules = members[i].rules[layout];
+
+    if (member.offset != members[i].offset)
+    {
+      throw std::runtime_error(memberError(block, member, i, "offset", member.offset, members[i].offset));
+    }
+
+    if (member.array_stride != rules.array_stride)
+    {
+      throw std::runtime_error(memberError(block, member, i, "array stride", member.array_stride, rules.array_stride));
+    }
+
+    // A trailing runtime array has no size, every other member must cover the same bytes
+    if (member.size != 0 && member.size != rules.size)
+    {
+      throw std::runtime_error(memberError(block, member, i, "size", member.size, rules.size));
+    }
+  }
+}
@@ -0,0 +1,225 @@
+#include "StagingUploader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void StagingUploader::init(VkDevice device, VkPhysicalDevice physical_device, VkQueue queue, uint32_t queue_family, VkDeviceSize staging_size)
+{
+  this->device = device;
+  this->queue = queue;
+
+  staging = createBuffer(device, physical_device, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  VkCommandPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  pool_info.queueFamilyIndex = queue_family;
+
+  if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create upload command pool!");
+  }
+
+  VkCommandBufferAllocateInfo buffer_alloc_info{};
+  buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  buffer_alloc_info.commandPool = command_pool;
+  buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  buffer_alloc_info.commandBufferCount = 1;
+
+  if (vkAllocateCommandBuffers(device, &buffer_alloc_info, &command_buffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate upload command buffer!");
+  }
+
+  VkFenceCreateInfo fence_info{};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  if (vkCreateFence(device, &fence_info, nullptr, &fence) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create upload fence!");
+  }
+}
+
+void StagingUploader::cleanup()
+{
+  flush();
+
+  vkDestroyFence(device, fence, nullptr);
+  vkDestroyCommandPool(device, command_pool, nullptr);
+  destroyBuffer(device, staging);
+}
+
+void StagingUploader::beginBatch()
+{
+  if (recording)
+  {
+    return;
+  }
+
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to begin upload command buffer!");
+  }
+
+  recording = true;
+}
+
+void *StagingUploader::reserve(VkDeviceSize size, VkDeviceSize alignment)
+{
+  if (size > staging.size)
+  {
+    throw std::runtime_error("Upload does not fit in the staging buffer!");
+  }
+
+  VkDeviceSize offset = (staging_offset + alignment - 1) & ~(alignment - 1);
+
+  if (offset + size > staging.size)
+  {
+    flush();
+    offset = 0;
+  }
+
+  beginBatch();
+  staging_offset = offset + size;
+
+  return static_cast<uint8_t*>(staging.mapped) + offset;
+}
+
+void *StagingUploader::stageBuffer(VkBuffer dst, VkDeviceSize dst_offset, VkDeviceSize size)
+{
+  uint8_t *data = static_cast<uint8_t*>(reserve(size, 16));
+
+  VkBufferCopy copy_region{};
+  copy_region.srcOffset = static_cast<VkDeviceSize>(data - static_cast<uint8_t*>(staging.mapped));
+  copy_region.dstOffset = dst_offset;
+  copy_region.size = size;
+  vkCmdCopyBuffer(command_buffer, staging.buffer, dst, 1, &copy_region);
+
+  return data;
+}
+
+void StagingUploader::uploadBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size)
+{
+  const uint8_t *src = static_cast<const uint8_t*>(data);
+
+  while (size > 0)
+  {
+    VkDeviceSize chunk_size = std::min(size, staging.size);
+    std::memcpy(stageBuffer(dst, dst_offset, chunk_size), src, chunk_size);
+
+    src += chunk_size;
+    dst_offset += chunk_size;
+    size -= chunk_size;
+  }
+}
+
+void StagingUploader::transitionImage(VkImage image, uint32_t mip_level, uint32_t array_layer, VkImageLayout old_layout, VkImageLayout new_layout)
+{
+  beginBatch();
+
+  bool to_transfer = new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = to_transfer ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = to_transfer ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, mip_level, 1, array_layer, 1};
+
+  VkPipelineStageFlags src_stage = to_transfer ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkPipelineStageFlags dst_stage = to_transfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void *StagingUploader::stageImage(VkImage dst, uint32_t mip_level, uint32_t array_layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, VkDeviceSize size)
+{
+  uint8_t *data = static_cast<uint8_t*>(reserve(size, 16));
+
+  VkBufferImageCopy copy_region{};
+  copy_region.bufferOffset = static_cast<VkDeviceSize>(data - static_cast<uint8_t*>(staging.mapped));
+  copy_region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip_level, array_layer, 1};
+  copy_region.imageOffset = {static_cast<int32_t>(x), static_cast<int32_t>(y), 0};
+  copy_region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(command_buffer, staging.buffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+
+  return data;
+}
+
+void StagingUploader::uploadImage(VkImage dst, uint32_t mip_level, uint32_t width, uint32_t height, uint32_t block_size, const void *data, uint32_t block_extent, uint32_t array_layer)
+{
+  const uint8_t *src = static_cast<const uint8_t*>(data);
+  uint32_t block_rows = (height + block_extent - 1) / block_extent;
+  VkDeviceSize row_size = VkDeviceSize((width + block_extent - 1) / block_extent) * block_size;
+  uint32_t band_rows = static_cast<uint32_t>(std::min<VkDeviceSize>(staging.size / row_size, block_rows));
+
+  if (band_rows == 0)
+  {
+    throw std::runtime_error("Image row does not fit in the staging buffer!");
+  }
+
+  // Batches submit in order, so the transitions hold even if a band flushes
+  transitionImage(dst, mip_level, array_layer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+  for (uint32_t row = 0; row < block_rows; row += band_rows)
+  {
+    uint32_t rows = std::min(band_rows, block_rows - row);
+    uint32_t y = row * block_extent;
+    uint32_t band_height = std::min(rows * block_extent, height - y);
+
+    std::memcpy(stageImage(dst, mip_level, array_layer, 0, y, width, band_height, rows * row_size), src + row * row_size, rows * row_size);
+  }
+
+  transitionImage(dst, mip_level, array_layer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+VkCommandBuffer StagingUploader::batchCommandBuffer()
+{
+  beginBatch();
+  return command_buffer;
+}
+
+void StagingUploader::flush()
+{
+  if (!recording)
+  {
+    return;
+  }
+
+  // Make the copies visible to whatever is submitted after this batch
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to record upload command buffer!");
+  }
+
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &command_buffer;
+
+  if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to submit upload command buffer!");
+  }
+
+  vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+  vkResetFences(device, 1, &fence);
+  vkResetCommandPool(device, command_pool, 0);
+
+  staging_offset = 0;
+  recording = false;
+}
@@ -0,0 +1,458 @@
+#include "TextureAtlas.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+  const char *const PLACEMENT_KIND_NAMES[] = {"standalone", "atlas", "array"};
+
+  uint32_t alignUp(uint32_t value, uint32_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  uint32_t log2(uint32_t value)
+  {
+    uint32_t bits = 0;
+    while (value > 1)
+    {
+      value >>= 1;
+      bits++;
+    }
+    return bits;
+  }
+
+  // Source texel for a padding texel: wrapped for repeating textures, clamped otherwise
+  uint32_t paddedCoordinate(int32_t coordinate, uint32_t size, bool repeat)
+  {
+    int32_t extent = static_cast<int32_t>(size);
+    if (repeat)
+    {
+      return static_cast<uint32_t>(((coordinate % extent) + extent) % extent);
+    }
+    return static_cast<uint32_t>(std::clamp(coordinate, 0, extent - 1));
+  }
+
+  // Copies the image into its cell at (x, y), filling the padding around it
+  void blitPadded(ImageData &page, const ImageData &image, uint32_t x, uint32_t y, uint32_t cell_width, uint32_t cell_height, uint32_t padding, bool repeat)
+  {
+    for (uint32_t cy = 0; cy < cell_height; cy++)
+    {
+      uint32_t sy = paddedCoordinate(static_cast<int32_t>(cy) - static_cast<int32_t>(padding), image.height, repeat);
+
+      for (uint32_t cx = 0; cx < cell_width; cx++)
+      {
+        uint32_t sx = paddedCoordinate(static_cast<int32_t>(cx) - static_cast<int32_t>(padding), image.width, repeat);
+        const uint8_t *src = &image.pixels[(size_t(sy) * image.width + sx) * 4];
+        uint8_t *dst = &page.pixels[(size_t(y + cy) * page.width + x + cx) * 4];
+        std::copy(src, src + 4, dst);
+      }
+    }
+  }
+
+  bool remapsUvs(const TexturePlacement &placement)
+  {
+    return placement.kind == TEXTURE_PLACEMENT_ATLAS && !placement.repeat;
+  }
+}
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+  : width(width), height(height)
+{
+  skyline.push_back({0, 0, width});
+}
+
+bool SkylinePacker::fits(size_t node, uint32_t rect_width, uint32_t rect_height, uint32_t &y) const
+{
+  uint32_t x = skyline[node].x;
+  if (x + rect_width > width)
+  {
+    return false;
+  }
+
+  // Rests on the highest node under its span
+  y = 0;
+  uint32_t remaining = rect_width;
+  for (size_t i = node; remaining > 0; i++)
+  {
+    y = std::max(y, skyline[i].y);
+    remaining -= std::min(remaining, skyline[i].width);
+  }
+
+  return y + rect_height <= height;
+}
+
+bool SkylinePacker::insert(uint32_t rect_width, uint32_t rect_height, uint32_t &x, uint32_t &y)
+{
+  size_t best = skyline.size();
+  uint32_t best_top = UINT32_MAX;
+  uint32_t best_width = UINT32_MAX;
+  uint32_t best_y = 0;
+
+  for (size_t i = 0; i < skyline.size(); i++)
+  {
+    uint32_t node_y = 0;
+    if (fits(i, rect_width, rect_height, node_y))
+    {
+      uint32_t top = node_y + rect_height;
+      if (top < best_top || (top == best_top && skyline[i].width < best_width))
+      {
+        best = i;
+        best_top = top;
+        best_width = skyline[i].width;
+        best_y = node_y;
+      }
+    }
+  }
+
+  if (best == skyline.size())
+  {
+    return false;
+  }
+
+  x = skyline[best].x;
+  y = best_y;
+  skyline.insert(skyline.begin() + best, {x, y + rect_height, rect_width});
+
+  // Nodes under the new one shrink or go
+  uint32_t right = x + rect_width;
+  while (best + 1 < skyline.size() && skyline[best + 1].x < right)
+  {
+    SkylineNode &node = skyline[best + 1];
+    uint32_t overlap = right - node.x;
+
+    if (node.width > overlap)
+    {
+      node.x += overlap;
+      node.width -= overlap;
+      break;
+    }
+
+    skyline.erase(skyline.begin() + best + 1);
+  }
+
+  for (size_t i = 0; i + 1 < skyline.size();)
+  {
+    if (skyline[i].y == skyline[i + 1].y)
+    {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  used_area += uint64_t(rect_width) * rect_height;
+  return true;
+}
+
+uint32_t SkylinePacker::usedHeight() const
+{
+  uint32_t used = 0;
+  for (const SkylineNode &node : skyline)
+  {
+    used = std::max(used, node.y);
+  }
+  return used;
+}
+
+float SkylinePacker::occupancy() const
+{
+  uint64_t area = uint64_t(width) * usedHeight();
+  return area > 0 ? float(double(used_area) / double(area)) : 0.0f;
+}
+
+uint32_t PackedTextures::bindGroup(uint32_t texture) const
+{
+  const TexturePlacement &placement = placements[texture];
+
+  switch (placement.kind)
+  {
+  case TEXTURE_PLACEMENT_ATLAS: return placement.group;
+  case TEXTURE_PLACEMENT_ARRAY: return static_cast<uint32_t>(pages.size()) + placement.group;
+  default: return static_cast<uint32_t>(pages.size() + arrays.size()) + placement.group;
+  }
+}
+
+PackedTextures packTextures(const std::vector<TexturePackInput> &textures, const TexturePackSettings &settings)
+{
+  uint32_t padding = settings.padding;
+
+  if (padding == 0 || (padding & (padding - 1)) != 0 || settings.page_size % padding != 0)
+  {
+    throw std::runtime_error("atlas padding must be a power of two dividing the page size!");
+  }
+
+  PackedTextures packed;
+  packed.placements.resize(textures.size());
+
+  // Arrays: textures of one size and color space
+  std::map<std::tuple<uint32_t, uint32_t, bool>, std::vector<uint32_t>> size_classes;
+  for (uint32_t i = 0; i < textures.size(); i++)
+  {
+    size_classes[{textures[i].image->width, textures[i].image->height, textures[i].srgb}].push_back(i);
+  }
+
+  std::vector<uint32_t> remaining;
+  uint32_t max_layers = std::max(settings.max_array_layers, 1u);
+
+  for (const auto &size_class : size_classes)
+  {
+    const std::vector<uint32_t> &members = size_class.second;
+
+    for (size_t first = 0; first < members.size(); first += max_layers)
+    {
+      size_t count = std::min<size_t>(max_layers, members.size() - first);
+
+      if (count < std::max(settings.min_array_layers, 2u))
+      {
+        remaining.insert(remaining.end(), members.begin() + first, members.begin() + first + count);
+        continue;
+      }
+
+      TextureArrayGroup group;
+      group.srgb = std::get<2>(size_class.first);
+      group.width = std::get<0>(size_class.first);
+      group.height = std::get<1>(size_class.first);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        uint32_t texture = members[first + i];
+        TexturePlacement &placement = packed.placements[texture];
+        placement.kind = TEXTURE_PLACEMENT_ARRAY;
+        placement.group = static_cast<uint32_t>(packed.arrays.size());
+        placement.layer = static_cast<uint32_t>(i);
+        placement.repeat = textures[texture].repeat;
+        group.textures.push_back(texture);
+      }
+
+      packed.arrays.push_back(std::move(group));
+    }
+  }
+
+  // Atlas pages: the small leftovers, tallest first
+  auto cellWidth = [&](uint32_t texture) { return alignUp(textures[texture].image->width + 2 * padding, padding); };
+  auto cellHeight = [&](uint32_t texture) { return alignUp(textures[texture].image->height + 2 * padding, padding); };
+
+  std::vector<uint32_t> atlas_textures;
+  for (uint32_t texture : remaining)
+  {
+    const ImageData &image = *textures[texture].image;
+    bool small = std::max(image.width, image.height) <= settings.max_atlas_size;
+
+    if (small && cellWidth(texture) <= settings.page_size && cellHeight(texture) <= settings.page_size)
+    {
+      atlas_textures.push_back(texture);
+    }
+    else
+    {
+      TexturePlacement &placement = packed.placements[texture];
+      placement.kind = TEXTURE_PLACEMENT_STANDALONE;
+      placement.group = static_cast<uint32_t>(packed.standalone.size());
+      placement.repeat = textures[texture].repeat;
+      packed.standalone.push_back(texture);
+    }
+  }
+
+  std::sort(atlas_textures.begin(), atlas_textures.end(), [&](uint32_t a, uint32_t b)
+  {
+    return std::make_tuple(cellHeight(b), cellWidth(b), a) < std::make_tuple(cellHeight(a), cellWidth(a), b);
+  });
+
+  std::vector<SkylinePacker> packers;
+  std::vector<glm::uvec2> cells(textures.size());
+
+  for (uint32_t texture : atlas_textures)
+  {
+    uint32_t page = 0;
+    for (; page < packed.pages.size(); page++)
+    {
+      if (packed.pages[page].srgb == textures[texture].srgb && packers[page].insert(cellWidth(texture), cellHeight(texture), cells[texture].x, cells[texture].y))
+      {
+        break;
+      }
+    }
+
+    if (page == packed.pages.size())
+    {
+      packed.pages.emplace_back();
+      packed.pages.back().srgb = textures[texture].srgb;
+      packers.emplace_back(settings.page_size, settings.page_size);
+      packers.back().insert(cellWidth(texture), cellHeight(texture), cells[texture].x, cells[texture].y);
+    }
+
+    packed.pages[page].textures.push_back(texture);
+  }
+
+  for (uint32_t page_index = 0; page_index < packed.pages.size(); page_index++)
+  {
+    AtlasPage &page = packed.pages[page_index];
+
+    // Trimmed to the cells, still a multiple of the padding so the kept mips halve exactly
+    uint32_t page_width = 0;
+    for (uint32_t texture : page.textures)
+    {
+      page_width = std::max(page_width, cells[texture].x + cellWidth(texture));
+    }
+
+    page.image.width = page_width;
+    page.image.height = alignUp(packers[page_index].usedHeight(), padding);
+    page.image.pixels.assign(size_t(page.image.width) * page.image.height * 4, 0);
+    page.mip_count = std::min(log2(padding) + 1, mipLevelCount(page.image.width, page.image.height));
+
+    glm::vec2 page_size(page.image.width, page.image.height);
+    uint64_t texture_area = 0;
+
+    for (uint32_t texture : page.textures)
+    {
+      const ImageData &image = *textures[texture].image;
+      blitPadded(page.image, image, cells[texture].x, cells[texture].y, cellWidth(texture), cellHeight(texture), padding, textures[texture].repeat);
+
+      TexturePlacement &placement = packed.placements[texture];
+      placement.kind = TEXTURE_PLACEMENT_ATLAS;
+      placement.group = page_index;
+      placement.repeat = textures[texture].repeat;
+      placement.uv_offset = (glm::vec2(cells[texture]) + glm::vec2(float(padding))) / page_size;
+      placement.uv_scale = glm::vec2(image.width, image.height) / page_size;
+      texture_area += uint64_t(image.width) * image.height;
+    }
+
+    page.occupancy = float(double(texture_area) / (double(page.image.width) * page.image.height));
+  }
+
+  return packed;
+}
+
+glm::vec2 atlasUv(const TexturePlacement &placement, glm::vec2 uv)
+{
+  return placement.uv_offset + uv * placement.uv_scale;
+}
+
+void remapUvs(MeshData &mesh, const std::vector<TexturePlacement> &submesh_placements)
+{
+  if (submesh_placements.size() != mesh.submeshes.size())
+  {
+    throw std::runtime_error("uv remapping needs one placement per submesh!");
+  }
+
+  const uint32_t no_owner = UINT32_MAX;
+  std::vector<uint32_t> owners(mesh.vertices.size(), no_owner);
+
+  for (uint32_t s = 0; s < mesh.submeshes.size(); s++)
+  {
+    const Submesh &submesh = mesh.submeshes[s];
+    const TexturePlacement &placement = submesh_placements[s];
+
+    for (uint32_t i = submesh.index_offset; i < submesh.index_offset + submesh.index_count; i++)
+    {
+      uint32_t &owner = owners[mesh.indices[i]];
+
+      if (owner == no_owner)
+      {
+        owner = s;
+        continue;
+      }
+
+      const TexturePlacement &other = submesh_placements[owner];
+      bool same_rect = placement.uv_offset == other.uv_offset && placement.uv_scale == other.uv_scale;
+
+      if ((remapsUvs(placement) || remapsUvs(other)) && (!same_rect || remapsUvs(placement) != remapsUvs(other)))
+      {
+        throw std::runtime_error("vertex shared by submeshes with different atlas rects, split it before remapping!");
+      }
+    }
+  }
+
+  const float tolerance = 1e-4f;
+
+  for (size_t v = 0; v < mesh.vertices.size(); v++)
+  {
+    if (owners[v] == no_owner || !remapsUvs(submesh_placements[owners[v]]))
+    {
+      continue;
+    }
+
+    glm::vec2 &uv = mesh.vertices[v].uv;
+
+    if (uv.x < -tolerance || uv.y < -tolerance || uv.x > 1.0f + tolerance || uv.y > 1.0f + tolerance)
+    {
+      throw std::runtime_error("uvs outside [0, 1] cannot be remapped into an atlas, pack the texture as repeating!");
+    }
+
+    uv = atlasUv(submesh_placements[owners[v]], glm::clamp(uv, glm::vec2(0.0f), glm::vec2(1.0f)));
+  }
+}
+
+void writeAtlasManifest(const std::string &file_name, const std::vector<AtlasManifestEntry> &entries)
+{
+  std::ofstream file(file_name, std::ios::trunc);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  file << std::setprecision(9);
+
+  for (const AtlasManifestEntry &entry : entries)
+  {
+    const TexturePlacement &placement = entry.placement;
+    file << entry.name << ' ' << PLACEMENT_KIND_NAMES[placement.kind] << ' ' << entry.file_name << ' ' << placement.layer << ' ' << (placement.repeat ? 1 : 0) << ' '
+      << placement.uv_offset.x << ' ' << placement.uv_offset.y << ' ' << placement.uv_scale.x << ' ' << placement.uv_scale.y << '\n';
+  }
+
+  if (!file.good())
+  {
+    throw std::runtime_error("failed to write atlas manifest!");
+  }
+}
+
+std::vector<AtlasManifestEntry> loadAtlasManifest(const std::string &file_name)
+{
+  std::ifstream file(file_name);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  std::vector<AtlasManifestEntry> entries;
+  std::string line;
+
+  while (std::getline(file, line))
+  {
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+    {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    AtlasManifestEntry entry;
+    TexturePlacement &placement = entry.placement;
+    std::string kind;
+    int repeat = 0;
+
+    fields >> entry.name >> kind >> entry.file_name >> placement.layer >> repeat >> placement.uv_offset.x >> placement.uv_offset.y >> placement.uv_scale.x >> placement.uv_scale.y;
+
+    auto kind_name = std::find(std::begin(PLACEMENT_KIND_NAMES), std::end(PLACEMENT_KIND_NAMES), kind);
+
+    if (fields.fail() || kind_name == std::end(PLACEMENT_KIND_NAMES))
+    {
+      throw std::runtime_error("invalid atlas manifest entry!");
+    }
+
+    placement.kind = static_cast<TexturePlacementKind>(kind_name - std::begin(PLACEMENT_KIND_NAMES));
+    placement.repeat = repeat != 0;
+    entries.push_back(std::move(entry));
+  }
+
+  return entries;
+}
@@ -0,0 +1,128 @@
+#include "ImageFile.hpp"
+#include "BlockCompression.hpp"
+#include "TextureFile.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cctype>
+
+bool hasAlpha(const ImageData &image)
+{
+  for (size_t i = 3; i < image.pixels.size(); i += 4)
+  {
+    if (image.pixels[i] != 255)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parseFormat(const std::string &name, TextureFormat &format)
+{
+  const TextureFormat formats[] = {TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC4, TEXTURE_FORMAT_BC5, TEXTURE_FORMAT_BC7};
+
+  for (TextureFormat candidate : formats)
+  {
+    std::string candidate_name = textureFormatName(candidate);
+    std::transform(candidate_name.begin(), candidate_name.end(), candidate_name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (name == candidate_name)
+    {
+      format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Offline converter: TGA or PNM in, .vtex out with a block compressed mip chain.
+ * auto picks BC1 for opaque images and BC7 when there is alpha; --normal stores
+ * the two normal map channels as BC5.
+ */
+int main(int argc, char *argv[])
+{
+  std::string format_name = "auto";
+  bool srgb = true;
+  bool normal = false;
+  int arg = 1;
+
+  while (arg < argc && std::string(argv[arg]).rfind("--", 0) == 0)
+  {
+    std::string option = argv[arg++];
+
+    if (option == "--format" && arg < argc)
+    {
+      format_name = argv[arg++];
+    }
+    else if (option == "--linear")
+    {
+      srgb = false;
+    }
+    else if (option == "--normal")
+    {
+      normal = true;
+      srgb = false;
+    }
+    else
+    {
+      arg = argc;
+    }
+  }
+
+  TextureFormat format = TEXTURE_FORMAT_BC7;
+
+  if (argc - arg < 2 || (format_name != "auto" && !parseFormat(format_name, format)))
+  {
+    std::cerr << "usage: TextureConverter [--format auto|rgba8|bc1|bc3|bc4|bc5|bc7] [--linear] [--normal] <input.tga|ppm|pgm> <output.vtex>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const char *input = argv[arg];
+  const char *output = argv[arg + 1];
+
+  try
+  {
+    ImageData image = loadImage(input);
+
+    if (format_name == "auto")
+    {
+      format = normal ? TEXTURE_FORMAT_BC5 : hasAlpha(image) ? TEXTURE_FORMAT_BC7 : TEXTURE_FORMAT_BC1;
+    }
+
+    // BC4 and BC5 store data channels; the file would drop the flag anyway
+    srgb = srgb && hasSrgbVariant(format);
+
+    TextureFileReport report = writeTextureFile(output, image, format, srgb);
+
+    std::cout << output << ": " << textureFormatName(format) << (srgb ? " srgb" : " linear") << ", " << image.width << "x" << image.height << ", "
+      << report.mip_count << " levels, " << report.data_bytes << " bytes ("
+      << 100.0 * report.data_bytes / std::max<size_t>(report.rgba8_bytes, 1) << "% of rgba8)" << std::endl;
+
+    if (report.level0_psnr > 0.0f)
+    {
+      std::cout << "\tlevel 0 psnr: " << report.level0_psnr << " dB" << std::endl;
+    }
+    else
+    {
+      std::cout << "\tlevel 0 psnr: lossless" << std::endl;
+    }
+
+    // Read it back the way the loader does, including the CPU fallback
+    TextureFile file(output);
+    std::vector<ImageData> levels = file.decompress();
+    std::cout << output << ": " << file.mipCount() << " levels read back, level 0 " << levels.front().width << "x" << levels.front().height << std::endl;
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+#include "TextureFile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cmath>
+
+namespace
+{
+  uint64_t alignOffset(uint64_t offset)
+  {
+    return (offset + TEXTURE_FILE_ALIGNMENT - 1) & ~(TEXTURE_FILE_ALIGNMENT - 1);
+  }
+
+  // Channels each format keeps, for the PSNR report
+  uint32_t storedChannels(TextureFormat format)
+  {
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1: return 3;
+    case TEXTURE_FORMAT_BC4: return 1;
+    case TEXTURE_FORMAT_BC5: return 2;
+    default: return 4;
+    }
+  }
+
+  void addSquaredError(const ImageData &source, const ImageData &decoded, uint32_t channels, double &error, double &count)
+  {
+    for (size_t i = 0; i < source.pixels.size(); i += 4)
+    {
+      for (uint32_t c = 0; c < channels; c++)
+      {
+        double d = double(source.pixels[i + c]) - decoded.pixels[i + c];
+        error += d * d;
+      }
+    }
+
+    count += double(source.pixels.size() / 4) * channels;
+  }
+}
+
+TextureFileReport writeTextureFile(const std::string &file_name, const ImageData &image, TextureFormat format, bool srgb, uint32_t mip_count)
+{
+  return writeTextureFile(file_name, std::vector<ImageData>{image}, format, srgb, mip_count);
+}
+
+TextureFileReport writeTextureFile(const std::string &file_name, const std::vector<ImageData> &layers, TextureFormat format, bool srgb, uint32_t mip_count)
+{
+  if (!hasBlockCodec(format))
+  {
+    throw std::runtime_error("no encoder for texture format!");
+  }
+
+  if (layers.empty())
+  {
+    throw std::runtime_error("texture has no layers!");
+  }
+
+  uint32_t width = layers.front().width;
+  uint32_t height = layers.front().height;
+
+  for (const ImageData &layer : layers)
+  {
+    if (layer.width != width || layer.height != height)
+    {
+      throw std::runtime_error("texture array layers differ in size!");
+    }
+  }
+
+  uint32_t full_chain = mipLevelCount(width, height);
+  mip_count = mip_count == 0 ? full_chain : std::min(mip_count, full_chain);
+
+  TextureFileReport report;
+  std::vector<std::vector<uint8_t>> levels(size_t(mip_count) * layers.size());
+  double error = 0.0;
+  double count = 0.0;
+
+  for (size_t layer = 0; layer < layers.size(); layer++)
+  {
+    ImageData level = layers[layer];
+
+    for (uint32_t i = 0; i < mip_count; i++)
+    {
+      if (i > 0)
+      {
+        level = downsampleImage(level);
+      }
+
+      std::vector<uint8_t> &encoded = levels[i * layers.size() + layer];
+      encoded = compressImage(level, format);
+      report.data_bytes += encoded.size();
+      report.rgba8_bytes += level.pixels.size();
+
+      if (i == 0)
+      {
+        addSquaredError(level, decompressImage(encoded.data(), level.width, level.height, format), storedChannels(format), error, count);
+      }
+    }
+  }
+
+  writeTextureLevels(file_name, format, srgb, width, height, static_cast<uint32_t>(layers.size()), levels);
+  report.mip_count = mip_count;
+  report.layer_count = static_cast<uint32_t>(layers.size());
+
+  double mean_error = error / std::max(count, 1.0);
+  report.level0_psnr = mean_error > 0.0 ? float(10.0 * std::log10(255.0 * 255.0 / mean_error)) : 0.0f;
+
+  return report;
+}
+
+void writeTextureLevels(const std::string &file_name, TextureFormat format, bool srgb, uint32_t width, uint32_t height, uint32_t layer_count, const std::vector<std::vector<uint8_t>> &levels)
+{
+  if (layer_count == 0 || levels.empty() || levels.size() % layer_count != 0)
+  {
+    throw std::runtime_error("texture levels do not cover every layer!");
+  }
+
+  TextureFileHeader header{};
+  header.magic = TEXTURE_FILE_MAGIC;
+  header.version = TEXTURE_FILE_VERSION;
+  header.format = format;
+  header.flags = srgb && hasSrgbVariant(format) ? TEXTURE_FILE_SRGB : 0;
+  header.width = width;
+  header.height = height;
+  header.mip_count = static_cast<uint32_t>(levels.size() / layer_count);
+  header.layer_count = layer_count;
+
+  std::vector<TextureFileLevel> table(levels.size());
+  uint64_t offset = alignOffset(sizeof(TextureFileHeader) + table.size() * sizeof(TextureFileLevel));
+
+  for (uint32_t i = 0; i < levels.size(); i++)
+  {
+    uint32_t mip = i / layer_count;
+    table[i].width = std::max(width >> mip, 1u);
+    table[i].height = std::max(height >> mip, 1u);
+    table[i].offset = offset;
+    table[i].size = levels[i].size();
+
+    if (table[i].size != textureLevelSize(format, table[i].width, table[i].height))
+    {
+      throw std::runtime_error("texture level size does not match its format!");
+    }
+
+    if (hasBlockCodec(format) && !canDecompress(levels[i].data(), levels[i].size(), format))
+    {
+      throw std::runtime_error("texture level has blocks the CPU fallback cannot decode (BC7 modes other than 6)!");
+    }
+
+    offset = alignOffset(offset + table[i].size);
+  }
+
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TextureFileLevel));
+
+  for (uint32_t i = 0; i < levels.size(); i++)
+  {
+    std::vector<char> padding(table[i].offset - static_cast<uint64_t>(file.tellp()), 0);
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+  }
+
+  if (!file.good())
+  {
+    throw std::runtime_error("failed to write texture file!");
+  }
+}
+
+TextureFile::TextureFile(const std::string &file_name)
+  : file(file_name)
+{
+  if (file.size() < sizeof(TextureFileHeader))
+  {
+    throw std::runtime_error("texture file is truncated!");
+  }
+
+  const TextureFileHeader &texture_header = header();
+
+  if (texture_header.magic != TEXTURE_FILE_MAGIC)
+  {
+    throw std::runtime_error("file is not a texture file!");
+  }
+
+  if (texture_header.version != TEXTURE_FILE_VERSION)
+  {
+    throw std::runtime_error("texture file version mismatch, re-run the texture converter!");
+  }
+
+  if (texture_header.format > TEXTURE_FORMAT_ASTC_4x4 || texture_header.mip_count == 0 || texture_header.layer_count == 0 ||
+    texture_header.mip_count > mipLevelCount(texture_header.width, texture_header.height))
+  {
+    throw std::runtime_error("texture file header is invalid!");
+  }
+
+  size_t level_count = size_t(texture_header.mip_count) * texture_header.layer_count;
+
+  if (sizeof(TextureFileHeader) + level_count * sizeof(TextureFileLevel) > file.size())
+  {
+    throw std::runtime_error("texture file is truncated!");
+  }
+
+  levels = reinterpret_cast<const TextureFileLevel*>(file.data() + sizeof(TextureFileHeader));
+
+  for (size_t i = 0; i < level_count; i++)
+  {
+    const TextureFileLevel &entry = levels[i];
+    uint32_t mip = static_cast<uint32_t>(i / texture_header.layer_count);
+    bool matches = entry.width == std::max(texture_header.width >> mip, 1u) && entry.height == std::max(texture_header.height >> mip, 1u) &&
+      entry.size == textureLevelSize(format(), entry.width, entry.height) && entry.offset % TEXTURE_FILE_ALIGNMENT == 0;
+
+    if (!matches || entry.offset + entry.size > file.size())
+    {
+      throw std::runtime_error("texture level is out of bounds!");
+    }
+  }
+}
+
+const TextureFileHeader &TextureFile::header() const
+{
+  return *reinterpret_cast<const TextureFileHeader*>(file.data());
+}
+
+std::vector<ImageData> TextureFile::decompress() const
+{
+  std::vector<ImageData> images;
+  for (uint32_t mip = 0; mip < mipCount(); mip++)
+  {
+    for (uint32_t layer = 0; layer < layerCount(); layer++)
+    {
+      images.push_back(decompressImage(levelData(mip, layer), level(mip, layer).width, level(mip, layer).height, format()));
+    }
+  }
+  return images;
+}
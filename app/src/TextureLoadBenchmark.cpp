@@ -0,0 +1,469 @@
+#include "TextureLoader.hpp"
+#include "TextureFile.hpp"
+#include "TextureAtlas.hpp"
+#include "PackedTextureSet.hpp"
+#include "DescriptorAllocator.hpp"
+#include "StagingUploader.hpp"
+#include "JobSystem.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <set>
+#include <cstdlib>
+
+/**
+ * Headless run of TextureLoader over synthetic .vtex files (RGBA8, BC1 and
+ * BC7 in turn, written to the working directory) with a small per-update
+ * upload budget, one update per simulated 60 Hz frame. Every handle must show
+ * the placeholder until the update that lists it in becameResident() and its
+ * own image from then on, and an update may only leave decoded textures
+ * waiting once it spent the budget. Prints TextureLoadStats for every update
+ * that uploaded something, then the load() cost, the decode times and the
+ * load latencies.
+ *
+ * Then packs a set of images the way TexturePacker does (atlas pages, an
+ * array, a standalone texture, as RGBA8 .vtex plus an .atlas manifest), loads
+ * the manifest's files through the same loader and binds one descriptor set
+ * per texture through DescriptorAllocator: textures of a bind group share a
+ * file, so they must share a handle and a set. PackedTextureSet packs the same
+ * images in memory and must agree with the manifest.
+ * Usage: TextureLoadBenchmark [textures] [budget KiB]
+ */
+namespace
+{
+  const int MAX_FRAMES = 600;
+  const std::chrono::microseconds FRAME_TIME(16667);
+
+  // Distinct sizes go to atlas pages, equal ones to an array, large ones stand alone
+  const uint32_t ATLAS_TEXTURES = 10;
+  const uint32_t ARRAY_LAYERS = 4;
+  const uint32_t ARRAY_SIZE = 256;
+  const uint32_t STANDALONE_SIZE = 768;
+  const char *const ATLAS_PREFIX = "packed_textures";
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Texture Load Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Uploads only, so any graphics queue will do
+    for (VkPhysicalDevice device : devices)
+    {
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      for (uint32_t i = 0; i < family_count && context.physical_device == VK_NULL_HANDLE; i++)
+      {
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+        }
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with a graphics queue!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  /**
+   * Smooth gradients with a few hard edges, so block compression has work to do
+   */
+  ImageData createTestImage(uint32_t width, uint32_t height, uint32_t seed)
+  {
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+      for (uint32_t x = 0; x < width; x++)
+      {
+        uint8_t *pixel = &image.pixels[(size_t(y) * width + x) * 4];
+        pixel[0] = static_cast<uint8_t>(x * 255 / width);
+        pixel[1] = static_cast<uint8_t>(y * 255 / height);
+        pixel[2] = static_cast<uint8_t>(((x + seed * 8) / 16 + y / 16) % 2 * 192);
+        pixel[3] = 255;
+      }
+    }
+
+    return image;
+  }
+
+  /**
+   * What TexturePacker writes for `images`: every bind group as an RGBA8 .vtex
+   * and <prefix>.atlas pointing each image at its group's file
+   */
+  PackedTextures writePackedSet(const std::string &prefix, const std::vector<ImageData> &images, const std::vector<TexturePackInput> &inputs)
+  {
+    PackedTextures packed = packTextures(inputs);
+    std::vector<std::string> group_files;
+
+    for (size_t i = 0; i < packed.pages.size(); i++)
+    {
+      group_files.push_back(prefix + "_page" + std::to_string(i) + ".vtex");
+      writeTextureFile(group_files.back(), packed.pages[i].image, TEXTURE_FORMAT_RGBA8, packed.pages[i].srgb, packed.pages[i].mip_count);
+    }
+
+    for (size_t i = 0; i < packed.arrays.size(); i++)
+    {
+      std::vector<ImageData> layers;
+      for (uint32_t texture : packed.arrays[i].textures)
+      {
+        layers.push_back(images[texture]);
+      }
+
+      group_files.push_back(prefix + "_array" + std::to_string(i) + ".vtex");
+      writeTextureFile(group_files.back(), layers, TEXTURE_FORMAT_RGBA8, packed.arrays[i].srgb);
+    }
+
+    for (size_t i = 0; i < packed.standalone.size(); i++)
+    {
+      group_files.push_back(prefix + "_texture" + std::to_string(i) + ".vtex");
+      writeTextureFile(group_files.back(), images[packed.standalone[i]], TEXTURE_FORMAT_RGBA8, inputs[packed.standalone[i]].srgb);
+    }
+
+    std::vector<AtlasManifestEntry> entries;
+    for (uint32_t i = 0; i < images.size(); i++)
+    {
+      entries.push_back({"texture" + std::to_string(i), group_files[packed.bindGroup(i)], packed.placements[i]});
+    }
+
+    writeAtlasManifest(prefix + ".atlas", entries);
+    return packed;
+  }
+
+  bool samePlacement(const TexturePlacement &a, const TexturePlacement &b)
+  {
+    return a.kind == b.kind && a.layer == b.layer && a.repeat == b.repeat && a.uv_offset == b.uv_offset && a.uv_scale == b.uv_scale;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t texture_count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 24;
+  VkDeviceSize budget = argc > 2 ? VkDeviceSize(std::strtod(argv[2], nullptr) * 1024.0) : 1024 * 1024;
+
+  if (texture_count == 0)
+  {
+    std::cerr << "usage: TextureLoadBenchmark [textures] [budget KiB]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    // Every upload either as stored or expanded to RGBA8, whichever the device takes
+    const TextureFormat formats[] = {TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC7};
+    std::vector<std::string> file_names;
+    size_t largest_upload = 0;
+    size_t total_bytes = 0;
+
+    for (uint32_t i = 0; i < texture_count; i++)
+    {
+      TextureFormat format = formats[i % 3];
+      std::string file_name = "loaded_texture_" + std::to_string(i) + ".vtex";
+      TextureFileReport report = writeTextureFile(file_name, createTestImage(i % 2 == 0 ? 256 : 512, i % 2 == 0 ? 256 : 512, i), format, true);
+
+      file_names.push_back(file_name);
+      largest_upload = std::max(largest_upload, std::max(report.data_bytes, report.rgba8_bytes));
+      total_bytes += report.data_bytes;
+    }
+
+    std::cout << texture_count << " textures, " << total_bytes / 1024 << " KiB as stored, upload budget " << budget / 1024 << " KiB" << std::endl;
+
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    JobSystem jobs;
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    TextureLoader loader;
+    loader.upload_budget = budget;
+    loader.init(device, context.physical_device, uploader, jobs);
+
+    // Returns at once; the reads and decodes run on the workers
+    auto load_start = std::chrono::high_resolution_clock::now();
+    std::vector<TextureHandle> textures;
+    for (const std::string &file_name : file_names)
+    {
+      textures.push_back(loader.load(file_name));
+    }
+    auto load_end = std::chrono::high_resolution_clock::now();
+
+    // Nothing is resident before the first update, so every view is the placeholder
+    VkImageView placeholder = loader.view(textures[0]);
+    bool passed = true;
+
+    auto expect = [&](bool condition, const char *message)
+    {
+      if (!condition)
+      {
+        std::cerr << message << std::endl;
+        passed = false;
+      }
+    };
+
+    expect(loader.load(file_names[0]) == textures[0], "loading a file twice did not return its first handle!");
+
+    for (TextureHandle texture : textures)
+    {
+      expect(!loader.isResident(texture) && loader.view(texture) == placeholder, "a texture was resident before the first update!");
+    }
+
+    std::vector<VkImageView> views(texture_count, placeholder);
+    int swap_errors = 0;
+    int budget_errors = 0;
+    int frame = 0;
+
+    auto next_frame = std::chrono::steady_clock::now();
+    for (; frame < MAX_FRAMES && loader.stats().resident + loader.stats().failed < texture_count; frame++)
+    {
+      next_frame += FRAME_TIME;
+      std::this_thread::sleep_until(next_frame);
+
+      loader.update();
+      const TextureLoadStats &stats = loader.stats();
+
+      // Each view changes once, from the placeholder, in the update that reports it
+      const std::vector<TextureHandle> &resident = loader.becameResident();
+      for (uint32_t i = 0; i < texture_count; i++)
+      {
+        bool reported = std::find(resident.begin(), resident.end(), textures[i]) != resident.end();
+        VkImageView view = loader.view(textures[i]);
+        bool swapped = view != views[i];
+
+        swap_errors += swapped != reported || (reported && (views[i] != placeholder || view == placeholder)) ? 1 : 0;
+        swap_errors += loader.isResident(textures[i]) == (view == placeholder) ? 1 : 0;
+        views[i] = view;
+      }
+
+      // The budget may be crossed by the texture that spends it, and must be spent before any decoded one waits
+      budget_errors += stats.uploaded_bytes >= budget + largest_upload ? 1 : 0;
+      budget_errors += stats.decoded > 0 && stats.uploaded_bytes < budget ? 1 : 0;
+
+      if (stats.uploaded > 0)
+      {
+        std::cout << "frame " << frame << ": " << stats.uploaded << " uploaded (" << stats.uploaded_bytes / 1024 << " KiB), "
+          << stats.pending << " pending, " << stats.decoded << " decoded and waiting, " << stats.resident << " resident" << std::endl;
+      }
+    }
+
+    const TextureLoadStats &stats = loader.stats();
+    float decode_ms = 0.0f;
+    float max_decode_ms = 0.0f;
+    for (TextureHandle texture : textures)
+    {
+      decode_ms += loader.timing(texture).decode_ms;
+      max_decode_ms = std::max(max_decode_ms, loader.timing(texture).decode_ms);
+    }
+
+    std::cout << texture_count << " load() calls in " << std::chrono::duration<double, std::milli>(load_end - load_start).count() << " ms, "
+      << frame << " frames to load them all" << std::endl;
+    std::cout << "decode: " << decode_ms / texture_count << " ms average, " << max_decode_ms << " ms max, " << stats.transcoded << " transcoded" << std::endl;
+    std::cout << "load to resident: " << stats.average_latency_ms << " ms average, " << stats.max_latency_ms << " ms max" << std::endl;
+
+    for (TextureHandle texture : textures)
+    {
+      if (loader.isFailed(texture))
+      {
+        std::cerr << loader.error(texture) << std::endl;
+      }
+    }
+
+    expect(stats.resident == texture_count && stats.failed == 0, "textures failed or were still loading!");
+    expect(stats.pending == 0 && stats.decoded == 0, "the loader still reports textures in flight!");
+    expect(swap_errors == 0, "a view did not swap from the placeholder exactly when the texture became resident!");
+    expect(budget_errors == 0, "an update broke the upload budget!");
+
+    // The packed set, loaded from its manifest
+    std::vector<ImageData> images;
+    for (uint32_t i = 0; i < ATLAS_TEXTURES; i++)
+    {
+      images.push_back(createTestImage(40 + 12 * i, 64 + 8 * i, i));
+    }
+    for (uint32_t i = 0; i < ARRAY_LAYERS; i++)
+    {
+      images.push_back(createTestImage(ARRAY_SIZE, ARRAY_SIZE, ATLAS_TEXTURES + i));
+    }
+    images.push_back(createTestImage(STANDALONE_SIZE, STANDALONE_SIZE, ATLAS_TEXTURES + ARRAY_LAYERS));
+
+    std::vector<TexturePackInput> inputs;
+    for (const ImageData &image : images)
+    {
+      inputs.push_back({&image, true, false});
+    }
+
+    PackedTextures packed = writePackedSet(ATLAS_PREFIX, images, inputs);
+    std::vector<AtlasManifestEntry> entries = loadAtlasManifest(std::string(ATLAS_PREFIX) + ".atlas");
+
+    if (entries.size() != images.size())
+    {
+      throw std::runtime_error("the atlas manifest lost entries!");
+    }
+
+    std::vector<TextureHandle> packed_textures;
+    bool placements_match = true;
+    for (uint32_t i = 0; i < entries.size(); i++)
+    {
+      placements_match = placements_match && samePlacement(entries[i].placement, packed.placements[i]);
+      packed_textures.push_back(loader.load(entries[i].file_name));
+    }
+    expect(placements_match, "the atlas manifest does not hold the packed placements!");
+
+    int packed_frames = 0;
+    auto packedResident = [&]()
+    {
+      return std::all_of(packed_textures.begin(), packed_textures.end(), [&](TextureHandle texture) { return loader.isResident(texture) || loader.isFailed(texture); });
+    };
+    for (next_frame = std::chrono::steady_clock::now(); packed_frames < MAX_FRAMES && !packedResident(); packed_frames++)
+    {
+      next_frame += FRAME_TIME;
+      std::this_thread::sleep_until(next_frame);
+      loader.update();
+    }
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = 1;
+    set_layout_info.pBindings = &binding;
+
+    VkDescriptorSetLayout set_layout;
+    if (vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    DescriptorAllocator descriptors;
+    descriptors.init(device, 1, static_cast<uint32_t>(images.size()), {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}});
+    descriptors.beginFrame(0);
+
+    // One set per texture as a draw per texture would ask; a bind group's textures get the same one
+    std::set<TextureHandle> packed_handles(packed_textures.begin(), packed_textures.end());
+    std::set<VkDescriptorSet> loaded_sets;
+    for (TextureHandle texture : packed_textures)
+    {
+      loaded_sets.insert(descriptors.allocate(set_layout, {imageDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, loader.view(texture), loader.sampler())}));
+    }
+
+    // The same images packed at load time instead
+    PackedTextureSet packed_set;
+    packed_set.init(device, context.physical_device, uploader, inputs);
+
+    bool packed_set_matches = packed_set.bindGroupCount() == packed.bindGroupCount();
+    std::set<VkDescriptorSet> packed_sets;
+    for (uint32_t i = 0; i < images.size() && packed_set_matches; i++)
+    {
+      uint32_t group = packed_set.bindGroup(i);
+      packed_set_matches = samePlacement(packed_set.placement(i), entries[i].placement) &&
+        packed_set.isArray(group) == (entries[i].placement.kind == TEXTURE_PLACEMENT_ARRAY);
+      packed_sets.insert(descriptors.allocate(set_layout, {imageDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, packed_set.view(group), loader.sampler())}));
+    }
+
+    std::cout << images.size() << " packed textures: " << packed.pages.size() << " atlas pages, " << packed.arrays.size() << " arrays, "
+      << packed.standalone.size() << " standalone, loaded in " << packed_frames << " frames" << std::endl;
+    std::cout << "descriptor sets for one draw per texture: " << images.size() << " -> " << loaded_sets.size() << " from the manifest, "
+      << packed_sets.size() << " from PackedTextureSet, " << descriptors.stats().reused << " reused" << std::endl;
+
+    expect(packedResident() && std::none_of(packed_textures.begin(), packed_textures.end(), [&](TextureHandle texture) { return loader.isFailed(texture); }),
+      "the packed texture files did not load!");
+    expect(packed_handles.size() == packed.bindGroupCount() && loaded_sets.size() == packed.bindGroupCount(),
+      "the manifest's textures did not share one handle and one set per bind group!");
+    expect(packed_set_matches && packed_sets.size() == packed.bindGroupCount(), "PackedTextureSet does not match the atlas manifest!");
+
+    descriptors.cleanup();
+    vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+    packed_set.cleanup();
+    loader.cleanup();
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    if (!passed)
+    {
+      std::cerr << "texture loading checks failed!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+#include "TextureLoader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+  float millisecondsSince(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  bool isTextureFile(const std::string &file_name)
+  {
+    const std::string extension = ".vtex";
+    return file_name.size() >= extension.size() && file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0;
+  }
+}
+
+void TextureLoader::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, MipGenerator *mips)
+{
+  this->device = device;
+  this->physical_device = physical_device;
+  this->uploader = &uploader;
+  this->jobs = &jobs;
+  this->mips = mips;
+
+  createPlaceholder(physical_device);
+  queryFormats();
+
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_LINEAR;
+  sampler_info.minFilter = VK_FILTER_LINEAR;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &default_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create texture sampler!");
+  }
+
+  load_stats = {};
+}
+
+void TextureLoader::createPlaceholder(VkPhysicalDevice physical_device)
+{
+  const uint8_t grey[4] = {128, 128, 128, 255};
+
+  placeholder = createImage(device, physical_device, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+  uploader->uploadImage(placeholder.image, 0, 1, 1, sizeof(grey), grey);
+  uploader->flush();
+}
+
+void TextureLoader::queryFormats()
+{
+  for (uint32_t format = TEXTURE_FORMAT_RGBA8; format <= TEXTURE_FORMAT_ASTC_4x4; format++)
+  {
+    for (uint32_t srgb = 0; srgb < 2; srgb++)
+    {
+      VkFormatProperties properties;
+      vkGetPhysicalDeviceFormatProperties(physical_device, vulkanFormat(static_cast<TextureFormat>(format), srgb != 0), &properties);
+      sampled_formats[format][srgb] = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+  }
+}
+
+Image TextureLoader::createTextureImage(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t layer_count, VkFormat format, VkImageUsageFlags extra_usage) const
+{
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | extra_usage;
+
+  if (layer_count > 1)
+  {
+    return createImageArray(device, physical_device, width, height, mip_count, layer_count, format, usage, VK_IMAGE_ASPECT_COLOR_BIT);
+  }
+
+  return createImage(device, physical_device, width, height, mip_count, format, usage, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+VkFormat TextureLoader::vulkanFormat(TextureFormat format, bool srgb)
+{
+  // BC4 and BC5 hold data channels, they have no sRGB variant
+  switch (format)
+  {
+  case TEXTURE_FORMAT_BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  case TEXTURE_FORMAT_ASTC_4x4: return srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+  default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  }
+}
+
+void TextureLoader::cleanup()
+{
+  // Decode jobs hold on to this object
+  if (jobs != nullptr)
+  {
+    jobs->waitIdle();
+  }
+
+  for (Texture &texture : textures)
+  {
+    if (texture.image.image != VK_NULL_HANDLE)
+    {
+      destroyImage(device, texture.image);
+    }
+  }
+
+  if (placeholder.image != VK_NULL_HANDLE)
+  {
+    destroyImage(device, placeholder);
+  }
+
+  vkDestroySampler(device, default_sampler, nullptr);
+  default_sampler = VK_NULL_HANDLE;
+
+  textures.clear();
+  handles.clear();
+  ready.clear();
+  decoded.clear();
+  resident_this_update.clear();
+  total_latency_ms = 0.0;
+  loading = 0;
+  jobs = nullptr;
+  uploader = nullptr;
+  mips = nullptr;
+}
+
+TextureHandle TextureLoader::load(const std::string &file_name, bool srgb)
+{
+  auto existing = handles.find(file_name);
+  if (existing != handles.end())
+  {
+    return existing->second;
+  }
+
+  TextureHandle texture = static_cast<TextureHandle>(textures.size());
+  textures.emplace_back();
+  textures.back().srgb = srgb;
+  textures.back().requested = Clock::now();
+  handles.emplace(file_name, texture);
+  loading++;
+
+  jobs->submit([this, texture, file_name, srgb]()
+  {
+    DecodedTexture result = decodeTexture(texture, file_name, srgb);
+
+    std::lock_guard<std::mutex> lock(decoded_mutex);
+    decoded.push_back(std::move(result));
+  });
+
+  return texture;
+}
+
+TextureLoader::DecodedTexture TextureLoader::decodeTexture(TextureHandle texture, const std::string &file_name, bool srgb) const
+{
+  Clock::time_point start = Clock::now();
+  DecodedTexture result{texture, {}, nullptr, 1, srgb, false, 0.0f, {}};
+
+  try
+  {
+    if (isTextureFile(file_name))
+    {
+      std::unique_ptr<TextureFile> file = std::make_unique<TextureFile>(file_name);
+      // Files written before BC4 and BC5 dropped the flag may still carry it
+      result.srgb = file->isSrgb() && hasSrgbVariant(file->format());
+      result.layer_count = file->layerCount();
+
+      if (sampled_formats[file->format()][result.srgb])
+      {
+        result.file = std::move(file);
+      }
+      else if (hasBlockCodec(file->format()))
+      {
+        result.levels = file->decompress();
+        result.transcoded = true;
+      }
+      else
+      {
+        throw std::runtime_error(std::string("device cannot sample ") + textureFormatName(file->format()) + " and there is no CPU fallback for it!");
+      }
+    }
+    else
+    {
+      result.levels.push_back(loadImage(file_name));
+    }
+  }
+  catch (const std::exception &e)
+  {
+    result.error = file_name + ": " + e.what();
+  }
+
+  result.decode_ms = millisecondsSince(start);
+  return result;
+}
+
+void TextureLoader::update()
+{
+  load_stats.uploaded = 0;
+  load_stats.uploaded_bytes = 0;
+  resident_this_update.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(decoded_mutex);
+    for (DecodedTexture &result : decoded)
+    {
+      ready.push_back(std::move(result));
+    }
+    decoded.clear();
+  }
+
+  // Oldest first, stop once the budget is spent but always make progress
+  while (!ready.empty() && (load_stats.uploaded_bytes == 0 || load_stats.uploaded_bytes < upload_budget))
+  {
+    DecodedTexture result = std::move(ready.front());
+    ready.pop_front();
+
+    Texture &texture = textures[result.texture];
+    texture.timing.decode_ms = result.decode_ms;
+    loading--;
+
+    if (!result.error.empty())
+    {
+      texture.state = TextureState::Failed;
+      texture.error = std::move(result.error);
+      load_stats.failed++;
+      continue;
+    }
+
+    if (result.file)
+    {
+      const TextureFile &file = *result.file;
+      TextureFormatInfo info = textureFormatInfo(file.format());
+
+      texture.image = createTextureImage(file.header().width, file.header().height, file.mipCount(), file.layerCount(), vulkanFormat(file.format(), result.srgb), 0);
+
+      for (uint32_t level = 0; level < file.mipCount(); level++)
+      {
+        for (uint32_t layer = 0; layer < file.layerCount(); layer++)
+        {
+          const TextureFileLevel &entry = file.level(level, layer);
+          uploader->uploadImage(texture.image.image, level, entry.width, entry.height, info.block_size, file.levelData(level, layer), info.block_extent, layer);
+          load_stats.uploaded_bytes += entry.size;
+        }
+      }
+    }
+    else
+    {
+      const ImageData &base = result.levels.front();
+      VkFormat format = vulkanFormat(TEXTURE_FORMAT_RGBA8, result.srgb);
+      uint32_t mip_count = static_cast<uint32_t>(result.levels.size()) / result.layer_count;
+
+      // A single level gets the rest of its chain from the GPU
+      VkImageUsageFlags mip_usage = mips != nullptr && result.levels.size() == 1 ? mips->requiredUsage(format) : 0;
+      uint32_t image_mip_count = mip_usage != 0 ? mipLevelCount(base.width, base.height) : mip_count;
+
+      texture.image = createTextureImage(base.width, base.height, image_mip_count, result.layer_count, format, mip_usage);
+
+      for (uint32_t i = 0; i < result.levels.size(); i++)
+      {
+        const ImageData &image = result.levels[i];
+        uploader->uploadImage(texture.image.image, i / result.layer_count, image.width, image.height, 4, image.pixels.data(), 1, i % result.layer_count);
+        load_stats.uploaded_bytes += image.pixels.size();
+      }
+
+      if (image_mip_count > mip_count)
+      {
+        MipChainHandle chain = mips->addChain(texture.image.image, format, {base.width, base.height}, image_mip_count);
+        mips->generate(uploader->batchCommandBuffer(), chain, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        mip_chains.push_back(chain);
+      }
+
+      if (result.transcoded)
+      {
+        load_stats.transcoded++;
+      }
+    }
+
+    resident_this_update.push_back(result.texture);
+    load_stats.uploaded++;
+  }
+
+  // Also submits a trailing layout transition when a band already flushed the copies
+  uploader->flush();
+
+  for (MipChainHandle chain : mip_chains)
+  {
+    mips->removeChain(chain);
+  }
+  mip_chains.clear();
+
+  // Resident once the flush has waited for the copies
+  for (TextureHandle handle : resident_this_update)
+  {
+    Texture &texture = textures[handle];
+    texture.state = TextureState::Resident;
+    texture.timing.total_ms = millisecondsSince(texture.requested);
+
+    total_latency_ms += texture.timing.total_ms;
+    load_stats.resident++;
+    load_stats.max_latency_ms = std::max(load_stats.max_latency_ms, texture.timing.total_ms);
+  }
+
+  load_stats.decoded = static_cast<uint32_t>(ready.size());
+  load_stats.pending = loading - load_stats.decoded;
+  load_stats.average_latency_ms = load_stats.resident > 0 ? static_cast<float>(total_latency_ms / load_stats.resident) : 0.0f;
+}
+
+VkImageView TextureLoader::view(TextureHandle texture) const
+{
+  const Texture &entry = textures[texture];
+  return entry.state == TextureState::Resident ? entry.image.view : placeholder.view;
+}
@@ -0,0 +1,166 @@
+#include "ImageFile.hpp"
+#include "BlockCompression.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureFile.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+
+bool parseFormat(const std::string &name, TextureFormat &format)
+{
+  const TextureFormat formats[] = {TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC7};
+  const char *const names[] = {"rgba8", "bc1", "bc3", "bc7"};
+
+  for (size_t i = 0; i < std::size(formats); i++)
+  {
+    if (name == names[i])
+    {
+      format = formats[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+// File name without directories or extension
+std::string textureName(const std::string &file_name)
+{
+  size_t start = file_name.find_last_of("/\\");
+  start = start == std::string::npos ? 0 : start + 1;
+  size_t end = file_name.find_last_of('.');
+  return file_name.substr(start, end == std::string::npos || end < start ? std::string::npos : end - start);
+}
+
+void printReport(const std::string &file_name, const TextureFileReport &report, TextureFormat format)
+{
+  std::cout << file_name << ": " << textureFormatName(format) << ", " << report.layer_count << " layers, " << report.mip_count << " levels, "
+    << report.data_bytes << " bytes" << std::endl;
+}
+
+/**
+ * Offline packer: many TGA or PNM images in, atlas pages and texture arrays
+ * out as .vtex files, plus a manifest of where each image went. Reports how
+ * many descriptor binds a draw per texture, sorted by bind group, needs
+ * before and after packing.
+ */
+int main(int argc, char *argv[])
+{
+  TexturePackSettings settings;
+  TextureFormat format = TEXTURE_FORMAT_BC7;
+  bool srgb = true;
+  bool repeat = false;
+  bool valid = true;
+  int arg = 1;
+
+  while (arg < argc && std::string(argv[arg]).rfind("--", 0) == 0)
+  {
+    std::string option = argv[arg++];
+
+    if (option == "--page-size" && arg < argc)
+    {
+      settings.page_size = static_cast<uint32_t>(std::strtoul(argv[arg++], nullptr, 10));
+    }
+    else if (option == "--padding" && arg < argc)
+    {
+      settings.padding = static_cast<uint32_t>(std::strtoul(argv[arg++], nullptr, 10));
+    }
+    else if (option == "--format" && arg < argc)
+    {
+      valid = parseFormat(argv[arg++], format) && valid;
+    }
+    else if (option == "--linear")
+    {
+      srgb = false;
+    }
+    else if (option == "--repeat")
+    {
+      repeat = true;
+    }
+    else
+    {
+      valid = false;
+    }
+  }
+
+  if (!valid || argc - arg < 2)
+  {
+    std::cerr << "usage: TexturePacker [--page-size N] [--padding N] [--format rgba8|bc1|bc3|bc7] [--linear] [--repeat] <output prefix> <input.tga|ppm|pgm>..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string prefix = argv[arg++];
+
+  try
+  {
+    std::vector<std::string> names;
+    std::vector<ImageData> images;
+
+    for (; arg < argc; arg++)
+    {
+      names.push_back(textureName(argv[arg]));
+      images.push_back(loadImage(argv[arg]));
+    }
+
+    std::vector<TexturePackInput> inputs;
+    for (const ImageData &image : images)
+    {
+      inputs.push_back({&image, srgb, repeat});
+    }
+
+    PackedTextures packed = packTextures(inputs, settings);
+    std::vector<std::string> group_files;
+
+    for (size_t i = 0; i < packed.pages.size(); i++)
+    {
+      const AtlasPage &page = packed.pages[i];
+      std::string file_name = prefix + "_page" + std::to_string(i) + ".vtex";
+      printReport(file_name, writeTextureFile(file_name, page.image, format, srgb, page.mip_count), format);
+      std::cout << "\t" << page.textures.size() << " textures, " << page.image.width << "x" << page.image.height << ", " << 100.0f * page.occupancy << "% occupied" << std::endl;
+      group_files.push_back(file_name);
+    }
+
+    for (size_t i = 0; i < packed.arrays.size(); i++)
+    {
+      std::vector<ImageData> layers;
+      for (uint32_t texture : packed.arrays[i].textures)
+      {
+        layers.push_back(images[texture]);
+      }
+
+      std::string file_name = prefix + "_array" + std::to_string(i) + ".vtex";
+      printReport(file_name, writeTextureFile(file_name, layers, format, srgb), format);
+      group_files.push_back(file_name);
+    }
+
+    for (size_t i = 0; i < packed.standalone.size(); i++)
+    {
+      std::string file_name = prefix + "_texture" + std::to_string(i) + ".vtex";
+      printReport(file_name, writeTextureFile(file_name, images[packed.standalone[i]], format, srgb), format);
+      group_files.push_back(file_name);
+    }
+
+    std::vector<AtlasManifestEntry> entries;
+    for (uint32_t i = 0; i < images.size(); i++)
+    {
+      entries.push_back({names[i], group_files[packed.bindGroup(i)], packed.placements[i]});
+    }
+
+    std::string manifest = prefix + ".atlas";
+    writeAtlasManifest(manifest, entries);
+
+    std::cout << manifest << ": " << images.size() << " textures in " << packed.pages.size() << " atlas pages, " << packed.arrays.size() << " arrays, "
+      << packed.standalone.size() << " standalone" << std::endl;
+    std::cout << "\tdescriptor binds for one sorted draw per texture: " << images.size() << " -> " << packed.bindGroupCount() << std::endl;
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
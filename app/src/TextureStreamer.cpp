@@ -0,0 +1,532 @@
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+  // MipFeedback.glsl writes 1 + log2(pixels per uv unit) in 1/16ths
+  const float FEEDBACK_STEPS = 16.0f;
+
+  uint32_t levelSize(uint32_t size, uint32_t level)
+  {
+    return std::max(size >> level, 1u);
+  }
+
+  uint32_t tailBase(uint32_t width, uint32_t height, uint32_t min_size)
+  {
+    uint32_t mip_count = mipLevelCount(width, height);
+    uint32_t base = 0;
+    while (base + 1 < mip_count && std::max(levelSize(width, base), levelSize(height, base)) > min_size)
+    {
+      base++;
+    }
+    return base;
+  }
+}
+
+void TextureStreamer::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, uint32_t material_count, VkDeviceSize memory_budget, uint32_t frames_in_flight)
+{
+  this->device = device;
+  this->physical_device = physical_device;
+  this->uploader = &uploader;
+  this->jobs = &jobs;
+  this->memory_budget = memory_budget;
+  this->frames_in_flight = std::max(frames_in_flight, 1u);
+
+  const uint8_t grey[4] = {128, 128, 128, 255};
+  placeholder = createImage(device, physical_device, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+  uploader.uploadImage(placeholder.image, 0, 1, 1, sizeof(grey), grey);
+  uploader.flush();
+
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_LINEAR;
+  sampler_info.minFilter = VK_FILTER_LINEAR;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &default_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create texture sampler!");
+  }
+
+  // Host visible so update() reads it in place, without a copy or a wait
+  feedback.resize(this->frames_in_flight);
+  for (Buffer &buffer : feedback)
+  {
+    buffer = createBuffer(device, physical_device, std::max(material_count, 1u) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memset(buffer.mapped, 0, buffer.size);
+  }
+
+  material_textures.assign(material_count, {});
+  frame_stats = {};
+  frame_stats.budget_bytes = memory_budget;
+}
+
+void TextureStreamer::cleanup()
+{
+  // Read jobs hold on to this object
+  if (jobs != nullptr)
+  {
+    jobs->waitIdle();
+  }
+
+  for (StreamedTexture &texture : textures)
+  {
+    if (texture.image.image != VK_NULL_HANDLE)
+    {
+      destroyImage(device, texture.image);
+    }
+  }
+
+  for (RetiredImage &old : retired)
+  {
+    destroyImage(device, old.image);
+  }
+
+  for (Buffer &buffer : feedback)
+  {
+    destroyBuffer(device, buffer);
+  }
+
+  if (placeholder.image != VK_NULL_HANDLE)
+  {
+    destroyImage(device, placeholder);
+  }
+
+  vkDestroySampler(device, default_sampler, nullptr);
+  default_sampler = VK_NULL_HANDLE;
+
+  textures.clear();
+  retired.clear();
+  feedback.clear();
+  material_textures.clear();
+  changed_textures.clear();
+  finished_reads.clear();
+  pending_reads = 0;
+  resident_bytes = 0;
+  jobs = nullptr;
+  uploader = nullptr;
+}
+
+VkDeviceSize TextureStreamer::chainBytes(uint32_t width, uint32_t height, uint32_t base)
+{
+  VkDeviceSize bytes = 0;
+  uint32_t mip_count = mipLevelCount(width, height);
+
+  for (uint32_t level = base; level < mip_count; level++)
+  {
+    bytes += VkDeviceSize(levelSize(width, level)) * levelSize(height, level) * 4;
+  }
+
+  return bytes;
+}
+
+VkDeviceSize TextureStreamer::residentBytes(const StreamedTexture &texture) const
+{
+  return texture.image.image != VK_NULL_HANDLE ? chainBytes(texture.width, texture.height, texture.resident_base) : 0;
+}
+
+TextureHandle TextureStreamer::load(const std::string &file_name, bool srgb)
+{
+  TextureHandle texture = static_cast<TextureHandle>(textures.size());
+  textures.emplace_back();
+  textures.back().file_name = file_name;
+  textures.back().srgb = srgb;
+
+  submitRead(texture, TAIL);
+
+  return texture;
+}
+
+void TextureStreamer::addMaterialTexture(uint32_t material, TextureHandle texture)
+{
+  material_textures[material].push_back(texture);
+}
+
+void TextureStreamer::submitRead(TextureHandle texture, uint32_t base)
+{
+  textures[texture].requested = true;
+  pending_reads++;
+
+  jobs->submit([this, texture, base, min_size = min_resident_size, file_name = textures[texture].file_name]()
+  {
+    MipRead read{texture, base, 0, 0, {}, {}};
+
+    try
+    {
+      // The file holds level 0 only, so every read decodes it and filters down
+      ImageData level = loadImage(file_name);
+      read.width = level.width;
+      read.height = level.height;
+
+      if (read.base == TAIL)
+      {
+        read.base = tailBase(level.width, level.height, min_size);
+      }
+
+      uint32_t mip_count = mipLevelCount(level.width, level.height);
+      for (uint32_t i = 0; i < mip_count; i++)
+      {
+        if (i > 0)
+        {
+          level = downsampleImage(level);
+        }
+        if (i >= read.base)
+        {
+          read.levels.push_back(level);
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      read.error = file_name + ": " + e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(read_mutex);
+    finished_reads.push_back(std::move(read));
+  });
+}
+
+uint32_t TextureStreamer::targetMip(const StreamedTexture &texture) const
+{
+  bool recently_sampled = texture.last_sampled > 0 && texture.last_sampled + keep_frames >= frame;
+  return recently_sampled ? texture.desired : texture.tail_base;
+}
+
+void TextureStreamer::readFeedback(uint32_t frame_index)
+{
+  uint32_t *rates = static_cast<uint32_t*>(feedback[frame_index].mapped);
+
+  for (StreamedTexture &texture : textures)
+  {
+    texture.sampled_rate = 0;
+  }
+
+  // A texture used by several materials takes the finest rate
+  for (uint32_t material = 0; material < material_textures.size(); material++)
+  {
+    if (rates[material] == 0)
+    {
+      continue;
+    }
+
+    for (TextureHandle texture : material_textures[material])
+    {
+      textures[texture].sampled_rate = std::max(textures[texture].sampled_rate, rates[material]);
+    }
+  }
+
+  std::memset(rates, 0, feedback[frame_index].size);
+
+  for (StreamedTexture &texture : textures)
+  {
+    if (texture.sampled_rate == 0 || texture.mip_count == 0)
+    {
+      continue;
+    }
+
+    // Texels per pixel along the larger side are size / (pixels per uv unit)
+    float log2_pixels_per_uv = (texture.sampled_rate - 1) / FEEDBACK_STEPS;
+    float mip = std::log2(float(std::max(texture.width, texture.height))) - log2_pixels_per_uv + mip_bias;
+
+    texture.desired = static_cast<uint32_t>(std::clamp(std::floor(mip), 0.0f, float(texture.tail_base)));
+    texture.last_sampled = frame;
+  }
+}
+
+bool TextureStreamer::makeRoom(VkDeviceSize bytes, TextureHandle keep)
+{
+  VkDeviceSize free_bytes = resident_bytes < memory_budget ? memory_budget - resident_bytes : 0;
+  if (free_bytes >= bytes)
+  {
+    return true;
+  }
+
+  struct Victim
+  {
+    TextureHandle texture;
+    uint32_t new_base;
+    bool over_resident;
+    uint64_t last_sampled;
+  };
+
+  std::vector<Victim> victims;
+  VkDeviceSize reclaimable = 0;
+
+  for (TextureHandle handle = 0; handle < textures.size(); handle++)
+  {
+    const StreamedTexture &texture = textures[handle];
+    if (handle == keep || texture.image.image == VK_NULL_HANDLE || texture.resident_base >= texture.tail_base)
+    {
+      continue;
+    }
+
+    // Sampled this update and not finer than it needs: keep
+    uint32_t target = targetMip(texture);
+    bool over_resident = target > texture.resident_base;
+    if (!over_resident && texture.last_sampled == frame)
+    {
+      continue;
+    }
+
+    uint32_t new_base = over_resident ? target : texture.tail_base;
+    victims.push_back({handle, new_base, over_resident, texture.last_sampled});
+    reclaimable += residentBytes(texture) - chainBytes(texture.width, texture.height, new_base);
+  }
+
+  if (free_bytes + reclaimable < bytes)
+  {
+    return false;
+  }
+
+  std::sort(victims.begin(), victims.end(), [](const Victim &a, const Victim &b)
+  {
+    return a.over_resident != b.over_resident ? a.over_resident : a.last_sampled < b.last_sampled;
+  });
+
+  for (const Victim &victim : victims)
+  {
+    if (resident_bytes + bytes <= memory_budget)
+    {
+      break;
+    }
+
+    shrink(victim.texture, victim.new_base);
+  }
+
+  return true;
+}
+
+void TextureStreamer::replaceImage(StreamedTexture &texture, const Image &image, uint32_t base)
+{
+  resident_bytes -= residentBytes(texture);
+
+  // In-flight frames may still sample the old image
+  if (texture.image.image != VK_NULL_HANDLE)
+  {
+    retired.push_back({texture.image, frame});
+  }
+
+  texture.image = image;
+  texture.resident_base = base;
+  resident_bytes += residentBytes(texture);
+
+  TextureHandle handle = static_cast<TextureHandle>(&texture - textures.data());
+  if (std::find(changed_textures.begin(), changed_textures.end(), handle) == changed_textures.end())
+  {
+    changed_textures.push_back(handle);
+  }
+}
+
+void TextureStreamer::shrink(TextureHandle handle, uint32_t new_base)
+{
+  StreamedTexture &texture = textures[handle];
+  uint32_t skipped = new_base - texture.resident_base;
+  uint32_t level_count = texture.mip_count - new_base;
+  VkFormat format = texture.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+  Image image = createImage(device, physical_device, levelSize(texture.width, new_base), levelSize(texture.height, new_base), level_count, format,
+    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+  VkCommandBuffer command_buffer = uploader->batchCommandBuffer();
+
+  // The source barrier waits for every frame submitted before this batch, and
+  // for the old image's upload when it was recorded in this same batch
+  VkImageMemoryBarrier barriers[2]{};
+  barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image = texture.image.image;
+  barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, skipped, level_count, 0, 1};
+  barriers[1] = barriers[0];
+  barriers[1].srcAccessMask = 0;
+  barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barriers[1].image = image.image;
+  barriers[1].subresourceRange.baseMipLevel = 0;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+  std::vector<VkImageCopy> regions(level_count);
+  for (uint32_t i = 0; i < level_count; i++)
+  {
+    uint32_t level = new_base + i;
+    regions[i].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, skipped + i, 0, 1};
+    regions[i].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+    regions[i].extent = {levelSize(texture.width, level), levelSize(texture.height, level), 1};
+  }
+  vkCmdCopyImage(command_buffer, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, level_count, regions.data());
+
+  barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barriers[1]);
+
+  replaceImage(texture, image, new_base);
+  frame_stats.evicted++;
+}
+
+void TextureStreamer::receiveReads()
+{
+  std::vector<MipRead> reads;
+  {
+    std::lock_guard<std::mutex> lock(read_mutex);
+    reads.swap(finished_reads);
+  }
+
+  for (MipRead &read : reads)
+  {
+    pending_reads--;
+    StreamedTexture &texture = textures[read.texture];
+    texture.requested = false;
+
+    if (!read.error.empty())
+    {
+      // Not retried; a texture that never loaded keeps the placeholder
+      texture.failed = true;
+      continue;
+    }
+
+    bool first_load = texture.mip_count == 0;
+    uint32_t base = read.base;
+
+    if (first_load)
+    {
+      // The tail is pinned, it goes in even over budget
+      texture.width = read.width;
+      texture.height = read.height;
+      texture.mip_count = mipLevelCount(read.width, read.height);
+      texture.tail_base = read.base;
+      texture.desired = read.base;
+    }
+    else
+    {
+      // The finest level that fits, the read holds every coarser one too
+      while (base < texture.resident_base && !makeRoom(chainBytes(texture.width, texture.height, base) - residentBytes(texture), read.texture))
+      {
+        base++;
+      }
+
+      if (base >= texture.resident_base)
+      {
+        frame_stats.dropped++;
+        continue;
+      }
+    }
+
+    VkFormat format = texture.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    const ImageData &top = read.levels[base - read.base];
+    Image image = createImage(device, physical_device, top.width, top.height, texture.mip_count - base, format,
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    for (uint32_t level = base; level < texture.mip_count; level++)
+    {
+      const ImageData &data = read.levels[level - read.base];
+      uploader->uploadImage(image.image, level - base, data.width, data.height, 4, data.pixels.data());
+    }
+
+    replaceImage(texture, image, base);
+    if (!first_load)
+    {
+      frame_stats.streamed_in++;
+    }
+  }
+}
+
+void TextureStreamer::requestReads()
+{
+  std::vector<TextureHandle> candidates;
+  for (TextureHandle handle = 0; handle < textures.size(); handle++)
+  {
+    const StreamedTexture &texture = textures[handle];
+    if (texture.image.image != VK_NULL_HANDLE && !texture.requested && !texture.failed && targetMip(texture) < texture.resident_base)
+    {
+      candidates.push_back(handle);
+    }
+  }
+
+  // Furthest from their target first, then the most recently sampled
+  std::sort(candidates.begin(), candidates.end(), [this](TextureHandle a, TextureHandle b)
+  {
+    uint32_t deficit_a = textures[a].resident_base - targetMip(textures[a]);
+    uint32_t deficit_b = textures[b].resident_base - targetMip(textures[b]);
+    return deficit_a != deficit_b ? deficit_a > deficit_b : textures[a].last_sampled > textures[b].last_sampled;
+  });
+
+  for (TextureHandle handle : candidates)
+  {
+    if (pending_reads >= max_pending_reads)
+    {
+      break;
+    }
+
+    submitRead(handle, targetMip(textures[handle]));
+  }
+}
+
+void TextureStreamer::update(uint32_t frame_index)
+{
+  frame++;
+  frame_stats.streamed_in = 0;
+  frame_stats.evicted = 0;
+  frame_stats.dropped = 0;
+  changed_textures.clear();
+
+  // Every frame that could sample these has completed
+  auto destroyable = std::remove_if(retired.begin(), retired.end(), [this](RetiredImage &old)
+  {
+    if (old.frame + frames_in_flight > frame)
+    {
+      return false;
+    }
+    destroyImage(device, old.image);
+    return true;
+  });
+  retired.erase(destroyable, retired.end());
+
+  readFeedback(frame_index);
+  receiveReads();
+  requestReads();
+
+  // Also submits trailing layout transitions when a band already flushed
+  uploader->flush();
+
+  frame_stats.textures = static_cast<uint32_t>(textures.size());
+  frame_stats.pending_reads = pending_reads;
+  frame_stats.resident_bytes = resident_bytes;
+  frame_stats.starved = 0;
+  for (const StreamedTexture &texture : textures)
+  {
+    if (texture.last_sampled == frame && texture.resident_base > texture.desired)
+    {
+      frame_stats.starved++;
+    }
+  }
+}
+
+void TextureStreamer::recordFeedbackBarrier(VkCommandBuffer command_buffer) const
+{
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+VkImageView TextureStreamer::view(TextureHandle texture) const
+{
+  const StreamedTexture &entry = textures[texture];
+  return entry.image.image != VK_NULL_HANDLE ? entry.image.view : placeholder.view;
+}
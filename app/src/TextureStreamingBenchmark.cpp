@@ -0,0 +1,679 @@
+#include "TextureStreamer.hpp"
+#include "DescriptorAllocator.hpp"
+#include "StagingUploader.hpp"
+#include "JobSystem.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Headless run of TextureStreamer over synthetic 512x512 images (written to
+ * the working directory as .ppm) under a budget of the pinned tails plus two
+ * full chains. Sampling rates are first written into the feedback buffer on
+ * the host, one material per texture:
+ *  - every texture sampled at mip 2 streams in to exactly mip 2,
+ *  - two textures sampled at mip 0 stream in fully, shrinking the others,
+ *  - two other textures at mip 0 push the first two back to their tails,
+ * then come from Textured.frag (MipFeedback.glsl) drawing every texture as a
+ * screen quad sized for mip 3. After every update the resident bytes must
+ * match the resident mips and stay within the budget. Needs the .spv files in
+ * the working directory. Usage: TextureStreamingBenchmark
+ */
+namespace
+{
+  const uint32_t TEXTURE_COUNT = 16;
+  const uint32_t TEXTURE_SIZE = 512;
+  const uint32_t TEXTURE_LOG2_SIZE = 9;
+  const uint32_t MIN_RESIDENT_SIZE = 32;
+  const uint32_t FRAMES_IN_FLIGHT = 2;
+  const int SETTLE_FRAMES = 64;
+  const uint32_t NOT_SAMPLED = UINT32_MAX;
+
+  // One quad per texture, in a grid, each sized to be sampled at QUAD_MIP
+  const uint32_t QUAD_MIP = 3;
+  const uint32_t QUAD_SIZE = TEXTURE_SIZE >> QUAD_MIP;
+  const uint32_t GRID = 4;
+  const uint32_t WIDTH = QUAD_SIZE * GRID;
+  const uint32_t HEIGHT = QUAD_SIZE * GRID;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    bool fragment_stores = false; // MipFeedback.glsl writes from the fragment shader
+  };
+
+  /**
+   * Push constants of TexturedQuad.vert
+   */
+  struct QuadConstants
+  {
+    float rect[4];
+    uint32_t material;
+  };
+
+  struct SettleResult
+  {
+    int frames = 0;
+    uint32_t streamed_in = 0;
+    uint32_t evicted = 0;
+    uint32_t dropped = 0;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Texture Streaming Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Any device runs the host feedback phases, prefer one that also runs the shader phase
+    for (VkPhysicalDevice device : devices)
+    {
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      VkPhysicalDeviceFeatures features;
+      vkGetPhysicalDeviceFeatures(device, &features);
+
+      for (uint32_t i = 0; i < family_count; i++)
+      {
+        if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+        {
+          continue;
+        }
+
+        bool fragment_stores = features.fragmentStoresAndAtomics == VK_TRUE;
+        if (context.physical_device == VK_NULL_HANDLE || (fragment_stores && !context.fragment_stores))
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+          context.fragment_stores = fragment_stores;
+        }
+        break;
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with a graphics queue!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceFeatures features{};
+    features.fragmentStoresAndAtomics = context.fragment_stores ? VK_TRUE : VK_FALSE;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.pEnabledFeatures = &features;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  /**
+   * A binary PPM with a pattern per texture, so a wrong view shows
+   */
+  void writeTestImage(const std::string &file_name, uint32_t seed)
+  {
+    std::vector<uint8_t> pixels(size_t(TEXTURE_SIZE) * TEXTURE_SIZE * 3);
+    for (uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+      for (uint32_t x = 0; x < TEXTURE_SIZE; x++)
+      {
+        uint8_t *pixel = &pixels[(size_t(y) * TEXTURE_SIZE + x) * 3];
+        pixel[0] = static_cast<uint8_t>(x ^ y);
+        pixel[1] = static_cast<uint8_t>(seed * 16);
+        pixel[2] = static_cast<uint8_t>((x / 32 + y / 32) % 2 * 255);
+      }
+    }
+
+    std::ofstream file(file_name, std::ios::binary);
+    file << "P6\n" << TEXTURE_SIZE << " " << TEXTURE_SIZE << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+    if (!file)
+    {
+      throw std::runtime_error("failed to write " + file_name + "!");
+    }
+  }
+
+  /**
+   * RGBA8 bytes of the chain from `base` down to 1x1, as the streamer counts them
+   */
+  VkDeviceSize chainBytes(uint32_t base)
+  {
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = base; level <= TEXTURE_LOG2_SIZE; level++)
+    {
+      VkDeviceSize size = TEXTURE_SIZE >> level;
+      bytes += size * size * 4;
+    }
+    return bytes;
+  }
+
+  /**
+   * What MipFeedback.glsl writes for a material sampled at `mip` of these textures
+   */
+  uint32_t feedbackRate(uint32_t mip)
+  {
+    return 1 + (TEXTURE_LOG2_SIZE - mip) * 16;
+  }
+
+  VkRenderPass createRenderPass(VkDevice device)
+  {
+    VkAttachmentDescription attachment{};
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+
+    // Frames run back to back on the same attachment
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    VkRenderPass render_pass;
+    if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create render pass!");
+    }
+
+    return render_pass;
+  }
+
+  VkPipeline createTexturedPipeline(VkDevice device, VkRenderPass render_pass, VkPipelineLayout pipeline_layout)
+  {
+    VkShaderModule vert_module = loadShaderModule(device, "textured_quad_vert.spv");
+    VkShaderModule frag_module = loadShaderModule(device, "textured_frag.spv");
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vert_module;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = frag_module;
+    stages[1].pName = "main";
+
+    // Corners come from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    VkViewport viewport{0.0f, 0.0f, float(WIDTH), float(HEIGHT), 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+
+    VkPipelineViewportStateCreateInfo viewport_state_info{};
+    viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_info.viewportCount = 1;
+    viewport_state_info.pViewports = &viewport;
+    viewport_state_info.scissorCount = 1;
+    viewport_state_info.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_info{};
+    rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_info.lineWidth = 1.0f;
+    rasterization_info.cullMode = VK_CULL_MODE_NONE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling_info{};
+    multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling_info.minSampleShading = 1.0f;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment{};
+    color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_info{};
+    color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_info.attachmentCount = 1;
+    color_blend_info.pAttachments = &color_blend_attachment;
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = stages;
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state_info;
+    pipeline_info.pRasterizationState = &rasterization_info;
+    pipeline_info.pMultisampleState = &multisampling_info;
+    pipeline_info.pColorBlendState = &color_blend_info;
+    pipeline_info.layout = pipeline_layout;
+    pipeline_info.renderPass = render_pass;
+    pipeline_info.subpass = 0;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, frag_module, nullptr);
+    vkDestroyShaderModule(device, vert_module, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create textured pipeline!");
+    }
+
+    return pipeline;
+  }
+
+  /**
+   * Updates once for the next frame in flight after `feedback` had its chance
+   * to write that frame's rates, then waits for the reads it started, so every
+   * read lands in the next update. Counts the updates that broke the budget or
+   * the byte accounting into `violations`.
+   */
+  template <typename Feedback>
+  SettleResult settle(TextureStreamer &streamer, JobSystem &jobs, const std::vector<TextureHandle> &textures, VkDeviceSize budget,
+    uint64_t &frame, uint32_t &violations, Feedback feedback)
+  {
+    SettleResult result;
+
+    while (result.frames < SETTLE_FRAMES)
+    {
+      uint32_t frame_index = static_cast<uint32_t>(frame++ % FRAMES_IN_FLIGHT);
+      feedback(frame_index);
+      streamer.update(frame_index);
+      jobs.waitIdle();
+      result.frames++;
+
+      const TextureStreamingStats &stats = streamer.stats();
+      result.streamed_in += stats.streamed_in;
+      result.evicted += stats.evicted;
+      result.dropped += stats.dropped;
+
+      // The tails alone fit, so the budget holds after every update
+      VkDeviceSize bytes = 0;
+      for (TextureHandle texture : textures)
+      {
+        bytes += streamer.mipCount(texture) > 0 ? chainBytes(streamer.residentMip(texture)) : 0;
+      }
+      violations += bytes != stats.resident_bytes || stats.resident_bytes > budget ? 1 : 0;
+
+      if (stats.pending_reads == 0 && stats.streamed_in == 0 && stats.evicted == 0 && stats.dropped == 0 && frame > FRAMES_IN_FLIGHT)
+      {
+        break;
+      }
+    }
+
+    return result;
+  }
+
+  void printResidency(const char *label, const TextureStreamer &streamer, const std::vector<TextureHandle> &textures, const SettleResult &result)
+  {
+    std::cout << label << result.frames << " updates, " << result.streamed_in << " streamed in, " << result.evicted << " shrunk, "
+      << result.dropped << " dropped, " << streamer.stats().resident_bytes / 1024 << " of " << streamer.stats().budget_bytes / 1024 << " KiB, mips";
+    for (TextureHandle texture : textures)
+    {
+      std::cout << " " << streamer.residentMip(texture);
+    }
+    std::cout << std::endl;
+  }
+}
+
+int main()
+{
+  try
+  {
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    JobSystem jobs;
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    // The tails plus two full chains
+    uint32_t tail = 0;
+    while ((TEXTURE_SIZE >> tail) > MIN_RESIDENT_SIZE)
+    {
+      tail++;
+    }
+    VkDeviceSize budget = TEXTURE_COUNT * chainBytes(tail) + 2 * (chainBytes(0) - chainBytes(tail));
+
+    TextureStreamer streamer;
+    streamer.min_resident_size = MIN_RESIDENT_SIZE;
+    streamer.init(device, context.physical_device, uploader, jobs, TEXTURE_COUNT, budget, FRAMES_IN_FLIGHT);
+
+    std::vector<TextureHandle> textures;
+    for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+    {
+      std::string file_name = "streamed_texture_" + std::to_string(i) + ".ppm";
+      writeTestImage(file_name, i);
+      textures.push_back(streamer.load(file_name, false));
+      streamer.addMaterialTexture(i, textures.back());
+    }
+
+    uint64_t frame = 0;
+    uint32_t violations = 0;
+    bool passed = true;
+
+    auto expect = [&](bool condition, const char *message)
+    {
+      if (!condition)
+      {
+        std::cerr << message << std::endl;
+        passed = false;
+      }
+    };
+
+    // Host feedback: material i sampled at mips[i], nothing for NOT_SAMPLED
+    auto hostFeedback = [&](const std::vector<uint32_t> &mips)
+    {
+      return [&streamer, mips](uint32_t frame_index)
+      {
+        uint32_t *rates = streamer.feedbackRates(frame_index);
+        for (uint32_t material = 0; material < mips.size(); material++)
+        {
+          rates[material] = mips[material] != NOT_SAMPLED ? feedbackRate(mips[material]) : 0;
+        }
+      };
+    };
+
+    auto allAt = [&](uint32_t first, uint32_t last, uint32_t mip)
+    {
+      for (uint32_t i = first; i <= last; i++)
+      {
+        if (streamer.residentMip(textures[i]) != mip)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    std::cout << TEXTURE_COUNT << " textures of " << TEXTURE_SIZE << "x" << TEXTURE_SIZE << ", tail from mip " << tail << ", budget " << budget / 1024 << " KiB" << std::endl;
+
+    SettleResult tails = settle(streamer, jobs, textures, budget, frame, violations, hostFeedback(std::vector<uint32_t>(TEXTURE_COUNT, NOT_SAMPLED)));
+    printResidency("tails:        ", streamer, textures, tails);
+    expect(allAt(0, TEXTURE_COUNT - 1, tail) && streamer.tailMip(textures[0]) == tail, "textures did not start with their tails!");
+
+    SettleResult everything = settle(streamer, jobs, textures, budget, frame, violations, hostFeedback(std::vector<uint32_t>(TEXTURE_COUNT, 2)));
+    printResidency("all at mip 2: ", streamer, textures, everything);
+    expect(allAt(0, TEXTURE_COUNT - 1, 2) && streamer.stats().starved == 0, "textures sampled at mip 2 are not resident at mip 2!");
+    expect(everything.evicted == 0 && everything.dropped == 0, "textures shrunk or dropped while the budget had room!");
+
+    std::vector<uint32_t> first_pair(TEXTURE_COUNT, NOT_SAMPLED);
+    first_pair[0] = 0;
+    first_pair[1] = 0;
+    SettleResult first = settle(streamer, jobs, textures, budget, frame, violations, hostFeedback(first_pair));
+    printResidency("0, 1 at mip 0: ", streamer, textures, first);
+    expect(allAt(0, 1, 0), "the two textures sampled at mip 0 did not stream in fully!");
+    expect(first.evicted > 0, "unsampled textures were not shrunk to make room!");
+
+    std::vector<uint32_t> second_pair(TEXTURE_COUNT, NOT_SAMPLED);
+    second_pair[2] = 0;
+    second_pair[3] = 0;
+    SettleResult second = settle(streamer, jobs, textures, budget, frame, violations, hostFeedback(second_pair));
+    printResidency("2, 3 at mip 0: ", streamer, textures, second);
+    expect(allAt(2, 3, 0), "the second pair sampled at mip 0 did not stream in fully!");
+    expect(allAt(0, 1, tail), "the first pair was not shrunk back to its tail!");
+
+    // The same through the shaders: every texture drawn for mip QUAD_MIP
+    if (context.fragment_stores)
+    {
+      VkDescriptorSetLayoutBinding bindings[2]{};
+      bindings[0].binding = 0;
+      bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[0].descriptorCount = 1;
+      bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+      bindings[1].binding = 1;
+      bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[1].descriptorCount = 1;
+      bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+      VkDescriptorSetLayoutCreateInfo set_layout_info{};
+      set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+      set_layout_info.bindingCount = 2;
+      set_layout_info.pBindings = bindings;
+
+      VkDescriptorSetLayout set_layout;
+      if (vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to create descriptor set layout!");
+      }
+
+      VkPushConstantRange push_range{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(QuadConstants)};
+
+      VkPipelineLayoutCreateInfo pipeline_layout_info{};
+      pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+      pipeline_layout_info.setLayoutCount = 1;
+      pipeline_layout_info.pSetLayouts = &set_layout;
+      pipeline_layout_info.pushConstantRangeCount = 1;
+      pipeline_layout_info.pPushConstantRanges = &push_range;
+
+      VkPipelineLayout pipeline_layout;
+      if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to create pipeline layout!");
+      }
+
+      Image color = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+      VkRenderPass render_pass = createRenderPass(device);
+      VkPipeline pipeline = createTexturedPipeline(device, render_pass, pipeline_layout);
+
+      VkFramebufferCreateInfo framebuffer_info{};
+      framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebuffer_info.renderPass = render_pass;
+      framebuffer_info.attachmentCount = 1;
+      framebuffer_info.pAttachments = &color.view;
+      framebuffer_info.width = WIDTH;
+      framebuffer_info.height = HEIGHT;
+      framebuffer_info.layers = 1;
+
+      VkFramebuffer framebuffer;
+      if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to create framebuffer!");
+      }
+
+      VkCommandPoolCreateInfo pool_info{};
+      pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+      pool_info.queueFamilyIndex = context.queue_family;
+
+      VkCommandPool command_pool;
+      if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to create command pool!");
+      }
+
+      VkCommandBufferAllocateInfo alloc_info{};
+      alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      alloc_info.commandPool = command_pool;
+      alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      alloc_info.commandBufferCount = 1;
+
+      VkCommandBuffer command_buffer;
+      vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+
+      DescriptorAllocator descriptors;
+      descriptors.init(device, FRAMES_IN_FLIGHT, TEXTURE_COUNT, {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+
+      VkClearValue clear_value{};
+
+      VkRenderPassBeginInfo render_pass_info{};
+      render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+      render_pass_info.renderPass = render_pass;
+      render_pass_info.framebuffer = framebuffer;
+      render_pass_info.renderArea = {{0, 0}, {WIDTH, HEIGHT}};
+      render_pass_info.clearValueCount = 1;
+      render_pass_info.pClearValues = &clear_value;
+
+      // Renders the frame whose feedback the next update reads; views are
+      // picked up fresh each frame, so streamed images show as they land
+      auto renderFeedback = [&](uint32_t frame_index)
+      {
+        descriptors.beginFrame(frame_index);
+        vkResetCommandBuffer(command_buffer, 0);
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+        for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+        {
+          VkDescriptorSet set = descriptors.allocate(set_layout,
+          {
+            imageDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, streamer.view(textures[i]), streamer.sampler()),
+            bufferDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, streamer.feedbackBuffer(frame_index))
+          });
+          vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &set, 0, nullptr);
+
+          float x = -1.0f + 2.0f * (i % GRID) / GRID;
+          float y = -1.0f + 2.0f * (i / GRID) / GRID;
+          QuadConstants quad{{x, y, x + 2.0f / GRID, y + 2.0f / GRID}, i};
+          vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(quad), &quad);
+          vkCmdDraw(command_buffer, 4, 1, 0, 0);
+        }
+
+        vkCmdEndRenderPass(command_buffer);
+        streamer.recordFeedbackBarrier(command_buffer);
+        vkEndCommandBuffer(command_buffer);
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+
+        if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+          throw std::runtime_error("Failed to submit feedback frame!");
+        }
+        vkQueueWaitIdle(context.queue);
+      };
+
+      auto start = std::chrono::high_resolution_clock::now();
+      SettleResult shaded = settle(streamer, jobs, textures, budget, frame, violations, renderFeedback);
+      auto end = std::chrono::high_resolution_clock::now();
+
+      printResidency("shader, mip 3: ", streamer, textures, shaded);
+      std::cout << "  " << std::chrono::duration<double, std::milli>(end - start).count() / shaded.frames << " ms per rendered frame and update" << std::endl;
+
+      bool desired = true;
+      for (TextureHandle texture : textures)
+      {
+        desired = desired && streamer.desiredMip(texture) == QUAD_MIP && streamer.residentMip(texture) <= QUAD_MIP;
+      }
+      expect(desired, "feedback from Textured.frag did not select and stream in the quad's mip!");
+      expect(streamer.stats().starved == 0, "textures drawn through the shader are still starved!");
+
+      vkDeviceWaitIdle(device);
+      descriptors.cleanup();
+      vkDestroyCommandPool(device, command_pool, nullptr);
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+      vkDestroyPipeline(device, pipeline, nullptr);
+      vkDestroyRenderPass(device, render_pass, nullptr);
+      destroyImage(device, color);
+      vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+      vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+    }
+    else
+    {
+      std::cout << "fragmentStoresAndAtomics is not supported, skipping the shader feedback phase" << std::endl;
+    }
+
+    expect(violations == 0, "resident bytes broke the budget or did not match the resident mips!");
+
+    streamer.cleanup();
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    if (!passed)
+    {
+      std::cerr << "texture streaming checks failed!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include "TransformStore.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+/**
+ * Times hierarchical transform updates on a random forest, serially and on
+ * the job system, for a full rebuild and for a few moving roots.
+ */
+const uint32_t LEVEL_COUNT = 5;
+
+/**
+ * Largest difference between the stored world matrices and ones rebuilt by walking the parents
+ */
+float worldError(const TransformStore &store)
+{
+  float error = 0.0f;
+
+  for (TransformId id = 0; id < store.size(); id += 97)
+  {
+    glm::mat4 world(1.0f);
+    for (TransformId node = id; node != INVALID_TRANSFORM; node = store.parent(node))
+    {
+      world = glm::translate(glm::mat4(1.0f), store.position(node)) * glm::mat4_cast(store.rotation(node)) * glm::scale(glm::mat4(1.0f), store.scale(node)) * world;
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+      for (int r = 0; r < 4; r++)
+      {
+        error = std::max(error, std::abs(world[c][r] - store.world(id)[c][r]));
+      }
+    }
+  }
+
+  return error;
+}
+
+double timeUpdate(TransformStore &store, JobSystem *jobs, const std::vector<TransformId> &moving, int iterations)
+{
+  double total = 0.0;
+
+  for (int i = 0; i < iterations; i++)
+  {
+    for (TransformId id : moving)
+    {
+      store.setRotation(id, glm::angleAxis(0.01f * i, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    store.update(jobs);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    total += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  return total / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t transform_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const int ITERATIONS = 20;
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+
+  // Each level is four times as big as the previous one, siblings are created together like a loader would
+  TransformStore store;
+  std::vector<TransformId> previous_level;
+  std::vector<TransformId> roots;
+  size_t level_size = std::max<size_t>(transform_count / (((1u << (2 * LEVEL_COUNT)) - 1) / 3), 1);
+
+  for (uint32_t level = 0; level < LEVEL_COUNT && store.size() < transform_count; level++)
+  {
+    std::vector<TransformId> current_level;
+    size_t count = level + 1 == LEVEL_COUNT ? transform_count - store.size() : std::min(level_size, transform_count - store.size());
+
+    for (size_t i = 0; i < count; i++)
+    {
+      TransformId parent = previous_level.empty() ? INVALID_TRANSFORM : previous_level[i * previous_level.size() / count];
+      current_level.push_back(store.create(parent, glm::vec3(offset(rng), offset(rng), offset(rng))));
+    }
+
+    if (level == 0)
+    {
+      roots = current_level;
+    }
+    previous_level.swap(current_level);
+    level_size *= 4;
+  }
+
+  std::vector<TransformId> moving;
+  for (size_t i = 0; i < roots.size(); i += 100)
+  {
+    moving.push_back(roots[i]);
+  }
+
+  JobSystem jobs;
+
+  store.update();
+  double serial_full_ms = timeUpdate(store, nullptr, roots, ITERATIONS);
+  uint32_t full_count = store.lastUpdateCount();
+  double parallel_full_ms = timeUpdate(store, &jobs, roots, ITERATIONS);
+  double serial_partial_ms = timeUpdate(store, nullptr, moving, ITERATIONS);
+  uint32_t partial_count = store.lastUpdateCount();
+  double parallel_partial_ms = timeUpdate(store, &jobs, moving, ITERATIONS);
+
+  std::cout << store.size() << " transforms in " << store.levelCount() << " levels, " << jobs.workerCount() + 1 << " threads" << std::endl;
+  std::cout << "full (" << full_count << " updated):" << std::endl;
+  std::cout << "  serial:   " << serial_full_ms << " ms" << std::endl;
+  std::cout << "  parallel: " << parallel_full_ms << " ms (" << serial_full_ms / parallel_full_ms << "x)" << std::endl;
+  std::cout << "partial (" << partial_count << " updated):" << std::endl;
+  std::cout << "  serial:   " << serial_partial_ms << " ms" << std::endl;
+  std::cout << "  parallel: " << parallel_partial_ms << " ms (" << serial_partial_ms / parallel_partial_ms << "x)" << std::endl;
+
+  float error = worldError(store);
+  if (error > 1e-3f)
+  {
+    std::cerr << "World matrices do not match their hierarchy (error " << error << ")!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+#include "TransformStore.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+  const uint32_t UPDATE_BATCH_SIZE = 4096;
+  const glm::mat4 IDENTITY(1.0f);
+
+  template<typename T>
+  void permute(std::vector<T> &values, const std::vector<uint32_t> &order)
+  {
+    std::vector<T> sorted(values.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+  }
+
+  /*
+  * parent * translate * rotate * scale, assuming the parent is affine.
+    Skips the bottom row and avoids the generic 4x4 product.
+  */
+  void composeWorld(glm::mat4 &world, const glm::mat4 &parent, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+  {
+    glm::mat3 basis = glm::mat3_cast(rotation);
+    glm::vec3 x = basis[0] * scale.x;
+    glm::vec3 y = basis[1] * scale.y;
+    glm::vec3 z = basis[2] * scale.z;
+
+    world[0] = parent[0] * x.x + parent[1] * x.y + parent[2] * x.z;
+    world[1] = parent[0] * y.x + parent[1] * y.y + parent[2] * y.z;
+    world[2] = parent[0] * z.x + parent[1] * z.y + parent[2] * z.z;
+    world[3] = parent[0] * position.x + parent[1] * position.y + parent[2] * position.z + parent[3];
+  }
+}
+
+TransformId TransformStore::create(TransformId parent, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+{
+  uint32_t parent_slot = NO_PARENT;
+  uint16_t depth = 0;
+
+  if (parent != INVALID_TRANSFORM)
+  {
+    if (parent >= slots.size())
+    {
+      throw std::runtime_error("Invalid parent transform!");
+    }
+    parent_slot = slots[parent];
+    depth = depths[parent_slot] + 1;
+  }
+
+  TransformId id = static_cast<TransformId>(slots.size());
+  uint32_t slot = static_cast<uint32_t>(ids.size());
+
+  // Appending keeps the slots sorted unless the new node is shallower than the last one
+  if (!depths.empty() && depth < depths.back())
+  {
+    unsorted = true;
+  }
+  if (depth >= level_starts.size())
+  {
+    level_starts.push_back(slot);
+    level_dirty.push_back(0);
+  }
+
+  slots.push_back(slot);
+  ids.push_back(id);
+  parents.push_back(parent_slot);
+  depths.push_back(depth);
+  positions.push_back(position);
+  rotations.push_back(rotation);
+  scales.push_back(scale);
+  worlds.push_back(glm::mat4(1.0f));
+  dirty.push_back(1);
+  level_dirty[depth] = 1;
+
+  return id;
+}
+
+void TransformStore::clear()
+{
+  slots.clear();
+  ids.clear();
+  parents.clear();
+  depths.clear();
+  positions.clear();
+  rotations.clear();
+  scales.clear();
+  worlds.clear();
+  dirty.clear();
+  level_starts.clear();
+  level_dirty.clear();
+  unsorted = false;
+  last_update_count = 0;
+}
+
+uint32_t TransformStore::markDirty(TransformId id)
+{
+  uint32_t slot = slots[id];
+  dirty[slot] = 1;
+  level_dirty[depths[slot]] = 1;
+  return slot;
+}
+
+void TransformStore::setPosition(TransformId id, const glm::vec3 &position)
+{
+  positions[markDirty(id)] = position;
+}
+
+void TransformStore::setRotation(TransformId id, const glm::quat &rotation)
+{
+  rotations[markDirty(id)] = rotation;
+}
+
+void TransformStore::setScale(TransformId id, const glm::vec3 &scale)
+{
+  scales[markDirty(id)] = scale;
+}
+
+TransformId TransformStore::parent(TransformId id) const
+{
+  uint32_t parent_slot = parents[slots[id]];
+  return parent_slot == NO_PARENT ? INVALID_TRANSFORM : ids[parent_slot];
+}
+
+void TransformStore::sortByDepth()
+{
+  // Counting sort by depth, stable so siblings keep their creation order
+  std::vector<uint32_t> level_fill(level_starts.size() + 1, 0);
+  for (uint16_t depth : depths)
+  {
+    level_fill[depth + 1]++;
+  }
+  for (size_t level = 1; level < level_fill.size(); level++)
+  {
+    level_fill[level] += level_fill[level - 1];
+  }
+  std::copy(level_fill.begin(), level_fill.end() - 1, level_starts.begin());
+
+  std::vector<uint32_t> order(ids.size());
+  std::vector<uint32_t> new_slots(ids.size());
+  for (uint32_t slot = 0; slot < ids.size(); slot++)
+  {
+    uint32_t new_slot = level_fill[depths[slot]]++;
+    order[new_slot] = slot;
+    new_slots[slot] = new_slot;
+  }
+
+  for (uint32_t &parent_slot : parents)
+  {
+    if (parent_slot != NO_PARENT)
+    {
+      parent_slot = new_slots[parent_slot];
+    }
+  }
+
+  permute(ids, order);
+  permute(parents, order);
+  permute(depths, order);
+  permute(positions, order);
+  permute(rotations, order);
+  permute(scales, order);
+  permute(worlds, order);
+  permute(dirty, order);
+
+  for (uint32_t slot = 0; slot < ids.size(); slot++)
+  {
+    slots[ids[slot]] = slot;
+  }
+
+  unsorted = false;
+}
+
+void TransformStore::update(JobSystem *jobs)
+{
+  if (unsorted)
+  {
+    sortByDepth();
+  }
+
+  std::atomic<uint32_t> update_count{0};
+  bool parent_level_changed = false;
+  uint32_t level_count = levelCount();
+  uint32_t first_level = level_count;
+  uint32_t last_level = 0;
+
+  for (uint32_t level = 0; level < level_count; level++)
+  {
+    if (!level_dirty[level] && !parent_level_changed)
+    {
+      continue;
+    }
+
+    uint32_t start = level_starts[level];
+    uint32_t end = level + 1 < level_count ? level_starts[level + 1] : static_cast<uint32_t>(ids.size());
+    std::atomic<bool> level_changed{false};
+
+    // A node is recomputed if it or its parent is dirty, and then marks itself
+    // dirty so the next level picks up the whole subtree
+    auto updateRange = [&](uint32_t begin, uint32_t range_end)
+    {
+      uint32_t changed = 0;
+
+      for (uint32_t slot = start + begin; slot < start + range_end; slot++)
+      {
+        uint32_t parent_slot = parents[slot];
+        bool parent_dirty = parent_slot != NO_PARENT && dirty[parent_slot];
+
+        if (!dirty[slot] && !parent_dirty)
+        {
+          continue;
+        }
+
+        composeWorld(worlds[slot], parent_slot != NO_PARENT ? worlds[parent_slot] : IDENTITY, positions[slot], rotations[slot], scales[slot]);
+        dirty[slot] = 1;
+        changed++;
+      }
+
+      if (changed > 0)
+      {
+        update_count.fetch_add(changed, std::memory_order_relaxed);
+        level_changed.store(true, std::memory_order_relaxed);
+      }
+    };
+
+    if (jobs != nullptr)
+    {
+      jobs->parallelFor(end - start, UPDATE_BATCH_SIZE, updateRange);
+    }
+    else
+    {
+      updateRange(0, end - start);
+    }
+
+    parent_level_changed = level_changed.load();
+    level_dirty[level] = 0;
+    first_level = std::min(first_level, level);
+    last_level = level;
+  }
+
+  // The flags of a level are read by the next one, so they are only cleared at the end
+  if (first_level < level_count)
+  {
+    uint32_t end = last_level + 1 < level_count ? level_starts[last_level + 1] : static_cast<uint32_t>(ids.size());
+    std::fill(dirty.begin() + level_starts[first_level], dirty.begin() + end, 0);
+  }
+
+  last_update_count = update_count.load();
+}
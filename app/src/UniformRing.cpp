@@ -0,0 +1,52 @@
+#include "UniformRing.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+void UniformRing::init(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize frame_capacity, uint32_t frames_in_flight)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  this->device = device;
+  alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+  frame_size = alignedSize(frame_capacity);
+
+  // Host coherent, so writes need no flush and are visible to the next submit
+  buffer = createBuffer(device, physical_device, frame_size * frames_in_flight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void UniformRing::cleanup()
+{
+  if (device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  destroyBuffer(device, buffer);
+  *this = UniformRing{};
+}
+
+void UniformRing::beginFrame(uint32_t frame)
+{
+  frame_start = frame * frame_size;
+  frame_used = 0;
+}
+
+UniformAllocation UniformRing::allocate(uint32_t size)
+{
+  VkDeviceSize reserved = alignedSize(size);
+  if (frame_used + reserved > frame_size)
+  {
+    throw std::runtime_error("Uniform ring frame is full!");
+  }
+
+  UniformAllocation allocation;
+  allocation.buffer = buffer.buffer;
+  allocation.offset = static_cast<uint32_t>(frame_start + frame_used);
+  allocation.size = size;
+
+  frame_used += reserved;
+  return allocation;
+}
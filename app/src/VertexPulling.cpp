@@ -0,0 +1,242 @@
+#include "VertexPulling.hpp"
+#include "PipelineLayoutBuilder.hpp"
+#include "SpirvReflection.hpp"
+
+#include <stdexcept>
+
+namespace
+{
+  // Meshes start where a buffer of their own would, a safe base for every encoding
+  const VkDeviceSize VERTEX_ALIGNMENT = 16;
+  // A multiple of both index sizes, so first_index is exact for either type
+  const VkDeviceSize INDEX_ALIGNMENT = 4;
+
+  VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+bool isVertexPullingSupported(VkInstance instance, VkPhysicalDevice physical_device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+  if (properties.apiVersion < VK_API_VERSION_1_2 || get_features2 == nullptr)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceBufferDeviceAddressFeatures address_features{};
+  address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &address_features;
+  get_features2(physical_device, &features);
+
+  return address_features.bufferDeviceAddress;
+}
+
+VkPhysicalDeviceBufferDeviceAddressFeatures vertexPullingFeatures()
+{
+  VkPhysicalDeviceBufferDeviceAddressFeatures features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+  features.bufferDeviceAddress = VK_TRUE;
+  return features;
+}
+
+PulledDrawConstants drawConstants(const PooledMesh &mesh, const glm::mat4 &transform)
+{
+  PulledDrawConstants constants;
+  constants.transform = transform;
+  constants.vertices = mesh.vertices;
+  constants.encoding = mesh.encoding;
+  constants.position_offset = mesh.quantization.position_offset;
+  constants.position_scale = mesh.quantization.position_scale;
+  return constants;
+}
+
+void MeshPool::init(VkDevice device, VkPhysicalDevice physical_device, VkRenderPass render_pass, VkDeviceSize vertex_capacity, VkDeviceSize index_capacity)
+{
+  this->device = device;
+
+  vertex_buffer = createBuffer(device, physical_device, vertex_capacity,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  index_buffer = createBuffer(device, physical_device, index_capacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  vertex_address = bufferAddress(device, vertex_buffer.buffer);
+
+  createPipeline(render_pass);
+}
+
+void MeshPool::cleanup()
+{
+  vkDestroyPipeline(device, graphics_pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+  destroyBuffer(device, vertex_buffer);
+  destroyBuffer(device, index_buffer);
+
+  vertex_offset = 0;
+  index_offset = 0;
+}
+
+PooledMesh MeshPool::add(StagingUploader &uploader, const MeshCache &cache)
+{
+  const MeshCacheSection &vertices = cache.vertexSection();
+  const MeshCacheSection &indices = *cache.findSection(MESH_SECTION_INDICES);
+
+  VkDeviceSize vertex_start = alignUp(vertex_offset, VERTEX_ALIGNMENT);
+  VkDeviceSize index_start = alignUp(index_offset, INDEX_ALIGNMENT);
+
+  if (vertex_start + vertices.size > vertex_buffer.size || index_start + indices.size > index_buffer.size)
+  {
+    throw std::runtime_error("Mesh pool is full!");
+  }
+
+  PooledMesh mesh;
+  mesh.vertices = vertex_address + vertex_start;
+  mesh.encoding = cache.vertexEncoding();
+  mesh.quantization = cache.quantizationParams();
+  mesh.index_type = cache.indexSize() == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  mesh.first_index = static_cast<uint32_t>(index_start / cache.indexSize());
+  mesh.vertex_count = cache.vertexCount();
+  mesh.index_count = cache.indexCount();
+  mesh.submeshes.assign(cache.submeshes(), cache.submeshes() + cache.submeshCount());
+  mesh.lod_count = cache.lodCount();
+
+  if (cache.lods() != nullptr)
+  {
+    mesh.lods.assign(cache.lods(), cache.lods() + mesh.submeshes.size() * mesh.lod_count);
+  }
+  else
+  {
+    for (const Submesh &submesh : mesh.submeshes)
+    {
+      mesh.lods.push_back({submesh.index_offset, submesh.index_count, 0.0f});
+    }
+  }
+  mesh.bounds_min = glm::vec3(cache.header().bounds_min[0], cache.header().bounds_min[1], cache.header().bounds_min[2]);
+  mesh.bounds_max = glm::vec3(cache.header().bounds_max[0], cache.header().bounds_max[1], cache.header().bounds_max[2]);
+
+  // Both blobs go from the mapping into staging memory as they are, whatever the encoding
+  uploader.uploadBuffer(vertex_buffer.buffer, vertex_start, cache.sectionData(vertices), vertices.size);
+  uploader.uploadBuffer(index_buffer.buffer, index_start, cache.sectionData(indices), indices.size);
+
+  vertex_offset = vertex_start + vertices.size;
+  index_offset = index_start + indices.size;
+
+  return mesh;
+}
+
+DrawPacket MeshPool::drawPacket(const PooledMesh &mesh, uint32_t submesh, uint32_t lod) const
+{
+  const MeshLod &level = mesh.lods[submesh * mesh.lod_count + lod];
+
+  // gl_VertexIndex is the raw index, the vertex address already points at the mesh
+  DrawPacket packet;
+  packet.pipeline = graphics_pipeline;
+  packet.pipeline_layout = pipeline_layout;
+  packet.index_buffer = index_buffer.buffer;
+  packet.index_type = mesh.index_type;
+  packet.element_count = level.index_count;
+  packet.first_element = mesh.first_index + level.index_offset;
+  return packet;
+}
+
+void MeshPool::createPipeline(VkRenderPass render_pass)
+{
+  pipeline_layout = PipelineLayoutBuilder()
+    .pushConstants<PulledDrawConstants>(VK_SHADER_STAGE_VERTEX_BIT)
+    .build(device, false).layout;
+
+  std::vector<uint32_t> vert_code = readSpirv("pulled_vert.spv");
+  verifyShaderBlock<PulledDrawConstants>(reflectSpirv(vert_code), SPIRV_BLOCK_PUSH_CONSTANT);
+
+  VkShaderModule vert_module = loadShaderModule(device, vert_code);
+  VkShaderModule frag_module = loadShaderModule(device, "frag.spv");
+
+  VkPipelineShaderStageCreateInfo shader_stages[2]{};
+  shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  shader_stages[0].module = vert_module;
+  shader_stages[0].pName = "main";
+  shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shader_stages[1].module = frag_module;
+  shader_stages[1].pName = "main";
+
+  // No vertex input state to vary, which is the point: one pipeline for every encoding
+  VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+  vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+  input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewport_state_info{};
+  viewport_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport_state_info.viewportCount = 1;
+  viewport_state_info.scissorCount = 1;
+
+  // Meshes are counter-clockwise; the transform is expected to flip Y for Vulkan
+  VkPipelineRasterizationStateCreateInfo rasterization_info{};
+  rasterization_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterization_info.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterization_info.lineWidth = 1.0f;
+  rasterization_info.cullMode = VK_CULL_MODE_BACK_BIT;
+  rasterization_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling_info{};
+  multisampling_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling_info.minSampleShading = 1.0f;
+
+  VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+  depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depth_stencil_info.depthTestEnable = VK_TRUE;
+  depth_stencil_info.depthWriteEnable = VK_TRUE;
+  depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS;
+
+  VkPipelineColorBlendAttachmentState color_blend_attachment{};
+  color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  VkPipelineColorBlendStateCreateInfo color_blend_info{};
+  color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  color_blend_info.attachmentCount = 1;
+  color_blend_info.pAttachments = &color_blend_attachment;
+
+  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+  VkPipelineDynamicStateCreateInfo dynamic_state{};
+  dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic_state.dynamicStateCount = 2;
+  dynamic_state.pDynamicStates = dynamic_states;
+
+  VkGraphicsPipelineCreateInfo pipeline_info{};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipeline_info.stageCount = 2;
+  pipeline_info.pStages = shader_stages;
+  pipeline_info.pVertexInputState = &vertex_input_info;
+  pipeline_info.pInputAssemblyState = &input_assembly;
+  pipeline_info.pViewportState = &viewport_state_info;
+  pipeline_info.pRasterizationState = &rasterization_info;
+  pipeline_info.pMultisampleState = &multisampling_info;
+  pipeline_info.pDepthStencilState = &depth_stencil_info;
+  pipeline_info.pColorBlendState = &color_blend_info;
+  pipeline_info.pDynamicState = &dynamic_state;
+  pipeline_info.layout = pipeline_layout;
+  pipeline_info.renderPass = render_pass;
+  pipeline_info.subpass = 0;
+
+  VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline);
+
+  vkDestroyShaderModule(device, frag_module, nullptr);
+  vkDestroyShaderModule(device, vert_module, nullptr);
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create vertex pulling pipeline!");
+  }
+}
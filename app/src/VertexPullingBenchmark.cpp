@@ -0,0 +1,464 @@
+#include "VertexPulling.hpp"
+#include "MeshCache.hpp"
+#include "StagingUploader.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+#include <glm/geometric.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Headless check of MeshPool: one mesh converted twice, once with float
+ * vertices (MeshConverter --float) and once quantized, pooled side by side and
+ * drawn through the pool's single pulled_vert.spv pipeline, which fetches the
+ * vertices through buffer device addresses. Each encoding is drawn alone, then
+ * both in one pass with the pipeline bound once. The two must cover the same
+ * pixels with the same normals, up to quantization error at the silhouette.
+ * Needs the .spv files in the working directory.
+ * Usage: VertexPullingBenchmark <float.vmesh> <quantized.vmesh>
+ */
+namespace
+{
+  const uint32_t WIDTH = 512;
+  const uint32_t HEIGHT = 512;
+  const int COLOR_TOLERANCE = 8;          // per channel, out of 255
+  const float MISMATCH_TOLERANCE = 0.02f; // of the covered pixels
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+  };
+
+  /**
+   * One mesh of the pool and where it goes on screen
+   */
+  struct PooledDraw
+  {
+    const PooledMesh *mesh;
+    glm::mat4 transform;
+  };
+
+  struct Coverage
+  {
+    uint32_t covered = 0;    // in either image
+    uint32_t mismatched = 0; // covered in only one, or shaded differently
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Vertex Pulling Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    for (VkPhysicalDevice device : devices)
+    {
+      if (!isVertexPullingSupported(context.instance, device))
+      {
+        continue;
+      }
+
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      for (uint32_t i = 0; i < family_count && context.physical_device == VK_NULL_HANDLE; i++)
+      {
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
+          context.physical_device = device;
+          context.queue_family = i;
+        }
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with buffer device addresses!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = context.queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures address_features = vertexPullingFeatures();
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &address_features;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+
+    return context;
+  }
+
+  /**
+   * Color and depth, the color left ready to copy out
+   */
+  VkRenderPass createRenderPass(VkDevice device, VkFormat depth_format)
+  {
+    VkAttachmentDescription attachments[2]{};
+    attachments[0].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    attachments[1].format = depth_format;
+    attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depth_reference{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+    subpass.pDepthStencilAttachment = &depth_reference;
+
+    // The copy out waits for the color writes
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = 0;
+    dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 2;
+    render_pass_info.pAttachments = attachments;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    VkRenderPass render_pass;
+    if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create render pass!");
+    }
+
+    return render_pass;
+  }
+
+  VkDeviceSize sectionBytes(const MeshCache &cache, MeshCacheSectionType type)
+  {
+    const MeshCacheSection *section = cache.findSection(type);
+    return section != nullptr ? section->size : 0;
+  }
+
+  bool isCovered(uint32_t pixel)
+  {
+    return (pixel >> 24) != 0;
+  }
+
+  Coverage compareImages(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+  {
+    Coverage coverage;
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+      if (!isCovered(a[i]) && !isCovered(b[i]))
+      {
+        continue;
+      }
+
+      coverage.covered++;
+
+      bool shaded_alike = isCovered(a[i]) && isCovered(b[i]);
+      for (uint32_t shift = 0; shift < 24 && shaded_alike; shift += 8)
+      {
+        shaded_alike = std::abs(int((a[i] >> shift) & 255) - int((b[i] >> shift) & 255)) <= COLOR_TOLERANCE;
+      }
+      coverage.mismatched += shaded_alike ? 0 : 1;
+    }
+
+    return coverage;
+  }
+
+  uint32_t countCovered(const std::vector<uint32_t> &pixels, uint32_t x_begin, uint32_t x_end)
+  {
+    uint32_t covered = 0;
+    for (uint32_t y = 0; y < HEIGHT; y++)
+    {
+      for (uint32_t x = x_begin; x < x_end; x++)
+      {
+        covered += isCovered(pixels[y * WIDTH + x]) ? 1 : 0;
+      }
+    }
+    return covered;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "usage: VertexPullingBenchmark <float.vmesh> <quantized.vmesh>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    MeshCache float_cache(argv[1]);
+    MeshCache quantized_cache(argv[2]);
+
+    if (float_cache.vertexEncoding() != VERTEX_ENCODING_FLOAT || quantized_cache.vertexEncoding() != VERTEX_ENCODING_QUANTIZED)
+    {
+      std::cerr << "expected a float mesh cache (MeshConverter --float) and a quantized one, in that order!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    VkFormat depth_format = findDepthFormat(context.physical_device);
+    Image color = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, VK_FORMAT_R8G8B8A8_UNORM,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+    Image depth = createImage(device, context.physical_device, WIDTH, HEIGHT, 1, depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+    VkRenderPass render_pass = createRenderPass(device, depth_format);
+
+    VkImageView attachments[2] = {color.view, depth.view};
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = render_pass;
+    framebuffer_info.attachmentCount = 2;
+    framebuffer_info.pAttachments = attachments;
+    framebuffer_info.width = WIDTH;
+    framebuffer_info.height = HEIGHT;
+    framebuffer_info.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create framebuffer!");
+    }
+
+    // Both meshes in one vertex and one index buffer, with room for the alignment of each
+    VkDeviceSize vertex_bytes = float_cache.vertexSection().size + quantized_cache.vertexSection().size + 32;
+    VkDeviceSize index_bytes = sectionBytes(float_cache, MESH_SECTION_INDICES) + sectionBytes(quantized_cache, MESH_SECTION_INDICES) + 8;
+
+    MeshPool pool;
+    pool.init(device, context.physical_device, render_pass, vertex_bytes, index_bytes);
+    PooledMesh float_mesh = pool.add(uploader, float_cache);
+    PooledMesh quantized_mesh = pool.add(uploader, quantized_cache);
+    uploader.flush();
+
+    std::cout << float_mesh.vertex_count << " vertices, " << float_mesh.index_count << " indices: "
+      << float_cache.vertexSection().size / 1024 << " KiB float, " << quantized_cache.vertexSection().size / 1024 << " KiB quantized, "
+      << pool.vertexBytes() / 1024 << " KiB of vertices pooled" << std::endl;
+
+    // Both meshes are the same source, framed by the float one's bounds
+    glm::vec3 center = (float_mesh.bounds_min + float_mesh.bounds_max) * 0.5f;
+    float radius = std::max(glm::length(float_mesh.bounds_max - float_mesh.bounds_min) * 0.5f, 1e-3f);
+    glm::mat4 proj = glm::orthoRH_ZO(-radius, radius, -radius, radius, -radius, radius);
+    proj[1][1] *= -1.0f;
+    glm::mat4 full = proj * glm::translate(glm::mat4(1.0f), -center);
+
+    // Halves of the target, in normalized device coordinates
+    glm::mat4 left = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.0f, 0.0f)), glm::vec3(0.5f, 0.5f, 1.0f)) * full;
+    glm::mat4 right = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, 0.0f)), glm::vec3(0.5f, 0.5f, 1.0f)) * full;
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = context.queue_family;
+
+    VkCommandPool command_pool;
+    if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+
+    Buffer readback = createBuffer(device, context.physical_device, VkDeviceSize(WIDTH) * HEIGHT * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkClearValue clear_values[2]{};
+    clear_values[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = render_pass;
+    render_pass_info.framebuffer = framebuffer;
+    render_pass_info.renderArea = {{0, 0}, {WIDTH, HEIGHT}};
+    render_pass_info.clearValueCount = 2;
+    render_pass_info.pClearValues = clear_values;
+
+    double frame_ms = 0.0;
+
+    // One pass, one pipeline bind; every draw only changes the index type and the push constants
+    auto render = [&](const std::vector<PooledDraw> &draws)
+    {
+      vkResetCommandBuffer(command_buffer, 0);
+
+      VkCommandBufferBeginInfo begin_info{};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vkBeginCommandBuffer(command_buffer, &begin_info);
+      vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+      vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pool.pipeline());
+
+      VkViewport viewport{0.0f, 0.0f, float(WIDTH), float(HEIGHT), 0.0f, 1.0f};
+      VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+      vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+      vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+      for (const PooledDraw &draw : draws)
+      {
+        PulledDrawConstants constants = drawConstants(*draw.mesh, draw.transform);
+        vkCmdPushConstants(command_buffer, pool.pipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+        for (uint32_t submesh = 0; submesh < draw.mesh->submeshes.size(); submesh++)
+        {
+          DrawPacket packet = pool.drawPacket(*draw.mesh, submesh);
+          vkCmdBindIndexBuffer(command_buffer, packet.index_buffer, 0, packet.index_type);
+          vkCmdDrawIndexed(command_buffer, packet.element_count, 1, packet.first_element, 0, 0);
+        }
+      }
+
+      vkCmdEndRenderPass(command_buffer);
+
+      VkBufferImageCopy region{};
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+      region.imageExtent = {WIDTH, HEIGHT, 1};
+      vkCmdCopyImageToBuffer(command_buffer, color.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+      vkEndCommandBuffer(command_buffer);
+
+      VkSubmitInfo submit_info{};
+      submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submit_info.commandBufferCount = 1;
+      submit_info.pCommandBuffers = &command_buffer;
+
+      auto start = std::chrono::high_resolution_clock::now();
+      if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to submit vertex pulling frame!");
+      }
+      vkQueueWaitIdle(context.queue);
+      frame_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+      const uint32_t *pixels = static_cast<const uint32_t*>(readback.mapped);
+      return std::vector<uint32_t>(pixels, pixels + size_t(WIDTH) * HEIGHT);
+    };
+
+    std::vector<uint32_t> float_image = render({{&float_mesh, full}});
+    std::vector<uint32_t> quantized_image = render({{&quantized_mesh, full}});
+    std::vector<uint32_t> both_image = render({{&float_mesh, left}, {&quantized_mesh, right}});
+
+    Coverage coverage = compareImages(float_image, quantized_image);
+    uint32_t float_covered = countCovered(float_image, 0, WIDTH);
+    uint32_t quantized_covered = countCovered(quantized_image, 0, WIDTH);
+    uint32_t left_covered = countCovered(both_image, 0, WIDTH / 2);
+    uint32_t right_covered = countCovered(both_image, WIDTH / 2, WIDTH);
+
+    std::cout << "float: " << float_covered << " pixels, quantized: " << quantized_covered << " pixels, "
+      << coverage.mismatched << " of " << coverage.covered << " differ" << std::endl;
+    std::cout << "both in one pass: " << left_covered << " + " << right_covered << " pixels, " << frame_ms << " ms to submit and finish" << std::endl;
+
+    vkDeviceWaitIdle(device);
+    destroyBuffer(device, readback);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    pool.cleanup();
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    vkDestroyRenderPass(device, render_pass, nullptr);
+    destroyImage(device, depth);
+    destroyImage(device, color);
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    if (float_covered == 0 || quantized_covered == 0)
+    {
+      std::cerr << "a pooled mesh drew nothing!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (coverage.mismatched > coverage.covered * MISMATCH_TOLERANCE)
+    {
+      std::cerr << "the float and quantized meshes do not draw alike!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (left_covered == 0 || right_covered == 0)
+    {
+      std::cerr << "a mesh is missing from the pass drawing both encodings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include "VertexQuantization.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  float angleDegrees(const glm::vec3 &a, const glm::vec3 &b)
+  {
+    float cosine = glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f);
+    return glm::degrees(std::acos(cosine));
+  }
+
+  glm::vec2 signNotZero(const glm::vec2 &v)
+  {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+  }
+
+  glm::vec2 octahedralProject(const glm::vec3 &direction)
+  {
+    glm::vec3 n = direction / (std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z));
+    glm::vec2 p(n.x, n.y);
+
+    if (n.z < 0.0f)
+    {
+      p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+    }
+
+    return p;
+  }
+}
+
+glm::i16vec2 encodeOctahedral(const glm::vec3 &direction)
+{
+  glm::vec2 projected = octahedralProject(direction);
+
+  // Rounding each axis independently is not always closest on the sphere,
+  // so try the four neighbouring snorm values and keep the best one.
+  glm::vec2 scaled = glm::clamp(projected, -1.0f, 1.0f) * 32767.0f;
+  glm::vec2 lower = glm::floor(scaled);
+
+  glm::i16vec2 best(0);
+  float best_error = 2.0f;
+
+  for (int i = 0; i < 4; i++)
+  {
+    glm::vec2 candidate = glm::clamp(lower + glm::vec2(i & 1, i >> 1), -32767.0f, 32767.0f);
+    glm::i16vec2 encoded(static_cast<int16_t>(candidate.x), static_cast<int16_t>(candidate.y));
+
+    float error = 1.0f - glm::dot(glm::normalize(direction), decodeOctahedral(encoded));
+    if (error < best_error)
+    {
+      best_error = error;
+      best = encoded;
+    }
+  }
+
+  return best;
+}
+
+glm::vec3 decodeOctahedral(const glm::i16vec2 &encoded)
+{
+  glm::vec2 p = glm::unpackSnorm<float>(encoded);
+  glm::vec3 n(p.x, p.y, 1.0f - std::fabs(p.x) - std::fabs(p.y));
+
+  if (n.z < 0.0f)
+  {
+    glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+    n.x = folded.x;
+    n.y = folded.y;
+  }
+
+  return glm::normalize(n);
+}
+
+QuantizedMesh quantizeMesh(const MeshData &mesh)
+{
+  QuantizedMesh quantized;
+
+  glm::vec3 extent = mesh.bounds_max - mesh.bounds_min;
+  glm::vec3 inverse_extent(
+    extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+    extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+    extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+  quantized.params.position_offset = glm::vec4(mesh.bounds_min, 0.0f);
+  quantized.params.position_scale = glm::vec4(extent, 0.0f);
+  quantized.vertices.resize(mesh.vertices.size());
+
+  QuantizationReport &report = quantized.report;
+  report.source_bytes = mesh.vertices.size() * sizeof(Vertex);
+  report.quantized_bytes = quantized.vertices.size() * sizeof(QuantizedVertex);
+
+  for (size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    const Vertex &vertex = mesh.vertices[i];
+    QuantizedVertex &out = quantized.vertices[i];
+
+    glm::vec3 normalized = glm::clamp((vertex.position - mesh.bounds_min) * inverse_extent, 0.0f, 1.0f);
+    float sign = vertex.tangent.w < 0.0f ? 0.0f : 1.0f;
+
+    out.position = glm::packUnorm<uint16_t>(glm::vec4(normalized, sign));
+    out.normal = encodeOctahedral(vertex.normal);
+    out.tangent = encodeOctahedral(glm::vec3(vertex.tangent));
+    out.uv = glm::packHalf(vertex.uv);
+
+    Vertex decoded = dequantizeVertex(out, quantized.params);
+    glm::vec3 position_error = glm::abs(decoded.position - vertex.position);
+    glm::vec2 uv_error = glm::abs(decoded.uv - vertex.uv);
+
+    report.max_position_error = std::max(report.max_position_error, std::max(position_error.x, std::max(position_error.y, position_error.z)));
+    report.max_normal_error = std::max(report.max_normal_error, angleDegrees(decoded.normal, vertex.normal));
+    report.max_tangent_error = std::max(report.max_tangent_error, angleDegrees(glm::vec3(decoded.tangent), glm::vec3(vertex.tangent)));
+    report.max_uv_error = std::max(report.max_uv_error, std::max(uv_error.x, uv_error.y));
+  }
+
+  return quantized;
+}
+
+Vertex dequantizeVertex(const QuantizedVertex &vertex, const QuantizationParams &params)
+{
+  glm::vec4 position = glm::unpackUnorm<float>(vertex.position);
+
+  Vertex out;
+  out.position = glm::vec3(params.position_offset) + glm::vec3(position) * glm::vec3(params.position_scale);
+  out.normal = decodeOctahedral(vertex.normal);
+  out.tangent = glm::vec4(decodeOctahedral(vertex.tangent), position.w * 2.0f - 1.0f);
+  out.uv = glm::unpackHalf(vertex.uv);
+
+  return out;
+}
@@ -0,0 +1,1076 @@
+#include "VirtualTexture.hpp"
+#include "TextureLoader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+  uint32_t levelSize(uint32_t size, uint32_t level)
+  {
+    return std::max(size >> level, 1u);
+  }
+
+  uint32_t divideUp(uint32_t value, uint32_t divisor)
+  {
+    return (value + divisor - 1) / divisor;
+  }
+
+  uint32_t packEntry(uint32_t slot_x, uint32_t slot_y, uint32_t level)
+  {
+    return slot_x | slot_y << 8 | level << 16 | 1u << 24;
+  }
+}
+
+bool isSparseResidencySupported(VkPhysicalDevice physical_device, VkFormat format)
+{
+  VkPhysicalDeviceFeatures features;
+  vkGetPhysicalDeviceFeatures(physical_device, &features);
+
+  if (!features.sparseBinding || !features.sparseResidencyImage2D)
+  {
+    return false;
+  }
+
+  uint32_t property_count = 0;
+  vkGetPhysicalDeviceSparseImageFormatProperties(physical_device, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_TILING_OPTIMAL, &property_count, nullptr);
+
+  return property_count > 0;
+}
+
+void VirtualTexture::init(VkDevice device, VkPhysicalDevice physical_device, StagingUploader &uploader, JobSystem &jobs, VkQueue sparse_queue, const std::string &file_name,
+  uint32_t cache_slots, uint32_t frames_in_flight, uint32_t tile_size, uint32_t border)
+{
+  this->device = device;
+  this->physical_device = physical_device;
+  this->uploader = &uploader;
+  this->jobs = &jobs;
+  this->sparse_queue = sparse_queue;
+  this->frames_in_flight = std::max(frames_in_flight, 1u);
+
+  file = std::make_unique<TextureFile>(file_name);
+
+  if (file->layerCount() != 1)
+  {
+    throw std::runtime_error("virtual texture file must have one layer!");
+  }
+
+  format = TextureLoader::vulkanFormat(file->format(), file->isSrgb());
+  format_info = textureFormatInfo(file->format());
+
+  VkFormatProperties format_properties;
+  vkGetPhysicalDeviceFormatProperties(physical_device, format, &format_properties);
+
+  if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+  {
+    throw std::runtime_error("Virtual texture format is not supported!");
+  }
+
+  choosePath(tile_size, border);
+
+  if (sparse)
+  {
+    createSparseImage();
+  }
+
+  createPageLevels();
+
+  if (sparse)
+  {
+    createSparseMemory(cache_slots);
+  }
+  else
+  {
+    createCache(cache_slots);
+  }
+
+  createPageTable();
+  createBuffers();
+  createSamplers();
+  loadPinnedLevels();
+
+  frame_stats.page_count = static_cast<uint32_t>(tiles.size());
+  frame_stats.cache_slots = static_cast<uint32_t>(slots.size());
+  frame_stats.sparse = sparse;
+}
+
+void VirtualTexture::cleanup()
+{
+  // Read jobs hold on to this object
+  if (jobs != nullptr)
+  {
+    jobs->waitIdle();
+  }
+
+  if (sparse)
+  {
+    vkDestroyImageView(device, cache.view, nullptr);
+    vkDestroyImage(device, cache.image, nullptr);
+    vkFreeMemory(device, tile_memory, nullptr);
+    vkFreeMemory(device, pinned_memory, nullptr);
+    vkDestroyFence(device, bind_fence, nullptr);
+  }
+  else if (cache.image != VK_NULL_HANDLE)
+  {
+    destroyImage(device, cache);
+  }
+
+  if (page_table.image != VK_NULL_HANDLE)
+  {
+    destroyImage(device, page_table);
+  }
+
+  if (info.buffer != VK_NULL_HANDLE)
+  {
+    destroyBuffer(device, info);
+  }
+
+  for (Buffer &buffer : feedback)
+  {
+    destroyBuffer(device, buffer);
+  }
+
+  vkDestroySampler(device, nearest_sampler, nullptr);
+  vkDestroySampler(device, linear_sampler, nullptr);
+
+  cache = Image{};
+  tile_memory = VK_NULL_HANDLE;
+  pinned_memory = VK_NULL_HANDLE;
+  bind_fence = VK_NULL_HANDLE;
+  nearest_sampler = VK_NULL_HANDLE;
+  linear_sampler = VK_NULL_HANDLE;
+  feedback.clear();
+  levels.clear();
+  tiles.clear();
+  slots.clear();
+  free_slots.clear();
+  page_entries.clear();
+  uploaded_entries.clear();
+  requests.clear();
+  finished_reads.clear();
+  pending_reads = 0;
+  layouts_initialized = false;
+  sparse = false;
+  file.reset();
+  jobs = nullptr;
+  uploader = nullptr;
+}
+
+void VirtualTexture::choosePath(uint32_t tile_size, uint32_t border)
+{
+  const TextureFileHeader &header = file->header();
+  sparse = false;
+
+  if (sparse_queue != VK_NULL_HANDLE && isSparseResidencySupported(physical_device, format))
+  {
+    uint32_t property_count = 1;
+    VkSparseImageFormatProperties properties{};
+    vkGetPhysicalDeviceSparseImageFormatProperties(physical_device, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_TILING_OPTIMAL, &property_count, &properties);
+
+    // A whole number of sparse blocks keeps level 0 out of the mip tail
+    VkExtent3D granularity = properties.imageGranularity;
+    sparse = property_count > 0 && header.width % granularity.width == 0 && header.height % granularity.height == 0;
+
+    if (sparse)
+    {
+      tile_width = granularity.width;
+      tile_height = granularity.height;
+      this->border = 0;
+      return;
+    }
+  }
+
+  if (tile_size == 0 || (tile_size & (tile_size - 1)) != 0 || tile_size % format_info.block_extent != 0 || border % format_info.block_extent != 0)
+  {
+    throw std::runtime_error("virtual texture tiles must be a power of two, and tiles and borders whole blocks!");
+  }
+
+  tile_width = tile_size;
+  tile_height = tile_size;
+  this->border = border;
+}
+
+void VirtualTexture::createPageLevels()
+{
+  const TextureFileHeader &header = file->header();
+  uint32_t level_limit = sparse ? sparse_requirements.imageMipTailFirstLod : file->mipCount();
+  uint32_t first_tile = 0;
+
+  levels.clear();
+
+  for (uint32_t level = 0; level < std::min(level_limit, VIRTUAL_TEXTURE_MAX_LEVELS); level++)
+  {
+    PageLevel page_level{};
+    page_level.width = levelSize(header.width, level);
+    page_level.height = levelSize(header.height, level);
+    page_level.tiles_x = divideUp(page_level.width, tile_width);
+    page_level.tiles_y = divideUp(page_level.height, tile_height);
+    page_level.first_tile = first_tile;
+    levels.push_back(page_level);
+
+    first_tile += page_level.tiles_x * page_level.tiles_y;
+
+    // The next level must halve this one exactly, so tiles nest
+    if (page_level.tiles_x * page_level.tiles_y == 1 || page_level.width % 2 != 0 || page_level.height % 2 != 0)
+    {
+      break;
+    }
+  }
+
+  if (levels.empty())
+  {
+    throw std::runtime_error("virtual texture has no page levels!");
+  }
+
+  tiles.assign(first_tile, Tile{});
+
+  // Page table levels halve exactly from a size that holds every level's tiles
+  uint32_t last = static_cast<uint32_t>(levels.size()) - 1;
+  page_table_width = levels.back().tiles_x << last;
+  page_table_height = levels.back().tiles_y << last;
+
+  size_t table_size = 0;
+  for (uint32_t level = 0; level < levels.size(); level++)
+  {
+    levels[level].table_offset = static_cast<uint32_t>(table_size);
+    table_size += size_t(levelSize(page_table_width, level)) * levelSize(page_table_height, level);
+  }
+
+  page_entries.assign(table_size, 0);
+  uploaded_entries.assign(table_size, 0);
+}
+
+void VirtualTexture::createSparseImage()
+{
+  const TextureFileHeader &header = file->header();
+
+  VkImageCreateInfo image_info{};
+  image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  image_info.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+  image_info.imageType = VK_IMAGE_TYPE_2D;
+  image_info.format = format;
+  image_info.extent = {header.width, header.height, 1};
+  image_info.mipLevels = file->mipCount();
+  image_info.arrayLayers = 1;
+  image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+  image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (vkCreateImage(device, &image_info, nullptr, &cache.image) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create sparse image!");
+  }
+
+  cache.format = format;
+  cache.width = header.width;
+  cache.height = header.height;
+  cache.mip_levels = file->mipCount();
+
+  VkMemoryRequirements memory_requirements;
+  vkGetImageMemoryRequirements(device, cache.image, &memory_requirements);
+  sparse_block_size = memory_requirements.alignment;
+  sparse_memory_types = memory_requirements.memoryTypeBits;
+
+  uint32_t requirement_count = 0;
+  vkGetImageSparseMemoryRequirements(device, cache.image, &requirement_count, nullptr);
+  std::vector<VkSparseImageMemoryRequirements> requirements(requirement_count);
+  vkGetImageSparseMemoryRequirements(device, cache.image, &requirement_count, requirements.data());
+
+  auto color = std::find_if(requirements.begin(), requirements.end(), [](const VkSparseImageMemoryRequirements &requirement)
+  {
+    return (requirement.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+  });
+
+  if (color == requirements.end())
+  {
+    throw std::runtime_error("Failed to query sparse image requirements!");
+  }
+
+  sparse_requirements = *color;
+  cache.view = createImageView(device, cache.image, format, VK_IMAGE_ASPECT_COLOR_BIT, 0, cache.mip_levels);
+
+  VkFenceCreateInfo fence_info{};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  if (vkCreateFence(device, &fence_info, nullptr, &bind_fence) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create sparse bind fence!");
+  }
+}
+
+void VirtualTexture::createSparseMemory(uint32_t cache_slots)
+{
+  VkMemoryAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = VkDeviceSize(std::max(cache_slots, 1u)) * sparse_block_size;
+  alloc_info.memoryTypeIndex = findMemoryType(physical_device, sparse_memory_types, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if (vkAllocateMemory(device, &alloc_info, nullptr, &tile_memory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate sparse tile memory!");
+  }
+
+  slots.assign(std::max(cache_slots, 1u), CacheSlot{});
+  for (uint32_t slot = 0; slot < slots.size(); slot++)
+  {
+    free_slots.push_back(slot);
+  }
+
+  // The last page level and every level below it stay bound, tiled levels whole, then the mip tail
+  uint32_t tail_level = sparse_requirements.imageMipTailFirstLod;
+  uint32_t pinned_level = static_cast<uint32_t>(levels.size()) - 1;
+  VkDeviceSize tail_size = (sparse_requirements.imageMipTailSize + sparse_block_size - 1) / sparse_block_size * sparse_block_size;
+
+  std::vector<VkSparseImageMemoryBind> level_binds;
+  VkDeviceSize pinned_size = 0;
+
+  for (uint32_t level = pinned_level; level < tail_level; level++)
+  {
+    uint32_t width = levelSize(cache.width, level);
+    uint32_t height = levelSize(cache.height, level);
+
+    VkSparseImageMemoryBind bind{};
+    bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0};
+    bind.offset = {0, 0, 0};
+    bind.extent = {width, height, 1};
+    bind.memoryOffset = pinned_size;
+    level_binds.push_back(bind);
+
+    pinned_size += VkDeviceSize(divideUp(width, tile_width)) * divideUp(height, tile_height) * sparse_block_size;
+  }
+
+  VkSparseMemoryBind tail_bind{};
+  tail_bind.resourceOffset = sparse_requirements.imageMipTailOffset;
+  tail_bind.size = sparse_requirements.imageMipTailSize;
+  tail_bind.memoryOffset = pinned_size;
+  pinned_size += tail_level < cache.mip_levels ? tail_size : 0;
+
+  alloc_info.allocationSize = std::max<VkDeviceSize>(pinned_size, sparse_block_size);
+
+  if (vkAllocateMemory(device, &alloc_info, nullptr, &pinned_memory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate sparse pinned memory!");
+  }
+
+  for (VkSparseImageMemoryBind &bind : level_binds)
+  {
+    bind.memory = pinned_memory;
+  }
+  tail_bind.memory = pinned_memory;
+
+  VkSparseImageMemoryBindInfo image_bind_info{};
+  image_bind_info.image = cache.image;
+  image_bind_info.bindCount = static_cast<uint32_t>(level_binds.size());
+  image_bind_info.pBinds = level_binds.data();
+
+  VkSparseImageOpaqueMemoryBindInfo opaque_bind_info{};
+  opaque_bind_info.image = cache.image;
+  opaque_bind_info.bindCount = 1;
+  opaque_bind_info.pBinds = &tail_bind;
+
+  VkBindSparseInfo bind_info{};
+  bind_info.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+  bind_info.imageBindCount = level_binds.empty() ? 0 : 1;
+  bind_info.pImageBinds = &image_bind_info;
+  bind_info.imageOpaqueBindCount = tail_level < cache.mip_levels ? 1 : 0;
+  bind_info.pImageOpaqueBinds = &opaque_bind_info;
+
+  submitBinds(bind_info);
+}
+
+void VirtualTexture::createCache(uint32_t cache_slots)
+{
+  const PageLevel &pinned = levels.back();
+  uint32_t slot_count = cache_slots + pinned.tiles_x * pinned.tiles_y;
+  uint32_t slot_width = tile_width + 2 * border;
+  uint32_t slot_height = tile_height + 2 * border;
+
+  // Page table entries hold 8-bit slot coordinates
+  slots_x = static_cast<uint32_t>(std::ceil(std::sqrt(double(slot_count))));
+  uint32_t slots_y = divideUp(slot_count, slots_x);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+  if (slots_x > 256 || slots_y > 256 || slots_x * slot_width > properties.limits.maxImageDimension2D || slots_y * slot_height > properties.limits.maxImageDimension2D)
+  {
+    throw std::runtime_error("Virtual texture cache is too large!");
+  }
+
+  cache = createImage(device, physical_device, slots_x * slot_width, slots_y * slot_height, 1, format,
+    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+  slots.assign(slot_count, CacheSlot{});
+  for (uint32_t slot = pinned.tiles_x * pinned.tiles_y; slot < slot_count; slot++)
+  {
+    free_slots.push_back(slot);
+  }
+}
+
+void VirtualTexture::createPageTable()
+{
+  page_table = createImage(device, physical_device, page_table_width, page_table_height, static_cast<uint32_t>(levels.size()), VK_FORMAT_R8G8B8A8_UINT,
+    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void VirtualTexture::createBuffers()
+{
+  VirtualTextureInfo texture_info{};
+  texture_info.size[0] = file->header().width;
+  texture_info.size[1] = file->header().height;
+  texture_info.size[2] = tile_width;
+  texture_info.size[3] = tile_height;
+  texture_info.config[0] = static_cast<uint32_t>(levels.size());
+  texture_info.config[1] = sparse ? 1 : 0;
+  texture_info.config[2] = border;
+  texture_info.cache[0] = cache.width;
+  texture_info.cache[1] = cache.height;
+  texture_info.cache[2] = tile_width + 2 * border;
+  texture_info.cache[3] = tile_height + 2 * border;
+
+  for (uint32_t level = 0; level < levels.size(); level++)
+  {
+    texture_info.levels[level][0] = levels[level].tiles_x;
+    texture_info.levels[level][1] = levels[level].tiles_y;
+    texture_info.levels[level][2] = levels[level].first_tile;
+  }
+
+  info = createBuffer(device, physical_device, sizeof(VirtualTextureInfo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  std::memcpy(info.mapped, &texture_info, sizeof(texture_info));
+
+  // Host visible so update() reads it in place, without a copy or a wait
+  VkDeviceSize feedback_size = VkDeviceSize(divideUp(static_cast<uint32_t>(tiles.size()), 32)) * sizeof(uint32_t);
+
+  feedback.resize(frames_in_flight);
+  for (Buffer &buffer : feedback)
+  {
+    buffer = createBuffer(device, physical_device, feedback_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memset(buffer.mapped, 0, buffer.size);
+  }
+}
+
+void VirtualTexture::createSamplers()
+{
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_NEAREST;
+  sampler_info.minFilter = VK_FILTER_NEAREST;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &nearest_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create page table sampler!");
+  }
+
+  // The software cache has one level, the shader blends page levels itself
+  sampler_info.magFilter = VK_FILTER_LINEAR;
+  sampler_info.minFilter = VK_FILTER_LINEAR;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  sampler_info.maxLod = sparse ? VK_LOD_CLAMP_NONE : 0.0f;
+
+  if (vkCreateSampler(device, &sampler_info, nullptr, &linear_sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create virtual texture sampler!");
+  }
+}
+
+void VirtualTexture::loadPinnedLevels()
+{
+  VkCommandBuffer command_buffer = uploader->batchCommandBuffer();
+  recordTransferBarriers(command_buffer, true, true);
+
+  const PageLevel &pinned = levels.back();
+  uint32_t pinned_level = static_cast<uint32_t>(levels.size()) - 1;
+
+  for (uint32_t i = 0; i < pinned.tiles_x * pinned.tiles_y; i++)
+  {
+    uint32_t tile = pinned.first_tile + i;
+    tiles[tile].resident = true;
+
+    if (!sparse)
+    {
+      slots[i].tile = tile;
+      slots[i].pinned = true;
+      tiles[tile].slot = i;
+      stageTile(readTile(tile), i);
+    }
+  }
+
+  // On the sparse path the pinned page level and everything coarser are bound whole
+  if (sparse)
+  {
+    for (uint32_t level = pinned_level; level < cache.mip_levels; level++)
+    {
+      const TextureFileLevel &entry = file->level(level);
+      stageRegion(cache.image, level, 0, 0, entry.width, entry.height, format_info, file->levelData(level));
+    }
+  }
+
+  frame_stats.resident_tiles = pinned.tiles_x * pinned.tiles_y;
+
+  rebuildPageTable();
+  stagePageTable(true);
+  recordTransferBarriers(uploader->batchCommandBuffer(), false, true);
+  uploader->flush();
+
+  layouts_initialized = true;
+}
+
+uint32_t VirtualTexture::tileLevel(uint32_t tile) const
+{
+  uint32_t level = static_cast<uint32_t>(levels.size()) - 1;
+  while (tile < levels[level].first_tile)
+  {
+    level--;
+  }
+  return level;
+}
+
+uint32_t VirtualTexture::parentTile(uint32_t tile) const
+{
+  uint32_t level = tileLevel(tile);
+  if (level + 1 == levels.size())
+  {
+    return NO_SLOT;
+  }
+
+  const PageLevel &page_level = levels[level];
+  const PageLevel &parent_level = levels[level + 1];
+  uint32_t local = tile - page_level.first_tile;
+  uint32_t x = local % page_level.tiles_x;
+  uint32_t y = local / page_level.tiles_x;
+
+  return parent_level.first_tile + (y / 2) * parent_level.tiles_x + x / 2;
+}
+
+VkExtent2D VirtualTexture::tileExtent(uint32_t tile) const
+{
+  const PageLevel &page_level = levels[tileLevel(tile)];
+  uint32_t local = tile - page_level.first_tile;
+  uint32_t x = local % page_level.tiles_x * tile_width;
+  uint32_t y = local / page_level.tiles_x * tile_height;
+
+  return {std::min(tile_width, page_level.width - x), std::min(tile_height, page_level.height - y)};
+}
+
+VirtualTexture::TileRead VirtualTexture::readTile(uint32_t tile) const
+{
+  uint32_t level = tileLevel(tile);
+  const PageLevel &page_level = levels[level];
+  uint32_t local = tile - page_level.first_tile;
+  uint32_t tile_x = local % page_level.tiles_x;
+  uint32_t tile_y = local / page_level.tiles_x;
+
+  uint32_t block_extent = format_info.block_extent;
+  uint32_t block_size = format_info.block_size;
+  uint32_t level_blocks_x = divideUp(page_level.width, block_extent);
+  uint32_t level_blocks_y = divideUp(page_level.height, block_extent);
+  const uint8_t *source = file->levelData(level);
+
+  TileRead read{tile, {}};
+
+  if (sparse)
+  {
+    // Exactly the tile, clipped to the level
+    VkExtent2D extent = tileExtent(tile);
+    uint32_t blocks_x = divideUp(extent.width, block_extent);
+    uint32_t blocks_y = divideUp(extent.height, block_extent);
+    uint32_t first_x = tile_x * tile_width / block_extent;
+    uint32_t first_y = tile_y * tile_height / block_extent;
+    size_t row_size = size_t(blocks_x) * block_size;
+
+    read.data.resize(row_size * blocks_y);
+    for (uint32_t row = 0; row < blocks_y; row++)
+    {
+      std::memcpy(read.data.data() + row * row_size, source + (size_t(first_y + row) * level_blocks_x + first_x) * block_size, row_size);
+    }
+    return read;
+  }
+
+  // The whole slot: the tile and its border, edges replicated past the level
+  uint32_t slot_blocks_x = (tile_width + 2 * border) / block_extent;
+  uint32_t slot_blocks_y = (tile_height + 2 * border) / block_extent;
+  int32_t first_x = (static_cast<int32_t>(tile_x * tile_width) - static_cast<int32_t>(border)) / static_cast<int32_t>(block_extent);
+  int32_t first_y = (static_cast<int32_t>(tile_y * tile_height) - static_cast<int32_t>(border)) / static_cast<int32_t>(block_extent);
+
+  read.data.resize(size_t(slot_blocks_x) * slot_blocks_y * block_size);
+  uint8_t *destination = read.data.data();
+
+  for (uint32_t row = 0; row < slot_blocks_y; row++)
+  {
+    uint32_t y = static_cast<uint32_t>(std::clamp(first_y + static_cast<int32_t>(row), 0, static_cast<int32_t>(level_blocks_y) - 1));
+
+    for (uint32_t column = 0; column < slot_blocks_x; column++)
+    {
+      uint32_t x = static_cast<uint32_t>(std::clamp(first_x + static_cast<int32_t>(column), 0, static_cast<int32_t>(level_blocks_x) - 1));
+      std::memcpy(destination, source + (size_t(y) * level_blocks_x + x) * block_size, block_size);
+      destination += block_size;
+    }
+  }
+
+  return read;
+}
+
+void VirtualTexture::update(uint32_t frame_index)
+{
+  frame++;
+  frame_stats.requested = 0;
+  frame_stats.uploaded = 0;
+  frame_stats.evicted = 0;
+  frame_stats.dropped = 0;
+
+  readFeedback(frame_index);
+  submitReads();
+
+  std::vector<TileRead> reads;
+  std::vector<uint32_t> read_slots;
+  receiveReads(reads, read_slots);
+
+  if (sparse && !reads.empty())
+  {
+    bindSparseTiles(reads, read_slots);
+  }
+
+  rebuildPageTable();
+  bool table_changed = page_entries != uploaded_entries;
+
+  if (!reads.empty() || table_changed)
+  {
+    recordTransferBarriers(uploader->batchCommandBuffer(), true, !reads.empty());
+
+    for (size_t i = 0; i < reads.size(); i++)
+    {
+      stageTile(reads[i], read_slots[i]);
+    }
+
+    stagePageTable(false);
+    recordTransferBarriers(uploader->batchCommandBuffer(), false, !reads.empty());
+    uploader->flush();
+  }
+
+  frame_stats.uploaded = static_cast<uint32_t>(reads.size());
+  frame_stats.pending_reads = pending_reads;
+}
+
+void VirtualTexture::readFeedback(uint32_t frame_index)
+{
+  uint32_t *words = static_cast<uint32_t*>(feedback[frame_index].mapped);
+  uint32_t word_count = static_cast<uint32_t>(feedback[frame_index].size / sizeof(uint32_t));
+
+  requests.clear();
+
+  for (uint32_t i = 0; i < word_count; i++)
+  {
+    for (uint32_t bits = words[i]; bits != 0; bits &= bits - 1)
+    {
+      uint32_t bit = 0;
+      while ((bits & (1u << bit)) == 0)
+      {
+        bit++;
+      }
+
+      uint32_t tile = i * 32 + bit;
+      if (tile < tiles.size())
+      {
+        requestTile(tile);
+      }
+    }
+  }
+
+  std::memset(words, 0, feedback[frame_index].size);
+
+  // Coarse levels first: they cover the most screen and unlock their children
+  std::sort(requests.begin(), requests.end(), [](uint32_t a, uint32_t b) { return a > b; });
+  requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+}
+
+void VirtualTexture::requestTile(uint32_t tile)
+{
+  // Every ancestor is sampled meanwhile, keep them all; load the coarsest
+  // missing one, whose parent is resident
+  uint32_t wanted = NO_SLOT;
+
+  for (uint32_t ancestor = tile; ancestor != NO_SLOT; ancestor = parentTile(ancestor))
+  {
+    Tile &entry = tiles[ancestor];
+    entry.last_requested = frame;
+
+    if (!entry.resident)
+    {
+      wanted = entry.pending ? NO_SLOT : ancestor;
+    }
+  }
+
+  if (wanted != NO_SLOT)
+  {
+    requests.push_back(wanted);
+  }
+}
+
+void VirtualTexture::submitReads()
+{
+  for (uint32_t tile : requests)
+  {
+    if (pending_reads >= max_pending_reads)
+    {
+      break;
+    }
+
+    tiles[tile].pending = true;
+    pending_reads++;
+    frame_stats.requested++;
+
+    jobs->submit([this, tile]()
+    {
+      TileRead read = readTile(tile);
+
+      std::lock_guard<std::mutex> lock(read_mutex);
+      finished_reads.push_back(std::move(read));
+    });
+  }
+}
+
+void VirtualTexture::receiveReads(std::vector<TileRead> &reads, std::vector<uint32_t> &read_slots)
+{
+  std::vector<TileRead> finished;
+  {
+    std::lock_guard<std::mutex> lock(read_mutex);
+    finished.swap(finished_reads);
+  }
+
+  std::vector<TileRead> waiting;
+  uint32_t slot_waits = 0;
+
+  for (TileRead &read : finished)
+  {
+    Tile &tile = tiles[read.tile];
+    uint32_t parent = parentTile(read.tile);
+
+    if (reads.size() >= max_uploads)
+    {
+      waiting.push_back(std::move(read));
+      continue;
+    }
+
+    // The parent may have been evicted while the read ran
+    bool retry = false;
+    uint32_t slot = parent == NO_SLOT || tiles[parent].resident ? allocateSlot(slot_waits, retry) : NO_SLOT;
+
+    // A slot frees up once the frames sampling an evicted tile are done
+    if (slot == NO_SLOT && retry)
+    {
+      slot_waits++;
+      waiting.push_back(std::move(read));
+      continue;
+    }
+
+    if (slot == NO_SLOT)
+    {
+      tile.pending = false;
+      pending_reads--;
+      frame_stats.dropped++;
+      continue;
+    }
+
+    tile.pending = false;
+    tile.resident = true;
+    tile.slot = slot;
+    pending_reads--;
+
+    if (parent != NO_SLOT)
+    {
+      tiles[parent].resident_children++;
+    }
+
+    if (!sparse)
+    {
+      slots[slot].tile = read.tile;
+    }
+
+    frame_stats.resident_tiles++;
+    reads.push_back(std::move(read));
+    read_slots.push_back(slot);
+  }
+
+  std::lock_guard<std::mutex> lock(read_mutex);
+  for (TileRead &read : waiting)
+  {
+    finished_reads.push_back(std::move(read));
+  }
+}
+
+uint32_t VirtualTexture::allocateSlot(uint32_t slot_waits, bool &retry)
+{
+  for (size_t i = 0; i < free_slots.size(); i++)
+  {
+    uint32_t slot = free_slots[i];
+    if (slots[slot].reusable_frame <= frame)
+    {
+      free_slots[i] = free_slots.back();
+      free_slots.pop_back();
+      return slot;
+    }
+  }
+
+  // Slots evicted earlier are on their way back; evict only for reads they do not cover
+  if (free_slots.size() > slot_waits)
+  {
+    retry = true;
+    return NO_SLOT;
+  }
+
+  // Evict the least recently requested leaf that the last frame did not ask for
+  uint32_t victim = NO_SLOT;
+  uint64_t oldest = frame;
+
+  for (uint32_t slot = 0; slot < slots.size(); slot++)
+  {
+    uint32_t tile = slots[slot].tile;
+    if (slots[slot].pinned || tile == NO_SLOT || !tiles[tile].resident || tiles[tile].slot != slot || tiles[tile].resident_children > 0)
+    {
+      continue;
+    }
+
+    if (tiles[tile].last_requested < oldest)
+    {
+      oldest = tiles[tile].last_requested;
+      victim = slot;
+    }
+  }
+
+  if (victim != NO_SLOT)
+  {
+    Tile &tile = tiles[slots[victim].tile];
+    uint32_t parent = parentTile(slots[victim].tile);
+
+    tile.resident = false;
+    tile.slot = NO_SLOT;
+    if (parent != NO_SLOT)
+    {
+      tiles[parent].resident_children--;
+    }
+
+    // Frames in flight may still sample it; the sparse path unbinds it on reuse
+    slots[victim].reusable_frame = frame + frames_in_flight;
+    free_slots.push_back(victim);
+    frame_stats.evicted++;
+    frame_stats.resident_tiles--;
+  }
+
+  retry = !free_slots.empty();
+  return NO_SLOT;
+}
+
+void VirtualTexture::bindSparseTiles(const std::vector<TileRead> &reads, const std::vector<uint32_t> &read_slots)
+{
+  std::vector<VkSparseImageMemoryBind> binds;
+
+  auto tileBind = [&](uint32_t tile, VkDeviceMemory memory, VkDeviceSize offset)
+  {
+    const PageLevel &page_level = levels[tileLevel(tile)];
+    uint32_t local = tile - page_level.first_tile;
+    VkExtent2D extent = tileExtent(tile);
+
+    VkSparseImageMemoryBind bind{};
+    bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, tileLevel(tile), 0};
+    bind.offset = {static_cast<int32_t>(local % page_level.tiles_x * tile_width), static_cast<int32_t>(local / page_level.tiles_x * tile_height), 0};
+    bind.extent = {extent.width, extent.height, 1};
+    bind.memory = memory;
+    bind.memoryOffset = offset;
+    binds.push_back(bind);
+  };
+
+  for (size_t i = 0; i < reads.size(); i++)
+  {
+    uint32_t tile = reads[i].tile;
+    uint32_t slot = read_slots[i];
+    uint32_t previous = slots[slot].tile;
+
+    // Evicted tiles keep their memory until it is reused
+    if (previous != NO_SLOT && previous != tile && tiles[previous].bound_slot == slot)
+    {
+      tileBind(previous, VK_NULL_HANDLE, 0);
+      tiles[previous].bound_slot = NO_SLOT;
+    }
+
+    if (tiles[tile].bound_slot != NO_SLOT && tiles[tile].bound_slot != slot)
+    {
+      slots[tiles[tile].bound_slot].tile = NO_SLOT;
+    }
+
+    tileBind(tile, tile_memory, slot * sparse_block_size);
+    tiles[tile].bound_slot = slot;
+    slots[slot].tile = tile;
+  }
+
+  VkSparseImageMemoryBindInfo image_bind_info{};
+  image_bind_info.image = cache.image;
+  image_bind_info.bindCount = static_cast<uint32_t>(binds.size());
+  image_bind_info.pBinds = binds.data();
+
+  VkBindSparseInfo bind_info{};
+  bind_info.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+  bind_info.imageBindCount = 1;
+  bind_info.pImageBinds = &image_bind_info;
+
+  submitBinds(bind_info);
+}
+
+void VirtualTexture::submitBinds(const VkBindSparseInfo &bind_info)
+{
+  // The copies that follow go through the uploader's queue, so wait here
+  if (vkQueueBindSparse(sparse_queue, 1, &bind_info, bind_fence) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to bind sparse memory!");
+  }
+
+  vkWaitForFences(device, 1, &bind_fence, VK_TRUE, UINT64_MAX);
+  vkResetFences(device, 1, &bind_fence);
+}
+
+void VirtualTexture::stageRegion(VkImage image, uint32_t level, uint32_t x, uint32_t y, uint32_t width, uint32_t height, TextureFormatInfo region_format, const uint8_t *data)
+{
+  uint32_t block_extent = region_format.block_extent;
+  uint32_t block_rows = divideUp(height, block_extent);
+  VkDeviceSize row_size = VkDeviceSize(divideUp(width, block_extent)) * region_format.block_size;
+  uint32_t band_rows = static_cast<uint32_t>(std::min<VkDeviceSize>(uploader->capacity() / row_size, block_rows));
+
+  if (band_rows == 0)
+  {
+    throw std::runtime_error("Virtual texture row does not fit in the staging buffer!");
+  }
+
+  for (uint32_t row = 0; row < block_rows; row += band_rows)
+  {
+    uint32_t rows = std::min(band_rows, block_rows - row);
+    uint32_t band_y = row * block_extent;
+    uint32_t band_height = std::min(rows * block_extent, height - band_y);
+
+    std::memcpy(uploader->stageImage(image, level, 0, x, y + band_y, width, band_height, rows * row_size), data + row * row_size, rows * row_size);
+  }
+}
+
+void VirtualTexture::stageTile(const TileRead &read, uint32_t slot)
+{
+  if (sparse)
+  {
+    const PageLevel &page_level = levels[tileLevel(read.tile)];
+    uint32_t local = read.tile - page_level.first_tile;
+    VkExtent2D extent = tileExtent(read.tile);
+    stageRegion(cache.image, tileLevel(read.tile), local % page_level.tiles_x * tile_width, local / page_level.tiles_x * tile_height, extent.width, extent.height, format_info, read.data.data());
+    return;
+  }
+
+  uint32_t slot_width = tile_width + 2 * border;
+  uint32_t slot_height = tile_height + 2 * border;
+  stageRegion(cache.image, 0, slot % slots_x * slot_width, slot / slots_x * slot_height, slot_width, slot_height, format_info, read.data.data());
+}
+
+void VirtualTexture::rebuildPageTable()
+{
+  // Coarse to fine: a missing tile points where its parent points
+  for (uint32_t level = static_cast<uint32_t>(levels.size()); level-- > 0;)
+  {
+    const PageLevel &page_level = levels[level];
+    uint32_t table_width = levelSize(page_table_width, level);
+
+    for (uint32_t y = 0; y < page_level.tiles_y; y++)
+    {
+      for (uint32_t x = 0; x < page_level.tiles_x; x++)
+      {
+        const Tile &tile = tiles[page_level.first_tile + y * page_level.tiles_x + x];
+        uint32_t &entry = page_entries[page_level.table_offset + y * table_width + x];
+
+        if (tile.resident)
+        {
+          uint32_t slot = sparse || tile.slot == NO_SLOT ? 0 : tile.slot;
+          entry = packEntry(slot % std::max(slots_x, 1u), slot / std::max(slots_x, 1u), level);
+        }
+        else
+        {
+          const PageLevel &parent_level = levels[level + 1];
+          entry = page_entries[parent_level.table_offset + (y / 2) * levelSize(page_table_width, level + 1) + x / 2];
+        }
+      }
+    }
+  }
+}
+
+void VirtualTexture::stagePageTable(bool everything)
+{
+  const TextureFormatInfo entry_format{1, 4};
+
+  // Only the rows that changed, as one band per level
+  for (uint32_t level = 0; level < levels.size(); level++)
+  {
+    uint32_t table_width = levelSize(page_table_width, level);
+    uint32_t first_row = UINT32_MAX;
+    uint32_t last_row = 0;
+
+    for (uint32_t y = 0; y < levels[level].tiles_y; y++)
+    {
+      size_t row = levels[level].table_offset + size_t(y) * table_width;
+      if (everything || std::memcmp(&page_entries[row], &uploaded_entries[row], levels[level].tiles_x * sizeof(uint32_t)) != 0)
+      {
+        first_row = std::min(first_row, y);
+        last_row = y;
+      }
+    }
+
+    if (first_row == UINT32_MAX)
+    {
+      continue;
+    }
+
+    const uint32_t *rows = &page_entries[levels[level].table_offset + size_t(first_row) * table_width];
+    stageRegion(page_table.image, level, 0, first_row, table_width, last_row - first_row + 1, entry_format, reinterpret_cast<const uint8_t*>(rows));
+  }
+
+  uploaded_entries = page_entries;
+}
+
+void VirtualTexture::recordTransferBarriers(VkCommandBuffer command_buffer, bool to_transfer, bool include_cache) const
+{
+  VkImageMemoryBarrier barriers[2]{};
+  VkImage images[2] = {page_table.image, cache.image};
+  uint32_t mip_levels[2] = {page_table.mip_levels, cache.mip_levels};
+  uint32_t barrier_count = include_cache ? 2 : 1;
+
+  for (uint32_t i = 0; i < barrier_count; i++)
+  {
+    VkImageMemoryBarrier &barrier = barriers[i];
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = to_transfer ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = to_transfer ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = to_transfer ? (layouts_initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED) : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = to_transfer ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = images[i];
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels[i], 0, 1};
+  }
+
+  // Earlier frames' reads only need an execution dependency before the copies overwrite slots
+  VkPipelineStageFlags src_stage = to_transfer ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkPipelineStageFlags dst_stage = to_transfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, barrier_count, barriers);
+}
+
+void VirtualTexture::recordFeedbackBarrier(VkCommandBuffer command_buffer) const
+{
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
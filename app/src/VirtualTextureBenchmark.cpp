@@ -0,0 +1,651 @@
+#include "VirtualTexture.hpp"
+#include "TextureFile.hpp"
+#include "ImageFile.hpp"
+#include "StagingUploader.hpp"
+#include "JobSystem.hpp"
+#include "VkHelpers.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Headless run of VirtualTexture over a synthetic 2048x2048 RGBA8 texture
+ * (written to the working directory), with feedback bits written on the host
+ * instead of by a fragment shader. Checks on the software cache path and, when
+ * the device has sparse residency, the sparse binding path:
+ *  - a requested tile loads coarsest missing ancestor first,
+ *  - a full cache evicts the least recently requested leaf, once, and reuses
+ *    its slot only frames in flight updates later,
+ *  - the page table read back from the GPU points every tile at its finest
+ *    resident ancestor (distinct cache slots on the software path).
+ * Then streams a window of finest tiles across the texture with a small cache
+ * and prints the update cost and the loaded, evicted and dropped tiles.
+ * Usage: VirtualTextureBenchmark [all|software|sparse]
+ */
+namespace
+{
+  const char *TEXTURE_FILE = "virtual_texture_test.vtex";
+  const uint32_t TEXTURE_SIZE = 2048;
+  const uint32_t TILE_SIZE = 128;
+  const uint32_t FRAMES_IN_FLIGHT = 2;
+  const int SETTLE_FRAMES = 64;
+  const int STREAM_FRAMES = 600;
+  const int FRAMES_PER_SECOND = 60;
+  const uint32_t WINDOW_TILES = 3;
+
+  struct HeadlessContext
+  {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    VkQueue sparse_queue = VK_NULL_HANDLE; // none without sparse residency
+  };
+
+  struct TileId
+  {
+    uint32_t level;
+    uint32_t x;
+    uint32_t y;
+  };
+
+  struct SettleResult
+  {
+    int frames = 0;
+    uint32_t uploaded = 0;
+    uint32_t evicted = 0;
+    uint32_t dropped = 0;
+    int first_eviction = -1; // frame of the first eviction
+    int last_upload = -1;
+    bool over_budget = false;
+  };
+
+  HeadlessContext createContext()
+  {
+    HeadlessContext context;
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Virtual Texture Benchmark";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // No surface, so no extensions
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create instance!");
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context.instance, &device_count, devices.data());
+
+    // Any device runs the software path, prefer one that also runs the sparse path
+    uint32_t sparse_family = UINT32_MAX;
+
+    for (VkPhysicalDevice device : devices)
+    {
+      uint32_t family_count = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+      std::vector<VkQueueFamilyProperties> families(family_count);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families.data());
+
+      uint32_t graphics_family = UINT32_MAX;
+      uint32_t binding_family = UINT32_MAX;
+
+      for (uint32_t i = 0; i < family_count; i++)
+      {
+        if (graphics_family == UINT32_MAX && (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+          graphics_family = i;
+        }
+
+        // The graphics family itself when it binds, to keep one queue
+        bool binds = (families[i].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) != 0;
+        if (binds && (binding_family == UINT32_MAX || i == graphics_family))
+        {
+          binding_family = i;
+        }
+      }
+
+      if (graphics_family == UINT32_MAX)
+      {
+        continue;
+      }
+
+      bool sparse = binding_family != UINT32_MAX && isSparseResidencySupported(device, VK_FORMAT_R8G8B8A8_UNORM);
+      if (context.physical_device == VK_NULL_HANDLE || (sparse && sparse_family == UINT32_MAX))
+      {
+        context.physical_device = device;
+        context.queue_family = graphics_family;
+        sparse_family = sparse ? binding_family : UINT32_MAX;
+      }
+    }
+
+    if (context.physical_device == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to find a GPU with a graphics queue!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    std::cout << properties.deviceName << std::endl;
+
+    float queue_priority = 1.0f;
+    std::vector<VkDeviceQueueCreateInfo> queue_infos;
+    for (uint32_t family : {context.queue_family, sparse_family})
+    {
+      if (family == UINT32_MAX || (!queue_infos.empty() && queue_infos[0].queueFamilyIndex == family))
+      {
+        continue;
+      }
+
+      VkDeviceQueueCreateInfo queue_info{};
+      queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+      queue_info.queueFamilyIndex = family;
+      queue_info.queueCount = 1;
+      queue_info.pQueuePriorities = &queue_priority;
+      queue_infos.push_back(queue_info);
+    }
+
+    VkPhysicalDeviceFeatures features{};
+    features.sparseBinding = sparse_family != UINT32_MAX ? VK_TRUE : VK_FALSE;
+    features.sparseResidencyImage2D = features.sparseBinding;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = static_cast<uint32_t>(queue_infos.size());
+    device_info.pQueueCreateInfos = queue_infos.data();
+    device_info.pEnabledFeatures = &features;
+
+    if (vkCreateDevice(context.physical_device, &device_info, nullptr, &context.device) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(context.device, context.queue_family, 0, &context.queue);
+    if (sparse_family != UINT32_MAX)
+    {
+      vkGetDeviceQueue(context.device, sparse_family, 0, &context.sparse_queue);
+    }
+
+    return context;
+  }
+
+  /**
+   * Every texel distinct enough to tell tiles apart when debugging
+   */
+  void writeTestTexture(const std::string &file_name)
+  {
+    ImageData image;
+    image.width = TEXTURE_SIZE;
+    image.height = TEXTURE_SIZE;
+    image.pixels.resize(size_t(TEXTURE_SIZE) * TEXTURE_SIZE * 4);
+
+    for (uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+      for (uint32_t x = 0; x < TEXTURE_SIZE; x++)
+      {
+        uint8_t *pixel = &image.pixels[(size_t(y) * TEXTURE_SIZE + x) * 4];
+        pixel[0] = static_cast<uint8_t>(x);
+        pixel[1] = static_cast<uint8_t>(y);
+        pixel[2] = static_cast<uint8_t>((x / TILE_SIZE) * 16 + y / TILE_SIZE);
+        pixel[3] = 255;
+      }
+    }
+
+    writeTextureFile(file_name, image, TEXTURE_FORMAT_RGBA8, false);
+  }
+
+  uint32_t tileIndex(const VirtualTextureInfo &layout, const TileId &id)
+  {
+    return layout.levels[id.level][2] + id.y * layout.levels[id.level][0] + id.x;
+  }
+
+  /**
+   * The tile and every ancestor below the pinned level
+   */
+  std::vector<TileId> tileChain(const VirtualTextureInfo &layout, TileId id)
+  {
+    std::vector<TileId> chain;
+    for (; id.level + 1 < layout.config[0]; id = {id.level + 1, id.x / 2, id.y / 2})
+    {
+      chain.push_back(id);
+    }
+    return chain;
+  }
+
+  /**
+   * Sets the feedback bits of `wanted` for the next frame in flight and updates
+   */
+  void requestTiles(VirtualTexture &texture, uint64_t &frame, const std::vector<TileId> &wanted)
+  {
+    uint32_t frame_index = static_cast<uint32_t>(frame++ % FRAMES_IN_FLIGHT);
+    uint32_t *bits = texture.feedbackBits(frame_index);
+
+    for (const TileId &id : wanted)
+    {
+      uint32_t tile = tileIndex(texture.layout(), id);
+      bits[tile / 32] |= 1u << (tile % 32);
+    }
+
+    texture.update(frame_index);
+  }
+
+  /**
+   * Requests `wanted` every frame, waiting for the reads in between, until
+   * nothing is loading any more
+   */
+  SettleResult settle(VirtualTexture &texture, JobSystem &jobs, uint64_t &frame, const std::vector<TileId> &wanted, uint32_t cache_slots, uint32_t pinned_tiles)
+  {
+    SettleResult result;
+
+    while (result.frames < SETTLE_FRAMES)
+    {
+      requestTiles(texture, frame, wanted);
+      jobs.waitIdle();
+      result.frames++;
+
+      const VirtualTextureStats &stats = texture.stats();
+      result.uploaded += stats.uploaded;
+      result.evicted += stats.evicted;
+      result.dropped += stats.dropped;
+      result.over_budget |= stats.resident_tiles > cache_slots + pinned_tiles;
+
+      if (stats.evicted > 0 && result.first_eviction < 0)
+      {
+        result.first_eviction = result.frames;
+      }
+      if (stats.uploaded > 0)
+      {
+        result.last_upload = result.frames;
+      }
+
+      if (stats.requested == 0 && stats.uploaded == 0 && stats.pending_reads == 0)
+      {
+        break;
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   * Copies every page table level into host memory, level after level
+   */
+  std::vector<uint32_t> readPageTable(const HeadlessContext &context, VkCommandBuffer command_buffer, const VirtualTexture &texture)
+  {
+    VkExtent2D extent = texture.pageTableExtent();
+    uint32_t level_count = texture.layout().config[0];
+
+    std::vector<VkBufferImageCopy> regions;
+    VkDeviceSize size = 0;
+
+    for (uint32_t level = 0; level < level_count; level++)
+    {
+      VkBufferImageCopy region{};
+      region.bufferOffset = size;
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+      region.imageExtent = {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1};
+      regions.push_back(region);
+
+      size += VkDeviceSize(region.imageExtent.width) * region.imageExtent.height * sizeof(uint32_t);
+    }
+
+    Buffer readback = createBuffer(context.device, context.physical_device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture.pageTableImage();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count, 0, 1};
+
+    vkResetCommandBuffer(command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdCopyImageToBuffer(command_buffer, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+    // Back to where update() expects it
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkEndCommandBuffer(command_buffer);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    if (vkQueueSubmit(context.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to submit page table readback!");
+    }
+    vkQueueWaitIdle(context.queue);
+
+    std::vector<uint32_t> entries(size / sizeof(uint32_t));
+    std::copy_n(static_cast<const uint32_t*>(readback.mapped), entries.size(), entries.begin());
+    destroyBuffer(context.device, readback);
+
+    return entries;
+  }
+
+  /**
+   * Compares the page table with the tiles that should be resident: every tile
+   * points at its finest resident ancestor, and a missing tile holds its
+   * parent's entry. Returns the number of wrong entries.
+   */
+  uint32_t checkPageTable(const VirtualTexture &texture, const std::vector<uint32_t> &entries, const std::vector<bool> &resident)
+  {
+    const VirtualTextureInfo &layout = texture.layout();
+    VkExtent2D extent = texture.pageTableExtent();
+    uint32_t last = layout.config[0] - 1;
+
+    std::vector<size_t> offsets;
+    size_t offset = 0;
+    for (uint32_t level = 0; level <= last; level++)
+    {
+      offsets.push_back(offset);
+      offset += size_t(std::max(extent.width >> level, 1u)) * std::max(extent.height >> level, 1u);
+    }
+
+    auto entryOf = [&](const TileId &id)
+    {
+      return entries[offsets[id.level] + size_t(id.y) * std::max(extent.width >> id.level, 1u) + id.x];
+    };
+
+    uint32_t errors = 0;
+    std::vector<uint32_t> used_slots;
+
+    for (uint32_t level = 0; level <= last; level++)
+    {
+      for (uint32_t y = 0; y < layout.levels[level][1]; y++)
+      {
+        for (uint32_t x = 0; x < layout.levels[level][0]; x++)
+        {
+          TileId id{level, x, y};
+          uint32_t resident_level = level;
+          while (resident_level < last && !resident[tileIndex(layout, {resident_level, x >> (resident_level - level), y >> (resident_level - level)})])
+          {
+            resident_level++;
+          }
+
+          uint32_t entry = entryOf(id);
+          bool valid = (entry >> 24) == 1 && ((entry >> 16) & 0xff) == resident_level;
+
+          if (resident_level != level)
+          {
+            valid = valid && entry == entryOf({level + 1, x / 2, y / 2});
+          }
+          else if (!texture.isSparse())
+          {
+            used_slots.push_back(entry & 0xffff);
+          }
+
+          errors += valid ? 0 : 1;
+        }
+      }
+    }
+
+    // Two resident tiles in one cache slot
+    std::sort(used_slots.begin(), used_slots.end());
+    errors += static_cast<uint32_t>(used_slots.end() - std::unique(used_slots.begin(), used_slots.end()));
+
+    return errors;
+  }
+
+  /**
+   * Runs the checks and the streaming run on one path, returns whether the checks passed
+   */
+  bool runPath(const HeadlessContext &context, StagingUploader &uploader, JobSystem &jobs, VkCommandBuffer command_buffer, bool use_sparse)
+  {
+    // Sized below so that the second request needs exactly one eviction
+    VirtualTexture probe;
+    probe.init(context.device, context.physical_device, uploader, jobs, use_sparse ? context.sparse_queue : VK_NULL_HANDLE, TEXTURE_FILE, 1, FRAMES_IN_FLIGHT, TILE_SIZE);
+    uint32_t level_count = probe.layout().config[0];
+    bool sparse = probe.isSparse();
+    probe.cleanup();
+
+    std::cout << (use_sparse ? "sparse path" : "software path") << (use_sparse && !sparse ? " (fell back to the software path)" : "") << ", "
+      << level_count << " page levels" << std::endl;
+
+    if (level_count < 4)
+    {
+      std::cerr << "virtual texture needs at least four page levels for the checks!" << std::endl;
+      return false;
+    }
+
+    uint32_t last = level_count - 1;
+    uint32_t cache_slots = last + (last - 1) - 1;
+
+    VirtualTexture texture;
+    texture.init(context.device, context.physical_device, uploader, jobs, use_sparse ? context.sparse_queue : VK_NULL_HANDLE, TEXTURE_FILE, cache_slots, FRAMES_IN_FLIGHT, TILE_SIZE);
+
+    const VirtualTextureInfo &layout = texture.layout();
+    uint32_t pinned_tiles = layout.levels[last][0] * layout.levels[last][1];
+    std::vector<bool> resident(texture.stats().page_count, false);
+    for (uint32_t i = 0; i < pinned_tiles; i++)
+    {
+      resident[layout.levels[last][2] + i] = true;
+    }
+
+    uint64_t frame = 0;
+    bool passed = true;
+
+    auto expect = [&](bool condition, const char *message)
+    {
+      if (!condition)
+      {
+        std::cerr << message << std::endl;
+        passed = false;
+      }
+    };
+
+    // One finest tile: its ancestors load one per update, coarsest first
+    TileId corner{0, 0, 0};
+    std::vector<TileId> first_chain = tileChain(layout, corner);
+
+    uint32_t chain_loaded = 0;
+    int first_updates = 0;
+    bool first_clean = true;
+
+    while (chain_loaded < first_chain.size() && first_updates < SETTLE_FRAMES)
+    {
+      requestTiles(texture, frame, {corner});
+      jobs.waitIdle();
+      first_updates++;
+
+      const VirtualTextureStats &stats = texture.stats();
+      first_clean = first_clean && stats.evicted == 0 && stats.dropped == 0 && stats.resident_tiles <= cache_slots + pinned_tiles;
+      if (stats.uploaded == 0)
+      {
+        continue;
+      }
+
+      expect(stats.uploaded == 1, "more than one level of a chain loaded in one update!");
+      chain_loaded = std::min<uint32_t>(chain_loaded + stats.uploaded, static_cast<uint32_t>(first_chain.size()));
+
+      // The chain fills from the pinned level down
+      for (uint32_t i = 0; i < chain_loaded; i++)
+      {
+        resident[tileIndex(layout, first_chain[first_chain.size() - 1 - i])] = true;
+      }
+      expect(checkPageTable(texture, readPageTable(context, command_buffer, texture), resident) == 0, "page table does not match the resident tiles while loading!");
+    }
+
+    expect(chain_loaded == first_chain.size() && texture.stats().resident_tiles == pinned_tiles + first_chain.size(), "the requested tile chain is not resident!");
+    expect(first_clean, "tiles evicted or dropped with free cache slots!");
+
+    // The opposite corner one level up needs one slot more than is free: the
+    // finest tile of the first chain goes, and its slot waits for the frames in flight
+    TileId far{1, layout.levels[1][0] - 1, layout.levels[1][1] - 1};
+    std::vector<TileId> second_chain = tileChain(layout, far);
+
+    SettleResult second = settle(texture, jobs, frame, {far}, cache_slots, pinned_tiles);
+    resident[tileIndex(layout, corner)] = false;
+    for (const TileId &id : second_chain)
+    {
+      resident[tileIndex(layout, id)] = true;
+    }
+
+    expect(second.evicted == 1, "expected exactly one eviction!");
+    expect(second.dropped == 0, "a tile was dropped although a slot was coming free!");
+    expect(second.first_eviction >= 0 && second.last_upload >= second.first_eviction + int(FRAMES_IN_FLIGHT), "an evicted slot was reused while frames in flight could sample it!");
+    expect(!second.over_budget, "more tiles resident than the cache holds!");
+    expect(texture.stats().resident_tiles == pinned_tiles + first_chain.size() - 1 + second_chain.size(), "wrong tiles resident after the eviction!");
+    expect(checkPageTable(texture, readPageTable(context, command_buffer, texture), resident) == 0, "page table does not match the resident tiles after the eviction!");
+
+    std::cout << "  first chain:  " << first_chain.size() << " tiles in " << first_updates << " updates" << std::endl;
+    std::cout << "  second chain: " << second_chain.size() << " tiles in " << second.frames << " updates, "
+      << second.evicted << " evicted, slot reused " << second.last_upload - second.first_eviction << " updates later" << std::endl;
+
+    // Streaming: a window of finest tiles slides across the texture, reads complete whenever they do
+    uint32_t finest_tiles = layout.levels[0][0];
+    uint32_t uploaded = 0;
+    uint32_t evicted = 0;
+    uint32_t dropped = 0;
+    double update_ms = 0.0;
+    bool over_budget = false;
+
+    for (int i = 0; i < STREAM_FRAMES; i++)
+    {
+      uint32_t offset = static_cast<uint32_t>(uint64_t(i) * (finest_tiles - WINDOW_TILES) / (STREAM_FRAMES - 1));
+      std::vector<TileId> window;
+      for (uint32_t y = 0; y < WINDOW_TILES; y++)
+      {
+        for (uint32_t x = 0; x < WINDOW_TILES; x++)
+        {
+          window.push_back({0, offset + x, offset + y});
+        }
+      }
+
+      auto start = std::chrono::high_resolution_clock::now();
+      requestTiles(texture, frame, window);
+      auto end = std::chrono::high_resolution_clock::now();
+
+      const VirtualTextureStats &stats = texture.stats();
+      update_ms += std::chrono::duration<double, std::milli>(end - start).count();
+      uploaded += stats.uploaded;
+      evicted += stats.evicted;
+      dropped += stats.dropped;
+      over_budget |= stats.resident_tiles > cache_slots + pinned_tiles;
+
+      if (i % FRAMES_PER_SECOND == 0)
+      {
+        std::cout << "  frame " << i << ": " << stats.resident_tiles << " resident, " << stats.pending_reads << " pending" << std::endl;
+      }
+    }
+
+    jobs.waitIdle();
+    expect(!over_budget, "more tiles resident than the cache holds while streaming!");
+
+    std::cout << "  streaming " << STREAM_FRAMES << " frames with " << cache_slots << " cache slots: " << update_ms / STREAM_FRAMES << " ms per update, "
+      << uploaded << " loaded, " << evicted << " evicted, " << dropped << " dropped" << std::endl;
+
+    texture.cleanup();
+    return passed;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::string paths = argc > 1 ? argv[1] : "all";
+
+  try
+  {
+    HeadlessContext context = createContext();
+    VkDevice device = context.device;
+
+    bool run_software = paths == "all" || paths == "software";
+    bool run_sparse = paths == "all" || paths == "sparse";
+
+    if (run_sparse && context.sparse_queue == VK_NULL_HANDLE)
+    {
+      std::cout << "sparse residency is not supported, skipping the sparse path" << std::endl;
+      run_sparse = false;
+    }
+
+    writeTestTexture(TEXTURE_FILE);
+
+    JobSystem jobs;
+    StagingUploader uploader;
+    uploader.init(device, context.physical_device, context.queue, context.queue_family, 64 * 1024 * 1024);
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = context.queue_family;
+
+    VkCommandPool command_pool;
+    if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+
+    bool passed = true;
+    if (run_software)
+    {
+      passed = runPath(context, uploader, jobs, command_buffer, false) && passed;
+    }
+    if (run_sparse)
+    {
+      passed = runPath(context, uploader, jobs, command_buffer, true) && passed;
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    uploader.cleanup();
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    if (!passed)
+    {
+      std::cerr << "virtual texture checks failed!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
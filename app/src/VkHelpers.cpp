@@ -0,0 +1,255 @@
+#include "VkHelpers.hpp"
+
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+
+uint32_t findMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties)
+{
+  VkPhysicalDeviceMemoryProperties memory_properties;
+  vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+  for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+  {
+    if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+    {
+      return i;
+    }
+  }
+
+  throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+Buffer createBuffer(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+  Buffer buffer;
+  buffer.size = size;
+
+  VkBufferCreateInfo buffer_info{};
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.size = size;
+  buffer_info.usage = usage;
+  buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer.buffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create buffer!");
+  }
+
+  VkMemoryRequirements memory_requirements;
+  vkGetBufferMemoryRequirements(device, buffer.buffer, &memory_requirements);
+
+  VkMemoryAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = memory_requirements.size;
+  alloc_info.memoryTypeIndex = findMemoryType(physical_device, memory_requirements.memoryTypeBits, properties);
+
+  // Addressable buffers need addressable memory
+  VkMemoryAllocateFlagsInfo flags_info{};
+  flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+  flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+  if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+  {
+    alloc_info.pNext = &flags_info;
+  }
+
+  if (vkAllocateMemory(device, &alloc_info, nullptr, &buffer.memory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to allocate buffer memory!");
+  }
+
+  vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+
+  if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+  {
+    vkMapMemory(device, buffer.memory, 0, size, 0, &buffer.mapped);
+  }
+
+  return buffer;
+}
+
+VkDeviceAddress bufferAddress(VkDevice device, VkBuffer buffer)
+{
+  VkBufferDeviceAddressInfo address_info{};
+  address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+  address_info.buffer = buffer;
+
+  return vkGetBufferDeviceAddress(device, &address_info);
+}
+
+void destroyBuffer(VkDevice device, Buffer &buffer)
+{
+  if (buffer.mapped != nullptr)
+  {
+    vkUnmapMemory(device, buffer.memory);
+  }
+
+  vkDestroyBuffer(device, buffer.buffer, nullptr);
+  vkFreeMemory(device, buffer.memory, nullptr);
+  buffer = Buffer{};
+}
+
+namespace
+{
+  Image allocateImage(VkDevice device, VkPhysicalDevice physical_device, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t layers, VkFormat format, VkImageUsageFlags usage)
+  {
+    Image image;
+    image.format = format;
+    image.width = width;
+    image.height = height;
+    image.mip_levels = mip_levels;
+    image.layers = layers;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = format;
+    image_info.extent = {width, height, 1};
+    image_info.mipLevels = mip_levels;
+    image_info.arrayLayers = layers;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = usage;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &image_info, nullptr, &image.image) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to create image!");
+    }
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(device, image.image, &memory_requirements);
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = memory_requirements.size;
+    alloc_info.memoryTypeIndex = findMemoryType(physical_device, memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &alloc_info, nullptr, &image.memory) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to allocate image memory!");
+    }
+
+    vkBindImageMemory(device, image.image, image.memory, 0);
+
+    return image;
+  }
+}
+
+Image createImage(VkDevice device, VkPhysicalDevice physical_device, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+  Image image = allocateImage(device, physical_device, width, height, mip_levels, 1, format, usage);
+  image.view = createImageView(device, image.image, format, aspect, 0, mip_levels);
+  return image;
+}
+
+Image createImageArray(VkDevice device, VkPhysicalDevice physical_device, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t layers, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+  Image image = allocateImage(device, physical_device, width, height, mip_levels, layers, format, usage);
+
+  VkImageViewCreateInfo view_info{};
+  view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  view_info.image = image.image;
+  view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+  view_info.format = format;
+  view_info.subresourceRange = {aspect, 0, mip_levels, 0, layers};
+
+  if (vkCreateImageView(device, &view_info, nullptr, &image.view) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create image view!");
+  }
+
+  return image;
+}
+
+void destroyImage(VkDevice device, Image &image)
+{
+  vkDestroyImageView(device, image.view, nullptr);
+  vkDestroyImage(device, image.image, nullptr);
+  vkFreeMemory(device, image.memory, nullptr);
+  image = Image{};
+}
+
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t base_mip, uint32_t mip_count)
+{
+  VkImageViewCreateInfo view_info{};
+  view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  view_info.image = image;
+  view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  view_info.format = format;
+  view_info.subresourceRange.aspectMask = aspect;
+  view_info.subresourceRange.baseMipLevel = base_mip;
+  view_info.subresourceRange.levelCount = mip_count;
+  view_info.subresourceRange.baseArrayLayer = 0;
+  view_info.subresourceRange.layerCount = 1;
+
+  VkImageView view;
+  if (vkCreateImageView(device, &view_info, nullptr, &view) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create image view!");
+  }
+
+  return view;
+}
+
+VkFormat findDepthFormat(VkPhysicalDevice physical_device)
+{
+  // Vulkan guarantees sampled depth for D16 and one of the other two
+  const VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM};
+  const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+
+  for (VkFormat format : candidates)
+  {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+    if ((properties.optimalTilingFeatures & required) == required)
+    {
+      return format;
+    }
+  }
+
+  throw std::runtime_error("Failed to find a sampled depth format!");
+}
+
+std::vector<uint32_t> readSpirv(const std::string &file_name)
+{
+  std::ifstream file(file_name, std::ios::ate | std::ios::binary);
+
+  if (!file.is_open())
+  {
+    throw std::runtime_error("failed to open file!");
+  }
+
+  // uint32_t storage keeps the code aligned for pCode
+  size_t file_size = static_cast<size_t>(file.tellg());
+  std::vector<uint32_t> code((file_size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(code.data()), file_size);
+
+  return code;
+}
+
+VkShaderModule loadShaderModule(VkDevice device, const std::vector<uint32_t> &code)
+{
+  VkShaderModuleCreateInfo create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  create_info.codeSize = code.size() * sizeof(uint32_t);
+  create_info.pCode = code.data();
+
+  VkShaderModule shader_module;
+  if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+  {
+    throw std::runtime_error("Failed to create shader module!");
+  }
+
+  return shader_module;
+}
+
+VkShaderModule loadShaderModule(VkDevice device, const std::string &file_name)
+{
+  return loadShaderModule(device, readSpirv(file_name));
+}
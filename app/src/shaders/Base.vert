@@ -1,5 +1,7 @@
 #version 450
 
+#include "DrawConstants.glsl"
+
 layout(location=0) out vec3 fragColor;
 
 vec2 positions[3] = vec2[] (
@@ -16,6 +18,6 @@ vec3 colors[3] = vec3[] (
 
 void main()
 {
-  gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+  gl_Position = draw.transform * vec4(positions[gl_VertexIndex], 0.0, 1.0);
   fragColor = colors[gl_VertexIndex];
 }
\ No newline at end of file
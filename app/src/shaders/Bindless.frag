@@ -0,0 +1,13 @@
+#version 450
+
+#define BINDLESS_SET 0
+#include "Bindless.glsl"
+
+layout(location=0) in vec2 fragUV;
+
+layout(location=0) out vec4 outColor;
+
+void main()
+{
+  outColor = bindlessAlbedo(fragUV);
+}
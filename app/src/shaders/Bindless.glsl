@@ -0,0 +1,51 @@
+// Global resource heap of BindlessHeap. Define BINDLESS_SET before including
+// (0 with BindlessHeap::pipelineLayout). Indices that differ within a draw
+// must go through nonuniformEXT, as the helpers below do.
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set=BINDLESS_SET, binding=0) uniform texture2D bindless_textures[];
+layout(set=BINDLESS_SET, binding=1) uniform sampler bindless_samplers[];
+
+struct BindlessMaterial
+{
+  uint albedo;
+  uint sampler_index;
+  uvec2 padding;
+  vec4 base_color;
+};
+
+layout(std430, set=BINDLESS_SET, binding=2) readonly buffer BindlessMaterials { BindlessMaterial materials[]; } bindless_materials[];
+
+layout(push_constant) uniform BindlessDrawConstants
+{
+  uint materials;
+  uint material;
+  uint objects;
+  uint object;
+} bindless_draw;
+
+const uint BINDLESS_NONE = 0xffffffffu;
+
+vec4 sampleBindless(uint texture_index, uint sampler_index, vec2 uv)
+{
+  return texture(sampler2D(bindless_textures[nonuniformEXT(texture_index)], bindless_samplers[nonuniformEXT(sampler_index)]), uv);
+}
+
+BindlessMaterial loadBindlessMaterial(uint materials, uint material)
+{
+  return bindless_materials[nonuniformEXT(materials)].materials[material];
+}
+
+// Base color times albedo of the draw's material
+vec4 bindlessAlbedo(vec2 uv)
+{
+  BindlessMaterial material = loadBindlessMaterial(bindless_draw.materials, bindless_draw.material);
+
+  if (material.albedo == BINDLESS_NONE)
+  {
+    return material.base_color;
+  }
+
+  return material.base_color * sampleBindless(material.albedo, material.sampler_index, uv);
+}
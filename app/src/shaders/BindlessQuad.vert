@@ -0,0 +1,20 @@
+#version 450
+
+#define BINDLESS_SET 0
+#include "Bindless.glsl"
+
+// The draw's object buffer holds one screen rectangle per object
+layout(std430, set=BINDLESS_SET, binding=2) readonly buffer BindlessQuads { vec4 rects[]; } bindless_quads[];
+
+layout(location=0) out vec2 fragUV;
+
+// A screen-aligned rectangle drawn as a 4 vertex strip, everything it reads
+// selected by the draw's push constants
+void main()
+{
+  vec4 rect = bindless_quads[nonuniformEXT(bindless_draw.objects)].rects[bindless_draw.object]; // x0, y0, x1, y1 in NDC
+
+  vec2 uv = vec2(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1);
+  gl_Position = vec4(mix(rect.xy, rect.zw, uv), 0.0, 1.0);
+  fragUV = uv;
+}
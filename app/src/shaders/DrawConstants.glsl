@@ -0,0 +1,7 @@
+// Per-draw push constants, matches DrawConstants in PipelineLayoutBuilder.hpp
+layout(std430, push_constant) uniform DrawConstants
+{
+  mat4 transform;
+  uint object;
+  uint material;
+} draw;
@@ -0,0 +1,16 @@
+#version 450
+
+#include "MeshletCommon.glsl"
+
+layout(location=0) out vec3 fragColor;
+
+// Fallback path: the index buffer holds the expanded meshlet triangles
+void main()
+{
+  vec3 position;
+  vec3 normal;
+  loadVertex(gl_VertexIndex, position, normal);
+
+  gl_Position = frame.view_proj * frame.model * vec4(position, 1.0);
+  fragColor = normal * 0.5 + 0.5;
+}
@@ -0,0 +1,87 @@
+// Shared by the meshlet task, mesh, cull and vertex shaders. Matches MeshletRenderer.
+
+struct Meshlet
+{
+  uint vertex_offset;
+  uint triangle_offset;
+  uint vertex_count;
+  uint triangle_count;
+};
+
+struct MeshletBounds
+{
+  vec4 sphere;    // xyz = center, w = radius
+  vec4 cone_apex; // w = cone cutoff
+  vec4 cone_axis;
+};
+
+layout(set=0, binding=0) uniform MeshletFrame
+{
+  mat4 model;
+  mat4 view_proj;
+  vec4 planes[6];
+  vec4 camera_position;
+  vec4 position_offset;
+  vec4 position_scale;
+  uint meshlet_count;
+  float model_scale;
+} frame;
+
+layout(std430, set=0, binding=1) readonly buffer Meshlets { Meshlet meshlets[]; };
+layout(std430, set=0, binding=2) readonly buffer Bounds { MeshletBounds meshlet_bounds[]; };
+layout(std430, set=0, binding=3) readonly buffer MeshletVertices { uint meshlet_vertices[]; };
+layout(std430, set=0, binding=4) readonly buffer MeshletTriangles { uint meshlet_triangles[]; };
+layout(std430, set=0, binding=5) readonly buffer Vertices { uint vertex_words[]; };
+
+// VertexEncoding: 0 = float Vertex (12 words), 1 = QuantizedVertex (5 words)
+layout(constant_id=0) const uint VERTEX_ENCODING = 1;
+
+vec3 decodeOctahedral(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+  {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+void loadVertex(uint index, out vec3 position, out vec3 normal)
+{
+  if (VERTEX_ENCODING == 0)
+  {
+    uint base = index * 12;
+    position = uintBitsToFloat(uvec3(vertex_words[base], vertex_words[base + 1], vertex_words[base + 2]));
+    normal = uintBitsToFloat(uvec3(vertex_words[base + 3], vertex_words[base + 4], vertex_words[base + 5]));
+  }
+  else
+  {
+    uint base = index * 5;
+    vec2 xy = unpackUnorm2x16(vertex_words[base]);
+    vec2 zw = unpackUnorm2x16(vertex_words[base + 1]);
+    position = frame.position_offset.xyz + vec3(xy, zw.x) * frame.position_scale.xyz;
+    normal = decodeOctahedral(unpackSnorm2x16(vertex_words[base + 2]));
+  }
+}
+
+// Frustum test of the bounding sphere, then the backface cone; assumes a uniformly scaled model
+bool isMeshletVisible(uint index)
+{
+  MeshletBounds bounds = meshlet_bounds[index];
+
+  vec3 center = (frame.model * vec4(bounds.sphere.xyz, 1.0)).xyz;
+  float radius = bounds.sphere.w * frame.model_scale;
+
+  for (int i = 0; i < 6; i++)
+  {
+    if (dot(frame.planes[i].xyz, center) + frame.planes[i].w < -radius)
+    {
+      return false;
+    }
+  }
+
+  vec3 apex = (frame.model * vec4(bounds.cone_apex.xyz, 1.0)).xyz;
+  vec3 axis = normalize(mat3(frame.model) * bounds.cone_axis.xyz);
+
+  return dot(normalize(apex - frame.camera_position.xyz), axis) < bounds.cone_apex.w;
+}
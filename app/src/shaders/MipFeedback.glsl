@@ -0,0 +1,23 @@
+// Sampling rate feedback for TextureStreamer. Define MIP_FEEDBACK_SET and
+// MIP_FEEDBACK_BINDING before including; bind TextureStreamer::feedbackBuffer.
+
+layout(std430, set=MIP_FEEDBACK_SET, binding=MIP_FEEDBACK_BINDING) buffer MipFeedback { uint material_rates[]; };
+
+// Records how many pixels one uv unit covers where the material is sampled
+// most finely, as 1 + log2(pixels per uv unit) in 1/16ths (0 = not sampled).
+// The streamer turns it into a mip per texture, so it needs no texture sizes.
+void writeMipFeedback(uint material, vec2 uv)
+{
+  vec2 dx = dFdx(uv);
+  vec2 dy = dFdy(uv);
+  float uv_per_pixel_sq = max(max(dot(dx, dx), dot(dy, dy)), 1e-20);
+
+  float log2_pixels_per_uv = -0.5 * log2(uv_per_pixel_sq);
+  uint rate = 1u + uint(clamp(log2_pixels_per_uv, 0.0, 255.0) * 16.0);
+
+  // Most fragments of a material agree, skip the atomic when it would not win
+  if (material_rates[material] < rate)
+  {
+    atomicMax(material_rates[material], rate);
+  }
+}
@@ -0,0 +1,32 @@
+#version 450
+
+struct CullObject
+{
+  vec4 sphere;
+  uint index_count;
+  uint first_index;
+  int vertex_offset;
+  uint padding;
+};
+
+layout(std430, set=0, binding=0) readonly buffer Objects { CullObject objects[]; };
+
+layout(push_constant) uniform Camera { mat4 view_proj; };
+
+layout(location=0) out vec3 fragColor;
+
+// Draws the largest cube inside each bounding sphere. The indices are the
+// cube corners: bit 0 = x, bit 1 = y, bit 2 = z.
+void main()
+{
+  CullObject object = objects[gl_InstanceIndex];
+
+  vec3 corner = vec3(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1, (gl_VertexIndex >> 2) & 1) * 2.0 - 1.0;
+  float half_extent = object.sphere.w * 0.57735;
+
+  gl_Position = view_proj * vec4(object.sphere.xyz + corner * half_extent, 1.0);
+
+  uint hash = uint(gl_InstanceIndex) * 2654435761u;
+  vec3 base = vec3(hash & 255u, (hash >> 8) & 255u, (hash >> 16) & 255u) / 255.0;
+  fragColor = base * (0.6 + 0.4 * (corner.y * 0.5 + 0.5));
+}
@@ -0,0 +1,16 @@
+#version 450
+
+layout(location=0) in vec3 inPosition;
+layout(location=1) in vec4 inColor;
+
+layout(push_constant) uniform Camera { mat4 view_proj; };
+
+layout(location=0) out vec3 fragColor;
+
+// Fixed function baseline for PointBenchmark
+void main()
+{
+  gl_Position = view_proj * vec4(inPosition, 1.0);
+  gl_PointSize = 1.0;
+  fragColor = inColor.rgb;
+}
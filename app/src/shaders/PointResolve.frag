@@ -0,0 +1,25 @@
+#version 450
+
+// Read as two 32-bit halves, the resolve needs no 64-bit support: x = color, y = depth
+layout(std430, set=0, binding=1) readonly buffer Pixels { uvec2 pixels[]; };
+
+layout(push_constant) uniform Raster
+{
+  layout(offset=64) uvec2 size;
+};
+
+layout(location=0) out vec4 outColor;
+
+void main()
+{
+  uvec2 value = pixels[uint(gl_FragCoord.y) * size.x + uint(gl_FragCoord.x)];
+
+  // Still cleared, no point landed here
+  if (value.y == 0xFFFFFFFFu)
+  {
+    discard;
+  }
+
+  outColor = unpackUnorm4x8(value.x);
+  gl_FragDepth = uintBitsToFloat(value.y);
+}
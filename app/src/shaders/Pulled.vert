@@ -0,0 +1,14 @@
+#version 450
+
+#include "VertexPulling.glsl"
+
+layout(location=0) out vec3 fragColor;
+
+// One pipeline for every mesh in the pool, whatever its encoding
+void main()
+{
+  PulledVertex vertex = pullVertex(gl_VertexIndex);
+
+  gl_Position = pulled.transform * vec4(vertex.position, 1.0);
+  fragColor = vertex.normal * 0.5 + 0.5;
+}
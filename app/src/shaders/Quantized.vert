@@ -0,0 +1,34 @@
+#version 450
+
+layout(location=0) in vec4 inPosition; // unorm16, w = tangent sign
+layout(location=1) in vec2 inNormal;   // octahedral snorm16
+layout(location=2) in vec2 inTangent;  // octahedral snorm16
+layout(location=3) in vec2 inUV;       // half
+
+layout(push_constant) uniform PushConstants
+{
+  mat4 mvp;
+  vec4 position_offset;
+  vec4 position_scale;
+} pc;
+
+layout(location=0) out vec3 fragColor;
+
+vec3 decodeOctahedral(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+  {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+void main()
+{
+  vec3 position = pc.position_offset.xyz + inPosition.xyz * pc.position_scale.xyz;
+  vec3 normal = decodeOctahedral(inNormal);
+
+  gl_Position = pc.mvp * vec4(position, 1.0);
+  fragColor = normal * 0.5 + 0.5;
+}
@@ -0,0 +1,19 @@
+// Sampling of textures placed by packTextures (TextureAtlas.hpp). A placement's
+// rect is vec4(uv_offset, uv_scale).
+
+// Non-repeating atlas entries: UVs already remapped by remapUvs sample directly.
+// Repeating ones wrap inside their rect; gradients come from the unwrapped UVs
+// so the seam picks the same mip as its neighbours. Keep the sampler's LOD
+// clamp at the page's mip count.
+vec4 sampleAtlas(sampler2D atlas, vec2 uv, vec4 rect)
+{
+  vec2 dx = dFdx(uv) * rect.zw;
+  vec2 dy = dFdy(uv) * rect.zw;
+  return textureGrad(atlas, rect.xy + fract(uv) * rect.zw, dx, dy);
+}
+
+// Array entries keep their UVs and pick a layer
+vec4 sampleLayer(sampler2DArray textures, vec2 uv, uint layer)
+{
+  return texture(textures, vec3(uv, float(layer)));
+}
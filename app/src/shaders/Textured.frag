@@ -0,0 +1,18 @@
+#version 450
+
+#define MIP_FEEDBACK_SET 0
+#define MIP_FEEDBACK_BINDING 1
+#include "MipFeedback.glsl"
+
+layout(set=0, binding=0) uniform sampler2D albedo;
+
+layout(location=0) in vec2 fragUV;
+layout(location=1) flat in uint fragMaterial;
+
+layout(location=0) out vec4 outColor;
+
+void main()
+{
+  writeMipFeedback(fragMaterial, fragUV);
+  outColor = texture(albedo, fragUV);
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout(push_constant) uniform Quad
+{
+  vec4 rect; // x0, y0, x1, y1 in normalized device coordinates
+  uint material;
+} quad;
+
+layout(location=0) out vec2 fragUV;
+layout(location=1) flat out uint fragMaterial;
+
+// A screen-aligned rectangle drawn as a 4 vertex strip, uv 0..1 across it
+void main()
+{
+  vec2 uv = vec2(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1);
+  gl_Position = vec4(mix(quad.rect.xy, quad.rect.zw, uv), 0.0, 1.0);
+  fragUV = uv;
+  fragMaterial = quad.material;
+}
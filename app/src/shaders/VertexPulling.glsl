@@ -0,0 +1,64 @@
+// Vertex pulling through buffer device addresses. Matches MeshPool and PulledDrawConstants.
+#extension GL_EXT_buffer_reference : require
+
+layout(buffer_reference, std430, buffer_reference_align=4) readonly buffer VertexWords { uint words[]; };
+
+// VertexEncoding: 0 = float Vertex (12 words), 1 = QuantizedVertex (5 words)
+layout(std430, push_constant) uniform PulledDraw
+{
+  mat4 transform;
+  VertexWords vertices;
+  uint encoding;
+  uint padding;
+  vec4 position_offset;
+  vec4 position_scale;
+} pulled;
+
+struct PulledVertex
+{
+  vec3 position;
+  vec3 normal;
+  vec4 tangent; // w = bitangent sign
+  vec2 uv;
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+  {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+// The encoding is uniform across a draw, so the branch costs no divergence
+PulledVertex pullVertex(uint index)
+{
+  PulledVertex vertex;
+
+  if (pulled.encoding == 0)
+  {
+    uint base = index * 12;
+    VertexWords v = pulled.vertices;
+
+    vertex.position = uintBitsToFloat(uvec3(v.words[base], v.words[base + 1], v.words[base + 2]));
+    vertex.normal = uintBitsToFloat(uvec3(v.words[base + 3], v.words[base + 4], v.words[base + 5]));
+    vertex.tangent = uintBitsToFloat(uvec4(v.words[base + 6], v.words[base + 7], v.words[base + 8], v.words[base + 9]));
+    vertex.uv = uintBitsToFloat(uvec2(v.words[base + 10], v.words[base + 11]));
+  }
+  else
+  {
+    uint base = index * 5;
+    VertexWords v = pulled.vertices;
+    vec2 xy = unpackUnorm2x16(v.words[base]);
+    vec2 zw = unpackUnorm2x16(v.words[base + 1]);
+
+    vertex.position = pulled.position_offset.xyz + vec3(xy, zw.x) * pulled.position_scale.xyz;
+    vertex.normal = decodeOctahedral(unpackSnorm2x16(v.words[base + 2]));
+    vertex.tangent = vec4(decodeOctahedral(unpackSnorm2x16(v.words[base + 3])), zw.y * 2.0 - 1.0);
+    vertex.uv = unpackHalf2x16(v.words[base + 4]);
+  }
+
+  return vertex;
+}
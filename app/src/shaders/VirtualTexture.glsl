@@ -0,0 +1,88 @@
+// Virtual texture sampling for VirtualTexture. Define VIRTUAL_TEXTURE_SET and
+// VIRTUAL_TEXTURE_BINDING (the first of four) before including, and bind
+// infoBuffer, pageTableView, cacheView and feedbackBuffer there in that order.
+// Requesting tiles needs the fragmentStoresAndAtomics feature.
+
+layout(std140, set=VIRTUAL_TEXTURE_SET, binding=VIRTUAL_TEXTURE_BINDING) uniform VirtualTextureInfo
+{
+  uvec4 size;       // virtual width, height, tile width, tile height
+  uvec4 config;     // page levels, 1 when sampling the sparse image, tile border
+  uvec4 cache;      // cache width, height, slot width, slot height
+  uvec4 levels[16]; // tiles x, tiles y, first feedback bit
+} virtual_texture;
+
+// Per tile: slot x, slot y, level of the finest resident tile covering it
+layout(set=VIRTUAL_TEXTURE_SET, binding=VIRTUAL_TEXTURE_BINDING + 1) uniform usampler2D virtual_page_table;
+layout(set=VIRTUAL_TEXTURE_SET, binding=VIRTUAL_TEXTURE_BINDING + 2) uniform sampler2D virtual_cache;
+layout(std430, set=VIRTUAL_TEXTURE_SET, binding=VIRTUAL_TEXTURE_BINDING + 3) buffer VirtualTextureFeedback { uint virtual_requests[]; };
+
+float virtualLod(vec2 uv)
+{
+  vec2 texels = vec2(virtual_texture.size.xy);
+  vec2 dx = dFdx(uv) * texels;
+  vec2 dy = dFdy(uv) * texels;
+  return 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-20));
+}
+
+uvec2 virtualTile(vec2 uv, uint level)
+{
+  uvec2 level_size = max(virtual_texture.size.xy >> level, uvec2(1));
+  uvec2 texel = min(uvec2(uv * vec2(level_size)), level_size - 1u);
+  return texel / virtual_texture.size.zw;
+}
+
+void requestVirtualTile(vec2 uv, uint level)
+{
+  uvec4 page_level = virtual_texture.levels[level];
+  uvec2 tile = virtualTile(uv, level);
+  uint bit = page_level.z + tile.y * page_level.x + tile.x;
+  uint mask = 1u << (bit & 31u);
+
+  // Most fragments of a tile agree, skip the atomic when the bit is already set
+  if ((virtual_requests[bit >> 5] & mask) == 0u)
+  {
+    atomicOr(virtual_requests[bit >> 5], mask);
+  }
+}
+
+// Bilinear sample of a page level from the software cache. A missing tile's
+// entry points at a resident ancestor, which is sampled at its own level.
+vec4 sampleVirtualLevel(vec2 uv, uint level)
+{
+  uvec4 entry = texelFetch(virtual_page_table, ivec2(virtualTile(uv, level)), int(level));
+  uint resident = entry.z;
+
+  vec2 tile_size = vec2(virtual_texture.size.zw);
+  vec2 texel = uv * vec2(max(virtual_texture.size.xy >> resident, uvec2(1)));
+  vec2 in_tile = texel - vec2(virtualTile(uv, resident)) * tile_size;
+  vec2 cache_texel = vec2(entry.xy * virtual_texture.cache.zw + virtual_texture.config.z) + in_tile;
+
+  return textureLod(virtual_cache, cache_texel / vec2(virtual_texture.cache.xy), 0.0);
+}
+
+vec4 sampleVirtual(vec2 uv)
+{
+  uv = clamp(uv, 0.0, 1.0);
+  float lod = virtualLod(uv);
+  uint last_level = virtual_texture.config.x - 1u;
+  uint level = uint(clamp(lod, 0.0, float(last_level)));
+
+  requestVirtualTile(uv, level);
+
+  // Sparse: the image holds every level where it is resident, clamp the LOD to it
+  if (virtual_texture.config.y != 0u)
+  {
+    uint resident = texelFetch(virtual_page_table, ivec2(virtualTile(uv, level)), int(level)).z;
+    return textureLod(virtual_cache, uv, max(lod, float(resident)));
+  }
+
+  // The cache has one level, blend two page levels by hand
+  vec4 fine = sampleVirtualLevel(uv, level);
+  if (level == last_level)
+  {
+    return fine;
+  }
+
+  vec4 coarse = sampleVirtualLevel(uv, level + 1u);
+  return mix(fine, coarse, clamp(lod - float(level), 0.0, 1.0));
+}
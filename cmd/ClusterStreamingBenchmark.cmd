@@ -0,0 +1,29 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\vkHelpers.o bin\stagingUploader.o bin\mappedFile.o bin\vertexQuantization.o bin\meshCache.o bin\gpuMesh.o bin\frustumCulling.o bin\lodSelector.o bin\jobSystem.o bin\clusterPages.o bin\clusterStreamer.o bin\clusterStreamingBenchmark.o
+
+echo "clean"
+del build\ClusterStreamingBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexQuantization.cpp -o bin\vertexQuantization.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -O2 -g
+g++ %includes% %defines% -c app\src\GpuMesh.cpp -o bin\gpuMesh.o -O2 -g
+g++ %includes% %defines% -c app\src\FrustumCulling.cpp -o bin\frustumCulling.o -O2 -g
+g++ %includes% %defines% -c app\src\LodSelector.cpp -o bin\lodSelector.o -O2 -g
+g++ %includes% %defines% -c app\src\JobSystem.cpp -o bin\jobSystem.o -O2 -g
+g++ %includes% %defines% -c app\src\ClusterPages.cpp -o bin\clusterPages.o -O2 -g
+g++ %includes% %defines% -c app\src\ClusterStreamer.cpp -o bin\clusterStreamer.o -O2 -g
+g++ %includes% %defines% -c app\src\ClusterStreamingBenchmark.cpp -o bin\clusterStreamingBenchmark.o -O2 -g
+
+echo "build"
+g++ %objects% %links% -o build\ClusterStreamingBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,18 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+SET arch=-mavx2 -mfma
+
+echo "clean"
+del build\CullingBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% %arch% -c app\src\FrustumCulling.cpp -o bin\frustumCulling.o -O2 -g
+g++ %includes% %defines% %arch% -c app\src\CullingBenchmark.cpp -o bin\cullingBenchmark.o -O2 -g
+
+echo "build"
+g++ bin\frustumCulling.o bin\cullingBenchmark.o -o build\CullingBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
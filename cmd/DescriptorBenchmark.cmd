@@ -0,0 +1,24 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\DescriptorBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\DescriptorAllocator.cpp -o bin\descriptorAllocator.o -O2 -g
+g++ %includes% %defines% -c app\src\BindlessHeap.cpp -o bin\bindlessHeap.o -O2 -g
+g++ %includes% %defines% -c app\src\DescriptorBenchmark.cpp -o bin\descriptorBenchmark.o -O2 -g
+
+echo "compile shaders"
+glslc app\src\shaders\BindlessQuad.vert -o build\bindless_quad_vert.spv
+glslc app\src\shaders\Bindless.frag -o build\bindless_frag.spv
+
+echo "build"
+g++ bin\vkHelpers.o bin\descriptorAllocator.o bin\bindlessHeap.o bin\descriptorBenchmark.o %links% -o build\DescriptorBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -1,22 +1,72 @@
 @echo off
 
 SET includes=-Iapp\inc -Ilib\GLFW -Ilib\glm -Ilib\Vulkan\Include
-SET links= -Llib\Vulkan\Lib -Llib\GLFW -lvulkan-1 -l:libglfw3.a -lgdi32
-SET defines=
+SET links= -Llib\Vulkan\Lib -Llib\GLFW -lvulkan-1 -l:libglfw3.a -lgdi32 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\helloTriangle.o bin\vkHelpers.o bin\descriptorAllocator.o bin\pipelineLayoutBuilder.o bin\spirvReflection.o bin\uniformRing.o bin\bindlessHeap.o bin\stagingUploader.o bin\mappedFile.o bin\mesh.o bin\vertexQuantization.o bin\meshCache.o bin\gpuMesh.o bin\vertexPulling.o bin\lodSelector.o bin\jobSystem.o bin\transformStore.o bin\drawList.o bin\frustumCulling.o bin\meshletRenderer.o bin\hiZPyramid.o bin\occlusionCuller.o bin\clusterPages.o bin\clusterStreamer.o bin\pointRasterizer.o bin\imageFile.o bin\textureLoader.o bin\textureStreamer.o bin\blockCompression.o bin\textureFile.o bin\mipGenerator.o bin\textureAtlas.o bin\packedTextureSet.o bin\virtualTexture.o
 
 echo "clean"
 del build\HelloTriangle.exe
 del build\*.spv /Q /F
 
 echo "compile"
-g++ %includes% -c app\src\HelloTriangle.cpp -o bin\helloTriangle.o -g
+g++ %includes% %defines% -c app\src\HelloTriangle.cpp -o bin\helloTriangle.o -g
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -g
+g++ %includes% %defines% -c app\src\DescriptorAllocator.cpp -o bin\descriptorAllocator.o -g
+g++ %includes% %defines% -c app\src\PipelineLayoutBuilder.cpp -o bin\pipelineLayoutBuilder.o -g
+g++ %includes% %defines% -c app\src\SpirvReflection.cpp -o bin\spirvReflection.o -g
+g++ %includes% %defines% -c app\src\UniformRing.cpp -o bin\uniformRing.o -g
+g++ %includes% %defines% -c app\src\BindlessHeap.cpp -o bin\bindlessHeap.o -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -g
+g++ %includes% %defines% -c app\src\Mesh.cpp -o bin\mesh.o -g
+g++ %includes% %defines% -c app\src\VertexQuantization.cpp -o bin\vertexQuantization.o -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -g
+g++ %includes% %defines% -c app\src\GpuMesh.cpp -o bin\gpuMesh.o -g
+g++ %includes% %defines% -c app\src\VertexPulling.cpp -o bin\vertexPulling.o -g
+g++ %includes% %defines% -c app\src\LodSelector.cpp -o bin\lodSelector.o -g
+g++ %includes% %defines% -c app\src\JobSystem.cpp -o bin\jobSystem.o -g
+g++ %includes% %defines% -c app\src\TransformStore.cpp -o bin\transformStore.o -g
+g++ %includes% %defines% -c app\src\DrawList.cpp -o bin\drawList.o -g
+g++ %includes% %defines% -c app\src\FrustumCulling.cpp -o bin\frustumCulling.o -g
+g++ %includes% %defines% -c app\src\MeshletRenderer.cpp -o bin\meshletRenderer.o -g
+g++ %includes% %defines% -c app\src\HiZPyramid.cpp -o bin\hiZPyramid.o -g
+g++ %includes% %defines% -c app\src\OcclusionCuller.cpp -o bin\occlusionCuller.o -g
+g++ %includes% %defines% -c app\src\ClusterPages.cpp -o bin\clusterPages.o -g
+g++ %includes% %defines% -c app\src\ClusterStreamer.cpp -o bin\clusterStreamer.o -g
+g++ %includes% %defines% -c app\src\PointRasterizer.cpp -o bin\pointRasterizer.o -g
+g++ %includes% %defines% -c app\src\ImageFile.cpp -o bin\imageFile.o -g
+g++ %includes% %defines% -c app\src\TextureLoader.cpp -o bin\textureLoader.o -g
+g++ %includes% %defines% -c app\src\TextureStreamer.cpp -o bin\textureStreamer.o -g
+g++ %includes% %defines% -c app\src\BlockCompression.cpp -o bin\blockCompression.o -g
+g++ %includes% %defines% -c app\src\TextureFile.cpp -o bin\textureFile.o -g
+g++ %includes% %defines% -c app\src\MipGenerator.cpp -o bin\mipGenerator.o -g
+g++ %includes% %defines% -c app\src\TextureAtlas.cpp -o bin\textureAtlas.o -g
+g++ %includes% %defines% -c app\src\PackedTextureSet.cpp -o bin\packedTextureSet.o -g
+g++ %includes% %defines% -c app\src\VirtualTexture.cpp -o bin\virtualTexture.o -g
 
 echo "compile shaders"
 glslc app\src\shaders\Base.vert -o build\vert.spv
 glslc app\src\shaders\base.frag -o build\frag.spv
+glslc app\src\shaders\Quantized.vert -o build\quantized_vert.spv
+glslc app\src\shaders\Object.vert -o build\object_vert.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Pulled.vert -o build\pulled_vert.spv
+glslc app\src\shaders\HiZBuild.comp -o build\hiz_build.spv
+glslc app\src\shaders\OcclusionCull.comp -o build\occlusion_cull.spv
+glslc app\src\shaders\Meshlet.vert -o build\meshlet_vert.spv
+glslc app\src\shaders\MeshletCull.comp -o build\meshlet_cull.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Meshlet.task -o build\meshlet_task.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Meshlet.mesh -o build\meshlet_mesh.spv
+glslc --target-env=vulkan1.2 app\src\shaders\PointRaster.comp -o build\point_raster.spv
+glslc app\src\shaders\PointResolve.vert -o build\point_resolve_vert.spv
+glslc app\src\shaders\PointResolve.frag -o build\point_resolve_frag.spv
+glslc app\src\shaders\Textured.frag -o build\textured_frag.spv
+glslc app\src\shaders\Bindless.frag -o build\bindless_frag.spv
+glslc app\src\shaders\MipDownsample.comp -o build\mip_downsample.spv
+glslc --target-env=vulkan1.1 -DSUBGROUP_QUADS app\src\shaders\MipDownsample.comp -o build\mip_downsample_quad.spv
 
 echo "build"
-g++ bin\helloTriangle.o %links% -o build\HelloTriangle.exe -g
+g++ %objects% %links% -o build\HelloTriangle.exe -g
 
 echo "obj-clean"
-del bin\*.o /Q /F
\ No newline at end of file
+del bin\*.o /Q /F
@@ -0,0 +1,19 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\LodBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -O2 -g
+g++ %includes% %defines% -c app\src\LodSelector.cpp -o bin\lodSelector.o -O2 -g
+g++ %includes% %defines% -c app\src\LodBenchmark.cpp -o bin\lodBenchmark.o -O2 -g
+
+echo "build"
+g++ bin\mappedFile.o bin\meshCache.o bin\lodSelector.o bin\lodBenchmark.o -o build\LodBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,24 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\MeshConverter.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\Mesh.cpp -o bin\mesh.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshOptimizer.cpp -o bin\meshOptimizer.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshSimplifier.cpp -o bin\meshSimplifier.o -O2 -g
+g++ %includes% %defines% -c app\src\Meshlets.cpp -o bin\meshlets.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexQuantization.cpp -o bin\vertexQuantization.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -O2 -g
+g++ %includes% %defines% -c app\src\ClusterPages.cpp -o bin\clusterPages.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshConverter.cpp -o bin\meshConverter.o -O2 -g
+
+echo "build"
+g++ bin\mesh.o bin\mappedFile.o bin\meshOptimizer.o bin\meshSimplifier.o bin\meshlets.o bin\vertexQuantization.o bin\meshCache.o bin\clusterPages.o bin\meshConverter.o -o build\MeshConverter.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
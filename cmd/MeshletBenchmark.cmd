@@ -0,0 +1,34 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\vkHelpers.o bin\spirvReflection.o bin\stagingUploader.o bin\mappedFile.o bin\vertexQuantization.o bin\meshCache.o bin\gpuMesh.o bin\frustumCulling.o bin\meshletRenderer.o bin\meshletBenchmark.o
+
+echo "clean"
+del build\MeshletBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\SpirvReflection.cpp -o bin\spirvReflection.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexQuantization.cpp -o bin\vertexQuantization.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -O2 -g
+g++ %includes% %defines% -c app\src\GpuMesh.cpp -o bin\gpuMesh.o -O2 -g
+g++ %includes% %defines% -c app\src\FrustumCulling.cpp -o bin\frustumCulling.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshletRenderer.cpp -o bin\meshletRenderer.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshletBenchmark.cpp -o bin\meshletBenchmark.o -O2 -g
+
+echo "compile shaders"
+glslc app\src\shaders\base.frag -o build\frag.spv
+glslc app\src\shaders\Meshlet.vert -o build\meshlet_vert.spv
+glslc app\src\shaders\MeshletCull.comp -o build\meshlet_cull.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Meshlet.task -o build\meshlet_task.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Meshlet.mesh -o build\meshlet_mesh.spv
+
+echo "build"
+g++ %objects% %links% -o build\MeshletBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,20 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+SET arch=-mavx2 -mfma
+
+echo "clean"
+del build\OcclusionBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% %arch% -c app\src\FrustumCulling.cpp -o bin\frustumCulling.o -O2 -g
+g++ %includes% %defines% %arch% -c app\src\JobSystem.cpp -o bin\jobSystem.o -O2 -g
+g++ %includes% %defines% %arch% -c app\src\SoftwareOcclusion.cpp -o bin\softwareOcclusion.o -O2 -g
+g++ %includes% %defines% %arch% -c app\src\OcclusionBenchmark.cpp -o bin\occlusionBenchmark.o -O2 -g
+
+echo "build"
+g++ bin\frustumCulling.o bin\jobSystem.o bin\softwareOcclusion.o bin\occlusionBenchmark.o -o build\OcclusionBenchmark.exe -g -pthread
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,27 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\PointBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\PointRasterizer.cpp -o bin\pointRasterizer.o -O2 -g
+g++ %includes% %defines% -c app\src\PointBenchmark.cpp -o bin\pointBenchmark.o -O2 -g
+
+echo "compile shaders"
+glslc app\src\shaders\base.frag -o build\frag.spv
+glslc app\src\shaders\PointList.vert -o build\point_list_vert.spv
+glslc --target-env=vulkan1.2 app\src\shaders\PointRaster.comp -o build\point_raster.spv
+glslc app\src\shaders\PointResolve.vert -o build\point_resolve_vert.spv
+glslc app\src\shaders\PointResolve.frag -o build\point_resolve_frag.spv
+
+echo "build"
+g++ bin\vkHelpers.o bin\stagingUploader.o bin\pointRasterizer.o bin\pointBenchmark.o %links% -o build\PointBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,20 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\TextureConverter.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\ImageFile.cpp -o bin\imageFile.o -O2 -g
+g++ %includes% %defines% -c app\src\BlockCompression.cpp -o bin\blockCompression.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureFile.cpp -o bin\textureFile.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureConverter.cpp -o bin\textureConverter.o -O2 -g
+
+echo "build"
+g++ bin\mappedFile.o bin\imageFile.o bin\blockCompression.o bin\textureFile.o bin\textureConverter.o -o build\TextureConverter.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
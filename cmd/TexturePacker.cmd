@@ -0,0 +1,21 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\TexturePacker.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\ImageFile.cpp -o bin\imageFile.o -O2 -g
+g++ %includes% %defines% -c app\src\BlockCompression.cpp -o bin\blockCompression.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureFile.cpp -o bin\textureFile.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureAtlas.cpp -o bin\textureAtlas.o -O2 -g
+g++ %includes% %defines% -c app\src\TexturePacker.cpp -o bin\texturePacker.o -O2 -g
+
+echo "build"
+g++ bin\mappedFile.o bin\imageFile.o bin\blockCompression.o bin\textureFile.o bin\textureAtlas.o bin\texturePacker.o -o build\TexturePacker.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,29 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\vkHelpers.o bin\stagingUploader.o bin\mappedFile.o bin\jobSystem.o bin\imageFile.o bin\descriptorAllocator.o bin\textureStreamer.o bin\textureStreamingBenchmark.o
+
+echo "clean"
+del build\TextureStreamingBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\JobSystem.cpp -o bin\jobSystem.o -O2 -g
+g++ %includes% %defines% -c app\src\ImageFile.cpp -o bin\imageFile.o -O2 -g
+g++ %includes% %defines% -c app\src\DescriptorAllocator.cpp -o bin\descriptorAllocator.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureStreamer.cpp -o bin\textureStreamer.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureStreamingBenchmark.cpp -o bin\textureStreamingBenchmark.o -O2 -g
+
+echo "compile shaders"
+glslc app\src\shaders\TexturedQuad.vert -o build\textured_quad_vert.spv
+glslc app\src\shaders\Textured.frag -o build\textured_frag.spv
+
+echo "build"
+g++ %objects% %links% -o build\TextureStreamingBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
@@ -0,0 +1,18 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm
+SET defines=-DGLM_FORCE_INTRINSICS
+
+echo "clean"
+del build\TransformBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\JobSystem.cpp -o bin\jobSystem.o -O2 -g
+g++ %includes% %defines% -c app\src\TransformStore.cpp -o bin\transformStore.o -O2 -g
+g++ %includes% %defines% -c app\src\TransformBenchmark.cpp -o bin\transformBenchmark.o -O2 -g
+
+echo "build"
+g++ bin\jobSystem.o bin\transformStore.o bin\transformBenchmark.o -o build\TransformBenchmark.exe -g -pthread
+
+echo "obj-clean"
+del bin\*.o /Q /F
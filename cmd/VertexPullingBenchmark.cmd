@@ -0,0 +1,31 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\vkHelpers.o bin\descriptorAllocator.o bin\pipelineLayoutBuilder.o bin\spirvReflection.o bin\stagingUploader.o bin\mappedFile.o bin\vertexQuantization.o bin\meshCache.o bin\vertexPulling.o bin\vertexPullingBenchmark.o
+
+echo "clean"
+del build\VertexPullingBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\DescriptorAllocator.cpp -o bin\descriptorAllocator.o -O2 -g
+g++ %includes% %defines% -c app\src\PipelineLayoutBuilder.cpp -o bin\pipelineLayoutBuilder.o -O2 -g
+g++ %includes% %defines% -c app\src\SpirvReflection.cpp -o bin\spirvReflection.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexQuantization.cpp -o bin\vertexQuantization.o -O2 -g
+g++ %includes% %defines% -c app\src\MeshCache.cpp -o bin\meshCache.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexPulling.cpp -o bin\vertexPulling.o -O2 -g
+g++ %includes% %defines% -c app\src\VertexPullingBenchmark.cpp -o bin\vertexPullingBenchmark.o -O2 -g
+
+echo "compile shaders"
+glslc app\src\shaders\base.frag -o build\frag.spv
+glslc --target-env=vulkan1.2 app\src\shaders\Pulled.vert -o build\pulled_vert.spv
+
+echo "build"
+g++ %objects% %links% -o build\VertexPullingBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F
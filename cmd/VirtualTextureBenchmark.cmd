@@ -0,0 +1,29 @@
+@echo off
+
+SET includes=-Iapp\inc -Ilib\glm -Ilib\Vulkan\Include
+SET links= -Llib\Vulkan\Lib -lvulkan-1 -pthread
+SET defines=-DGLM_FORCE_INTRINSICS
+SET objects=bin\vkHelpers.o bin\spirvReflection.o bin\stagingUploader.o bin\mappedFile.o bin\jobSystem.o bin\imageFile.o bin\blockCompression.o bin\textureFile.o bin\mipGenerator.o bin\textureLoader.o bin\virtualTexture.o bin\virtualTextureBenchmark.o
+
+echo "clean"
+del build\VirtualTextureBenchmark.exe
+
+echo "compile"
+g++ %includes% %defines% -c app\src\VkHelpers.cpp -o bin\vkHelpers.o -O2 -g
+g++ %includes% %defines% -c app\src\SpirvReflection.cpp -o bin\spirvReflection.o -O2 -g
+g++ %includes% %defines% -c app\src\StagingUploader.cpp -o bin\stagingUploader.o -O2 -g
+g++ %includes% %defines% -c app\src\MappedFile.cpp -o bin\mappedFile.o -O2 -g
+g++ %includes% %defines% -c app\src\JobSystem.cpp -o bin\jobSystem.o -O2 -g
+g++ %includes% %defines% -c app\src\ImageFile.cpp -o bin\imageFile.o -O2 -g
+g++ %includes% %defines% -c app\src\BlockCompression.cpp -o bin\blockCompression.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureFile.cpp -o bin\textureFile.o -O2 -g
+g++ %includes% %defines% -c app\src\MipGenerator.cpp -o bin\mipGenerator.o -O2 -g
+g++ %includes% %defines% -c app\src\TextureLoader.cpp -o bin\textureLoader.o -O2 -g
+g++ %includes% %defines% -c app\src\VirtualTexture.cpp -o bin\virtualTexture.o -O2 -g
+g++ %includes% %defines% -c app\src\VirtualTextureBenchmark.cpp -o bin\virtualTextureBenchmark.o -O2 -g
+
+echo "build"
+g++ %objects% %links% -o build\VirtualTextureBenchmark.exe -g
+
+echo "obj-clean"
+del bin\*.o /Q /F